@@ -0,0 +1,294 @@
+112681287 OP_GET_LOCAL OP_GET_LOCAL
+31071923 OP_POP OP_GET_LOCAL
+30805460 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL
+30388609 OP_GET_LOCAL OP_GET
+25793341 OP_GET_LOCAL OP_CONSTANT
+24688591 OP_GET_LOCAL OP_GET_LOCAL OP_GET
+20353907 OP_SET OP_POP
+19726470 OP_CONSTANT OP_ADD
+19476412 OP_GET_LOCAL OP_CONSTANT OP_ADD
+18353907 OP_SET OP_POP OP_GET_LOCAL
+18013095 OP_SET_LOCAL OP_POP
+17912418 OP_GET_GLOBAL OP_GET_LOCAL
+17018286 OP_POP OP_GET_LOCAL OP_GET_LOCAL
+15169068 OP_GET OP_GET_LOCAL
+15169068 OP_GET OP_GET_LOCAL OP_GET_LOCAL
+15027508 OP_GET_LOCAL OP_GET OP_GET_LOCAL
+15027508 OP_GET_LOCAL OP_GET OP_GET_LOCAL OP_GET_LOCAL
+13860157 OP_ADD OP_SET_LOCAL
+13860157 OP_ADD OP_SET_LOCAL OP_POP
+13853634 OP_POP OP_GET_LOCAL OP_CONSTANT
+13027508 OP_GET_LOCAL OP_GET_LOCAL OP_GET OP_GET_LOCAL
+12068671 OP_GET_LOCAL OP_LESS_EQUAL
+12068671 OP_GET_LOCAL OP_GET_LOCAL OP_LESS_EQUAL
+11084949 OP_CONSTANT OP_ADD OP_SET_LOCAL
+11084949 OP_CONSTANT OP_ADD OP_SET_LOCAL OP_POP
+11084949 OP_GET_LOCAL OP_CONSTANT OP_ADD OP_SET_LOCAL
+10933155 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL
+10474583 OP_GET_LOCAL OP_GET_LOCAL OP_CONSTANT
+10432549 OP_LESS_EQUAL OP_JUMP_IF_FALSE_POP
+10432549 OP_GET_LOCAL OP_LESS_EQUAL OP_JUMP_IF_FALSE_POP
+10432549 OP_GET_LOCAL OP_GET_LOCAL OP_LESS_EQUAL OP_JUMP_IF_FALSE_POP
+10228947 OP_SET OP_POP OP_GET_LOCAL OP_GET_LOCAL
+10021854 OP_POP OP_GET_LOCAL OP_CONSTANT OP_ADD
+9122667 OP_GET OP_SET
+9122667 OP_GET OP_SET OP_POP
+9122667 OP_GET OP_SET OP_POP OP_GET_LOCAL
+8835165 OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL
+8191463 OP_GET_LOCAL OP_GET_LOCAL OP_CONSTANT OP_ADD
+8124960 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL OP_GET
+8124960 OP_SET OP_POP OP_GET_LOCAL OP_CONSTANT
+8000026 OP_GET_GLOBAL OP_GET_GLOBAL
+7453739 OP_GET_LOCAL OP_SET
+7397265 OP_GET_LOCAL OP_GET_GLOBAL
+7190928 OP_GREATER OP_JUMP_IF_FALSE_POP
+6456032 OP_POP OP_JUMP
+6456032 OP_GET_LOCAL OP_GET_LOCAL OP_SET
+6456032 OP_GET_LOCAL OP_GET OP_SET
+6456032 OP_GET_LOCAL OP_SET OP_POP
+6456032 OP_SET_LOCAL OP_POP OP_JUMP
+6456032 OP_POP OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL
+6456032 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL OP_SET
+6456032 OP_GET_LOCAL OP_GET_LOCAL OP_GET OP_SET
+6456032 OP_GET_LOCAL OP_GET_LOCAL OP_SET OP_POP
+6456032 OP_GET_LOCAL OP_GET OP_SET OP_POP
+6456032 OP_GET_LOCAL OP_SET OP_POP OP_GET_LOCAL
+6408501 OP_SET_GLOBAL OP_POP
+5700018 OP_GET_GLOBAL OP_GET_LOCAL OP_GET
+5296793 OP_CONSTANT OP_SUBTRACT
+4893758 OP_ADD OP_GET
+4893758 OP_CONSTANT OP_ADD OP_GET
+4893758 OP_GET_LOCAL OP_CONSTANT OP_ADD OP_GET
+4510524 OP_GET_GLOBAL OP_CONSTANT
+4408498 OP_ADD OP_SET_GLOBAL
+4408498 OP_ADD OP_SET_GLOBAL OP_POP
+4300457 OP_SET_LOCAL OP_POP OP_GET_LOCAL
+4000000 OP_GET_LOCAL OP_MULTIPLY
+4000000 OP_GET_LOCAL OP_GET_LOCAL OP_MULTIPLY
+3896051 OP_GET OP_GREATER
+3896051 OP_ADD OP_GET OP_GREATER
+3896051 OP_GET OP_GREATER OP_JUMP_IF_FALSE_POP
+3896051 OP_CONSTANT OP_ADD OP_GET OP_GREATER
+3896051 OP_ADD OP_GET OP_GREATER OP_JUMP_IF_FALSE_POP
+3896051 OP_GET OP_GET_LOCAL OP_GET_LOCAL OP_CONSTANT
+3302750 OP_ADD OP_SET_LOCAL OP_POP OP_GET_LOCAL
+3302750 OP_ADD OP_SET_LOCAL OP_POP OP_JUMP
+3302750 OP_SET_LOCAL OP_POP OP_GET_LOCAL OP_CONSTANT
+3294877 OP_GET_LOCAL OP_GREATER
+3294877 OP_GET_LOCAL OP_GREATER OP_JUMP_IF_FALSE_POP
+3294877 OP_GET_LOCAL OP_GET_LOCAL OP_GREATER
+3294877 OP_GET_LOCAL OP_GET_LOCAL OP_GREATER OP_JUMP_IF_FALSE_POP
+3155233 OP_GET_LOCAL OP_CONSTANT OP_SUBTRACT
+3153282 OP_SUBTRACT OP_SET_LOCAL
+3153282 OP_CONSTANT OP_SUBTRACT OP_SET_LOCAL
+3153282 OP_SUBTRACT OP_SET_LOCAL OP_POP
+3153282 OP_POP OP_GET_LOCAL OP_CONSTANT OP_SUBTRACT
+3153282 OP_CONSTANT OP_SUBTRACT OP_SET_LOCAL OP_POP
+3153282 OP_SUBTRACT OP_SET_LOCAL OP_POP OP_JUMP
+3153282 OP_GET_LOCAL OP_CONSTANT OP_SUBTRACT OP_SET_LOCAL
+3139267 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL OP_CONSTANT
+3000000 OP_MOD OP_CONSTANT
+3000000 OP_GET_LOCAL OP_GET_GLOBAL OP_GET_GLOBAL
+2875207 OP_GET_LOCAL OP_ADD
+2875207 OP_GET_LOCAL OP_GET_LOCAL OP_ADD
+2800020 OP_GET_GLOBAL OP_GET_GLOBAL OP_GET_LOCAL
+2775208 OP_TRUE OP_SET
+2775208 OP_GET_LOCAL OP_TRUE
+2775208 OP_TRUE OP_SET OP_POP
+2775208 OP_GET_GLOBAL OP_GET_LOCAL OP_TRUE
+2775208 OP_GET_LOCAL OP_TRUE OP_SET
+2775208 OP_GET_LOCAL OP_ADD OP_SET_LOCAL
+2775208 OP_POP OP_GET_LOCAL OP_GET_LOCAL OP_ADD
+2775208 OP_TRUE OP_SET OP_POP OP_GET_LOCAL
+2775208 OP_GET_GLOBAL OP_GET_LOCAL OP_TRUE OP_SET
+2775208 OP_GET_LOCAL OP_TRUE OP_SET OP_POP
+2775208 OP_GET_LOCAL OP_ADD OP_SET_LOCAL OP_POP
+2775208 OP_GET_LOCAL OP_GET_LOCAL OP_ADD OP_SET_LOCAL
+2341559 OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL OP_CONSTANT
+2300000 OP_GET_GLOBAL OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL
+2200000 OP_GET_GLOBAL OP_GET_GLOBAL OP_GET_GLOBAL
+2200000 OP_GET_GLOBAL OP_GET_GLOBAL OP_GET_GLOBAL OP_GET_LOCAL
+2178497 OP_CONSTANT OP_MULTIPLY
+2100000 OP_GET OP_ADD
+2100000 OP_GET OP_ADD OP_SET_GLOBAL
+2100000 OP_GET OP_ADD OP_SET_GLOBAL OP_POP
+2078498 OP_MULTIPLY OP_GET_LOCAL
+2078498 OP_GET_LOCAL OP_CONSTANT OP_MULTIPLY
+2052047 OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL
+2000001 OP_POP OP_NIL
+2000000 OP_MULTIPLY OP_ADD
+2000000 OP_MULTIPLY OP_SET
+2000000 OP_CONSTANT OP_MULTIPLY OP_SET
+2000000 OP_MULTIPLY OP_GET_LOCAL OP_GET_LOCAL
+2000000 OP_MULTIPLY OP_SET OP_POP
+2000000 OP_GET_LOCAL OP_MULTIPLY OP_ADD
+2000000 OP_GET_LOCAL OP_MULTIPLY OP_GET_LOCAL
+2000000 OP_GET_LOCAL OP_GET OP_ADD
+2000000 OP_CONSTANT OP_MULTIPLY OP_SET OP_POP
+2000000 OP_MULTIPLY OP_GET_LOCAL OP_GET_LOCAL OP_MULTIPLY
+2000000 OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL OP_MULTIPLY
+2000000 OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL OP_GET
+2000000 OP_GET_GLOBAL OP_GET_LOCAL OP_GET OP_GET_LOCAL
+2000000 OP_GET_LOCAL OP_CONSTANT OP_MULTIPLY OP_SET
+2000000 OP_GET_LOCAL OP_MULTIPLY OP_GET_LOCAL OP_GET_LOCAL
+2000000 OP_GET_LOCAL OP_GET_LOCAL OP_CONSTANT OP_MULTIPLY
+2000000 OP_GET_LOCAL OP_GET_LOCAL OP_MULTIPLY OP_ADD
+2000000 OP_GET_LOCAL OP_GET_LOCAL OP_MULTIPLY OP_GET_LOCAL
+2000000 OP_GET_LOCAL OP_GET_LOCAL OP_GET OP_ADD
+2000000 OP_GET_LOCAL OP_GET OP_ADD OP_SET_GLOBAL
+1668931 OP_GET_LOCAL OP_SUBTRACT
+1668928 OP_SUBTRACT OP_GET
+1668928 OP_SUBTRACT OP_GET OP_SET
+1668928 OP_GET_LOCAL OP_GET_LOCAL OP_SUBTRACT
+1668928 OP_SUBTRACT OP_GET OP_SET OP_POP
+1668928 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL OP_SUBTRACT
+1668927 OP_GET_LOCAL OP_SUBTRACT OP_GET
+1668927 OP_GET_LOCAL OP_SUBTRACT OP_GET OP_SET
+1668927 OP_GET_LOCAL OP_GET_LOCAL OP_SUBTRACT OP_GET
+1636122 OP_LESS_EQUAL OP_JUMP_IF_FALSE
+1636122 OP_GET_LOCAL OP_LESS_EQUAL OP_JUMP_IF_FALSE
+1636122 OP_GET_LOCAL OP_GET_LOCAL OP_LESS_EQUAL OP_JUMP_IF_FALSE
+1591632 OP_POP OP_GET_LOCAL OP_GET_LOCAL OP_LESS_EQUAL
+1539265 OP_ADD OP_GET_LOCAL
+1539265 OP_CONSTANT OP_ADD OP_GET_LOCAL
+1536123 OP_GET OP_GET_LOCAL OP_GET_LOCAL OP_GET
+1397705 OP_GET_LOCAL OP_CONSTANT OP_ADD OP_GET_LOCAL
+1001948 OP_NOT OP_JUMP_IF_FALSE_POP
+999998 OP_GET OP_NOT
+999998 OP_GET_LOCAL OP_GET OP_NOT
+999998 OP_GET OP_NOT OP_JUMP_IF_FALSE_POP
+999998 OP_GET_GLOBAL OP_GET_LOCAL OP_GET OP_NOT
+999998 OP_GET_LOCAL OP_GET OP_NOT OP_JUMP_IF_FALSE_POP
+997707 OP_FALSE OP_SET_LOCAL
+997707 OP_SET OP_POPN
+997707 OP_FALSE OP_SET_LOCAL OP_POP
+997707 OP_ADD OP_GET_LOCAL OP_SET
+997707 OP_ADD OP_GET OP_SET
+997707 OP_GET_LOCAL OP_SET OP_POPN
+997707 OP_POP OP_GET_LOCAL OP_GET_LOCAL OP_CONSTANT
+997707 OP_POP OP_GET_LOCAL OP_GET_LOCAL OP_GET
+997707 OP_CONSTANT OP_ADD OP_GET_LOCAL OP_SET
+997707 OP_CONSTANT OP_ADD OP_GET OP_SET
+997707 OP_FALSE OP_SET_LOCAL OP_POP OP_GET_LOCAL
+997707 OP_ADD OP_GET_LOCAL OP_SET OP_POPN
+997707 OP_ADD OP_GET OP_SET OP_POP
+997707 OP_SET_LOCAL OP_POP OP_GET_LOCAL OP_GET_LOCAL
+997707 OP_GET OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL
+602000 OP_CONSTANT OP_CONSTANT
+402000 OP_GET_GLOBAL OP_CONSTANT OP_CONSTANT
+402000 OP_GET_GLOBAL OP_GET_LOCAL OP_GET_GLOBAL
+402000 OP_GET_LOCAL OP_GET_GLOBAL OP_CONSTANT
+402000 OP_GET_GLOBAL OP_GET_LOCAL OP_GET_GLOBAL OP_CONSTANT
+402000 OP_GET_LOCAL OP_GET_GLOBAL OP_CONSTANT OP_CONSTANT
+400000 OP_ADD OP_GET_GLOBAL
+400000 OP_ADD OP_GET_GLOBAL OP_GET_LOCAL
+400000 OP_ADD OP_GET_GLOBAL OP_GET_LOCAL OP_GET
+383140 OP_GET OP_CONSTANT
+383120 OP_CONSTANT OP_GET
+300000 OP_GET_GLOBAL OP_GET_GLOBAL OP_GET_LOCAL OP_GET
+283121 OP_GREATER_EQUAL OP_JUMP_IF_FALSE_POP
+283121 OP_GET_LOCAL OP_GREATER_EQUAL
+283121 OP_GET_LOCAL OP_GREATER_EQUAL OP_JUMP_IF_FALSE_POP
+283121 OP_GET_LOCAL OP_GET_LOCAL OP_GREATER_EQUAL
+283121 OP_GET_LOCAL OP_GET_LOCAL OP_GREATER_EQUAL OP_JUMP_IF_FALSE_POP
+283120 OP_CONSTANT OP_GET OP_CONSTANT
+283120 OP_GET_LOCAL OP_CONSTANT OP_GET
+283120 OP_GET_LOCAL OP_CONSTANT OP_GET OP_CONSTANT
+283120 OP_GET_LOCAL OP_GET_LOCAL OP_CONSTANT OP_GET
+241589 OP_POP OP_GET_GLOBAL
+241563 OP_POPN OP_NIL
+241559 OP_POP OP_GET_GLOBAL OP_GET_LOCAL
+241559 OP_POP OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL
+200002 OP_GET_GLOBAL OP_GET_LOCAL OP_CONSTANT
+200000 OP_ADD OP_GET_LOCAL OP_CONSTANT
+200000 OP_GET_LOCAL OP_CONSTANT OP_CONSTANT
+200000 OP_CONSTANT OP_ADD OP_GET_LOCAL OP_CONSTANT
+200000 OP_ADD OP_GET_LOCAL OP_CONSTANT OP_ADD
+200000 OP_GET_GLOBAL OP_GET_GLOBAL OP_GET_LOCAL OP_CONSTANT
+200000 OP_GET_GLOBAL OP_GET_LOCAL OP_CONSTANT OP_CONSTANT
+141595 OP_POP OP_POP
+141595 OP_SET_LOCAL OP_POP OP_POP
+141595 OP_ADD OP_SET_LOCAL OP_POP OP_POP
+141560 OP_GET_LOCAL OP_GET_GLOBAL OP_GET_LOCAL
+141560 OP_GET_LOCAL OP_GET_LOCAL OP_GET_GLOBAL
+141560 OP_GET OP_CONSTANT OP_ADD
+141560 OP_GET OP_CONSTANT OP_SUBTRACT
+141560 OP_CONSTANT OP_GET OP_CONSTANT OP_ADD
+141560 OP_CONSTANT OP_GET OP_CONSTANT OP_SUBTRACT
+141560 OP_GET_LOCAL OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL
+141560 OP_GET_LOCAL OP_GET_LOCAL OP_GET_GLOBAL OP_GET_LOCAL
+141560 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL OP_GET_GLOBAL
+141560 OP_GET OP_CONSTANT OP_ADD OP_GET_LOCAL
+141560 OP_GET OP_GET_LOCAL OP_GET_LOCAL OP_LESS_EQUAL
+108498 OP_CONSTANT OP_ADD OP_SET_GLOBAL
+108498 OP_GET_GLOBAL OP_CONSTANT OP_ADD
+108498 OP_CONSTANT OP_ADD OP_SET_GLOBAL OP_POP
+108498 OP_GET_GLOBAL OP_CONSTANT OP_ADD OP_SET_GLOBAL
+100020 OP_GET_LOCAL OP_GET OP_CONSTANT
+100020 OP_GET_GLOBAL OP_GET_LOCAL OP_GET OP_CONSTANT
+100000 OP_CONSTANT OP_GET OP_ADD
+100000 OP_GET OP_CONSTANT OP_GET
+100000 OP_CONSTANT OP_GET OP_ADD OP_SET_GLOBAL
+100000 OP_GET_LOCAL OP_GET OP_CONSTANT OP_GET
+100000 OP_GET OP_CONSTANT OP_GET OP_ADD
+99999 OP_ADD OP_CONSTANT
+99999 OP_ADD OP_CONSTANT OP_MULTIPLY
+99999 OP_ADD OP_GET_LOCAL OP_GET_LOCAL
+99999 OP_CONSTANT OP_ADD OP_GET_LOCAL OP_GET_LOCAL
+99999 OP_ADD OP_GET_LOCAL OP_GET_LOCAL OP_LESS_EQUAL
+99999 OP_GET_GLOBAL OP_GET_LOCAL OP_GET_LOCAL OP_ADD
+99999 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL OP_LESS_EQUAL
+99998 OP_GET_LOCAL OP_ADD OP_CONSTANT
+99998 OP_GET_LOCAL OP_ADD OP_CONSTANT OP_MULTIPLY
+99998 OP_GET_LOCAL OP_GET_LOCAL OP_ADD OP_CONSTANT
+78498 OP_CONSTANT OP_MULTIPLY OP_GET_LOCAL
+78498 OP_MULTIPLY OP_GET_LOCAL OP_GET_GLOBAL
+78498 OP_SET_GLOBAL OP_POP OP_GET_LOCAL
+78498 OP_POP OP_GET_LOCAL OP_CONSTANT OP_MULTIPLY
+78498 OP_CONSTANT OP_MULTIPLY OP_GET_LOCAL OP_GET_GLOBAL
+78498 OP_ADD OP_SET_GLOBAL OP_POP OP_GET_LOCAL
+78498 OP_SET_GLOBAL OP_POP OP_GET_LOCAL OP_CONSTANT
+78498 OP_GET_LOCAL OP_CONSTANT OP_MULTIPLY OP_GET_LOCAL
+2026 OP_CONSTANT OP_GET_LOCAL
+2022 OP_CONSTANT OP_GET_LOCAL OP_CONSTANT
+1969 OP_POP OP_CONSTANT
+1961 OP_POP OP_CONSTANT OP_GET_LOCAL
+1961 OP_POP OP_CONSTANT OP_GET_LOCAL OP_CONSTANT
+1951 OP_CONSTANT OP_GET_LOCAL OP_CONSTANT OP_SUBTRACT
+1950 OP_GET_LOCAL OP_NOT
+1950 OP_GET_LOCAL OP_NOT OP_JUMP_IF_FALSE_POP
+1949 OP_TRUE OP_SET_LOCAL
+1949 OP_SUBTRACT OP_GET_LOCAL
+1949 OP_CONSTANT OP_SUBTRACT OP_GET_LOCAL
+1949 OP_TRUE OP_SET_LOCAL OP_POP
+1949 OP_SUBTRACT OP_GET_LOCAL OP_GET_LOCAL
+1949 OP_SET_LOCAL OP_POP OP_CONSTANT
+1949 OP_CONSTANT OP_SUBTRACT OP_GET_LOCAL OP_GET_LOCAL
+1949 OP_TRUE OP_SET_LOCAL OP_POP OP_CONSTANT
+1949 OP_GET_LOCAL OP_CONSTANT OP_SUBTRACT OP_GET_LOCAL
+1949 OP_SET_LOCAL OP_POP OP_CONSTANT OP_GET_LOCAL
+22 OP_POP OP_GET_GLOBAL OP_GET_GLOBAL
+20 OP_GET OP_CONSTANT OP_GET_LOCAL
+20 OP_POP OP_GET_GLOBAL OP_GET_GLOBAL OP_GET_LOCAL
+20 OP_GET_LOCAL OP_GET OP_CONSTANT OP_GET_LOCAL
+20 OP_GET OP_CONSTANT OP_GET_LOCAL OP_CONSTANT
+7 OP_GET_GLOBAL OP_SUBTRACT
+3 OP_CONSTANT OP_GET_LOCAL OP_GET_LOCAL
+3 OP_GET_GLOBAL OP_GET_GLOBAL OP_CONSTANT
+2 OP_CONSTANT OP_GET_GLOBAL
+2 OP_CONSTANT OP_GET_GLOBAL OP_GET_GLOBAL
+2 OP_SET_GLOBAL OP_POP OP_CONSTANT
+2 OP_GET_LOCAL OP_CONSTANT OP_GET_LOCAL
+2 OP_POP OP_GET_GLOBAL OP_GET_GLOBAL OP_CONSTANT
+2 OP_GET_GLOBAL OP_GET_LOCAL OP_CONSTANT OP_GET_LOCAL
+2 OP_GET_LOCAL OP_CONSTANT OP_GET_LOCAL OP_CONSTANT
+1 OP_FALSE OP_GET_LOCAL
+1 OP_POP OP_CONSTANT OP_GET_GLOBAL
+1 OP_POP OP_GET_GLOBAL OP_CONSTANT
+1 OP_CONSTANT OP_GET_LOCAL OP_GET_GLOBAL
+1 OP_FALSE OP_GET_LOCAL OP_NOT
+1 OP_SET_GLOBAL OP_POP OP_GET_GLOBAL
+1 OP_POP OP_CONSTANT OP_GET_GLOBAL OP_GET_GLOBAL
+1 OP_FALSE OP_GET_LOCAL OP_NOT OP_JUMP_IF_FALSE_POP
+1 OP_SET_GLOBAL OP_POP OP_CONSTANT OP_GET_LOCAL
+1 OP_SET_GLOBAL OP_POP OP_GET_GLOBAL OP_CONSTANT
@@ -112,7 +112,7 @@ void ASTCallExpr::accept(visitor* vis) {
 #pragma region Grouping expr
 ASTGroupingExpr::ASTGroupingExpr(ASTNode* _expr) {
 	expr = _expr;
-	ASTType::GROUPING;
+	type = ASTType::GROUPING;
 	gc.addASTNode(this);
 }
 
@@ -275,7 +275,7 @@ void ASTPrintStmt::accept(visitor* vis) {
 #pragma region Expr stmt
 ASTExprStmt::ASTExprStmt(ASTNode* _expr) {
 	expr = _expr;
-	ASTType::EXPR_STMT;
+	type = ASTType::EXPR_STMT;
 	gc.addASTNode(this);
 }
 
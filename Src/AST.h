@@ -36,6 +36,9 @@ class ASTSwitchStmt;
 class ASTCase;
 class ASTReturn;
 
+//rewrites the tree in place between parsing and compilation
+class ASTOptimizer;
+
 enum class ASTType {
 	ASSINGMENT,
 	SET,
@@ -127,6 +130,7 @@ public:
 #pragma region Expressions
 
 class ASTAssignmentExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	Token name;
 	ASTNode* value;
@@ -139,6 +143,7 @@ public:
 };
 
 class ASTSetExpr : public ASTNode{
+	friend class ASTOptimizer;
 private:
 	ASTNode* callee;
 	ASTNode* field;
@@ -155,6 +160,7 @@ public:
 };
 
 class ASTConditionalExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* condition;
 	ASTNode* thenBranch;
@@ -169,6 +175,7 @@ public:
 };
 
 class ASTBinaryExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	Token op;
 	ASTNode* left;
@@ -183,6 +190,7 @@ public:
 };
 
 class ASTUnaryExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	Token op;
 	ASTNode* right;
@@ -195,6 +203,7 @@ public:
 };
 
 class ASTArrayDeclExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	vector<ASTNode*> members;
 	int size;
@@ -206,6 +215,7 @@ public:
 };
 
 class ASTCallExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* callee;
 	Token accessor;
@@ -229,6 +239,7 @@ public:
 };
 
 class ASTGroupingExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* expr;
 public:
@@ -239,6 +250,7 @@ public:
 };
 
 class ASTUnaryVarAlterExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* incrementExpr;
 	bool isPositive;
@@ -269,6 +281,7 @@ struct structEntry {
 };
 
 class ASTStructLiteral : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	vector<structEntry> fields;
 public:
@@ -279,6 +292,7 @@ public:
 };
 
 class ASTYieldExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* expr;
 public:
@@ -290,6 +304,7 @@ public:
 };
 
 class ASTFiberLiteral : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	vector<Token> startParams;
 	int arity;
@@ -305,6 +320,7 @@ public:
 };
 
 class ASTFiberRunExpr : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	vector<ASTNode*> args;
 public:
@@ -320,6 +336,7 @@ public:
 #pragma region Statements
 
 class ASTPrintStmt : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* expr;
 public:
@@ -329,6 +346,7 @@ public:
 };
 
 class ASTExprStmt : public ASTNode {
+	friend class ASTOptimizer;
 private :
 	ASTNode* expr;
 public:
@@ -339,6 +357,7 @@ public:
 };
 
 class ASTVarDecl : public ASTNode {
+	friend class ASTOptimizer;
 private: 
 	ASTNode* setExpr;
 	Token name;
@@ -350,6 +369,7 @@ public:
 };
 
 class ASTBlockStmt : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	vector<ASTNode*> statements;
 public:
@@ -359,6 +379,7 @@ public:
 };
 
 class ASTIfStmt : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* thenBranch;
 	ASTNode* elseBranch;
@@ -372,6 +393,7 @@ public:
 };
 
 class ASTWhileStmt : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* body;
 	ASTNode* condition;
@@ -383,6 +405,7 @@ public:
 };
 
 class ASTForStmt : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* body;
 	ASTNode* init;
@@ -398,6 +421,7 @@ public:
 };
 
 class ASTForeachStmt : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	Token varName;
 	ASTNode* collection;
@@ -430,6 +454,7 @@ public:
 };
 
 class ASTSwitchStmt : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* expr;
 	vector<ASTNode*> cases;
@@ -445,6 +470,7 @@ public:
 };
 
 class ASTCase : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* expr;
 	vector<ASTNode*> stmts;
@@ -461,6 +487,7 @@ public:
 };
 
 class ASTFunc : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	vector<Token> args;
 	int arity;
@@ -478,6 +505,7 @@ public:
 };
 
 class ASTReturn : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	ASTNode* expr;
 	//for error reporting
@@ -490,6 +518,7 @@ public:
 };
 
 class ASTClass : public ASTNode {
+	friend class ASTOptimizer;
 private:
 	Token name;
 	Token inheritedClass;
@@ -2,18 +2,53 @@
 #include "debug.h"
 #include "namespaces.h"
 #include "builtInFunction.h"
+#include "aot.h"
 
 
 using namespace global;
 
 vm::vm(compiler* current) {
 	if (!current->compiled) return;
+	defineNatives();
+	//globals that haven't been declared by the module fall back to the natives, this never allocates
+	for (objModule* mod : current->modules) mod->bindNatives(&globals);
+
+	objFunc* func = current->endFuncDecl();
+	gc.cachePtr(func);
+	delete current;
+	//every function will be accessible from the VM from now on, so there's no point in marking and tracing the compiler
+	gc.compilerSession = nullptr;
+	run(dynamic_cast<objFunc*>(gc.getCachedPtr()));
+}
+
+vm::vm(bytecodeImage* image) {
+	defineNatives();
+	for (objModule* mod : image->modules) mod->bindNatives(&globals);
+	#ifdef AOT_BUILD
+	aot::link(image->funcs);
+	#endif
+
+	gc.cachePtr(image->funcs[0]);
+	delete image;
+	gc.imageSession = nullptr;
+	run(dynamic_cast<objFunc*>(gc.getCachedPtr()));
+}
+
+void vm::defineNatives() {
 	//we do this here because defineNative() mutates the globals field,
 	//and if a collection happens we need to update all pointers in globals
 	gc.VM = this;
 	curFiber = nullptr;
 	curModule = nullptr;
-	toString = copyString("toString");
+	for (int i = 0; i < METAMETHOD_COUNT; i++) metamethodNames[i] = nullptr;
+	structShape = nullptr;
+	#ifdef DEBUG_COUNT_INSTRUCTIONS
+	instructionCount = 0;
+	#endif
+	metamethodNames[METAMETHOD_ACCESS] = copyString("access");
+	metamethodNames[METAMETHOD_SET] = copyString("set");
+	metamethodNames[METAMETHOD_TO_STRING] = copyString("toString");
+	structShape = new objShape(0);
 	//globals are set in the vm and the fibers access them by having a pointer to the VM
 	defineNative("clock", nativeClock, 0);
 	defineNative("randomRange", nativeRandomRange, 2);
@@ -21,6 +56,7 @@ vm::vm(compiler* current) {
 	defineNative("string", nativeToString, 1);
 	defineNative("real", nativeToReal, 1);
 	defineNative("input", nativeInput, 0);
+	defineNative("gcStep", nativeGcStep, 1);
 
 	#pragma region Math
 
@@ -98,16 +134,33 @@ vm::vm(compiler* current) {
 	defineNative("arrayLength", nativeArrayLength, 1);
 	defineNative("arrayFill", nativeArrayFill, 4);
 	#pragma endregion
+}
 
+void vm::run(objFunc* func) {
 	//using cachePtr because a relocation might happen while allocating closure or fiber
-	objFunc* func = current->endFuncDecl();
+	#ifdef DEBUG_INLINE_CACHE
+	//kept cached for the entire run so we can get to every function once the program finishes
+	gc.cachePtr(func);
+	#endif // DEBUG_INLINE_CACHE
 	gc.cachePtr(func);
 	gc.cachePtr(new objClosure(dynamic_cast<objFunc*>(gc.getCachedPtr())));
 	objFiber* fiber = new objFiber(dynamic_cast<objClosure*>(gc.getCachedPtr()), this, 0);
-	delete current;
-	//every function will be accessible from the VM from now on, so there's no point in marking and tracing the compiler
-	gc.compilerSession = nullptr;
 	interpret(fiber);
+	#ifdef BASELINE_JIT
+	if (jit.stats) jit.dumpStats();
+	#endif // BASELINE_JIT
+	#ifdef TRACING_JIT
+	if (tracer.stats) tracer.dumpStats();
+	#endif // TRACING_JIT
+	#ifdef DEBUG_INLINE_CACHE
+	dumpInlineCaches(dynamic_cast<objFunc*>(gc.getCachedPtr()));
+	#endif // DEBUG_INLINE_CACHE
+	#ifdef DEBUG_COUNT_INSTRUCTIONS
+	std::cout << "Instructions dispatched: " << instructionCount << "\n";
+	#endif // DEBUG_COUNT_INSTRUCTIONS
+	#ifdef PROFILE_SEQUENCES
+	if (!profiler.path.empty() && !profiler.write()) std::cout << "Couldn't write the profile to " << profiler.path << "\n";
+	#endif // PROFILE_SEQUENCES
 }
 
 vm::~vm() {
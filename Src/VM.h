@@ -2,6 +2,7 @@
 
 #include "common.h"
 #include "compiler.h"
+#include "bytecodeImage.h"
 #include "object.h"
 #include "hashTable.h"
 #include "fiber.h"
@@ -9,6 +10,8 @@
 class vm {
 public:
 	vm(compiler* current);
+	//skips straight to running the code loaded from a bytecode image
+	vm(bytecodeImage* image);
 	~vm();
 
 	void interpret(objFiber* fiber);
@@ -18,8 +21,15 @@ public:
 	hashTable globals;
 	objModule* curModule;
 
-	//strings used by fibers
-	objString* toString;
+	//names of the metamethods, indexed by metamethodType
+	objString* metamethodNames[METAMETHOD_COUNT];
+	//every struct literal starts out with this shape
+	objShape* structShape;
+	#ifdef DEBUG_COUNT_INSTRUCTIONS
+	uInt64 instructionCount;
+	#endif
 private:
 	void defineNative(string name, NativeFn func, int arity);
+	void defineNatives();
+	void run(objFunc* script);
 };
\ No newline at end of file
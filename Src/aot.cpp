@@ -0,0 +1,235 @@
+#include "aot.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+//FNV-1a over the bytecode, plus the number of constants and arguments
+uInt64 aotChecksum(objFunc* func) {
+	uInt64 hash = 14695981039346656037ull;
+	chunk& body = func->body;
+	for (uInt i = 0; i < body.code.count(); i++) {
+		hash ^= body.code[i];
+		hash *= 1099511628211ull;
+	}
+	hash ^= ((uInt64)body.constants.count() << 32) | (uInt)func->arity;
+	hash *= 1099511628211ull;
+	return hash;
+}
+
+#pragma region Translation
+static uInt16 readShort(uint8_t* code, uInt offset) {
+	return (uInt16)((code[offset] << 8) | code[offset + 1]);
+}
+
+static string label(uInt offset) {
+	return "L" + std::to_string(offset);
+}
+
+//statement that leaves to the interpreter if the fast path fails
+static string guarded(string fastPath, uInt offset) {
+	return "if (!" + fastPath + ") AOT_EXIT(" + std::to_string(offset) + ");";
+}
+
+bool aotCompiler::write(string path, vector<objFunc*>& funcs) {
+	std::ofstream out(path);
+	if (!out.is_open()) return false;
+	out << "//generated by -aot, build it together with the interpreter's sources and AOT_BUILD defined(see aot.h)\n";
+	out << "#include \"aot.h\"\n\n";
+	out << "#ifdef AOT_BUILD\n";
+	for (uInt i = 0; i < funcs.size(); i++) out << translate(funcs[i], i) << "\n";
+	out << "aotEntry aotFunctions[] = {\n";
+	for (uInt i = 0; i < funcs.size(); i++) {
+		out << "\t{ aot_" << i << ", 0x" << std::hex << aotChecksum(funcs[i]) << std::dec << "ull },\n";
+	}
+	out << "};\n";
+	out << "uInt aotFunctionCount = " << funcs.size() << ";\n";
+	out << "#endif\n";
+	return out.good();
+}
+
+string aotCompiler::translate(objFunc* func, uInt index) {
+	chunk& body = func->body;
+	uint8_t* code = body.code.data();
+	uInt size = body.code.count();
+	vector<uInt> offsets;
+	vector<string> statements;
+	vector<bool> native;
+	//only instructions that can be entered or jumped to get a label
+	vector<bool> labeled(size + 1, false);
+	for (uInt offset = 0; offset < size; offset += body.instructionLength(offset)) {
+		bool isNative = false;
+		offsets.push_back(offset);
+		statements.push_back(translateInstruction(body, offset, isNative));
+		native.push_back(isNative);
+		if (isNative) labeled[offset] = true;
+		switch (genericOpcode(code[offset])) {
+		case OP_JUMP:
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+		case OP_JUMP_IF_FALSE_POP: labeled[offset + 3 + readShort(code, offset + 1)] = true; break;
+		case OP_LOOP: labeled[offset + 3 - readShort(code, offset + 1)] = true; break;
+		case OP_JUMP_POPN: labeled[offset + 5 + readShort(code, offset + 3)] = true; break;
+		}
+	}
+
+	std::stringstream out;
+	out << "//" << (func->name == nullptr ? "script" : func->name->str) << "\n";
+	out << "static uInt aot_" << index << "(uInt ip, Value* slots, Value** stackTop, Value* constants, objUpval** upvals) {\n";
+	out << "\tValue* sp = *stackTop;\n";
+	out << "\tswitch (ip) {\n";
+	for (uInt i = 0; i < offsets.size(); i++) {
+		if (native[i]) out << "\tcase " << offsets[i] << ": goto " << label(offsets[i]) << ";\n";
+	}
+	out << "\tdefault: return ip;\n";
+	out << "\t}\n";
+	uInt64 line = 0;
+	for (uInt i = 0; i < offsets.size(); i++) {
+		uInt64 instrLine = body.getLine(offsets[i]).line;
+		if (instrLine != line) {
+			line = instrLine;
+			out << "\t//line " << line << "\n";
+		}
+		if (labeled[offsets[i]]) out << label(offsets[i]) << ":\n";
+		out << "\t" << statements[i] << "\n";
+	}
+	//every function ends with OP_RETURN, which always leaves
+	out << "\treturn ip;\n";
+	out << "}\n";
+	return out.str();
+}
+
+//sets native if the instruction can run without the interpreter, otherwise it always leaves
+string aotCompiler::translateInstruction(chunk& body, uInt offset, bool& native) {
+	uint8_t* code = body.code.data();
+	native = true;
+	switch (genericOpcode(code[offset])) {
+	case OP_POP: return "sp--;";
+	case OP_POPN: return "sp -= " + std::to_string(code[offset + 1]) + ";";
+	case OP_CONSTANT: return "*sp++ = constants[" + std::to_string(code[offset + 1]) + "];";
+	case OP_CONSTANT_LONG: return "*sp++ = constants[" + std::to_string(readShort(code, offset + 1)) + "];";
+	case OP_NIL: return "*sp++ = NIL_VAL();";
+	case OP_TRUE: return "*sp++ = BOOL_VAL(true);";
+	case OP_FALSE: return "*sp++ = BOOL_VAL(false);";
+	case OP_GET_LOCAL: return "*sp++ = slots[" + std::to_string(code[offset + 1]) + "];";
+	case OP_SET_LOCAL: return "slots[" + std::to_string(code[offset + 1]) + "] = sp[-1];";
+	case OP_GET_UPVALUE: return "*sp++ = *upvals[" + std::to_string(code[offset + 1]) + "]->location;";
+	case OP_SET_UPVALUE: {
+		string upval = "upvals[" + std::to_string(code[offset + 1]) + "]";
+		return "*" + upval + "->location = sp[-1]; WRITE_BARRIER(" + upval + ", sp[-1]);";
+	}
+	case OP_GET_GLOBAL:
+		return guarded("aotGetGlobal(sp, constants[" + std::to_string(code[offset + 1]) + "], " + std::to_string(code[offset + 2]) + ")", offset);
+	case OP_GET_GLOBAL_LONG:
+		return guarded("aotGetGlobal(sp, constants[" + std::to_string(readShort(code, offset + 1)) + "], "
+			+ std::to_string(readShort(code, offset + 3)) + ")", offset);
+	case OP_SET_GLOBAL:
+		return guarded("aotSetGlobal(sp, constants[" + std::to_string(code[offset + 1]) + "], " + std::to_string(code[offset + 2]) + ")", offset);
+	case OP_SET_GLOBAL_LONG:
+		return guarded("aotSetGlobal(sp, constants[" + std::to_string(readShort(code, offset + 1)) + "], "
+			+ std::to_string(readShort(code, offset + 3)) + ")", offset);
+
+	case OP_ADD: return guarded("aotArith(sp, OP_ADD)", offset);
+	case OP_SUBTRACT: return guarded("aotArith(sp, OP_SUBTRACT)", offset);
+	case OP_MULTIPLY: return guarded("aotArith(sp, OP_MULTIPLY)", offset);
+	case OP_DIVIDE: return guarded("aotArith(sp, OP_DIVIDE)", offset);
+	case OP_MOD: return guarded("aotIntArith(sp, OP_MOD)", offset);
+	case OP_BITSHIFT_LEFT: return guarded("aotIntArith(sp, OP_BITSHIFT_LEFT)", offset);
+	case OP_BITSHIFT_RIGHT: return guarded("aotIntArith(sp, OP_BITSHIFT_RIGHT)", offset);
+	case OP_BITWISE_AND: return guarded("aotIntArith(sp, OP_BITWISE_AND)", offset);
+	case OP_BITWISE_OR: return guarded("aotIntArith(sp, OP_BITWISE_OR)", offset);
+	case OP_BITWISE_XOR: return guarded("aotIntArith(sp, OP_BITWISE_XOR)", offset);
+	case OP_ADD_1: return guarded("aotIncrement(sp, 1)", offset);
+	case OP_SUBTRACT_1: return guarded("aotIncrement(sp, -1)", offset);
+	case OP_NEGATE: return guarded("aotUnary(sp, OP_NEGATE)", offset);
+	case OP_NOT: return guarded("aotUnary(sp, OP_NOT)", offset);
+	case OP_BIN_NOT: return guarded("aotUnary(sp, OP_BIN_NOT)", offset);
+	case OP_EQUAL: return "aotEqual(sp, false);";
+	case OP_NOT_EQUAL: return "aotEqual(sp, true);";
+	case OP_GREATER: return guarded("aotCompare(sp, OP_GREATER)", offset);
+	case OP_GREATER_EQUAL: return guarded("aotCompare(sp, OP_GREATER_EQUAL)", offset);
+	case OP_LESS: return guarded("aotCompare(sp, OP_LESS)", offset);
+	case OP_LESS_EQUAL: return guarded("aotCompare(sp, OP_LESS_EQUAL)", offset);
+	case OP_GET: return guarded("aotGet(sp)", offset);
+	case OP_SET: return guarded("aotSet(sp)", offset);
+
+	case OP_JUMP: return "goto " + label(offset + 3 + readShort(code, offset + 1)) + ";";
+	case OP_JUMP_IF_FALSE: return "if (aotFalsey(sp[-1])) goto " + label(offset + 3 + readShort(code, offset + 1)) + ";";
+	case OP_JUMP_IF_TRUE: return "if (!aotFalsey(sp[-1])) goto " + label(offset + 3 + readShort(code, offset + 1)) + ";";
+	case OP_JUMP_IF_FALSE_POP: return "if (aotFalsey(*--sp)) goto " + label(offset + 3 + readShort(code, offset + 1)) + ";";
+	case OP_LOOP: return "goto " + label(offset + 3 - readShort(code, offset + 1)) + ";";
+	case OP_JUMP_POPN:
+		return "sp -= " + std::to_string(readShort(code, offset + 1)) + "; goto " + label(offset + 5 + readShort(code, offset + 3)) + ";";
+	}
+	//calls, returns, allocation, fibers and everything else that needs the fiber
+	native = false;
+	return "AOT_EXIT(" + std::to_string(offset) + ");";
+}
+#pragma endregion
+
+#ifdef AOT_BUILD
+bool aot::enabled = true;
+
+uInt aot::link(vector<objFunc*>& funcs) {
+	if (!enabled) return 0;
+	uInt linked = 0;
+	for (uInt i = 0; i < funcs.size() && i < aotFunctionCount; i++) {
+		if (aotChecksum(funcs[i]) != aotFunctions[i].checksum) continue;
+		funcs[i]->aot = aotFunctions[i].func;
+		linked++;
+	}
+	//printed to stderr so that --aot-test still compares only what the program printed
+	if (linked != funcs.size()) {
+		std::cerr << "Only " << linked << " out of " << funcs.size() << " functions match the image this executable was built for.\n";
+	}
+	return linked;
+}
+
+//everything the command prints to stdout and stderr, it's input is empty so that 'Pause' doesn't wait
+static string captureOutput(string command) {
+	#ifdef _WIN32
+	command += " < NUL 2>&1";
+	#else
+	command += " < /dev/null 2>&1";
+	#endif
+	FILE* pipe = popen(command.c_str(), "r");
+	if (pipe == nullptr) return "";
+	string output;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), pipe)) > 0) output.append(buffer, read);
+	pclose(pipe);
+	return output;
+}
+
+int aot::test(string self, string path) {
+	string interpreted = captureOutput("\"" + self + "\" --no-aot \"" + path + "\"");
+	string native = captureOutput("\"" + self + "\" \"" + path + "\"");
+	if (interpreted == native) {
+		std::cout << "AOT build matches the interpreter(" << interpreted.size() << " bytes of output).\n";
+		return 0;
+	}
+	std::stringstream a(interpreted);
+	std::stringstream b(native);
+	string lineA;
+	string lineB;
+	uInt line = 1;
+	while (true) {
+		bool hasA = (bool)std::getline(a, lineA);
+		bool hasB = (bool)std::getline(b, lineB);
+		if (!hasA && !hasB) break;
+		if (!hasA) lineA = "<end of output>";
+		if (!hasB) lineB = "<end of output>";
+		if (lineA != lineB) break;
+		line++;
+	}
+	std::cout << "AOT build differs from the interpreter at line " << line << " of the output:\n";
+	std::cout << "interpreter: " << lineA << "\n";
+	std::cout << "AOT:         " << lineB << "\n";
+	return 1;
+}
+#endif
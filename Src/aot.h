@@ -0,0 +1,247 @@
+#pragma once
+#include "common.h"
+#include "object.h"
+#include "namespaces.h"
+
+//-aot compiles main.ifs into main.ifsc(see bytecodeImage.h) and translates every function in the image to C++ in main.aot.cpp
+//
+//building the interpreter with AOT_BUILD defined and main.aot.cpp added gives a executable that runs that image natively:
+//every function becomes a C++ function over the same stack, slots and constants as the interpreter, with a label for every instruction
+//it can be entered at any instruction and runs until it reaches one that calls, returns, allocates, switches fibers or throws,
+//then it returns that offset and the interpreter runs the instruction before going back into the native code
+//since every instruction is a entry point, fibers that yield and resume in the middle of a function need nothing extra
+//
+//the translation is checked against the loaded image with a checksum of every function, functions that don't match stay interpreted
+class aotCompiler {
+public:
+	//funcs are in the order the image stores them, script first
+	static bool write(string path, vector<objFunc*>& funcs);
+private:
+	static string translate(objFunc* func, uInt index);
+	static string translateInstruction(chunk& body, uInt offset, bool& native);
+};
+
+uInt64 aotChecksum(objFunc* func);
+
+#ifdef AOT_BUILD
+struct aotEntry {
+	aotFunction func;
+	uInt64 checksum;
+};
+
+//defined in main.aot.cpp
+extern aotEntry aotFunctions[];
+extern uInt aotFunctionCount;
+
+namespace aot {
+	//cleared by --no-aot
+	extern bool enabled;
+	//gives every function of a freshly loaded image it's translation, returns how many matched
+	uInt link(vector<objFunc*>& funcs);
+	//--aot-test, runs the image with and without the translations and compares what they print
+	int test(string self, string path);
+}
+
+//leaves the native code, the interpreter continues with the instruction at offset
+#define AOT_EXIT(offset) \
+	do { \
+		*stackTop = sp; \
+		return offset; \
+	} while (false)
+
+//fast paths of the instructions the translations run natively, everything here mirrors a handler in objFiber::execute
+//returning false leaves the stack untouched so the interpreter can run the instruction(and report the error) itself
+inline bool aotFalsey(Value value) {
+	return ((IS_BOOL(value) && !AS_BOOL(value)) || IS_NIL(value));
+}
+
+inline bool aotGetGlobal(Value*& sp, Value module, uInt slot) {
+	globalVar* var = &AS_MODULE(module)->globals.data()[slot];
+	if (var->state == globalState::UNDEFINED) return false;
+	*sp++ = var->val;
+	return true;
+}
+
+inline bool aotSetGlobal(Value*& sp, Value module, uInt slot) {
+	globalVar* var = &AS_MODULE(module)->globals.data()[slot];
+	if (var->state != globalState::DEFINED) return false;
+	var->val = sp[-1];
+	WRITE_BARRIER(AS_MODULE(module), var->val);
+	return true;
+}
+
+//op is always a constant, so only one case survives after inlining
+inline bool aotArith(Value*& sp, uint8_t op) {
+	Value a = sp[-2];
+	Value b = sp[-1];
+	if (ARE_INTS(a, b) && op != OP_DIVIDE) {
+		int64_t x = AS_INT(a);
+		int64_t y = AS_INT(b);
+		switch (op) {
+		case OP_ADD: sp[-2] = INT_OR_NUMBER_VAL(x + y); break;
+		case OP_SUBTRACT: sp[-2] = INT_OR_NUMBER_VAL(x - y); break;
+		case OP_MULTIPLY: sp[-2] = INT_OR_NUMBER_VAL(x * y); break;
+		}
+		sp--;
+		return true;
+	}
+	if (!IS_NUMBER(a) || !IS_NUMBER(b)) return false;
+	double x = AS_NUMBER(a);
+	double y = AS_NUMBER(b);
+	switch (op) {
+	case OP_ADD: sp[-2] = NUMBER_VAL(x + y); break;
+	case OP_SUBTRACT: sp[-2] = NUMBER_VAL(x - y); break;
+	case OP_MULTIPLY: sp[-2] = NUMBER_VAL(x * y); break;
+	case OP_DIVIDE: sp[-2] = NUMBER_VAL(x / y); break;
+	}
+	sp--;
+	return true;
+}
+
+inline bool aotIntArith(Value*& sp, uint8_t op) {
+	Value a = sp[-2];
+	Value b = sp[-1];
+	if (ARE_INTS(a, b)) {
+		int64_t x = AS_INT(a);
+		int64_t y = AS_INT(b);
+		switch (op) {
+		case OP_MOD:
+			//division by zero is left to the interpreter
+			if (y == 0) return false;
+			sp[-2] = INT_OR_NUMBER_VAL(x % y);
+			break;
+		case OP_BITSHIFT_LEFT: sp[-2] = INT_OR_NUMBER_VAL(x << y); break;
+		case OP_BITSHIFT_RIGHT: sp[-2] = INT_OR_NUMBER_VAL(x >> y); break;
+		case OP_BITWISE_AND: sp[-2] = INT_OR_NUMBER_VAL(x & y); break;
+		case OP_BITWISE_OR: sp[-2] = INT_OR_NUMBER_VAL(x | y); break;
+		case OP_BITWISE_XOR: sp[-2] = INT_OR_NUMBER_VAL(x ^ y); break;
+		}
+		sp--;
+		return true;
+	}
+	if (!IS_NUMBER(a) || !IS_NUMBER(b)) return false;
+	uInt64 x = AS_NUMBER(a);
+	uInt64 y = AS_NUMBER(b);
+	switch (op) {
+	case OP_MOD:
+		if (y == 0) return false;
+		sp[-2] = NUMBER_VAL((double)(x % y));
+		break;
+	case OP_BITSHIFT_LEFT: sp[-2] = NUMBER_VAL((double)(x << y)); break;
+	case OP_BITSHIFT_RIGHT: sp[-2] = NUMBER_VAL((double)(x >> y)); break;
+	case OP_BITWISE_AND: sp[-2] = NUMBER_VAL((double)(x & y)); break;
+	case OP_BITWISE_OR: sp[-2] = NUMBER_VAL((double)(x | y)); break;
+	case OP_BITWISE_XOR: sp[-2] = NUMBER_VAL((double)(x ^ y)); break;
+	}
+	sp--;
+	return true;
+}
+
+inline bool aotIncrement(Value*& sp, int delta) {
+	Value a = sp[-1];
+	if (IS_INT(a)) sp[-1] = INT_OR_NUMBER_VAL((int64_t)AS_INT(a) + delta);
+	else if (IS_NUMBER(a)) sp[-1] = NUMBER_VAL(AS_NUMBER(a) + delta);
+	else return false;
+	return true;
+}
+
+//integers are compared in 32 bits, doubles that are close enough count as equal for >= and <=
+inline bool aotCompare(Value*& sp, uint8_t op) {
+	Value a = sp[-2];
+	Value b = sp[-1];
+	bool result = false;
+	if (ARE_INTS(a, b)) {
+		int32_t x = AS_INT(a);
+		int32_t y = AS_INT(b);
+		switch (op) {
+		case OP_GREATER: result = x > y; break;
+		case OP_GREATER_EQUAL: result = x >= y; break;
+		case OP_LESS: result = x < y; break;
+		case OP_LESS_EQUAL: result = x <= y; break;
+		}
+	}
+	else {
+		if (!IS_NUMBER(a) || !IS_NUMBER(b)) return false;
+		double x = AS_NUMBER(a);
+		double y = AS_NUMBER(b);
+		switch (op) {
+		case OP_GREATER: result = x > y; break;
+		case OP_GREATER_EQUAL: result = x > y || FLOAT_EQ(x, y); break;
+		case OP_LESS: result = x < y; break;
+		case OP_LESS_EQUAL: result = x < y || FLOAT_EQ(x, y); break;
+		}
+	}
+	sp[-2] = BOOL_VAL(result);
+	sp--;
+	return true;
+}
+
+inline void aotEqual(Value*& sp, bool negate) {
+	Value a = sp[-2];
+	Value b = sp[-1];
+	bool result = ARE_INTS(a, b) ? AS_INT(a) == AS_INT(b) : valuesEqual(a, b);
+	sp[-2] = BOOL_VAL(result != negate);
+	sp--;
+}
+
+inline bool aotUnary(Value*& sp, uint8_t op) {
+	Value a = sp[-1];
+	switch (op) {
+	case OP_NEGATE:
+		//-0 can only be represented as a double
+		if (IS_INT(a) && AS_INT(a) != 0) sp[-1] = INT_OR_NUMBER_VAL(-(int64_t)AS_INT(a));
+		else if (IS_NUMBER(a)) sp[-1] = NUMBER_VAL(-AS_NUMBER(a));
+		else return false;
+		return true;
+	case OP_NOT:
+		sp[-1] = BOOL_VAL(aotFalsey(a));
+		return true;
+	case OP_BIN_NOT: {
+		if (!IS_NUMBER(a)) return false;
+		int num = AS_NUMBER(a);
+		sp[-1] = INT_VAL(~num);
+		return true;
+	}
+	}
+	return false;
+}
+
+//only arrays, instances can run user code through their metamethods
+inline int64_t aotArrayIndex(objArray* arr, Value field) {
+	if (IS_INT(field)) {
+		if (AS_INT(field) < 0 || (uInt)AS_INT(field) >= arr->values.count()) return -1;
+		return AS_INT(field);
+	}
+	if (!IS_NUMBER(field)) return -1;
+	double num = AS_NUMBER(field);
+	if (num != (uInt64)num) return -1;
+	if (num < 0 || num > arr->values.count() - 1) return -1;
+	return (uInt64)num;
+}
+
+inline bool aotGet(Value*& sp) {
+	if (!IS_ARRAY(sp[-2])) return false;
+	objArray* arr = AS_ARRAY(sp[-2]);
+	int64_t index = aotArrayIndex(arr, sp[-1]);
+	if (index < 0) return false;
+	sp[-2] = arr->values[index];
+	sp--;
+	return true;
+}
+
+inline bool aotSet(Value*& sp) {
+	if (!IS_ARRAY(sp[-3])) return false;
+	objArray* arr = AS_ARRAY(sp[-3]);
+	int64_t index = aotArrayIndex(arr, sp[-2]);
+	if (index < 0) return false;
+	Value val = sp[-1];
+	//if numOfHeapPtr is 0 we don't trace or update the array when garbage collecting
+	if (IS_OBJ(val)) arr->numOfHeapPtr++;
+	else if (IS_OBJ(arr->values[index])) arr->numOfHeapPtr--;
+	arr->values[index] = val;
+	ARRAY_WRITE_BARRIER(arr, index, index + 1, val);
+	sp[-3] = val;
+	sp -= 2;
+	return true;
+}
+#endif
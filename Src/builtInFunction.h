@@ -100,6 +100,7 @@ bool nativeFileWriteLn(objFiber* fiber, int argCount, Value* args);
 
 
 bool nativeClock(objFiber* fiber, int argCount, Value* args);
+bool nativeGcStep(objFiber* fiber, int argCount, Value* args);
 
 bool nativeRandomRange(objFiber* fiber, int argCount, Value* args);
 bool nativeRandomNumber(objFiber* fiber, int argCount, Value* args);
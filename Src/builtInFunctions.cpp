@@ -89,6 +89,7 @@ bool nativeArrayFill(objFiber* fiber, int argCount, Value* args) {
 		else if (!isObj && indexIsObj) arr->numOfHeapPtr--;
 		arr->values[i] = val;
 	}
+	ARRAY_WRITE_BARRIER(arr, start, end + 1, val);
 
 	fiber->transferValue(NIL_VAL());
 	return true;
@@ -100,7 +101,7 @@ bool nativeArrayPush(objFiber* fiber, int argCount, Value* args) {
 	//if numOfHeapPtr is 0 we don't trace or update the array when garbage collecting
 	if (IS_OBJ(*(args + 1))) arr->numOfHeapPtr++;
 	arr->values.push(*(args + 1));
-	global::gc.getCachedPtr();
+	ARRAY_WRITE_BARRIER(arr, arr->values.count() - 1, arr->values.count(), *(args + 1));
 	fiber->transferValue(NIL_VAL());
 	return true;
 }
@@ -127,6 +128,8 @@ bool nativeArrayInsert(objFiber* fiber, int argCount, Value* args) {
 	//if numOfHeapPtr is 0 we don't trace or update the array when garbage collecting
 	if (IS_OBJ(*(args + 2))) arr->numOfHeapPtr++;
 	arr->values.insert(*(args + 2), index);
+	ARRAY_SHIFT_BARRIER(arr, index);
+	ARRAY_WRITE_BARRIER(arr, index, index + 1, *(args + 2));
 
 	fiber->transferValue(NIL_VAL());
 	return true;
@@ -139,6 +142,7 @@ bool nativeArrayDelete(objFiber* fiber, int argCount, Value* args) {
 	double index = AS_NUMBER(*(args + 1));
 	arrRangeError(1, index, arr->values.count(), true);
 	Value val = arr->values.removeAt(index);
+	ARRAY_SHIFT_BARRIER(arr, index);
 
 	//if numOfHeapPtr is 0 we don't trace or update the array when garbage collecting
 	if (IS_OBJ(val)) arr->numOfHeapPtr--;
@@ -149,7 +153,7 @@ bool nativeArrayDelete(objFiber* fiber, int argCount, Value* args) {
 bool nativeArrayLength(objFiber* fiber, int argCount, Value* args) {
 	if (!IS_ARRAY(*args))throw expectedType("Expected a array, argument 0 is ", *args);
 	objArray* arr = AS_ARRAY(*args);
-	fiber->transferValue(NUMBER_VAL(AS_ARRAY(*args)->values.count()));
+	fiber->transferValue(INT_OR_NUMBER_VAL(AS_ARRAY(*args)->values.count()));
 	return true;
 }
 
@@ -390,7 +394,7 @@ bool nativeSqrt(objFiber* fiber, int argCount, Value* args) {
 #pragma region Strings
 bool nativeStringLength(objFiber* fiber, int argCount, Value* args) {
 	isString(*args, 0);
-	fiber->transferValue(NUMBER_VAL(AS_STRING(*args)->length));
+	fiber->transferValue(INT_OR_NUMBER_VAL(AS_STRING(*args)->length));
 	return true;
 }
 
@@ -475,7 +479,7 @@ bool nativeStringByteAt(objFiber* fiber, int argCount, Value* args) {
 	double pos = AS_NUMBER(*(args + 1));
 	strRangeError(1, pos, str->length);
 
-	fiber->transferValue(NUMBER_VAL(string(str->str)[pos]));
+	fiber->transferValue(INT_VAL(string(str->str)[pos]));
 	return true;
 }
 
@@ -593,6 +597,13 @@ bool nativeClock(objFiber* fiber, int argCount, Value* args) {
 	return true;
 }
 
+//lets the program spend time it has left over(the rest of a frame...) on incremental marking, returns true if a collection finished
+bool nativeGcStep(objFiber* fiber, int argCount, Value* args) {
+	if (!IS_NUMBER(*args)) throw expectedType("Expected a number of microseconds, argument 0 is ", *args);
+	fiber->transferValue(BOOL_VAL(global::gc.step(AS_NUMBER(*args))));
+	return true;
+}
+
 bool nativeRandomNumber(objFiber* fiber, int argCount, Value* args) {
 	fiber->transferValue(NUMBER_VAL(std::uniform_int_distribution<uInt64>(0, UINT64_MAX)(rng)));
 	return true;
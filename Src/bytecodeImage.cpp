@@ -0,0 +1,459 @@
+#include "bytecodeImage.h"
+#include "namespaces.h"
+#include "files.h"
+#include <unordered_map>
+
+using namespace global;
+
+#define IMAGE_MAGIC "IFSC"
+//used in place of a string index for functions without a name(the script)
+#define NO_NAME UINT32_MAX
+
+//only these can end up in a constants array
+enum class constantTag : uint8_t {
+	NIL,
+	BOOL,
+	NUMBER,
+	INT,
+	STRING,
+	FUNC,
+	CLOSURE,
+	MODULE
+};
+
+#pragma region Helpers
+//same FNV-1a hash that is used for strings
+static uInt64 hashSource(string& src) {
+	uInt64 hash = 14695981039346656037u;
+	for (uInt64 i = 0; i < src.size(); i++) {
+		hash ^= (uint8_t)src[i];
+		hash *= 1099511628211;
+	}
+	return hash;
+}
+
+static uInt64 hashSourceFile(string& sourceDir, objString* moduleName) {
+	string fullPath = sourceDir + string(moduleName->str) + ".ifs";
+	string src = readFile(fullPath);
+	return hashSource(src);
+}
+
+//everything is stored in the native byte order, images aren't meant to be moved between machines
+template<typename T>
+static void writeRaw(std::ofstream& out, T val) {
+	out.write(reinterpret_cast<char*>(&val), sizeof(T));
+}
+
+static void writeStr(std::ofstream& out, const char* str, uInt length) {
+	writeRaw<uInt>(out, length);
+	out.write(str, length);
+}
+
+template<typename T>
+static bool readRaw(std::ifstream& in, T& val) {
+	return static_cast<bool>(in.read(reinterpret_cast<char*>(&val), sizeof(T)));
+}
+
+static bool readStr(std::ifstream& in, string& str) {
+	uInt length;
+	if (!readRaw(in, length)) return false;
+	//a corrupt length would otherwise try to allocate gigabytes
+	if (length > (1u << 30)) return false;
+	str.resize(length);
+	return length == 0 || static_cast<bool>(in.read(&str[0], length));
+}
+#pragma endregion
+
+#pragma region Writing
+//gives every string, module and function a index, functions are found by walking the constants starting from the script
+class imageWriter {
+public:
+	std::ofstream out;
+	string sourceDir;
+	bool error;
+
+	vector<objString*> strings;
+	vector<objModule*> modules;
+	vector<objFunc*> funcs;
+
+	imageWriter(string path, string _sourceDir) : out(path, std::ios::binary), sourceDir(_sourceDir), error(false) {}
+
+	void collect(objFunc* script, vector<objModule*>& _modules) {
+		for (objModule* mod : _modules) {
+			moduleIDs[mod] = modules.size();
+			modules.push_back(mod);
+			addString(mod->name);
+			for (uInt i = 0; i < mod->globals.count(); i++) addString(mod->slotName(i));
+		}
+		addFunc(script);
+		//funcs grows while we walk it
+		for (uInt i = 0; i < funcs.size(); i++) {
+			objFunc* func = funcs[i];
+			if (func->name != nullptr) addString(func->name);
+			for (uInt j = 0; j < func->body.constants.count(); j++) {
+				Value val = func->body.constants[j];
+				if (!IS_OBJ(val)) continue;
+				switch (OBJ_TYPE(val)) {
+				case OBJ_STRING: addString(AS_STRING(val)); break;
+				case OBJ_FUNC: addFunc(AS_FUNCTION(val)); break;
+				case OBJ_CLOSURE: addFunc(AS_CLOSURE(val)->func); break;
+				case OBJ_MODULE: break;
+				default: error = true;
+				}
+			}
+		}
+	}
+
+	void writeHeader() {
+		out.write(IMAGE_MAGIC, 4);
+		writeRaw<uInt>(out, IMAGE_VERSION);
+		//superinstruction opcodes depend on the set the interpreter was built with
+		writeRaw<uInt>(out, SUPERINSTRUCTION_SET);
+		//every module is compiled from exactly one source file of the same name
+		writeRaw<uInt>(out, modules.size());
+		for (objModule* mod : modules) {
+			writeStr(out, mod->name->str, mod->name->length);
+			writeRaw<uInt64>(out, hashSourceFile(sourceDir, mod->name));
+		}
+	}
+
+	void writeObjects() {
+		writeRaw<uInt>(out, strings.size());
+		for (objString* str : strings) writeStr(out, str->str, str->length);
+
+		writeRaw<uInt>(out, modules.size());
+		for (objModule* mod : modules) {
+			writeRaw<uInt>(out, stringIDs[mod->name]);
+			writeRaw<uInt>(out, mod->globals.count());
+			for (uInt i = 0; i < mod->globals.count(); i++) writeRaw<uInt>(out, stringIDs[mod->slotName(i)]);
+		}
+
+		//headers of all functions come first so that every function is complete by the time a closure of it is made while loading
+		writeRaw<uInt>(out, funcs.size());
+		for (objFunc* func : funcs) {
+			writeRaw<uInt>(out, func->name == nullptr ? NO_NAME : stringIDs[func->name]);
+			writeRaw<int>(out, func->arity);
+			writeRaw<int>(out, func->upvalueCount);
+		}
+		for (objFunc* func : funcs) writeChunk(func->body);
+	}
+private:
+	std::unordered_map<objString*, uInt> stringIDs;
+	std::unordered_map<objModule*, uInt> moduleIDs;
+	std::unordered_map<objFunc*, uInt> funcIDs;
+
+	void addString(objString* str) {
+		if (str == nullptr || stringIDs.count(str) > 0) return;
+		stringIDs[str] = strings.size();
+		strings.push_back(str);
+	}
+
+	void addFunc(objFunc* func) {
+		if (funcIDs.count(func) > 0) return;
+		funcIDs[func] = funcs.size();
+		funcs.push_back(func);
+	}
+
+	void writeChunk(chunk& body) {
+		writeRaw<uInt>(out, body.code.count());
+		out.write(reinterpret_cast<char*>(body.code.data()), body.code.count());
+
+		writeRaw<uInt>(out, body.constants.count());
+		for (uInt i = 0; i < body.constants.count(); i++) writeValue(body.constants[i]);
+
+		writeRaw<uInt>(out, body.lines.size());
+		for (codeLine& line : body.lines) {
+			writeRaw<uInt64>(out, line.line);
+			writeRaw<uInt64>(out, line.end);
+			writeStr(out, line.name.c_str(), line.name.size());
+		}
+
+		writeRaw<uInt>(out, body.inlined.size());
+		for (inlinedCall& call : body.inlined) {
+			writeRaw<uInt>(out, call.start);
+			writeRaw<uInt>(out, call.end);
+			writeRaw<uInt64>(out, call.line);
+			writeStr(out, call.name.c_str(), call.name.size());
+		}
+
+		writeRaw<uInt>(out, body.switchTables.size());
+		for (switchTable& table : body.switchTables) {
+			writeRaw<uint8_t>(out, (uint8_t)table.type);
+			writeRaw<uInt64>(out, table.defaultJump);
+			writeRaw<uInt>(out, table.table.size());
+			for (auto& pair : table.table) {
+				writeStr(out, pair.first.c_str(), pair.first.size());
+				writeRaw<uInt64>(out, pair.second);
+			}
+			writeRaw<uInt>(out, table.arr.count());
+			for (uInt i = 0; i < table.arr.count(); i++) {
+				writeRaw<int>(out, table.arr[i].key);
+				writeRaw<uInt64>(out, table.arr[i].ip);
+			}
+		}
+
+		//only the offsets are stored, caches always start out empty
+		writeRaw<uInt>(out, body.caches.size());
+		for (inlineCache& cache : body.caches) writeRaw<uInt>(out, cache.offset);
+	}
+
+	void writeValue(Value val) {
+		if (IS_NIL(val)) writeRaw(out, constantTag::NIL);
+		else if (IS_BOOL(val)) {
+			writeRaw(out, constantTag::BOOL);
+			writeRaw<uint8_t>(out, AS_BOOL(val));
+		}
+		else if (IS_INT(val)) {
+			writeRaw(out, constantTag::INT);
+			writeRaw<int32_t>(out, AS_INT(val));
+		}
+		else if (IS_NUMBER(val)) {
+			writeRaw(out, constantTag::NUMBER);
+			writeRaw<double>(out, AS_NUMBER(val));
+		}
+		else switch (OBJ_TYPE(val)) {
+		case OBJ_STRING:
+			writeRaw(out, constantTag::STRING);
+			writeRaw<uInt>(out, stringIDs[AS_STRING(val)]);
+			break;
+		case OBJ_FUNC:
+			writeRaw(out, constantTag::FUNC);
+			writeRaw<uInt>(out, funcIDs[AS_FUNCTION(val)]);
+			break;
+		case OBJ_CLOSURE:
+			writeRaw(out, constantTag::CLOSURE);
+			writeRaw<uInt>(out, funcIDs[AS_CLOSURE(val)->func]);
+			break;
+		case OBJ_MODULE:
+			writeRaw(out, constantTag::MODULE);
+			writeRaw<uInt>(out, moduleIDs[AS_MODULE(val)]);
+			break;
+		}
+	}
+};
+
+bool bytecodeImage::write(string path, string sourceDir, objFunc* script, vector<objModule*>& modules) {
+	//nothing in here allocates, so none of the pointers can move while writing
+	imageWriter writer(path, sourceDir);
+	if (!writer.out.is_open()) return false;
+	writer.collect(script, modules);
+	if (writer.error) return false;
+	writer.writeHeader();
+	writer.writeObjects();
+	return static_cast<bool>(writer.out);
+}
+#pragma endregion
+
+#pragma region Reading
+bool bytecodeImage::read(string path, string sourceDir) {
+	in.open(path, std::ios::binary);
+	if (!in.is_open()) return false;
+	char magic[4];
+	uInt version;
+	uInt superinstructions;
+	if (!in.read(magic, 4) || string(magic, 4) != IMAGE_MAGIC) return false;
+	if (!readRaw(in, version) || version != IMAGE_VERSION) return false;
+	if (!readRaw(in, superinstructions) || superinstructions != SUPERINSTRUCTION_SET) return false;
+	//checked before anything is allocated, a stale image is never loaded
+	if (!readSources(sourceDir)) return false;
+
+	//from here on a collection can happen, the GC marks and updates everything in funcs, modules and strings
+	gc.imageSession = this;
+	if (!readStrings() || !readModules() || !readFuncs()) {
+		fail();
+		return false;
+	}
+	in.close();
+	return true;
+}
+
+bool bytecodeImage::readSources(string& sourceDir) {
+	uInt count;
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		string name;
+		uInt64 hash;
+		if (!readStr(in, name) || !readRaw(in, hash)) return false;
+		string fullPath = sourceDir + name + ".ifs";
+		string src = readFile(fullPath);
+		if (hashSource(src) != hash) return false;
+	}
+	return true;
+}
+
+bool bytecodeImage::readStrings() {
+	uInt count;
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		string str;
+		if (!readStr(in, str)) return false;
+		//interned strings are weak references, so until the VM takes over, strings is the only thing keeping these alive
+		objString* interned = copyString(str);
+		strings.push_back(interned);
+	}
+	return true;
+}
+
+bool bytecodeImage::readModules() {
+	uInt count;
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		uInt name, slotCount;
+		if (!readRaw(in, name) || name >= strings.size() || !readRaw(in, slotCount)) return false;
+		objModule* mod = new objModule(strings[name]);
+		modules.push_back(mod);
+		for (uInt j = 0; j < slotCount; j++) {
+			objString* varName = readStringRef();
+			//resolveSlot only allocates on the LOH, so the module stays where it is
+			if (varName == nullptr || modules.back()->resolveSlot(varName) != j) return false;
+		}
+	}
+	return true;
+}
+
+bool bytecodeImage::readFuncs() {
+	uInt count;
+	if (!readRaw(in, count) || count == 0) return false;
+	for (uInt i = 0; i < count; i++) {
+		objFunc* func = new objFunc();
+		funcs.push_back(func);
+	}
+	for (uInt i = 0; i < count; i++) {
+		uInt name;
+		if (!readRaw(in, name) || !readRaw(in, funcs[i]->arity) || !readRaw(in, funcs[i]->upvalueCount)) return false;
+		if (name != NO_NAME && name >= strings.size()) return false;
+		funcs[i]->name = name == NO_NAME ? nullptr : strings[name];
+	}
+	for (uInt i = 0; i < count; i++) {
+		if (!readChunk(i)) return false;
+	}
+	return true;
+}
+
+//closure constants allocate on the normal heap, which can move every function, so the chunk is always reached through funcs
+bool bytecodeImage::readChunk(uInt func) {
+	uInt count;
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		uint8_t byte;
+		if (!readRaw(in, byte)) return false;
+		funcs[func]->body.code.push(byte);
+	}
+
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		Value val;
+		if (!readValue(val)) return false;
+		//only allocates on the LOH, so a closure in val can't move
+		funcs[func]->body.constants.push(val);
+	}
+
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		codeLine line;
+		if (!readRaw(in, line.line) || !readRaw(in, line.end) || !readStr(in, line.name)) return false;
+		funcs[func]->body.lines.push_back(line);
+	}
+
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		inlinedCall call;
+		if (!readRaw(in, call.start) || !readRaw(in, call.end) || !readRaw(in, call.line) || !readStr(in, call.name)) return false;
+		funcs[func]->body.inlined.push_back(call);
+	}
+
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		uint8_t type;
+		uInt64 defaultJump;
+		uInt size;
+		if (!readRaw(in, type) || !readRaw(in, defaultJump) || !readRaw(in, size)) return false;
+		int pos = funcs[func]->body.addSwitch(switchTable((switchType)type, 0));
+		funcs[func]->body.switchTables[pos].defaultJump = defaultJump;
+		for (uInt j = 0; j < size; j++) {
+			string key;
+			uInt64 ip;
+			if (!readStr(in, key) || !readRaw(in, ip)) return false;
+			funcs[func]->body.switchTables[pos].addToTable(key, ip);
+		}
+		if (!readRaw(in, size)) return false;
+		for (uInt j = 0; j < size; j++) {
+			int key;
+			uInt64 ip;
+			if (!readRaw(in, key) || !readRaw(in, ip)) return false;
+			funcs[func]->body.switchTables[pos].addToArr(key, ip);
+		}
+	}
+
+	if (!readRaw(in, count)) return false;
+	for (uInt i = 0; i < count; i++) {
+		uInt offset;
+		if (!readRaw(in, offset) || offset >= funcs[func]->body.code.count()) return false;
+		funcs[func]->body.addCache(offset);
+	}
+	return true;
+}
+
+bool bytecodeImage::readValue(Value& val) {
+	constantTag tag;
+	if (!readRaw(in, tag)) return false;
+	switch (tag) {
+	case constantTag::NIL: val = NIL_VAL(); return true;
+	case constantTag::BOOL: {
+		uint8_t boolean;
+		if (!readRaw(in, boolean)) return false;
+		val = BOOL_VAL(boolean != 0);
+		return true;
+	}
+	case constantTag::INT: {
+		int32_t num;
+		if (!readRaw(in, num)) return false;
+		val = INT_VAL(num);
+		return true;
+	}
+	case constantTag::NUMBER: {
+		double num;
+		if (!readRaw(in, num)) return false;
+		val = NUMBER_VAL(num);
+		return true;
+	}
+	case constantTag::STRING: {
+		objString* str = readStringRef();
+		if (str == nullptr) return false;
+		val = OBJ_VAL(str);
+		return true;
+	}
+	case constantTag::FUNC:
+	case constantTag::CLOSURE: {
+		uInt index;
+		if (!readRaw(in, index) || index >= funcs.size()) return false;
+		//funcs[index] is read after the closure is allocated, so it's never stale
+		if (tag == constantTag::CLOSURE) val = OBJ_VAL(new objClosure(funcs[index]));
+		else val = OBJ_VAL(funcs[index]);
+		return true;
+	}
+	case constantTag::MODULE: {
+		uInt index;
+		if (!readRaw(in, index) || index >= modules.size()) return false;
+		val = OBJ_VAL(modules[index]);
+		return true;
+	}
+	}
+	return false;
+}
+
+objString* bytecodeImage::readStringRef() {
+	uInt index;
+	if (!readRaw(in, index) || index >= strings.size()) return nullptr;
+	return strings[index];
+}
+
+//everything that was loaded is garbage now
+void bytecodeImage::fail() {
+	funcs.clear();
+	modules.clear();
+	strings.clear();
+	gc.imageSession = nullptr;
+	in.close();
+}
+#pragma endregion
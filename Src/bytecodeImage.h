@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+#include "object.h"
+#include <fstream>
+
+//bump whenever the OpCode enum or the layout of the image changes, images with a different version are never loaded
+#define IMAGE_VERSION 6
+
+//.ifsc files hold everything the compiler produces: every function's chunk, the module table and all string constants
+//along with a hash of every source file that went into them, so a image is only ever ran if none of the sources changed
+//
+//loaded objects are kept in the arrays below until the VM takes over, the GC treats them as roots(like it does with the compiler)
+class bytecodeImage {
+public:
+	//script function is always at index 0
+	vector<objFunc*> funcs;
+	vector<objModule*> modules;
+	vector<objString*> strings;
+
+	bytecodeImage() {};
+	//returns false if the image doesn't exist, is corrupt, was made by a different version(or set of superinstructions) or any of it's sources changed
+	bool read(string path, string sourceDir);
+	//the image is written before any code runs, so chunks never contain quickened instructions or filled inline caches
+	static bool write(string path, string sourceDir, objFunc* script, vector<objModule*>& modules);
+private:
+	std::ifstream in;
+
+	bool readSources(string& sourceDir);
+	bool readStrings();
+	bool readModules();
+	bool readFuncs();
+	bool readChunk(uInt func);
+	bool readValue(Value& val);
+	objString* readStringRef();
+	void fail();
+};
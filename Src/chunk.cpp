@@ -1,5 +1,6 @@
 #include "chunk.h"
 #include "debug.h"
+#include "object.h"
 
 void chunk::writeData(uint8_t opCode, uInt line, string& name) {
 	code.push(opCode);
@@ -16,19 +17,123 @@ void chunk::writeData(uint8_t opCode, uInt line, string& name) {
 //first checks if this value already exists, this helps keep the constants array small
 uInt chunk::addConstant(Value val) {
 	for (uInt i = 0; i < constants.count(); i++) {
-		if (valuesEqual(constants[i], val)) return i;
+		//1 and 1.0 are equal, but they shouldn't share a constant
+		if (IS_INT(constants[i]) == IS_INT(val) && valuesEqual(constants[i], val)) return i;
 	}
 	uInt size = constants.count();
 	constants.push(val);
 	return size;
 }
 
+//size of the instruction at 'offset' in bytes, opcode included
+uInt chunk::instructionLength(uInt offset) {
+	switch (genericOpcode(code[offset])) {
+	case OP_POPN:
+	case OP_CONSTANT:
+	case OP_DEFINE_GLOBAL:
+	case OP_GET_LOCAL:
+	case OP_SET_LOCAL:
+	case OP_GET_UPVALUE:
+	case OP_SET_UPVALUE:
+	case OP_CREATE_ARRAY:
+	case OP_SWITCH:
+	case OP_CALL:
+	case OP_GET_SUPER:
+	case OP_FIBER_RUN:
+	case OP_MODULE_GET:
+		return 2;
+	case OP_CONSTANT_LONG:
+	case OP_DEFINE_GLOBAL_LONG:
+	case OP_GET_GLOBAL:
+	case OP_SET_GLOBAL:
+	case OP_JUMP:
+	case OP_JUMP_IF_FALSE:
+	case OP_JUMP_IF_TRUE:
+	case OP_JUMP_IF_FALSE_POP:
+	case OP_LOOP:
+	case OP_CLASS:
+	case OP_METHOD:
+	case OP_GET_SUPER_LONG:
+	case OP_SUPER_INVOKE:
+	case OP_MODULE_GET_LONG:
+	case OP_REG_MOVE:
+	case OP_REG_LOAD:
+		return 3;
+	case OP_GET_PROPERTY:
+	case OP_SET_PROPERTY:
+	case OP_SUPER_INVOKE_LONG:
+	case OP_FIBER_CREATE:
+	case OP_REG_ADD:
+	case OP_REG_SUBTRACT:
+	case OP_REG_MULTIPLY:
+	case OP_REG_DIVIDE:
+	case OP_REG_MOD:
+	case OP_REG_EQUAL:
+	case OP_REG_NOT_EQUAL:
+	case OP_REG_GREATER:
+	case OP_REG_GREATER_EQUAL:
+	case OP_REG_LESS:
+	case OP_REG_LESS_EQUAL:
+	case OP_REG_ADD_K:
+	case OP_REG_SUBTRACT_K:
+	case OP_REG_MULTIPLY_K:
+	case OP_REG_DIVIDE_K:
+	case OP_REG_MOD_K:
+	case OP_REG_EQUAL_K:
+	case OP_REG_NOT_EQUAL_K:
+	case OP_REG_GREATER_K:
+	case OP_REG_GREATER_EQUAL_K:
+	case OP_REG_LESS_K:
+	case OP_REG_LESS_EQUAL_K:
+		return 4;
+	case OP_GET_GLOBAL_LONG:
+	case OP_SET_GLOBAL_LONG:
+	case OP_JUMP_POPN:
+	case OP_GET_PROPERTY_LONG:
+	case OP_SET_PROPERTY_LONG:
+	case OP_INVOKE:
+		return 5;
+	case OP_INVOKE_LONG:
+		return 6;
+	//every captured upvalue is 2 more bytes(isLocal and index)
+	case OP_CLOSURE:
+		return 2 + 2 * AS_FUNCTION(constants[code[offset + 1]])->upvalueCount;
+	case OP_CLOSURE_LONG:
+		return 3 + 2 * AS_FUNCTION(constants[(code[offset + 1] << 8) | code[offset + 2]])->upvalueCount;
+	//field name constants follow the field count
+	case OP_CREATE_STRUCT:
+		return 2 + code[offset + 1];
+	case OP_CREATE_STRUCT_LONG:
+		return 2 + 2 * code[offset + 1];
+	default:
+		return 1;
+	}
+}
+
 int chunk::addSwitch(switchTable table) {
 	int size = switchTables.size();
 	switchTables.push_back(table);
 	return size;
 }
 
+uInt16 chunk::addCache(uInt offset) {
+	uInt16 size = caches.size();
+	caches.push_back(inlineCache(offset));
+	return size;
+}
+
+//once a site has seen more than IC_MAX_ENTRIES shapes it's considered megamorphic and is never cached again
+void inlineCache::add(cacheEntry entry) {
+	if (state == cacheState::MEGAMORPHIC) return;
+	if (count == IC_MAX_ENTRIES) {
+		state = cacheState::MEGAMORPHIC;
+		count = 0;
+		return;
+	}
+	entries[count++] = entry;
+	state = count == 1 ? cacheState::MONOMORPHIC : cacheState::POLYMORPHIC;
+}
+
 void chunk::disassemble(string name) {
 	std::cout << "=======" << name << "=======\n";
 	//prints every instruction in chunk
@@ -44,3 +149,32 @@ codeLine chunk::getLine(uInt offset) {
 	std::cout << "FUck";
 	exit(64);
 }
+
+uint8_t genericOpcode(uint8_t op) {
+	switch (op) {
+	case OP_ADD_INT_INT: case OP_ADD_NUM_NUM: case OP_ADD_NUM: return OP_ADD;
+	case OP_SUBTRACT_INT_INT: case OP_SUBTRACT_NUM_NUM: case OP_SUBTRACT_NUM: return OP_SUBTRACT;
+	case OP_MULTIPLY_NUM: return OP_MULTIPLY;
+	case OP_DIVIDE_NUM: return OP_DIVIDE;
+	case OP_ADD_1_NUM: return OP_ADD_1;
+	case OP_SUBTRACT_1_NUM: return OP_SUBTRACT_1;
+	case OP_LESS_INT_INT: case OP_LESS_NUM_NUM: case OP_LESS_NUM: return OP_LESS;
+	case OP_LESS_EQUAL_NUM: return OP_LESS_EQUAL;
+	case OP_GREATER_NUM: return OP_GREATER;
+	case OP_GREATER_EQUAL_NUM: return OP_GREATER_EQUAL;
+	case OP_GET_ARRAY_NUM: return OP_GET;
+	case OP_SET_ARRAY_NUM: return OP_SET;
+	case OP_CALL_CLOSURE: return OP_CALL;
+	case OP_LESS_JUMP: return OP_LESS;
+	case OP_EQUAL_JUMP: return OP_EQUAL;
+	case OP_FOR_INCR_LOOP: case OP_FOR_INCR_LOOP_K: return OP_GET_LOCAL;
+	#define SUPERINSTRUCTION_FIRST(name, op0, op1, op2, op3) case name: return op0;
+	SUPERINSTRUCTION_LIST(SUPERINSTRUCTION_FIRST)
+	#undef SUPERINSTRUCTION_FIRST
+	}
+	return op;
+}
+
+bool isFusedBranch(uint8_t op) {
+	return op == OP_LESS_JUMP || op == OP_EQUAL_JUMP || op == OP_FOR_INCR_LOOP || op == OP_FOR_INCR_LOOP_K;
+}
@@ -4,6 +4,7 @@
 #include "value.h"
 #include "switch.h"
 #include "gcVector.h"
+#include "superinstruction.h"
 
 using std::vector;
 
@@ -101,8 +102,88 @@ enum OpCode {
 	OP_START_MODULE,
 	OP_MODULE_GET,
 	OP_MODULE_GET_LONG,
+
+	//Quickened
+	//never emitted by the compiler, the VM rewrites generic instructions into these once it has seen their operand types
+	//every one of them has the same operand layout as the generic instruction it replaces
+	OP_ADD_INT_INT,
+	OP_ADD_NUM_NUM,
+	OP_SUBTRACT_INT_INT,
+	OP_SUBTRACT_NUM_NUM,
+	OP_LESS_INT_INT,
+	OP_LESS_NUM_NUM,
+	OP_GET_ARRAY_NUM,
+	OP_SET_ARRAY_NUM,
+	OP_CALL_CLOSURE,
+
+	//Typed
+	//emitted by the type inference in place of the generic instruction when it proves the types of the operands(see ssa.h),
+	//they never check their operands and have the same operand layout as the generic instruction
+	OP_ADD_NUM,
+	OP_ADD_STRING,
+	OP_SUBTRACT_NUM,
+	OP_MULTIPLY_NUM,
+	OP_DIVIDE_NUM,
+	OP_ADD_1_NUM,
+	OP_SUBTRACT_1_NUM,
+	OP_GREATER_NUM,
+	OP_GREATER_EQUAL_NUM,
+	OP_LESS_NUM,
+	OP_LESS_EQUAL_NUM,
+
+	//Register
+	//three-address instructions over the frame's slots, the peephole pass fuses the stack instructions that load the operands,
+	//compute the result and store it into them(see peephole.h), the destination is a slot or REG_TOP which pushes the result
+	//dst src
+	OP_REG_MOVE,
+	//dst constant
+	OP_REG_LOAD,
+	//dst a b
+	OP_REG_ADD,
+	OP_REG_SUBTRACT,
+	OP_REG_MULTIPLY,
+	OP_REG_DIVIDE,
+	OP_REG_MOD,
+	OP_REG_EQUAL,
+	OP_REG_NOT_EQUAL,
+	OP_REG_GREATER,
+	OP_REG_GREATER_EQUAL,
+	OP_REG_LESS,
+	OP_REG_LESS_EQUAL,
+	//dst a constant
+	OP_REG_ADD_K,
+	OP_REG_SUBTRACT_K,
+	OP_REG_MULTIPLY_K,
+	OP_REG_DIVIDE_K,
+	OP_REG_MOD_K,
+	OP_REG_EQUAL_K,
+	OP_REG_NOT_EQUAL_K,
+	OP_REG_GREATER_K,
+	OP_REG_GREATER_EQUAL_K,
+	OP_REG_LESS_K,
+	OP_REG_LESS_EQUAL_K,
+	//Fused branches
+	//written over the comparison of a comparison followed by OP_JUMP_IF_FALSE_POP
+	OP_LESS_JUMP,
+	OP_EQUAL_JUMP,
+	//written over the first instruction of the increment at the end of a counted loop, the limit is a local or a constant
+	OP_FOR_INCR_LOOP,
+	OP_FOR_INCR_LOOP_K,
+	//Superinstructions
+	#define SUPERINSTRUCTION_OPCODE(name, op0, op1, op2, op3) name,
+	SUPERINSTRUCTION_LIST(SUPERINSTRUCTION_OPCODE)
+	#undef SUPERINSTRUCTION_OPCODE
 };
 
+//destination of a register instruction that pushes it's result instead of storing it in a slot
+#define REG_TOP 255
+
+//quickened and typed instructions have the same operands as the generic ones, superinstructions and fused branches the operands of
+//the first instruction they fuse
+uint8_t genericOpcode(uint8_t op);
+//fused branches run instructions past the one they replace, so they can't be a part of a superinstruction
+bool isFusedBranch(uint8_t op);
+
 
 struct codeLine {
 	uInt64 end;
@@ -120,6 +201,79 @@ struct codeLine {
 	}
 };
 
+//range of code that was compiled from the body of a inlined function,
+//runtime errors inside of it get an extra entry in the callstack as if the function was called
+struct inlinedCall {
+	uInt start;
+	uInt end;
+	//line of the call that was replaced
+	uInt64 line;
+	string name;
+	inlinedCall() : start(0), end(0), line(0), name("") {}
+	inlinedCall(uInt _start, uInt _end, uInt64 _line, string _name) : start(_start), end(_end), line(_line), name(_name) {}
+};
+
+class objShape;
+class objClosure;
+
+//max number of shapes a single property access site remembers before giving up on caching
+#define IC_MAX_ENTRIES 4
+
+enum class cacheState {
+	EMPTY,
+	MONOMORPHIC,
+	POLYMORPHIC,
+	MEGAMORPHIC
+};
+
+struct cacheEntry {
+	//instances with this shape hit this entry, shapes are unique to a class so this also decides the class
+	objShape* shape;
+	//only used by stores that add a new field, shape the instance has after the store
+	objShape* next;
+	uInt slot;
+	//set if the property is a method of the class instead of a field
+	objClosure* method;
+	cacheEntry() : shape(nullptr), next(nullptr), slot(0), method(nullptr) {}
+	cacheEntry(objShape* _shape, objShape* _next, uInt _slot, objClosure* _method)
+		: shape(_shape), next(_next), slot(_slot), method(_method) {}
+};
+
+//every OP_GET_PROPERTY, OP_SET_PROPERTY and OP_INVOKE gets it's own cache, the index of which follows the other operands
+struct inlineCache {
+	cacheState state;
+	uInt count;
+	cacheEntry entries[IC_MAX_ENTRIES];
+	//offset of the instruction that uses this cache
+	uInt offset;
+	uInt64 hits;
+	uInt64 misses;
+	inlineCache(uInt _offset) : state(cacheState::EMPTY), count(0), offset(_offset), hits(0), misses(0) {}
+
+	cacheEntry* find(objShape* shape) {
+		for (uInt i = 0; i < count; i++) {
+			if (entries[i].shape == shape) return &entries[i];
+		}
+		return nullptr;
+	}
+	void add(cacheEntry entry);
+};
+
+#ifdef TRACING_JIT
+struct traceCode;
+
+//every loop header that's the target of a OP_LOOP gets one once the back edge runs, see trace.h
+struct traceAnchor {
+	uInt offset;
+	//back edges taken since the last time the loop was recorded
+	uInt hotness;
+	//once this reaches TRACE_MAX_ABORTS the loop is never recorded again
+	uInt aborts;
+	traceCode* compiled;
+	traceAnchor(uInt _offset) : offset(_offset), hotness(0), aborts(0), compiled(nullptr) {}
+};
+#endif
+
 //disassemble is here, but the functions it calls are in debug.cpp
 class chunk {
 public:
@@ -129,10 +283,17 @@ public:
 	gcVector<uint8_t> code;
 	gcVector<Value> constants;
 	vector<switchTable> switchTables;
+	vector<inlineCache> caches;
+	vector<inlinedCall> inlined;
+	#ifdef TRACING_JIT
+	vector<traceAnchor> anchors;
+	#endif
 	chunk() {};
 	void writeData(uint8_t opCode, uInt line, string& name);
 	codeLine getLine(uInt offset);
 	void disassemble(string name);
 	uInt addConstant(Value val);
 	int addSwitch(switchTable table);
+	uInt16 addCache(uInt offset);
+	uInt instructionLength(uInt offset);
 };
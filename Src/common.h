@@ -23,4 +23,104 @@ namespace global {
 //WARNING: massivly slows down code execution
 //#define DEBUG_TRACE_EXECUTION
 //#define DEBUG_GC
-//#define DEBUG_STRESS_GC
\ No newline at end of file
+//#define DEBUG_STRESS_GC
+//prints how many minor and major collections ran and how long they paused the program once it finishes
+//#define DEBUG_GC_PAUSES
+//prints the state and hit rate of every inline cache once the program finishes
+//#define DEBUG_INLINE_CACHE
+//prints the size of every function's code before and after the peephole pass
+//#define DEBUG_PEEPHOLE
+//prints the SSA form of every function after the SSA passes have marked their changes
+//#define DEBUG_PRINT_SSA
+//prints how many arithmetic and comparison instructions of every function the type inference specialized
+//#define DEBUG_TYPE_INFERENCE
+//prints how many instructions the interpreter dispatched once the program finishes(machine code doesn't count)
+//#define DEBUG_COUNT_INSTRUCTIONS
+//counts the sequences of instructions that run back to back, --profile adds them to a file superinstructions are generated from(see superinstruction.h)
+//#define PROFILE_SEQUENCES
+
+//packs every value into a single 64 bit word(quiet NaN payloads for everything other than numbers), halves the size of Value
+//comment out to use the tagged union representation
+#define NAN_BOXING
+
+//compiles functions that run hot to x86-64 machine code(see jit.h), needs NAN_BOXING and only works on x86-64 Linux,
+//uncomment to run hot functions natively, --jit-stats prints what was compiled once the program finishes
+//#define BASELINE_JIT
+
+//records a single iteration of loops that run hot and compiles it to x86-64 with type guards(see trace.h), same requirements as BASELINE_JIT,
+//uncomment to trace hot loops, --jit-stats also prints every trace and why the loops that couldn't be traced were aborted
+//#define TRACING_JIT
+#if !defined(NAN_BOXING) || !defined(__x86_64__) || !defined(__linux__)
+#undef BASELINE_JIT
+#undef TRACING_JIT
+#endif
+
+//defined when building the interpreter together with the C++ that -aot wrote for a program(see aot.h),
+//uncomment to run the functions of that program natively, --no-aot and --aot-test compare it against the interpreter
+//#define AOT_BUILD
+
+//rewrites generic arithmetic, comparison, indexing and call instructions into type specialized ones after they execute,
+//comment out to always run the generic instructions
+#define QUICKENING
+
+//folds constant expressions and removes dead branches/loops before compiling,
+//comment out to compile the AST exactly as it was parsed
+#define AST_OPTIMIZE
+
+//compiles calls to small module level functions as the body of the function(see inliner.h),
+//comment out to always emit a real call
+#define INLINE_FUNCTIONS
+
+//runs dead store elimination, loop invariant code motion and global value numbering on the SSA form of every function(see ssa.h),
+//comment out to leave the compiled code as it is
+#define SSA_OPTIMIZE
+
+//emits unchecked arithmetic and comparison instructions where the operands are proven to always be numbers or strings(see ssa.h),
+//comment out to only use the generic instructions
+#define TYPE_INFERENCE
+
+//runs the peephole pass over every function once it's compiled(jump threading, dead code removal, pop merging),
+//comment out to run the code exactly as the compiler emitted it
+#define PEEPHOLE_OPTIMIZE
+
+//fuses the stack instructions of simple arithmetic, comparisons and assignments between locals into three-address register instructions
+//in the peephole pass(see peephole.h), needs PEEPHOLE_OPTIMIZE, uncomment to compile for the register instruction set
+//#define REGISTER_ISA
+#ifndef PEEPHOLE_OPTIMIZE
+#undef REGISTER_ISA
+#endif
+
+//replaces the instruction sequences listed in superinstructionSet.h with a superinstruction that runs all of them with a single dispatch
+//in the peephole pass(see superinstruction.h), needs PEEPHOLE_OPTIMIZE, comment out to dispatch every instruction on it's own
+#define SUPERINSTRUCTIONS
+//profiles are made from the instructions the compiler emits without them
+#if !defined(PEEPHOLE_OPTIMIZE) || defined(PROFILE_SEQUENCES)
+#undef SUPERINSTRUCTIONS
+#endif
+
+//replaces comparisons followed by a conditional jump and the increment at the end of 'for (var i = ...; i < n; i++)' loops with
+//instructions that also branch(see peephole.h), needs PEEPHOLE_OPTIMIZE, comment out to compare and branch separately
+#define FUSED_BRANCHES
+#ifndef PEEPHOLE_OPTIMIZE
+#undef FUSED_BRANCHES
+#endif
+
+//allocates objects in a nursery that's emptied by minor collections which only trace the young objects, stores into older objects go
+//through a write barrier(see memory.h), comment out to only run full mark-compact collections
+#define GENERATIONAL_GC
+
+//marks the heap in small slices while the program allocates instead of all at once when a heap fills up, only finding what changed
+//and compacting pauses the program(see memory.h), needs GENERATIONAL_GC, comment out to mark everything in a single pause
+#define INCREMENTAL_GC
+#ifndef GENERATIONAL_GC
+#undef INCREMENTAL_GC
+#endif
+
+//full collections mark, compute addresses, update pointers and compact on several threads(see parallelGC.h), --gc-threads sets how many,
+//comment out to always collect on the thread that runs the program
+#define PARALLEL_GC
+
+//uses computed gotos for instruction dispatch on compilers that support them(GCC and Clang), otherwise a switch is used
+#if defined(__GNUC__) || defined(__clang__)
+#define THREADED_DISPATCH
+#endif
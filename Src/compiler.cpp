@@ -1,5 +1,9 @@
 #include "compiler.h"
 #include "namespaces.h"
+#include "peephole.h"
+#include "ssa.h"
+#include "optimizer.h"
+#include "inliner.h"
 #ifdef DEBUG_PRINT_CODE
 #include "debug.h"
 #endif
@@ -11,6 +15,7 @@ compilerInfo::compilerInfo(compilerInfo* _enclosing, funcType _type) : enclosing
 	upvalues = std::array<upvalue, UPVAL_MAX>();
 	hasReturn = false;
 	hasCapturedLocals = false;
+	stmtStart = -1;
 	localCount = 0;
 	scopeDepth = 0;
 	line = 0;
@@ -35,8 +40,16 @@ compiler::compiler(string path, string fileName, funcType _type) {
 
 	current = new compilerInfo(nullptr, funcType::TYPE_SCRIPT);
 	currentClass = nullptr;
+	inlineBase = -1;
 	//if compiled is false the bytecode produces isn't ran
 	if (Parser.hadError) compiled = false;
+	#ifdef AST_OPTIMIZE
+	//has to outlive the AST, folded literals point to strings it owns
+	ASTOptimizer optimizer;
+	if (compiled) {
+		for (translationUnit* unit : sortedUnits) optimizer.optimize(unit->stmts);
+	}
+	#endif
 
 	for (translationUnit* unit : sortedUnits) {
 		curUnit = unit;
@@ -53,13 +66,32 @@ compiler::compiler(string path, string fileName, funcType _type) {
 			for (objModule* mod : modules) {
 				if (mod->name->compare(depName)) {
 					emitConstant(OBJ_VAL(mod));
-					emitByte(OP_DEFINE_GLOBAL_LONG);
-					emit16Bit(makeConstant(OBJ_VAL(copyString(depName))));
+					objString* str = copyString(depName);
+					emitByteAnd16Bit(OP_DEFINE_GLOBAL_LONG, modules[modules.size() - 1]->resolveSlot(str));
 					break;
 				}
 			}
 		}
 
+		#if defined(SSA_OPTIMIZE) || defined(TYPE_INFERENCE)
+		//reads of globals the module never declares always go to the native of the same name
+		std::unordered_set<string>& names = declaredGlobals[unit->name];
+		for (translationUnit* dep : unit->deps) names.insert(dep->name);
+		for (ASTNode* stmt : unit->stmts) {
+			switch (stmt->type) {
+			case ASTType::VAR_DECL: names.insert(((ASTVarDecl*)stmt)->getToken().getLexeme()); break;
+			case ASTType::FUNC: names.insert(((ASTFunc*)stmt)->getName().getLexeme()); break;
+			case ASTType::CLASS: names.insert(((ASTClass*)stmt)->getName().getLexeme()); break;
+			}
+		}
+		#endif
+
+		#ifdef INLINE_FUNCTIONS
+		inlineScanner scanner;
+		inlineCandidates = scanner.scan(unit->stmts);
+		inlinable.clear();
+		#endif
+
 		for (int i = 0; i < unit->stmts.size(); i++) {
 			//doing this here so that even if a error is detected, we go on and possibly catch other(valid) errors
 			try {
@@ -67,6 +99,7 @@ compiler::compiler(string path, string fileName, funcType _type) {
 			}
 			catch (int e) {
 				compiled = false;
+				inlineBase = -1;
 			}
 		}
 	}
@@ -99,8 +132,10 @@ void compiler::visitSetExpr(ASTSetExpr* expr) {
 		expr->getCallee()->accept(this);
 		expr->getValue()->accept(this);
 		uInt16 name = identifierConstant(((ASTLiteralExpr*)expr->getField())->getToken());
+		uInt offset = getChunk()->code.count();
 		if (name < UINT8_MAX) emitBytes(OP_SET_PROPERTY, name);
 		else emitByteAnd16Bit(OP_SET_PROPERTY_LONG, name);
+		emitCache(offset);
 		break;
 	}
 	}
@@ -203,6 +238,7 @@ void compiler::visitArrayDeclExpr(ASTArrayDeclExpr* expr) {
 
 void compiler::visitCallExpr(ASTCallExpr* expr) {
 	updateLine(expr->getAccessor());
+	if (inlineCall(expr)) return;
 	//invoking is field access + call, when the compiler recognizes this pattern it optimizes
 	if(invoke(expr)) return;
 	expr->getCallee()->accept(this);
@@ -225,8 +261,10 @@ void compiler::visitCallExpr(ASTCallExpr* expr) {
 	}
 	case TOKEN_DOT:
 		uInt16 name = identifierConstant(((ASTLiteralExpr*)expr->getArgs()[0])->getToken());
+		uInt offset = getChunk()->code.count();
 		if(name < UINT8_MAX) emitBytes(OP_GET_PROPERTY, name);
 		else emitByteAnd16Bit(OP_GET_PROPERTY_LONG, name);
+		emitCache(offset);
 		break;
 	}
 }
@@ -295,7 +333,17 @@ void compiler::visitLiteralExpr(ASTLiteralExpr* expr) {
 	updateLine(token);
 	switch (token.type) {
 	case TOKEN_NUMBER: {
-		double num = std::stod(token.getLexeme());//doing this becuase stod doesn't accept string_view
+		string lexeme = token.getLexeme();//doing this becuase stod doesn't accept string_view
+		//literals without a fractional part become integers if they fit into 32 bits
+		//(only literals folded by the AST optimizer can be negative)
+		if (lexeme.find('.') == string::npos && lexeme.size() <= 11) {
+			long long num = std::stoll(lexeme);
+			if (num >= INT32_MIN && num <= INT32_MAX) {
+				emitConstant(INT_VAL((int32_t)num));
+				break;
+			}
+		}
+		double num = std::stod(lexeme);
 		emitConstant(NUMBER_VAL(num));
 		break;
 	}
@@ -362,6 +410,7 @@ void compiler::visitVarDecl(ASTVarDecl* decl) {
 	uInt16 global = parseVar(decl->getToken());
 	//compile the right side of the declaration, if there is no right side, the variable is initialized as nil
 	ASTNode* expr = decl->getExpr();
+	beginStmt();
 	if (expr == NULL) {
 		emitByte(OP_NIL);
 	}else{
@@ -375,6 +424,11 @@ void compiler::visitVarDecl(ASTVarDecl* decl) {
 void compiler::visitFuncDecl(ASTFunc* decl) {
 	uInt16 name = parseVar(decl->getName());
 	markInit();
+	//only module level functions are inlined, calls that are compiled after this point can't run before the function is defined
+	if (current->type == funcType::TYPE_SCRIPT && current->scopeDepth == 0) {
+		auto it = inlineCandidates.find(decl->getName().getLexeme());
+		if (it != inlineCandidates.end()) inlinable.insert(*it);
+	}
 	//creating a new compilerInfo sets us up with a clean slate for writing bytecode, the enclosing functions info
 	//is stored in current->enclosing
 	current = new compilerInfo(current, funcType::TYPE_FUNC);
@@ -464,12 +518,14 @@ void compiler::visitClassDecl(ASTClass* decl) {
 
 
 void compiler::visitPrintStmt(ASTPrintStmt* stmt) {
+	beginStmt();
 	stmt->getExpr()->accept(this);
 	//OP_TO_STRING is emitted first to handle the case of a instance whose class defines a toString method
 	emitBytes(OP_TO_STRING, OP_PRINT);
 }
 
 void compiler::visitExprStmt(ASTExprStmt* stmt) {
+	beginStmt();
 	stmt->getExpr()->accept(this);
 	emitByte(OP_POP);
 }
@@ -485,6 +541,7 @@ void compiler::visitBlockStmt(ASTBlockStmt* stmt) {
 
 void compiler::visitIfStmt(ASTIfStmt* stmt) {
 	//compile condition and emit a jump over then branch if the condition is false
+	beginStmt();
 	stmt->getCondition()->accept(this);
 	int thenJump = emitJump(OP_JUMP_IF_FALSE_POP);
 	stmt->getThen()->accept(this);
@@ -504,12 +561,17 @@ void compiler::visitWhileStmt(ASTWhileStmt* stmt) {
 	//the bytecode for this is almost the same as if statement
 	//but at the end of the body, we loop back to the start of the condition
 	int loopStart = getChunk()->code.count();
-	stmt->getCondition()->accept(this);
-	int jump = emitJump(OP_JUMP_IF_FALSE_POP);
+	//the AST optimizer removes conditions that are always true
+	int jump = -1;
+	if (stmt->getCondition() != NULL) {
+		beginStmt();
+		stmt->getCondition()->accept(this);
+		jump = emitJump(OP_JUMP_IF_FALSE_POP);
+	}
 	stmt->getBody()->accept(this);
 	patchContinue();
 	emitLoop(loopStart);
-	patchJump(jump);
+	if (jump != -1) patchJump(jump);
 	patchBreak();
 }
 
@@ -521,6 +583,7 @@ void compiler::visitForStmt(ASTForStmt* stmt) {
 	//only emit the exit jump code if there is a condition expression
 	int exitJump = -1;
 	if (stmt->getCondition() != NULL) { 
+		beginStmt();
 		stmt->getCondition()->accept(this); 
 		exitJump = emitJump(OP_JUMP_IF_FALSE_POP);
 	}
@@ -530,6 +593,7 @@ void compiler::visitForStmt(ASTForStmt* stmt) {
 	patchContinue();
 	//if there is a increment expression, we compile it and emit a POP to get rid of the result
 	if (stmt->getIncrement() != NULL) {
+		beginStmt();
 		stmt->getIncrement()->accept(this);
 		emitByte(OP_POP);
 	}
@@ -547,10 +611,13 @@ void compiler::visitForeachStmt(ASTForeachStmt* stmt) {
 	//and we don't want the underlying code to clash with some user defined variables
 	Token iterator = syntheticToken("0iterable");
 	//get the iterator
+	beginStmt();
 	stmt->getCollection()->accept(this);
 	uInt16 name = identifierConstant(syntheticToken("begin"));
+	uInt offset = getChunk()->code.count();
 	emitByte(OP_INVOKE);
 	emitBytes(name, 0);
+	emitCache(offset);
 	addLocal(iterator);
 	defineVar(0);
 	//Get the var ready
@@ -563,14 +630,18 @@ void compiler::visitForeachStmt(ASTForeachStmt* stmt) {
 	//advancing
 	namedVar(iterator, false);
 	name = identifierConstant(syntheticToken("next"));
+	offset = getChunk()->code.count();
 	emitByte(OP_INVOKE);
 	emitBytes(name, 0);
+	emitCache(offset);
 	int jump = emitJump(OP_JUMP_IF_FALSE_POP);
 
 	//get new variable
 	namedVar(iterator, false);
 	name = identifierConstant(syntheticToken("current"));
+	offset = getChunk()->code.count();
 	emitBytes(OP_GET_PROPERTY, name);
+	emitCache(offset);
 	namedVar(stmt->getVarName(), true);
 	emitByte(OP_POP);
 
@@ -609,6 +680,7 @@ void compiler::visitContinueStmt(ASTContinueStmt* stmt) {
 void compiler::visitSwitchStmt(ASTSwitchStmt* stmt) {
 	beginScope();
 	//compile the expression in ()
+	beginStmt();
 	stmt->getExpr()->accept(this);
 	//based on the switch stmt type(all num, all string or mixed) we create a new switch table struct and get it's pos
 	//passing in the size to call .reserve() on map/vector
@@ -685,6 +757,7 @@ void compiler::visitReturnStmt(ASTReturn* stmt) {
 		emitReturn();
 		return;
 	}
+	beginStmt();
 	stmt->getExpr()->accept(this);
 	emitByte(OP_RETURN);
 	current->hasReturn = true;
@@ -721,7 +794,7 @@ uInt16 compiler::makeConstant(Value value) {
 		return 0;
 	}
 	//since the pointer in value is now a cached ptr, it doesn't change if a resize/collection occurs, so we need to take care of that
-	if (IS_OBJ(value)) AS_OBJ(getChunk()->constants[constant]) =  dynamic_cast<obj*>(gc.getCachedPtr());
+	if (IS_OBJ(value)) getChunk()->constants[constant] = OBJ_VAL(dynamic_cast<obj*>(gc.getCachedPtr()));
 	return constant;
 }
 
@@ -733,19 +806,25 @@ void compiler::emitConstant(Value value) {
 }
 
 void compiler::emitGlobalVar(Token name, bool canAssign) {
-	uInt arg = identifierConstant(name);
+	//every global gets a slot in the module that uses it, reads of natives are bound to their slot before the program runs
+	updateLine(name);
+	string temp = name.getLexeme();
+	//copyString can move the module, so it has to be called before we get the module pointer
+	objString* str = copyString((char*)temp.c_str(), temp.length());
+	uInt slot = modules[modules.size() - 1]->resolveSlot(str);
+	if (slot > UINT16_MAX) error(name, "Too many global variables in one file.");
 	uInt mod = makeConstant(OBJ_VAL(modules[modules.size() - 1]));
 	uint8_t getOp = OP_GET_GLOBAL;
 	uint8_t setOp = OP_SET_GLOBAL;
-	if (arg > UINT8_MAX || mod > UINT8_MAX) {
+	if (slot > UINT8_MAX || mod > UINT8_MAX) {
 		getOp = OP_GET_GLOBAL_LONG;
 		setOp = OP_SET_GLOBAL_LONG;
-		emitByteAnd16Bit(canAssign ? setOp : getOp, arg);
-		emit16Bit(mod);
+		emitByteAnd16Bit(canAssign ? setOp : getOp, mod);
+		emit16Bit(slot);
 		return;
 	}
 	emitByte(canAssign ? setOp : getOp);
-	emitBytes(arg, mod);
+	emitBytes(mod, slot);
 }
 
 
@@ -804,14 +883,17 @@ void compiler::defineVar(uInt16 name) {
 		markInit();
 		return; 
 	}
-	if(name < UINT8_MAX) emitBytes(OP_DEFINE_GLOBAL, name);
+	uInt slot = modules[modules.size() - 1]->resolveSlot(AS_STRING(getChunk()->constants[name]));
+	if(slot < UINT8_MAX) emitBytes(OP_DEFINE_GLOBAL, slot);
 	else {
-		emitByteAnd16Bit(OP_DEFINE_GLOBAL_LONG, name);
+		emitByteAnd16Bit(OP_DEFINE_GLOBAL_LONG, slot);
 	}
 }
 
 void compiler::namedVar(Token token, bool canAssign) {
 	updateLine(token);
+	//the body of a inlined function only sees it's own parameters, everything else is a global
+	if (inlineBase != -1 && resolveLocal(token) < inlineBase) return emitGlobalVar(token, canAssign);
 	uint8_t getOp;
 	uint8_t setOp;
 	uInt arg = resolveLocal(token);
@@ -990,6 +1072,11 @@ Token compiler::syntheticToken(const char* str) {
 	return Token(str, current->line, TOKEN_IDENTIFIER);
 }
 
+//'offset' is the position of the instruction that uses the cache, the index of the new cache is emitted as a operand
+void compiler::emitCache(uInt offset) {
+	emit16Bit(getChunk()->addCache(offset));
+}
+
 #pragma endregion
 
 #pragma region Classes and methods
@@ -1056,6 +1143,7 @@ bool compiler::invoke(ASTCallExpr* expr) {
 			arg->accept(this);
 			argCount++;
 		}
+		uInt offset = getChunk()->code.count();
 		if (field < UINT8_MAX) {
 			emitBytes(OP_INVOKE, field);
 			emitByte(argCount);
@@ -1064,6 +1152,7 @@ bool compiler::invoke(ASTCallExpr* expr) {
 			emitByteAnd16Bit(OP_INVOKE_LONG, field);
 			emitByte(argCount);
 		}
+		emitCache(offset);
 		return true;
 	}else if (expr->getCallee()->type == ASTType::SUPER) {
 		ASTSuperExpr* _superCall = (ASTSuperExpr*)expr->getCallee();
@@ -1098,6 +1187,80 @@ bool compiler::invoke(ASTCallExpr* expr) {
 }
 #pragma endregion
 
+#pragma region Inlining
+//compiles the returned expression of a small module level function in place of a call to it(see inliner.h)
+//a slot for the result is reserved before the arguments, the arguments become locals that the expression uses as it's parameters
+//once the result is written to it's slot the parameters are popped, leaving only the result on the stack, same as a call would
+//
+//locals are addressed by their index, so this only works if there are no temporaries on the stack below them,
+//meaning the call has to be the first thing evaluated in it's statement, eg. 'var x = f(a);', 'return f(a) + 1;'
+bool compiler::inlineCall(ASTCallExpr* expr) {
+	#ifdef INLINE_FUNCTIONS
+	//no inlining inside of inlined code, this also stops recursive functions from being inlined forever
+	if (!compiled || inlineBase != -1 || current->stmtStart != getChunk()->code.count()) return false;
+	if (expr->getAccessor().type != TOKEN_LEFT_PAREN || expr->getCallee()->type != ASTType::LITERAL) return false;
+	Token name = ((ASTLiteralExpr*)expr->getCallee())->getToken();
+	if (name.type != TOKEN_IDENTIFIER) return false;
+	auto it = inlinable.find(name.getLexeme());
+	if (it == inlinable.end() || isShadowed(name)) return false;
+	ASTFunc* decl = it->second;
+	vector<ASTNode*> args = expr->getArgs();
+	vector<Token> params = decl->getArgs();
+	//wrong number of arguments is a runtime error, so it's left to a real call
+	if (args.size() != params.size() || current->localCount + params.size() + 1 > UINT8_MAX) return false;
+	ASTNode* body = ((ASTReturn*)((ASTBlockStmt*)decl->getBody())->getStmts()[0])->getExpr();
+	uInt callLine = current->line;
+
+	//in 'var x = f(a);' x is declared before it's initializer is compiled, it's slot is where the result would end up anyway
+	int resultSlot = current->localCount - 1;
+	bool declaredResult = current->locals[resultSlot].depth == -1;
+	if (params.size() > 0) {
+		beginScope();
+		emitByte(OP_NIL);
+		if (!declaredResult) {
+			addLocal(syntheticToken("0result"));
+			markInit();
+			resultSlot = current->localCount - 1;
+		}
+		for (ASTNode* arg : args) arg->accept(this);
+		//parameters are declared after all of the arguments are compiled, arguments can't see them
+		for (Token& param : params) {
+			addLocal(param);
+			markInit();
+		}
+	}
+	inlineBase = current->localCount - params.size();
+	uInt start = getChunk()->code.count();
+	body->accept(this);
+	getChunk()->inlined.emplace_back(start, getChunk()->code.count(), callLine, name.getLexeme());
+	inlineBase = -1;
+	//code after the call belongs to the line of the call
+	current->line = callLine;
+	if (params.size() == 0) return true;
+
+	emitBytes(OP_SET_LOCAL, resultSlot);
+	emitBytes(OP_POPN, params.size() + 1);
+	//result slot isn't popped, it's value is the value of the call
+	current->localCount = declaredResult ? resultSlot + 1 : resultSlot;
+	current->scopeDepth--;
+	return true;
+	#else
+	return false;
+	#endif
+}
+
+//true if 'name' refers to a local or upvalue instead of a global
+bool compiler::isShadowed(Token& name) {
+	string str = name.getLexeme();
+	for (compilerInfo* info = current; info != nullptr; info = info->enclosing) {
+		for (int i = 0; i < info->localCount; i++) {
+			if (identifiersEqual(str, info->locals[i].name)) return true;
+		}
+	}
+	return false;
+}
+#pragma endregion
+
 
 chunk* compiler::getChunk() {
 	return &current->func->body;
@@ -1119,6 +1282,27 @@ objFunc* compiler::endFuncDecl() {
 	objFunc* func = current->func;
 	//for the last line of code
 	func->body.lines[func->body.lines.size() - 1].end = func->body.code.count();
+	#if defined(SSA_OPTIMIZE) || defined(TYPE_INFERENCE)
+	//fibers start with a different stack layout, and code of a file that didn't compile is never ran
+	if (compiled && current->type != funcType::TYPE_FIBER) {
+		ssaFunction ssa(&func->body, func->arity, declaredGlobals, func->name == nullptr ? "script" : func->name->str);
+		#ifdef SSA_OPTIMIZE
+		ssa.optimize();
+		#endif
+		#ifdef TYPE_INFERENCE
+		ssa.specializeTypes();
+		#endif
+	}
+	#endif
+	#ifdef PEEPHOLE_OPTIMIZE
+	#ifdef DEBUG_PEEPHOLE
+	uInt sizeBefore = func->body.code.count();
+	#endif
+	peephole(&func->body).optimize();
+	#ifdef DEBUG_PEEPHOLE
+	std::cout << (func->name == nullptr ? "script" : func->name->str) << ": " << sizeBefore << " -> " << func->body.code.count() << " bytes\n";
+	#endif
+	#endif
 	#ifdef DEBUG_PRINT_CODE
 		current->func->body.disassemble(current->func->name == nullptr ? "script" : current->func->name->str);
 	#endif
@@ -5,6 +5,8 @@
 #include "chunk.h"
 #include "object.h"
 #include <array>
+#include <unordered_map>
+#include <unordered_set>
 
 
 #define LOCAL_MAX 512
@@ -54,6 +56,9 @@ struct compilerInfo {
 	int scopeDepth;
 	std::array<upvalue, UPVAL_MAX> upvalues;
 	bool hasCapturedLocals;
+	//offset at which the code of the statement that's being compiled starts, -1 before the first one
+	//until something is emitted after it, the stack holds nothing but the locals
+	int stmtStart;
 	compilerInfo(compilerInfo* _enclosing, funcType _type);
 };
 
@@ -76,6 +81,14 @@ public:
 	objFunc* endFuncDecl();
 private:
 	translationUnit* curUnit;
+	//functions of the current file that calls can be replaced with(see inliner.h),
+	//a candidate becomes inlinable once it's declaration is compiled, so the global is always defined by the time inlined code runs
+	std::unordered_map<string, ASTFunc*> inlineCandidates;
+	std::unordered_map<string, ASTFunc*> inlinable;
+	//index of the first local that belongs to the function that's being inlined, -1 when not inlining
+	int inlineBase;
+	//names every file declares at the top level, keyed by the name of the file(see ssa.h)
+	std::unordered_map<string, std::unordered_set<string>> declaredGlobals;
 
 	#pragma region Helpers
 	//emitters
@@ -107,11 +120,16 @@ private:
 	int addUpvalue(uint8_t index, bool isLocal);
 	void markInit();
 	void beginScope() { current->scopeDepth++; }
+	void beginStmt() { current->stmtStart = getChunk()->code.count(); }
 	void endScope();
 	//classes and methods
 	void method(ASTFunc* _method, Token className);
 	bool invoke(ASTCallExpr* expr);
+	//inlining
+	bool inlineCall(ASTCallExpr* expr);
+	bool isShadowed(Token& name);
 	Token syntheticToken(const char* str);
+	void emitCache(uInt offset);
 	//misc
 	void updateLine(Token token);
 	void error(Token token, string msg);
@@ -178,25 +178,31 @@ static int constantInstruction(string name, chunk* Chunk, int offset, bool isLon
 	return offset + (isLong ? 3 : 2);
 }
 
-static int doubleConstantInstruction(string name, chunk* Chunk, int offset, bool isLong) {
-	uInt constant1 = 0;
-	uInt constant2 = 0;
+//module constant followed by the index of the variable in that module
+static int globalInstruction(string name, chunk* Chunk, int offset, bool isLong) {
+	uInt constant = 0;
+	uInt slot = 0;
 	if (!isLong) {
-		constant1 = Chunk->code[offset + 1];
-		constant2 = Chunk->code[offset + 2];
+		constant = Chunk->code[offset + 1];
+		slot = Chunk->code[offset + 2];
 	}
 	else {
-		constant1 = ((Chunk->code[offset + 1] << 8) | Chunk->code[offset + 2]);
-		constant2 = ((Chunk->code[offset + 3] << 8) | Chunk->code[offset + 4]);
+		constant = ((Chunk->code[offset + 1] << 8) | Chunk->code[offset + 2]);
+		slot = ((Chunk->code[offset + 3] << 8) | Chunk->code[offset + 4]);
 	}
-	printf("%-16s %4d %4d '", name.c_str(), constant1, constant2);//have to use printf because of string spacing
-	printValue(Chunk->constants[constant1]);
-	printf("' '");
-	printValue(Chunk->constants[constant2]);
-	printf("'\n");
+	objModule* mod = AS_MODULE(Chunk->constants[constant]);
+	printf("%-16s %4d %4d '%s' '%s'\n", name.c_str(), constant, slot, mod->name->str, mod->slotName(slot)->str);
 	return offset + (isLong ? 5 : 3);
 }
 
+static int defineGlobalInstruction(string name, chunk* Chunk, int offset, bool isLong) {
+	uInt slot = 0;
+	if (!isLong) slot = Chunk->code[offset + 1];
+	else slot = ((Chunk->code[offset + 1] << 8) | Chunk->code[offset + 2]);
+	printf("%-16s %4d\n", name.c_str(), slot);
+	return offset + (isLong ? 3 : 2);
+}
+
 static int jumpInstruction(const char* name, int sign, chunk* Chunk, int offset) {
 	uint16_t jump = (uint16_t)(Chunk->code[offset + 1] << 8);
 	jump |= Chunk->code[offset + 2];
@@ -222,6 +228,53 @@ static int longInvokeInstruction(const char* name, chunk* Chunk, int offset) {
 	return offset + 5;
 }
 
+//property accesses and invokes are followed by the index of their inline cache
+static int propertyInstruction(string name, chunk* Chunk, int offset, bool isLong) {
+	uInt constant = 0;
+	if (!isLong) constant = Chunk->code[offset + 1];
+	else constant = ((Chunk->code[offset + 1] << 8) | Chunk->code[offset + 2]);
+	offset += (isLong ? 3 : 2);
+	uInt cache = ((Chunk->code[offset] << 8) | Chunk->code[offset + 1]);
+	printf("%-16s %4d '", name.c_str(), constant);
+	printValue(Chunk->constants[constant]);
+	printf("' cache %d\n", cache);
+	return offset + 2;
+}
+
+static int cachedInvokeInstruction(string name, chunk* Chunk, int offset, bool isLong) {
+	uInt constant = 0;
+	if (!isLong) constant = Chunk->code[offset + 1];
+	else constant = ((Chunk->code[offset + 1] << 8) | Chunk->code[offset + 2]);
+	offset += (isLong ? 3 : 2);
+	uint8_t argCount = Chunk->code[offset];
+	uInt cache = ((Chunk->code[offset + 1] << 8) | Chunk->code[offset + 2]);
+	printf("%-16s (%d args) %4d '", name.c_str(), argCount, constant);
+	printValue(Chunk->constants[constant]);
+	printf("' cache %d\n", cache);
+	return offset + 3;
+}
+
+//slots are printed as r<index>, REG_TOP as top and constants by value
+static void printRegister(uint8_t slot) {
+	if (slot == REG_TOP) printf(" top");
+	else printf(" r%d", slot);
+}
+
+static int registerInstruction(const char* name, chunk* Chunk, int offset, int operands, bool lastIsConstant) {
+	printf("%-16s", name);
+	for (int i = 1; i <= operands; i++) {
+		uint8_t operand = Chunk->code[offset + i];
+		if (i == operands && lastIsConstant) {
+			printf(" '");
+			printValue(Chunk->constants[operand]);
+			printf("'");
+		}
+		else printRegister(operand);
+	}
+	printf("\n");
+	return offset + 1 + operands;
+}
+
 static int incrementInstruction(const char* name, chunk* Chunk, int offset) {
 	uint8_t type = Chunk->code[offset + 1];
 	uint8_t arg = Chunk->code[offset + 2];
@@ -240,6 +293,16 @@ int disassembleInstruction(chunk* Chunk, int offset) {
 	}
 
 	uint8_t instruction = Chunk->code[offset];
+	//superinstructions and fused branches are printed as the first instruction they fuse
+	switch (instruction) {
+	#define SUPERINSTRUCTION_NAME(name, op0, op1, op2, op3) case name: std::cout << #name << " > "; instruction = op0; break;
+	SUPERINSTRUCTION_LIST(SUPERINSTRUCTION_NAME)
+	#undef SUPERINSTRUCTION_NAME
+	case OP_LESS_JUMP: std::cout << "OP LESS JUMP > "; instruction = OP_LESS; break;
+	case OP_EQUAL_JUMP: std::cout << "OP EQUAL JUMP > "; instruction = OP_EQUAL; break;
+	case OP_FOR_INCR_LOOP: std::cout << "OP FOR INCR LOOP > "; instruction = OP_GET_LOCAL; break;
+	case OP_FOR_INCR_LOOP_K: std::cout << "OP FOR INCR LOOP K > "; instruction = OP_GET_LOCAL; break;
+	}
 	switch (instruction) {
 	case OP_CONSTANT:
 		return constantInstruction("OP_CONSTANT", Chunk, offset, false);
@@ -296,17 +359,17 @@ int disassembleInstruction(chunk* Chunk, int offset) {
 	case OP_PRINT:
 		return simpleInstruction("OP PRINT", offset);
 	case OP_DEFINE_GLOBAL:
-		return constantInstruction("OP DEFINE GLOBAL", Chunk, offset, false);
+		return defineGlobalInstruction("OP DEFINE GLOBAL", Chunk, offset, false);
 	case OP_DEFINE_GLOBAL_LONG:
-		return constantInstruction("OP DEFINE GLOBAL LONG", Chunk, offset, true);
+		return defineGlobalInstruction("OP DEFINE GLOBAL LONG", Chunk, offset, true);
 	case OP_GET_GLOBAL:
-		return doubleConstantInstruction("OP GET GLOBAL", Chunk, offset, false);
+		return globalInstruction("OP GET GLOBAL", Chunk, offset, false);
 	case OP_GET_GLOBAL_LONG:
-		return doubleConstantInstruction("OP GET GLOBAL LONG", Chunk, offset, true);
+		return globalInstruction("OP GET GLOBAL LONG", Chunk, offset, true);
 	case OP_SET_GLOBAL:
-		return doubleConstantInstruction("OP SET GLOBAL", Chunk, offset, false);
+		return globalInstruction("OP SET GLOBAL", Chunk, offset, false);
 	case OP_SET_GLOBAL_LONG:
-		return doubleConstantInstruction("OP SET GLOBAL LONG", Chunk, offset, true);
+		return globalInstruction("OP SET GLOBAL LONG", Chunk, offset, true);
 	case OP_GET_LOCAL:
 		return byteInstruction("OP GET LOCAL", Chunk, offset);
 	case OP_SET_LOCAL:
@@ -379,13 +442,13 @@ int disassembleInstruction(chunk* Chunk, int offset) {
 	case OP_CLASS:
 		return constantInstruction("OP CLASS", Chunk, offset, true);
 	case OP_GET_PROPERTY:
-		return constantInstruction("OP GET PROPERTY", Chunk, offset, false);
+		return propertyInstruction("OP GET PROPERTY", Chunk, offset, false);
 	case OP_GET_PROPERTY_LONG:
-		return constantInstruction("OP GET PROPERTY LONG", Chunk, offset, true);
+		return propertyInstruction("OP GET PROPERTY LONG", Chunk, offset, true);
 	case OP_SET_PROPERTY:
-		return constantInstruction("OP SET PROPERTY", Chunk, offset, false);
+		return propertyInstruction("OP SET PROPERTY", Chunk, offset, false);
 	case OP_SET_PROPERTY_LONG:
-		return constantInstruction("OP SET PROPERTY LONG", Chunk, offset, true);
+		return propertyInstruction("OP SET PROPERTY LONG", Chunk, offset, true);
 	case OP_CREATE_STRUCT: {
 		offset++;
 		uint8_t fieldNum = Chunk->code[offset++];
@@ -412,9 +475,9 @@ int disassembleInstruction(chunk* Chunk, int offset) {
 	case OP_METHOD:
 		return constantInstruction("OP METHOD", Chunk, offset, true);
 	case OP_INVOKE:
-		return invokeInstruction("OP INVOKE", Chunk, offset);
+		return cachedInvokeInstruction("OP INVOKE", Chunk, offset, false);
 	case OP_INVOKE_LONG:
-		return longInvokeInstruction("OP INVOKE LONG", Chunk, offset);
+		return cachedInvokeInstruction("OP INVOKE LONG", Chunk, offset, true);
 	case OP_INHERIT:
 		return simpleInstruction("OP INHERIT", offset);
 	case OP_GET_SUPER:
@@ -447,8 +510,96 @@ int disassembleInstruction(chunk* Chunk, int offset) {
 		return constantInstruction("OP MODULE GET", Chunk, offset, false);
 	case OP_MODULE_GET_LONG:
 		return constantInstruction("OP MODULE GET LONG", Chunk, offset, true);
+	case OP_ADD_INT_INT:
+		return simpleInstruction("OP ADD INT INT", offset);
+	case OP_ADD_NUM_NUM:
+		return simpleInstruction("OP ADD NUM NUM", offset);
+	case OP_SUBTRACT_INT_INT:
+		return simpleInstruction("OP SUBTRACT INT INT", offset);
+	case OP_SUBTRACT_NUM_NUM:
+		return simpleInstruction("OP SUBTRACT NUM NUM", offset);
+	case OP_LESS_INT_INT:
+		return simpleInstruction("OP LESS INT INT", offset);
+	case OP_LESS_NUM_NUM:
+		return simpleInstruction("OP LESS NUM NUM", offset);
+	case OP_GET_ARRAY_NUM:
+		return simpleInstruction("OP GET ARRAY NUM", offset);
+	case OP_SET_ARRAY_NUM:
+		return simpleInstruction("OP SET ARRAY NUM", offset);
+	case OP_CALL_CLOSURE:
+		return byteInstruction("OP CALL CLOSURE", Chunk, offset);
+	case OP_ADD_NUM:
+		return simpleInstruction("OP ADD NUM", offset);
+	case OP_ADD_STRING:
+		return simpleInstruction("OP ADD STRING", offset);
+	case OP_SUBTRACT_NUM:
+		return simpleInstruction("OP SUBTRACT NUM", offset);
+	case OP_MULTIPLY_NUM:
+		return simpleInstruction("OP MULTIPLY NUM", offset);
+	case OP_DIVIDE_NUM:
+		return simpleInstruction("OP DIVIDE NUM", offset);
+	case OP_ADD_1_NUM:
+		return simpleInstruction("OP ADD 1 NUM", offset);
+	case OP_SUBTRACT_1_NUM:
+		return simpleInstruction("OP SUBTRACT 1 NUM", offset);
+	case OP_GREATER_NUM:
+		return simpleInstruction("OP GREATER NUM", offset);
+	case OP_GREATER_EQUAL_NUM:
+		return simpleInstruction("OP GREATER EQUAL NUM", offset);
+	case OP_LESS_NUM:
+		return simpleInstruction("OP LESS NUM", offset);
+	case OP_LESS_EQUAL_NUM:
+		return simpleInstruction("OP LESS EQUAL NUM", offset);
 	case OP_TO_STRING:
 		return simpleInstruction("OP TO STRING", offset);
+	case OP_REG_MOVE:
+		return registerInstruction("OP REG MOVE", Chunk, offset, 2, false);
+	case OP_REG_LOAD:
+		return registerInstruction("OP REG LOAD", Chunk, offset, 2, true);
+	case OP_REG_ADD:
+		return registerInstruction("OP REG ADD", Chunk, offset, 3, false);
+	case OP_REG_SUBTRACT:
+		return registerInstruction("OP REG SUBTRACT", Chunk, offset, 3, false);
+	case OP_REG_MULTIPLY:
+		return registerInstruction("OP REG MULTIPLY", Chunk, offset, 3, false);
+	case OP_REG_DIVIDE:
+		return registerInstruction("OP REG DIVIDE", Chunk, offset, 3, false);
+	case OP_REG_MOD:
+		return registerInstruction("OP REG MOD", Chunk, offset, 3, false);
+	case OP_REG_EQUAL:
+		return registerInstruction("OP REG EQUAL", Chunk, offset, 3, false);
+	case OP_REG_NOT_EQUAL:
+		return registerInstruction("OP REG NOT EQUAL", Chunk, offset, 3, false);
+	case OP_REG_GREATER:
+		return registerInstruction("OP REG GREATER", Chunk, offset, 3, false);
+	case OP_REG_GREATER_EQUAL:
+		return registerInstruction("OP REG GREATER EQUAL", Chunk, offset, 3, false);
+	case OP_REG_LESS:
+		return registerInstruction("OP REG LESS", Chunk, offset, 3, false);
+	case OP_REG_LESS_EQUAL:
+		return registerInstruction("OP REG LESS EQUAL", Chunk, offset, 3, false);
+	case OP_REG_ADD_K:
+		return registerInstruction("OP REG ADD K", Chunk, offset, 3, true);
+	case OP_REG_SUBTRACT_K:
+		return registerInstruction("OP REG SUBTRACT K", Chunk, offset, 3, true);
+	case OP_REG_MULTIPLY_K:
+		return registerInstruction("OP REG MULTIPLY K", Chunk, offset, 3, true);
+	case OP_REG_DIVIDE_K:
+		return registerInstruction("OP REG DIVIDE K", Chunk, offset, 3, true);
+	case OP_REG_MOD_K:
+		return registerInstruction("OP REG MOD K", Chunk, offset, 3, true);
+	case OP_REG_EQUAL_K:
+		return registerInstruction("OP REG EQUAL K", Chunk, offset, 3, true);
+	case OP_REG_NOT_EQUAL_K:
+		return registerInstruction("OP REG NOT EQUAL K", Chunk, offset, 3, true);
+	case OP_REG_GREATER_K:
+		return registerInstruction("OP REG GREATER K", Chunk, offset, 3, true);
+	case OP_REG_GREATER_EQUAL_K:
+		return registerInstruction("OP REG GREATER EQUAL K", Chunk, offset, 3, true);
+	case OP_REG_LESS_K:
+		return registerInstruction("OP REG LESS K", Chunk, offset, 3, true);
+	case OP_REG_LESS_EQUAL_K:
+		return registerInstruction("OP REG LESS EQUAL K", Chunk, offset, 3, true);
 	default:
 		std::cout << "Unknown opcode " << (int)instruction << "\n";
 		return offset + 1;
@@ -456,3 +607,34 @@ int disassembleInstruction(chunk* Chunk, int offset) {
 }
 
 #pragma endregion
+
+#ifdef DEBUG_INLINE_CACHE
+static const char* cacheStateToStr(cacheState state) {
+	switch (state) {
+	case cacheState::EMPTY: return "empty";
+	case cacheState::MONOMORPHIC: return "monomorphic";
+	case cacheState::POLYMORPHIC: return "polymorphic";
+	case cacheState::MEGAMORPHIC: return "megamorphic";
+	}
+	return "";
+}
+
+//prints every inline cache of 'func' and of every function declared inside of it
+void dumpInlineCaches(objFunc* func) {
+	chunk* Chunk = &func->body;
+	if (!Chunk->caches.empty()) {
+		std::cout << "=======" << (func->name == nullptr ? "script" : func->name->str) << " inline caches=======\n";
+		for (inlineCache& cache : Chunk->caches) {
+			disassembleInstruction(Chunk, cache.offset);
+			uInt64 total = cache.hits + cache.misses;
+			printf("     | %-12s hits: %llu misses: %llu (%.2f%%)\n", cacheStateToStr(cache.state), cache.hits, cache.misses,
+				total == 0 ? 0.0 : 100.0 * cache.hits / total);
+		}
+	}
+	for (int i = 0; i < Chunk->constants.count(); i++) {
+		Value val = Chunk->constants[i];
+		if (IS_FUNCTION(val)) dumpInlineCaches(AS_FUNCTION(val));
+		else if (IS_CLOSURE(val)) dumpInlineCaches(AS_CLOSURE(val)->func);
+	}
+}
+#endif // DEBUG_INLINE_CACHE
@@ -44,6 +44,10 @@ private:
 
 #pragma region Debug
 int disassembleInstruction(chunk* Chunk, int offset);
+#ifdef DEBUG_INLINE_CACHE
+class objFunc;
+void dumpInlineCaches(objFunc* func);
+#endif // DEBUG_INLINE_CACHE
 //static int constantInstruction(string name, chunk* Chunk, int offset);
 //static int simpleInstruction(string name, int offset);
 //void printValue(Value value);
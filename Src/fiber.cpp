@@ -113,6 +113,13 @@ interpretResult objFiber::runtimeError(const char* format, ...) {
 		objFunc* function = frame->closure->func;
 		uInt64 instruction = frame->ip - 1;
 		codeLine line = function->body.getLine(instruction);
+		//code that was inlined into this function gets it's own entry, same as it would have if it was called
+		vector<inlinedCall>& inlined = function->body.inlined;
+		for (int j = inlined.size() - 1; j >= 0; j--) {
+			if (instruction < inlined[j].start || instruction >= inlined[j].end) continue;
+			std::cout << yellow + line.name + black + ":" + cyan + std::to_string(line.line) + " | " + black << "in " << inlined[j].name << "()\n";
+			line.line = inlined[j].line;
+		}
 		//fileName:line | in <func name>()
 		string temp = yellow + line.name + black + ":" + cyan + std::to_string(line.line) + " | " + black;
 		std::cout << temp<<"in ";
@@ -183,7 +190,14 @@ bool objFiber::callValue(Value callee, int argCount) {
 		case OBJ_CLASS: {
 			//we do this so if a GC runs we safely update all the pointers(since the stack is considered a root)
 			push(callee);
-			stackTop[-argCount - 2] = OBJ_VAL(new objInstance(AS_CLASS(peek(0))));
+			if (AS_CLASS(peek(0))->shape == nullptr) {
+				objShape* root = new objShape(0);
+				AS_CLASS(peek(0))->shape = root;
+				WRITE_BARRIER(AS_CLASS(peek(0)), root);
+			}
+			//inline slots are sized using the number of fields previous instances of this class ended up with
+			uInt inlineSlots = AS_CLASS(peek(0))->expectedFields;
+			stackTop[-argCount - 2] = OBJ_VAL(new(inlineSlots) objInstance(AS_CLASS(peek(0)), AS_CLASS(peek(0))->shape, inlineSlots));
 			objClass* klass = AS_CLASS(pop());
 			Value initializer;
 			if (klass->methods.get(klass->name, &initializer)) {
@@ -249,6 +263,7 @@ void objFiber::closeUpvalues(Value* last) {
 		upval = openUpvals[i];
 		if (upval->location >= last) {
 			upval->closed = *upval->location;
+			WRITE_BARRIER(upval, upval->closed);
 			upval->location = &upval->closed;
 			upval->isOpen = false;//this check is used by the GC
 		}
@@ -261,6 +276,12 @@ void objFiber::defineMethod(objString* name) {
 	Value method = peek(0);
 	objClass* klass = AS_CLASS(peek(1));
 	klass->methods.set(name, method);
+	WRITE_BARRIER(klass, name);
+	WRITE_BARRIER(klass, method);
+	//method names are interned, so comparing pointers is enough
+	for (int i = 0; i < METAMETHOD_COUNT; i++) {
+		if (name == VM->metamethodNames[i]) klass->metamethods[i] = AS_CLOSURE(method);
+	}
 	//we only pop the method, since other methods we're compiling will also need to know their class
 	pop();
 }
@@ -272,21 +293,101 @@ bool objFiber::bindMethod(objClass* klass, objString* name) {
 		runtimeError("%s doesn't contain method '%s'.", klass->name->str, name->str);
 		return false;
 	}
+	bindMethod(AS_CLOSURE(method));
+	return true;
+}
+
+void objFiber::bindMethod(objClosure* method) {
 	//we need to push the method to the stack because if a GC collection happens the ptr inside of method becomes invalid
 	//easiest way for it to update is to push it onto the stack
-	push(method);
+	push(OBJ_VAL(method));
 	//peek(1) because the method(closure) itself is on top of the stack right now
 	objBoundMethod* bound = new objBoundMethod(peek(1), nullptr);
 	//make sure to pop the closure to maintain stack discipline and to get the updated value(if it changed)
-	method = pop();
-	bound->method = AS_CLOSURE(method);
+	bound->method = AS_CLOSURE(pop());
 	//pop the receiver instance
 	pop();
 	push(OBJ_VAL(bound));
+}
+
+//inline caches belong to the function that's running, the shapes and methods they cache can be younger than it
+void objFiber::addCacheEntry(inlineCache* cache, cacheEntry entry) {
+	cache->add(entry);
+	objFunc* func = frames[frameCount - 1].closure->func;
+	WRITE_BARRIER(func, entry.shape);
+	WRITE_BARRIER(func, entry.next);
+	WRITE_BARRIER(func, entry.method);
+}
+
+//slow path of OP_GET_PROPERTY, cached fields are handled in the interpreter loop, the instance is on top of the stack
+bool objFiber::getProperty(objString* name, inlineCache* cache) {
+	objInstance* instance = AS_INSTANCE(peek(0));
+	cacheEntry* entry = cache->find(instance->shape);
+	if (entry != nullptr) {
+		cache->hits++;
+		bindMethod(entry->method);
+		return true;
+	}
+	cache->misses++;
+
+	Value value;
+	uInt slot;
+	if (instance->shape != nullptr && instance->shape->lookup(name, &slot)) {
+		addCacheEntry(cache, cacheEntry(instance->shape, nullptr, slot, nullptr));
+		stackTop[-1] = *instance->slot(slot);
+		return true;
+	}
+	if (instance->shape == nullptr && instance->table.get(name, &value)) {
+		stackTop[-1] = value;
+		return true;
+	}
+	//first check is because structs(instances with no class) are also represented using objInstance
+	if (instance->klass) {
+		if (!instance->klass->methods.get(name, &value)) {
+			runtimeError("%s doesn't contain method '%s'.", instance->klass->name->str, name->str);
+			return false;
+		}
+		if (instance->shape != nullptr) addCacheEntry(cache, cacheEntry(instance->shape, nullptr, 0, AS_CLOSURE(value)));
+		bindMethod(AS_CLOSURE(value));
+		return true;
+	}
+	//if 'name' isn't a field of the struct, we push nil as a sentinel value
+	stackTop[-1] = NIL_VAL();
 	return true;
 }
 
-bool objFiber::invoke(objString* fieldName, int argCount) {
+//slow path of OP_SET_PROPERTY, the instance and the value are on top of the stack
+void objFiber::setProperty(objString* name, inlineCache* cache) {
+	objInstance* instance = AS_INSTANCE(peek(1));
+	objShape* shape = instance->shape;
+	//instances in dictionary mode are never cached
+	if (shape == nullptr) {
+		setField(instance, name, peek(0));
+		return;
+	}
+	//the interpreter loop only misses a cached entry if the store adds a field that doesn't fit inline
+	cacheEntry* entry = cache->find(shape);
+	if (entry != nullptr) cache->hits++;
+	else cache->misses++;
+
+	uInt slot;
+	if (shape->lookup(name, &slot)) {
+		if (entry == nullptr) addCacheEntry(cache, cacheEntry(shape, nullptr, slot, nullptr));
+		*instance->slot(slot) = peek(0);
+		WRITE_BARRIER(instance, peek(0));
+		return;
+	}
+	//adding a field can allocate a new shape, which would move the old one
+	global::gc.cachePtr(shape);
+	setField(instance, name, peek(0));
+	shape = dynamic_cast<objShape*>(global::gc.getCachedPtr());
+	instance = AS_INSTANCE(peek(1));
+	if (entry == nullptr && instance->shape != nullptr) {
+		addCacheEntry(cache, cacheEntry(shape, instance->shape, instance->shape->fieldCount - 1, nullptr));
+	}
+}
+
+bool objFiber::invoke(objString* fieldName, int argCount, inlineCache* cache) {
 	Value receiver = peek(argCount);
 	if (!IS_INSTANCE(receiver)) {
 		runtimeError("Only instances can call methods, got %s.", valueTypeToStr(receiver).c_str());
@@ -294,9 +395,29 @@ bool objFiber::invoke(objString* fieldName, int argCount) {
 	}
 
 	objInstance* instance = AS_INSTANCE(receiver);
+	if (cache != nullptr) {
+		cacheEntry* entry = cache->find(instance->shape);
+		if (entry != nullptr) {
+			cache->hits++;
+			//the bottom of the call stack will contain the receiver instance
+			if (entry->method != nullptr) return call(entry->method, argCount);
+			Value value = *instance->slot(entry->slot);
+			stackTop[-argCount - 1] = value;
+			return callValue(value, argCount);
+		}
+		cache->misses++;
+	}
+
 	Value value;
+	uInt slot;
 	//this is here because invoke can also be used on functions stored in a instances field
-	if (instance->table.get(fieldName, &value)) {
+	if (instance->shape != nullptr && instance->shape->lookup(fieldName, &slot)) {
+		if (cache != nullptr) addCacheEntry(cache, cacheEntry(instance->shape, nullptr, slot, nullptr));
+		value = *instance->slot(slot);
+		stackTop[-argCount - 1] = value;
+		return callValue(value, argCount);
+	}
+	if (instance->shape == nullptr && instance->table.get(fieldName, &value)) {
 		stackTop[-argCount - 1] = value;
 		return callValue(value, argCount);
 	}
@@ -307,7 +428,12 @@ bool objFiber::invoke(objString* fieldName, int argCount) {
 		return false;
 	}
 
-	return invokeFromClass(instance->klass, fieldName, argCount);
+	if (!instance->klass->methods.get(fieldName, &value)) {
+		runtimeError("Class '%s' doesn't contain '%s'.", instance->klass->name->str, fieldName->str);
+		return false;
+	}
+	if (cache != nullptr && instance->shape != nullptr) addCacheEntry(cache, cacheEntry(instance->shape, nullptr, 0, AS_CLOSURE(value)));
+	return call(AS_CLOSURE(value), argCount);
 }
 
 bool objFiber::invokeFromClass(objClass* klass, objString* name, int argCount) {
@@ -327,15 +453,11 @@ bool pushValToStr(objFiber* fiber, Value _val) {
 		return true;
 	}
 	if (IS_INSTANCE(val)) {
-		objInstance* inst = AS_INSTANCE(val);
-		global::gc.cachePtr(inst);
-		objString* str = fiber->VM->toString;
-		inst = dynamic_cast<objInstance*>(global::gc.getCachedPtr());
-		Value method;
-		if (inst->klass != nullptr && inst->klass->methods.get(str, &method)) {
-			fiber->push(method);
-			if (!fiber->callValue(method, 0)) return false;
-			return true;
+		objClass* klass = AS_INSTANCE(val)->klass;
+		//the instance is the receiver of toString, it's return value takes the place of the instance on the stack
+		if (klass != nullptr && klass->metamethods[METAMETHOD_TO_STRING] != nullptr) {
+			fiber->push(val);
+			return fiber->call(klass->metamethods[METAMETHOD_TO_STRING], 0);
 		}
 	}
 	string str = valueToStr(val);
@@ -346,359 +468,1028 @@ bool pushValToStr(objFiber* fiber, Value _val) {
 
 interpretResult objFiber::execute() {
 	state = fiberState::RUNNING;
-	callFrame* frame = &frames[frameCount - 1];
+	//ip, code and constants of the current frame are cached in locals since every instruction uses them,
+	//code and constants live on the GC heap, so the ip has to be stored back to the frame as an offset before anything that
+	//can allocate, call, switch fibers or throw a runtime error, and all 3 have to be reloaded afterwards
+	callFrame* frame;
+	uint8_t* code;
+	uint8_t* ip;
+	Value* constants;
+	//inline caches aren't on the GC heap, so this pointer stays valid even if the function moves
+	inlineCache* caches;
 	#pragma region Macros
-	#define READ_BYTE() (getOp(frame->ip++))
-	#define READ_SHORT() (frame->ip += 2, (uint16_t)((getOp(frame->ip-2) << 8) | getOp(frame->ip-1)))
-	#define READ_CONSTANT() (frames[frameCount - 1].closure->func->body.constants[READ_BYTE()])
-	#define READ_CONSTANT_LONG() (frames[frameCount - 1].closure->func->body.constants[READ_SHORT()])
+	#define READ_BYTE() (*ip++)
+	#define READ_SHORT() (ip += 2, (uint16_t)((ip[-2] << 8) | ip[-1]))
+	#define READ_CONSTANT() (constants[READ_BYTE()])
+	#define READ_CONSTANT_LONG() (constants[READ_SHORT()])
 	#define READ_STRING() AS_STRING(READ_CONSTANT())
 	#define READ_STRING_LONG() AS_STRING(READ_CONSTANT_LONG())
+	#define READ_CACHE() (&caches[READ_SHORT()])
+	//used inside of new-initializers, those are evaluated after the allocation, which might have moved the constants array
+	#define FRAME_CONSTANT(index) (frame->closure->func->body.constants[index])
+	#define STORE_FRAME() (frame->ip = ip - code)
+	#define LOAD_FRAME() \
+		do { \
+			frame = &frames[frameCount - 1]; \
+			code = frame->closure->func->body.code.data(); \
+			constants = frame->closure->func->body.constants.data(); \
+			caches = frame->closure->func->body.caches.data(); \
+			ip = code + frame->ip; \
+		} while (false)
+	#define RUNTIME_ERR(...) \
+		do { \
+			STORE_FRAME(); \
+			return runtimeError(__VA_ARGS__); \
+		} while (false)
+
+	//integer operands are done in 64 bits and produce a integer if the result fits, otherwise both sides are treated as doubles
 	#define BINARY_OP(valueType, op) \
 		do { \
+			if (ARE_INTS(peek(0), peek(1))) { \
+				int64_t b = AS_INT(pop()); \
+				int64_t a = AS_INT(pop()); \
+				push(INT_OR_NUMBER_VAL(a op b)); \
+				break; \
+			} \
 			if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) { \
-			return runtimeError("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str()); \
+			RUNTIME_ERR("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str()); \
 			} \
 			double b = AS_NUMBER(pop()); \
 			double a = AS_NUMBER(pop()); \
 			push(valueType(a op b)); \
 		} while (false)
 
+	#define COMPARISON_OP(op) \
+		do { \
+			if (ARE_INTS(peek(0), peek(1))) { \
+				int32_t b = AS_INT(pop()); \
+				int32_t a = AS_INT(pop()); \
+				push(BOOL_VAL(a op b)); \
+				break; \
+			} \
+			if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) { \
+			RUNTIME_ERR("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str()); \
+			} \
+			double b = AS_NUMBER(pop()); \
+			double a = AS_NUMBER(pop()); \
+			push(BOOL_VAL(a op b)); \
+		} while (false)
+
 	#define INT_BINARY_OP(valueType, op)\
 		do {\
+			if (ARE_INTS(peek(0), peek(1))) { \
+				int64_t b = AS_INT(pop()); \
+				int64_t a = AS_INT(pop()); \
+				push(INT_OR_NUMBER_VAL(a op b)); \
+				break; \
+			} \
 			if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) { \
-			return runtimeError("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str()); \
+			RUNTIME_ERR("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str()); \
 			} \
 			double b = AS_NUMBER(pop()); \
 			double a = AS_NUMBER(pop()); \
 			push(valueType((double)((uInt64)a op (uInt64)b))); \
 		} while (false)
 
+	//guarded versions of the binary ops, NUM_NUM accepts any pair of numbers so that a site that sees both
+	//integers and doubles settles on it instead of bouncing between the specialized and generic instruction
+	#define INT_INT_OP(generic, valueType, op) \
+		do { \
+			if (!ARE_INTS(peek(0), peek(1))) DEQUICKEN(generic); \
+			int64_t b = AS_INT(pop()); \
+			int64_t a = AS_INT(pop()); \
+			push(valueType(a op b)); \
+		} while (false)
+
+	#define NUM_NUM_OP(generic, intValueType, valueType, op) \
+		do { \
+			if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) DEQUICKEN(generic); \
+			NUM_OP(intValueType, valueType, op); \
+		} while (false)
+
+	//unchecked versions of the binary ops, the compiler only emits the typed instructions if both operands are always numbers
+	#define NUM_OP(intValueType, valueType, op) \
+		do { \
+			if (ARE_INTS(peek(0), peek(1))) { \
+				int64_t b = AS_INT(pop()); \
+				int64_t a = AS_INT(pop()); \
+				push(intValueType(a op b)); \
+				break; \
+			} \
+			double b = AS_NUMBER(pop()); \
+			double a = AS_NUMBER(pop()); \
+			push(valueType(a op b)); \
+		} while (false)
+
+	//doubles that are close enough count as equal, same as the generic >= and <=
+	#define NUM_OR_EQUAL_OP(op) \
+		do { \
+			if (ARE_INTS(peek(0), peek(1))) { \
+				int32_t b = AS_INT(pop()); \
+				int32_t a = AS_INT(pop()); \
+				push(BOOL_VAL(a op b || a == b)); \
+				break; \
+			} \
+			double b = AS_NUMBER(pop()); \
+			double a = AS_NUMBER(pop()); \
+			push(BOOL_VAL(a op b || FLOAT_EQ(a, b))); \
+		} while (false)
+
+	//register instructions read their operands straight from the frame's slots(the second one can be a constant instead)
+	//and store the result in slot dst, or push it if dst is REG_TOP, checks and errors are the same as in the stack versions
+	#define REG_OPERANDS(constantB) \
+		uint8_t dst = READ_BYTE(); \
+		Value a = frame->slots[READ_BYTE()]; \
+		Value b = (constantB) ? READ_CONSTANT() : frame->slots[READ_BYTE()]
+	#define REG_STORE(dst, value) \
+		do { \
+			if ((dst) == REG_TOP) push(value); \
+			else frame->slots[dst] = (value); \
+		} while (false)
+
+	#define REG_ADD_OP(constantB) \
+		do { \
+			REG_OPERANDS(constantB); \
+			if (ARE_INTS(a, b)) REG_STORE(dst, INT_OR_NUMBER_VAL((int64_t)AS_INT(a) + (int64_t)AS_INT(b))); \
+			else if (IS_STRING(a) && IS_STRING(b)) { \
+				push(a); \
+				push(b); \
+				STORE_FRAME(); \
+				concatenate(); \
+				LOAD_FRAME(); \
+				if (dst != REG_TOP) frame->slots[dst] = pop(); \
+			} \
+			else if (IS_NUMBER(a) && IS_NUMBER(b)) REG_STORE(dst, NUMBER_VAL(AS_NUMBER(a) + AS_NUMBER(b))); \
+			else { \
+				RUNTIME_ERR("Operands must be two numbers or two strings, got %s and %s.", \
+					valueTypeToStr(a).c_str(), valueTypeToStr(b).c_str()); \
+			} \
+		} while (false)
+
+	#define REG_BINARY_OP(constantB, op) \
+		do { \
+			REG_OPERANDS(constantB); \
+			if (ARE_INTS(a, b)) { \
+				REG_STORE(dst, INT_OR_NUMBER_VAL((int64_t)AS_INT(a) op (int64_t)AS_INT(b))); \
+				break; \
+			} \
+			if (!IS_NUMBER(a) || !IS_NUMBER(b)) { \
+			RUNTIME_ERR("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(a).c_str(), valueTypeToStr(b).c_str()); \
+			} \
+			REG_STORE(dst, NUMBER_VAL(AS_NUMBER(a) op AS_NUMBER(b))); \
+		} while (false)
+
+	#define REG_DIVIDE_OP(constantB) \
+		do { \
+			REG_OPERANDS(constantB); \
+			if (!IS_NUMBER(a) || !IS_NUMBER(b)) { \
+			RUNTIME_ERR("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(a).c_str(), valueTypeToStr(b).c_str()); \
+			} \
+			REG_STORE(dst, NUMBER_VAL(AS_NUMBER(a) / AS_NUMBER(b))); \
+		} while (false)
+
+	#define REG_MOD_OP(constantB) \
+		do { \
+			REG_OPERANDS(constantB); \
+			if (ARE_INTS(a, b)) { \
+				REG_STORE(dst, INT_OR_NUMBER_VAL((int64_t)AS_INT(a) % (int64_t)AS_INT(b))); \
+				break; \
+			} \
+			if (!IS_NUMBER(a) || !IS_NUMBER(b)) { \
+			RUNTIME_ERR("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(a).c_str(), valueTypeToStr(b).c_str()); \
+			} \
+			REG_STORE(dst, NUMBER_VAL((double)((uInt64)AS_NUMBER(a) % (uInt64)AS_NUMBER(b)))); \
+		} while (false)
+
+	#define REG_EQUALITY_OP(constantB, negate) \
+		do { \
+			REG_OPERANDS(constantB); \
+			bool equal = ARE_INTS(a, b) ? AS_INT(a) == AS_INT(b) : valuesEqual(a, b); \
+			REG_STORE(dst, BOOL_VAL(equal != (negate))); \
+		} while (false)
+
+	#define REG_COMPARISON_OP(constantB, op) \
+		do { \
+			REG_OPERANDS(constantB); \
+			if (ARE_INTS(a, b)) { \
+				REG_STORE(dst, BOOL_VAL((int32_t)AS_INT(a) op (int32_t)AS_INT(b))); \
+				break; \
+			} \
+			if (!IS_NUMBER(a) || !IS_NUMBER(b)) { \
+			RUNTIME_ERR("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(a).c_str(), valueTypeToStr(b).c_str()); \
+			} \
+			REG_STORE(dst, BOOL_VAL(AS_NUMBER(a) op AS_NUMBER(b))); \
+		} while (false)
+
+	//doubles that are close enough count as equal, same as the generic >= and <=
+	#define REG_OR_EQUAL_OP(constantB, op) \
+		do { \
+			REG_OPERANDS(constantB); \
+			if (ARE_INTS(a, b)) { \
+				REG_STORE(dst, BOOL_VAL((int32_t)AS_INT(a) op (int32_t)AS_INT(b) || AS_INT(a) == AS_INT(b))); \
+				break; \
+			} \
+			if (!IS_NUMBER(a) || !IS_NUMBER(b)) { \
+				RUNTIME_ERR("Operands must be two numbers, got %s and %s.", valueTypeToStr(a).c_str(), valueTypeToStr(b).c_str()); \
+			} \
+			REG_STORE(dst, BOOL_VAL(AS_NUMBER(a) op AS_NUMBER(b) || FLOAT_EQ(AS_NUMBER(a), AS_NUMBER(b)))); \
+		} while (false)
+
+	//both are used at the very start of a handler, before any operands are read, so ip[-1] is the opcode of the current instruction
+	#ifdef QUICKENING
+	#define QUICKEN(opcode) (ip[-1] = (opcode))
+	#else
+	#define QUICKEN(opcode) do {} while (false)
+	#endif // QUICKENING
+	//the guard of a specialized instruction failed, put the generic one back and run it instead
+	#define DEQUICKEN(opcode) \
+		do { \
+			ip[-1] = (opcode); \
+			ip--; \
+			DISPATCH(); \
+		} while (false)
+
+	#ifdef BASELINE_JIT
+	//used after every call, return and loop back edge, counts towards compiling the current function and runs it's machine code
+	//from ip if it has any, machine code never allocates so code and constants stay where they are
+	#define JIT_ENTER(countsTowardsHotness) \
+		do { \
+			objFunc* jitFunc = frame->closure->func; \
+			if (jitFunc->native == nullptr) { \
+				if (!(countsTowardsHotness) || ++jitFunc->hotness != JIT_THRESHOLD) break; \
+				jitFunc->native = global::jit.compile(jitFunc); \
+				if (jitFunc->native == nullptr) break; \
+			} \
+			if (stackTop + JIT_STACK_RESERVE > stack + STACK_MAX) break; \
+			frame->ip = global::jit.run(jitFunc, ip - code, frame->slots, &stackTop, constants, frame->closure->upvals.data()); \
+			ip = code + frame->ip; \
+		} while (false)
+	#else
+	#define JIT_ENTER(countsTowardsHotness) do {} while (false)
+	#endif // BASELINE_JIT
+
+	#ifdef TRACING_JIT
+	//every instruction is reported to the recorder while it records a iteration of a loop
+	#define RECORD_INSTRUCTION() \
+		do { \
+			if (global::tracer.recording) global::tracer.record(this, ip - code); \
+		} while (false)
+	//used on every loop back edge after ip is set to the header, runs the loop's trace if it has one, otherwise counts towards recording
+	//the next iteration, neither goes through JIT_ENTER so the recorder sees the iteration, traces never allocate either
+	#define TRACE_LOOP(loopEnd) \
+		do { \
+			if (global::tracer.recording) DISPATCH(); \
+			traceAnchor* anchor = global::tracer.anchor(frame->closure->func->body, ip - code); \
+			traceCode* compiledTrace = anchor->compiled; \
+			if (compiledTrace == nullptr) { \
+				if (global::tracer.hot(this, anchor, loopEnd)) DISPATCH(); \
+				break; \
+			} \
+			if (stackTop - frame->slots != compiledTrace->depth || frame->slots + compiledTrace->maxDepth > stack + STACK_MAX) break; \
+			frame->ip = global::tracer.run(compiledTrace, frame->slots, &stackTop, constants, frame->closure->upvals.data()); \
+			ip = code + frame->ip; \
+			DISPATCH(); \
+		} while (false)
+	#else
+	#define RECORD_INSTRUCTION() do {} while (false)
+	#define TRACE_LOOP(loopEnd) do {} while (false)
+	#endif // TRACING_JIT
+
+	#ifdef AOT_BUILD
+	//the instruction the native code last left at, the interpreter runs it before going back in
+	uint8_t* aotExit = nullptr;
+	//used before every instruction, runs the function's translation(see aot.h) from ip until it reaches something it can't do
+	#define AOT_ENTER() \
+		do { \
+			if (ip == aotExit || frame->closure->func->aot == nullptr) break; \
+			frame->ip = frame->closure->func->aot(ip - code, frame->slots, &stackTop, constants, frame->closure->upvals.data()); \
+			ip = code + frame->ip; \
+			aotExit = ip; \
+		} while (false)
+	#else
+	#define AOT_ENTER() do {} while (false)
+	#endif // AOT_BUILD
+
+	#ifdef DEBUG_COUNT_INSTRUCTIONS
+	#define COUNT_INSTRUCTION() (VM->instructionCount++)
+	#else
+	#define COUNT_INSTRUCTION() do {} while (false)
+	#endif // DEBUG_COUNT_INSTRUCTIONS
+
 	#ifdef DEBUG_TRACE_EXECUTION
+	#define TRACE_INSTRUCTION() \
+		do { \
+			std::cout << "          "; \
+			for (Value* slot = stack; slot < stackTop; slot++) { \
+				std::cout << "["; \
+				printValue(*slot); \
+				std::cout << "] "; \
+			} \
+			std::cout << "\n"; \
+			disassembleInstruction(&frame->closure->func->body, ip - code); \
+		} while (false)
 	std::cout << "-------------Code execution starts-------------\n";
+	#else
+	#define TRACE_INSTRUCTION() do {} while (false)
 	#endif // DEBUG_TRACE_EXECUTION
-	#pragma endregion
 
-	while (state == fiberState::RUNNING) {
-		#ifdef DEBUG_TRACE_EXECUTION
-			std::cout << "          ";
-			for (Value* slot = stack; slot < stackTop; slot++) {
-				std::cout << "[";
-				printValue(*slot);
-				std::cout << "] ";
-			}
-			std::cout << "\n";
-			disassembleInstruction(&frame->closure->func->body, frames[frameCount - 1].ip);
-		#endif
+	#ifdef PROFILE_SEQUENCES
+	#define PROFILE_INSTRUCTION() global::profiler.record(ip, *ip, frame->closure->func->body.instructionLength(ip - code))
+	#else
+	#define PROFILE_INSTRUCTION() do {} while (false)
+	#endif // PROFILE_SEQUENCES
+
+	//a superinstruction runs the fast path of every instruction it fuses(see superinstruction.h), each step starts with ip on the opcode
+	//of it's instruction and leaves it on the next one, anything a step can't do is left to the instruction's own handler
+	//the first instruction only exists as the superinstruction, so it's put back for good, same as with DEQUICKEN
+	#define SUPER_FALLBACK(first, opcode) \
+		do { \
+			if (first) *ip = (opcode); \
+			DISPATCH(); \
+		} while (false)
+	#define SUPER_PUSH_OPERAND(value, length) \
+		do { \
+			push(value); \
+			ip += (length); \
+		} while (false)
+	#define SUPER_ARITH_STEP(first, generic, op) \
+		do { \
+			if (ARE_INTS(peek(0), peek(1))) { \
+				int64_t b = AS_INT(pop()); \
+				int64_t a = AS_INT(pop()); \
+				push(INT_OR_NUMBER_VAL(a op b)); \
+			} \
+			else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) { \
+				double b = AS_NUMBER(pop()); \
+				double a = AS_NUMBER(pop()); \
+				push(NUMBER_VAL(a op b)); \
+			} \
+			else SUPER_FALLBACK(first, generic); \
+			ip++; \
+		} while (false)
+	#define SUPER_INCREMENT_STEP(first, generic, delta) \
+		do { \
+			if (IS_INT(peek(0))) push(INT_OR_NUMBER_VAL((int64_t)AS_INT(pop()) + (delta))); \
+			else if (IS_NUMBER(peek(0))) push(NUMBER_VAL(AS_NUMBER(pop()) + (delta))); \
+			else SUPER_FALLBACK(first, generic); \
+			ip++; \
+		} while (false)
+	//orEqual is set for >= and <=, which count doubles that are close enough as equal
+	#define SUPER_COMPARISON_STEP(first, generic, op, orEqual) \
+		do { \
+			if (ARE_INTS(peek(0), peek(1))) { \
+				int32_t b = AS_INT(pop()); \
+				int32_t a = AS_INT(pop()); \
+				push(BOOL_VAL(a op b || ((orEqual) && a == b))); \
+			} \
+			else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) { \
+				double b = AS_NUMBER(pop()); \
+				double a = AS_NUMBER(pop()); \
+				push(BOOL_VAL(a op b || ((orEqual) && FLOAT_EQ(a, b)))); \
+			} \
+			else SUPER_FALLBACK(first, generic); \
+			ip++; \
+		} while (false)
+	#define SUPER_EQUALITY_STEP(negate) \
+		do { \
+			Value b = pop(); \
+			Value a = pop(); \
+			push(BOOL_VAL((ARE_INTS(a, b) ? AS_INT(a) == AS_INT(b) : valuesEqual(a, b)) != (negate))); \
+			ip++; \
+		} while (false)
+	#define SUPER_JUMP_STEP(condition) \
+		do { \
+			uint16_t offset = (uint16_t)((ip[1] << 8) | ip[2]); \
+			ip += 3; \
+			if (condition) ip += offset; \
+		} while (false)
+
+	#define SUPER_STEP_SUPER_NONE(first) do {} while (false)
+	#define SUPER_STEP_OP_GET_LOCAL(first) SUPER_PUSH_OPERAND(frame->slots[ip[1]], 2)
+	#define SUPER_STEP_OP_SET_LOCAL(first) \
+		do { \
+			frame->slots[ip[1]] = peek(0); \
+			ip += 2; \
+		} while (false)
+	#define SUPER_STEP_OP_GET_UPVALUE(first) SUPER_PUSH_OPERAND(*frame->closure->upvals[ip[1]]->location, 2)
+	#define SUPER_STEP_OP_SET_UPVALUE(first) \
+		do { \
+			*frame->closure->upvals[ip[1]]->location = peek(0); \
+			WRITE_BARRIER(frame->closure->upvals[ip[1]], peek(0)); \
+			ip += 2; \
+		} while (false)
+	#define SUPER_STEP_OP_GET_GLOBAL(first) \
+		do { \
+			globalVar* var = &AS_MODULE(constants[ip[1]])->globals.data()[ip[2]]; \
+			if (var->state == globalState::UNDEFINED) SUPER_FALLBACK(first, OP_GET_GLOBAL); \
+			SUPER_PUSH_OPERAND(var->val, 3); \
+		} while (false)
+	#define SUPER_STEP_OP_SET_GLOBAL(first) \
+		do { \
+			globalVar* var = &AS_MODULE(constants[ip[1]])->globals.data()[ip[2]]; \
+			if (var->state != globalState::DEFINED) SUPER_FALLBACK(first, OP_SET_GLOBAL); \
+			var->val = peek(0); \
+			WRITE_BARRIER(AS_MODULE(constants[ip[1]]), var->val); \
+			ip += 3; \
+		} while (false)
+	#define SUPER_STEP_OP_CONSTANT(first) SUPER_PUSH_OPERAND(constants[ip[1]], 2)
+	#define SUPER_STEP_OP_NIL(first) SUPER_PUSH_OPERAND(NIL_VAL(), 1)
+	#define SUPER_STEP_OP_TRUE(first) SUPER_PUSH_OPERAND(BOOL_VAL(true), 1)
+	#define SUPER_STEP_OP_FALSE(first) SUPER_PUSH_OPERAND(BOOL_VAL(false), 1)
+	#define SUPER_STEP_OP_POP(first) \
+		do { \
+			stackTop--; \
+			ip++; \
+		} while (false)
+	#define SUPER_STEP_OP_POPN(first) \
+		do { \
+			stackTop -= ip[1]; \
+			ip += 2; \
+		} while (false)
+	#define SUPER_STEP_OP_ADD(first) SUPER_ARITH_STEP(first, OP_ADD, +)
+	#define SUPER_STEP_OP_SUBTRACT(first) SUPER_ARITH_STEP(first, OP_SUBTRACT, -)
+	#define SUPER_STEP_OP_MULTIPLY(first) SUPER_ARITH_STEP(first, OP_MULTIPLY, *)
+	#define SUPER_STEP_OP_DIVIDE(first) \
+		do { \
+			if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) SUPER_FALLBACK(first, OP_DIVIDE); \
+			double b = AS_NUMBER(pop()); \
+			double a = AS_NUMBER(pop()); \
+			push(NUMBER_VAL(a / b)); \
+			ip++; \
+		} while (false)
+	//only integers, division by zero is left to OP_MOD
+	#define SUPER_STEP_OP_MOD(first) \
+		do { \
+			if (!ARE_INTS(peek(0), peek(1)) || AS_INT(peek(0)) == 0) SUPER_FALLBACK(first, OP_MOD); \
+			int64_t b = AS_INT(pop()); \
+			int64_t a = AS_INT(pop()); \
+			push(INT_OR_NUMBER_VAL(a % b)); \
+			ip++; \
+		} while (false)
+	#define SUPER_STEP_OP_ADD_1(first) SUPER_INCREMENT_STEP(first, OP_ADD_1, 1)
+	#define SUPER_STEP_OP_SUBTRACT_1(first) SUPER_INCREMENT_STEP(first, OP_SUBTRACT_1, -1)
+	#define SUPER_STEP_OP_EQUAL(first) SUPER_EQUALITY_STEP(false)
+	#define SUPER_STEP_OP_NOT_EQUAL(first) SUPER_EQUALITY_STEP(true)
+	#define SUPER_STEP_OP_GREATER(first) SUPER_COMPARISON_STEP(first, OP_GREATER, >, false)
+	#define SUPER_STEP_OP_GREATER_EQUAL(first) SUPER_COMPARISON_STEP(first, OP_GREATER_EQUAL, >, true)
+	#define SUPER_STEP_OP_LESS(first) SUPER_COMPARISON_STEP(first, OP_LESS, <, false)
+	#define SUPER_STEP_OP_LESS_EQUAL(first) SUPER_COMPARISON_STEP(first, OP_LESS_EQUAL, <, true)
+	#define SUPER_STEP_OP_NOT(first) \
+		do { \
+			push(BOOL_VAL(isFalsey(pop()))); \
+			ip++; \
+		} while (false)
+	//only arrays indexed with integers that are in range
+	#define SUPER_STEP_OP_GET(first) \
+		do { \
+			Value field = peek(0); \
+			Value callee = peek(1); \
+			if (!IS_ARRAY(callee) || !IS_INT(field) || AS_INT(field) < 0 \
+				|| (uInt)AS_INT(field) >= AS_ARRAY(callee)->values.count()) SUPER_FALLBACK(first, OP_GET); \
+			stackTop -= 2; \
+			push(AS_ARRAY(callee)->values.data()[AS_INT(field)]); \
+			ip++; \
+		} while (false)
+	#define SUPER_STEP_OP_SET(first) \
+		do { \
+			Value val = peek(0); \
+			Value field = peek(1); \
+			Value callee = peek(2); \
+			if (!IS_ARRAY(callee) || !IS_INT(field) || AS_INT(field) < 0 \
+				|| (uInt)AS_INT(field) >= AS_ARRAY(callee)->values.count()) SUPER_FALLBACK(first, OP_SET); \
+			objArray* arr = AS_ARRAY(callee); \
+			/* if numOfHeapPtr is 0 we don't trace or update the array when garbage collecting */ \
+			if (IS_OBJ(val)) arr->numOfHeapPtr++; \
+			else if (IS_OBJ(arr->values[AS_INT(field)])) arr->numOfHeapPtr--; \
+			arr->values[AS_INT(field)] = val; \
+			ARRAY_WRITE_BARRIER(arr, AS_INT(field), AS_INT(field) + 1, val); \
+			stackTop -= 3; \
+			push(val); \
+			ip++; \
+		} while (false)
+	#define SUPER_STEP_OP_JUMP(first) SUPER_JUMP_STEP(true)
+	#define SUPER_STEP_OP_JUMP_IF_FALSE(first) SUPER_JUMP_STEP(isFalsey(peek(0)))
+	#define SUPER_STEP_OP_JUMP_IF_TRUE(first) SUPER_JUMP_STEP(!isFalsey(peek(0)))
+	#define SUPER_STEP_OP_JUMP_IF_FALSE_POP(first) SUPER_JUMP_STEP(isFalsey(pop()))
+
+	#ifdef TRACING_JIT
+	//the recorder has to see every instruction on it's own, so while it records only the first one runs
+	#define SUPER_RECORDING_EXIT() \
+		do { \
+			if (global::tracer.recording) DISPATCH(); \
+		} while (false)
+	#else
+	#define SUPER_RECORDING_EXIT() do {} while (false)
+	#endif // TRACING_JIT
+	//unused steps are SUPER_STEP_SUPER_NONE, the opcode was already read so ip is moved back onto it
+	#define SUPER_CASE(name, op0, op1, op2, op3) \
+		CASE(name): { \
+			ip--; \
+			SUPER_STEP_##op0(true); \
+			SUPER_RECORDING_EXIT(); \
+			SUPER_STEP_##op1(false); \
+			SUPER_STEP_##op2(false); \
+			SUPER_STEP_##op3(false); \
+			DISPATCH(); \
+		}
+
+	#ifdef TRACING_JIT
+	//the recorder has to see the instructions a fused branch replaced, so while it records they run on their own
+	#define FUSED_RECORDING() (global::tracer.recording)
+	//the loop's condition is left to the header so that every back edge goes through the JITs the same way as with OP_LOOP
+	#define FOR_INCR_BACK_EDGE(header, loopEnd) \
+		do { \
+			ip = (header); \
+			TRACE_LOOP((loopEnd) - 3 - code); \
+			JIT_ENTER(true); \
+			DISPATCH(); \
+		} while (false)
+	#else
+	#define FUSED_RECORDING() false
+	#ifdef BASELINE_JIT
+	#define FOR_INCR_BACK_EDGE(header, loopEnd) \
+		do { \
+			ip = (header); \
+			JIT_ENTER(true); \
+			DISPATCH(); \
+		} while (false)
+	#else
+	#define FOR_INCR_BACK_EDGE(header, loopEnd) do {} while (false)
+	#endif // BASELINE_JIT
+	#endif // TRACING_JIT
+	//a fused comparison also runs the OP_JUMP_IF_FALSE_POP after it(see peephole::fuseBranches), which stays in place for the JITs
+	#define FUSED_BRANCH(result) \
+		do { \
+			bool condition = (result); \
+			stackTop -= 2; \
+			if (FUSED_RECORDING()) { \
+				push(BOOL_VAL(condition)); \
+				DISPATCH(); \
+			} \
+			uint16_t offset = (uint16_t)((ip[1] << 8) | ip[2]); \
+			ip += 3; \
+			if (!condition) ip += offset; \
+		} while (false)
+	//replaces GET_LOCAL i CONSTANT step OP_ADD SET_LOCAL i OP_POP OP_LOOP, and also runs the condition at the loop's header:
+	//GET_LOCAL i GET_LOCAL/CONSTANT limit OP_LESS OP_JUMP_IF_FALSE_POP, only the operands of those instructions are read
+	//anything that isn't a number runs the instructions it replaced, starting with the GET_LOCAL it was written over
+	#define FOR_INCR_LOOP_OP(constantLimit) \
+		do { \
+			Value counter = frame->slots[ip[0]]; \
+			Value step = constants[ip[2]]; \
+			uint8_t* loopEnd = ip + 10; \
+			uint8_t* header = loopEnd - ((ip[8] << 8) | ip[9]); \
+			Value limit = (constantLimit) ? constants[header[3]] : frame->slots[header[3]]; \
+			if (FUSED_RECORDING() || !IS_NUMBER(counter) || !IS_NUMBER(step) || !IS_NUMBER(limit)) { \
+				push(counter); \
+				ip++; \
+				break; \
+			} \
+			Value next = ARE_INTS(counter, step) ? INT_OR_NUMBER_VAL((int64_t)AS_INT(counter) + AS_INT(step)) \
+				: NUMBER_VAL(AS_NUMBER(counter) + AS_NUMBER(step)); \
+			frame->slots[ip[0]] = next; \
+			FOR_INCR_BACK_EDGE(header, loopEnd); \
+			bool condition = ARE_INTS(next, limit) ? (int32_t)AS_INT(next) < (int32_t)AS_INT(limit) : AS_NUMBER(next) < AS_NUMBER(limit); \
+			ip = condition ? header + 8 : loopEnd; \
+		} while (false)
 
-		uint8_t instruction;
-		switch (instruction = READ_BYTE()) {
+	#ifdef THREADED_DISPATCH
+	//labels have to be in the same order as the OpCode enum
+	static void* dispatchTable[] = {
+		//Helpers
+		&&CASE_OP_POP, &&CASE_OP_POPN,
+		//constants
+		&&CASE_OP_CONSTANT, &&CASE_OP_CONSTANT_LONG, &&CASE_OP_NIL, &&CASE_OP_TRUE, &&CASE_OP_FALSE,
+		//unary
+		&&CASE_OP_NEGATE, &&CASE_OP_NOT, &&CASE_OP_BIN_NOT,
+		//binary
+		&&CASE_OP_BITWISE_XOR, &&CASE_OP_BITWISE_OR, &&CASE_OP_BITWISE_AND, &&CASE_OP_ADD, &&CASE_OP_SUBTRACT, &&CASE_OP_MULTIPLY,
+		&&CASE_OP_DIVIDE, &&CASE_OP_MOD, &&CASE_OP_BITSHIFT_LEFT, &&CASE_OP_BITSHIFT_RIGHT, &&CASE_OP_ADD_1, &&CASE_OP_SUBTRACT_1,
+		//comparisons and equality
+		&&CASE_OP_EQUAL, &&CASE_OP_NOT_EQUAL, &&CASE_OP_GREATER, &&CASE_OP_GREATER_EQUAL, &&CASE_OP_LESS, &&CASE_OP_LESS_EQUAL,
+		//Statements
+		&&CASE_OP_PRINT, &&CASE_OP_TO_STRING,
+		//Variables
+		&&CASE_OP_DEFINE_GLOBAL, &&CASE_OP_DEFINE_GLOBAL_LONG, &&CASE_OP_GET_GLOBAL, &&CASE_OP_GET_GLOBAL_LONG,
+		&&CASE_OP_SET_GLOBAL, &&CASE_OP_SET_GLOBAL_LONG, &&CASE_OP_GET_LOCAL, &&CASE_OP_SET_LOCAL,
+		&&CASE_OP_GET_UPVALUE, &&CASE_OP_SET_UPVALUE, &&CASE_OP_CLOSE_UPVALUE,
+		//Arrays
+		&&CASE_OP_CREATE_ARRAY, &&CASE_OP_GET, &&CASE_OP_SET,
+		//control flow
+		&&CASE_OP_JUMP, &&CASE_OP_JUMP_IF_FALSE, &&CASE_OP_JUMP_IF_TRUE, &&CASE_OP_JUMP_IF_FALSE_POP, &&CASE_OP_LOOP,
+		&&CASE_OP_JUMP_POPN, &&CASE_OP_SWITCH,
+		//Functions
+		&&CASE_OP_CALL, &&CASE_OP_RETURN, &&CASE_OP_CLOSURE, &&CASE_OP_CLOSURE_LONG,
+		//OOP
+		&&CASE_OP_CLASS, &&CASE_OP_GET_PROPERTY, &&CASE_OP_GET_PROPERTY_LONG, &&CASE_OP_SET_PROPERTY, &&CASE_OP_SET_PROPERTY_LONG,
+		&&CASE_OP_CREATE_STRUCT, &&CASE_OP_CREATE_STRUCT_LONG, &&CASE_OP_METHOD, &&CASE_OP_INVOKE, &&CASE_OP_INVOKE_LONG,
+		&&CASE_OP_INHERIT, &&CASE_OP_GET_SUPER, &&CASE_OP_GET_SUPER_LONG, &&CASE_OP_SUPER_INVOKE, &&CASE_OP_SUPER_INVOKE_LONG,
+		//fibers
+		&&CASE_OP_FIBER_CREATE, &&CASE_OP_FIBER_RUN, &&CASE_OP_FIBER_YIELD,
+		//Modules
+		&&CASE_OP_START_MODULE, &&CASE_OP_MODULE_GET, &&CASE_OP_MODULE_GET_LONG,
+		//Quickened
+		&&CASE_OP_ADD_INT_INT, &&CASE_OP_ADD_NUM_NUM, &&CASE_OP_SUBTRACT_INT_INT, &&CASE_OP_SUBTRACT_NUM_NUM,
+		&&CASE_OP_LESS_INT_INT, &&CASE_OP_LESS_NUM_NUM, &&CASE_OP_GET_ARRAY_NUM, &&CASE_OP_SET_ARRAY_NUM, &&CASE_OP_CALL_CLOSURE,
+		//Typed
+		&&CASE_OP_ADD_NUM, &&CASE_OP_ADD_STRING, &&CASE_OP_SUBTRACT_NUM, &&CASE_OP_MULTIPLY_NUM, &&CASE_OP_DIVIDE_NUM,
+		&&CASE_OP_ADD_1_NUM, &&CASE_OP_SUBTRACT_1_NUM, &&CASE_OP_GREATER_NUM, &&CASE_OP_GREATER_EQUAL_NUM, &&CASE_OP_LESS_NUM,
+		&&CASE_OP_LESS_EQUAL_NUM,
+		//Register
+		&&CASE_OP_REG_MOVE, &&CASE_OP_REG_LOAD,
+		&&CASE_OP_REG_ADD, &&CASE_OP_REG_SUBTRACT, &&CASE_OP_REG_MULTIPLY, &&CASE_OP_REG_DIVIDE, &&CASE_OP_REG_MOD,
+		&&CASE_OP_REG_EQUAL, &&CASE_OP_REG_NOT_EQUAL, &&CASE_OP_REG_GREATER, &&CASE_OP_REG_GREATER_EQUAL,
+		&&CASE_OP_REG_LESS, &&CASE_OP_REG_LESS_EQUAL,
+		&&CASE_OP_REG_ADD_K, &&CASE_OP_REG_SUBTRACT_K, &&CASE_OP_REG_MULTIPLY_K, &&CASE_OP_REG_DIVIDE_K, &&CASE_OP_REG_MOD_K,
+		&&CASE_OP_REG_EQUAL_K, &&CASE_OP_REG_NOT_EQUAL_K, &&CASE_OP_REG_GREATER_K, &&CASE_OP_REG_GREATER_EQUAL_K,
+		&&CASE_OP_REG_LESS_K, &&CASE_OP_REG_LESS_EQUAL_K,
+		//Fused branches
+		&&CASE_OP_LESS_JUMP, &&CASE_OP_EQUAL_JUMP, &&CASE_OP_FOR_INCR_LOOP, &&CASE_OP_FOR_INCR_LOOP_K,
+		//Superinstructions
+		#define SUPERINSTRUCTION_LABEL(name, op0, op1, op2, op3) &&CASE_##name,
+		SUPERINSTRUCTION_LIST(SUPERINSTRUCTION_LABEL)
+		#undef SUPERINSTRUCTION_LABEL
+	};
+	static_assert(sizeof(dispatchTable) / sizeof(void*) == OP_FOR_INCR_LOOP_K + 1 + SUPERINSTRUCTION_COUNT, "Dispatch table is missing opcodes.");
+	//every instruction jumps straight to the handler of the next one, which gives each of them it's own indirect branch
+	#define DISPATCH() \
+		do { \
+			AOT_ENTER(); \
+			TRACE_INSTRUCTION(); \
+			RECORD_INSTRUCTION(); \
+			COUNT_INSTRUCTION(); \
+			PROFILE_INSTRUCTION(); \
+			goto *dispatchTable[READ_BYTE()]; \
+		} while (false)
+	#define INTERPRET_LOOP DISPATCH();
+	#define CASE(op) CASE_##op
+	#else
+	#define DISPATCH() goto loop
+	#define INTERPRET_LOOP \
+		loop: \
+		AOT_ENTER(); \
+		TRACE_INSTRUCTION(); \
+		RECORD_INSTRUCTION(); \
+		COUNT_INSTRUCTION(); \
+		PROFILE_INSTRUCTION(); \
+		switch (READ_BYTE())
+	#define CASE(op) case op
+	#endif // THREADED_DISPATCH
+	#pragma endregion
 
+	LOAD_FRAME();
+	INTERPRET_LOOP
+	{
 		#pragma region Helpers
-		case OP_POP:
+		CASE(OP_POP):
 			pop();
-			break;
-		case OP_POPN: {
+			DISPATCH();
+		CASE(OP_POPN): {
 			uint8_t nToPop = READ_BYTE();
-			int i = 0;
-			while (i < nToPop) {
-				pop();
-				i++;
-			}
-			break;
+			stackTop -= nToPop;
+			DISPATCH();
 		}
 		#pragma endregion
 
 		#pragma region Constants
-		case OP_CONSTANT: {
+		CASE(OP_CONSTANT): {
 			Value constant = READ_CONSTANT();
 			push(constant);
-			break;
+			DISPATCH();
 		}
-		case OP_CONSTANT_LONG: {
+		CASE(OP_CONSTANT_LONG): {
 			Value constant = READ_CONSTANT_LONG();
 			push(constant);
-			break;
+			DISPATCH();
 		}
-		case OP_NIL: push(NIL_VAL()); break;
-		case OP_TRUE: push(BOOL_VAL(true)); break;
-		case OP_FALSE: push(BOOL_VAL(false)); break;
+		CASE(OP_NIL): push(NIL_VAL()); DISPATCH();
+		CASE(OP_TRUE): push(BOOL_VAL(true)); DISPATCH();
+		CASE(OP_FALSE): push(BOOL_VAL(false)); DISPATCH();
 		#pragma endregion
 
 		#pragma region Unary
-		case OP_NEGATE:
+		CASE(OP_NEGATE):
+			//-0 can only be represented as a double
+			if (IS_INT(peek(0)) && AS_INT(peek(0)) != 0) {
+				push(INT_OR_NUMBER_VAL(-(int64_t)AS_INT(pop())));
+				DISPATCH();
+			}
 			if (!IS_NUMBER(peek(0))) {
-				return runtimeError("Operand must be a number, got %s.", valueTypeToStr(peek(0)).c_str());
+				RUNTIME_ERR("Operand must be a number, got %s.", valueTypeToStr(peek(0)).c_str());
 			}
 			push(NUMBER_VAL(-AS_NUMBER(pop())));
-			break;
-		case OP_NOT:
+			DISPATCH();
+		CASE(OP_NOT):
 			push(BOOL_VAL(isFalsey(pop())));
-			break;
-		case OP_BIN_NOT: {
+			DISPATCH();
+		CASE(OP_BIN_NOT): {
 			if (!IS_NUMBER(peek(0))) {
-				return runtimeError("Operand must be a number, got %s.", valueTypeToStr(peek(0)).c_str());
+				RUNTIME_ERR("Operand must be a number, got %s.", valueTypeToStr(peek(0)).c_str());
 			}
 			int num = AS_NUMBER(pop());
-			num = ~num;
-			push(NUMBER_VAL((double)num));
-			break;
+			push(INT_VAL(~num));
+			DISPATCH();
 		}
 		#pragma endregion
 
 		#pragma region Binary
-		case OP_ADD: {
-			if (IS_STRING(peek(0)) && IS_STRING(peek(1))) {
+		CASE(OP_ADD): {
+			if (ARE_INTS(peek(0), peek(1))) {
+				QUICKEN(OP_ADD_INT_INT);
+				int64_t b = AS_INT(pop());
+				int64_t a = AS_INT(pop());
+				push(INT_OR_NUMBER_VAL(a + b));
+			}
+			else if (IS_STRING(peek(0)) && IS_STRING(peek(1))) {
+				STORE_FRAME();
 				concatenate();
+				LOAD_FRAME();
 			}
 			else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
+				QUICKEN(OP_ADD_NUM_NUM);
 				double b = AS_NUMBER(pop());
 				double a = AS_NUMBER(pop());
 				push(NUMBER_VAL(a + b));
 			}
 			else {
-				return runtimeError("Operands must be two numbers or two strings, got %s and %s.",
-					valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)));
-			}
-			break;
-		}
-		case OP_SUBTRACT: BINARY_OP(NUMBER_VAL, -); break;
-		case OP_MULTIPLY: BINARY_OP(NUMBER_VAL, *); break;
-		case OP_DIVIDE:   BINARY_OP(NUMBER_VAL, / ); break;
-		case OP_MOD:	  INT_BINARY_OP(NUMBER_VAL, %); break;
-		case OP_BITSHIFT_LEFT: INT_BINARY_OP(NUMBER_VAL, << ); break;
-		case OP_BITSHIFT_RIGHT: INT_BINARY_OP(NUMBER_VAL, >> ); break;
-		case OP_BITWISE_AND: INT_BINARY_OP(NUMBER_VAL, &); break;
-		case OP_BITWISE_OR: INT_BINARY_OP(NUMBER_VAL, | ); break;
-		case OP_BITWISE_XOR: INT_BINARY_OP(NUMBER_VAL, ^); break;
-		case OP_ADD_1: {
-			if (IS_NUMBER(peek(0))) {
-				Value num = pop();
-				num.as.num++;
-				push(num);
-			}
-			else return runtimeError("Operands must be two numbers, got %s and number.", valueTypeToStr(peek(0)).c_str());
-			break;
-		}
-		case OP_SUBTRACT_1: {
-			if (IS_NUMBER(peek(0))) {
-				Value num = pop();
-				num.as.num--;
-				push(num);
-			}
-			else return runtimeError("Operands must be two numbers, got %s and number.", valueTypeToStr(peek(0)).c_str());
-			break;
+				RUNTIME_ERR("Operands must be two numbers or two strings, got %s and %s.",
+					valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str());
+			}
+			DISPATCH();
+		}
+		CASE(OP_SUBTRACT):
+			if (ARE_INTS(peek(0), peek(1))) QUICKEN(OP_SUBTRACT_INT_INT);
+			else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) QUICKEN(OP_SUBTRACT_NUM_NUM);
+			BINARY_OP(NUMBER_VAL, -);
+			DISPATCH();
+		CASE(OP_MULTIPLY): BINARY_OP(NUMBER_VAL, *); DISPATCH();
+		CASE(OP_DIVIDE): {
+			//division always produces a double, even if both operands are integers
+			if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
+				RUNTIME_ERR("Operands must be numbers, got '%s' and '%s'.", valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str());
+			}
+			double b = AS_NUMBER(pop());
+			double a = AS_NUMBER(pop());
+			push(NUMBER_VAL(a / b));
+			DISPATCH();
+		}
+		CASE(OP_MOD):	  INT_BINARY_OP(NUMBER_VAL, %); DISPATCH();
+		CASE(OP_BITSHIFT_LEFT): INT_BINARY_OP(NUMBER_VAL, << ); DISPATCH();
+		CASE(OP_BITSHIFT_RIGHT): INT_BINARY_OP(NUMBER_VAL, >> ); DISPATCH();
+		CASE(OP_BITWISE_AND): INT_BINARY_OP(NUMBER_VAL, &); DISPATCH();
+		CASE(OP_BITWISE_OR): INT_BINARY_OP(NUMBER_VAL, | ); DISPATCH();
+		CASE(OP_BITWISE_XOR): INT_BINARY_OP(NUMBER_VAL, ^); DISPATCH();
+		CASE(OP_ADD_1): {
+			if (IS_INT(peek(0))) {
+				push(INT_OR_NUMBER_VAL((int64_t)AS_INT(pop()) + 1));
+			}
+			else if (IS_NUMBER(peek(0))) {
+				push(NUMBER_VAL(AS_NUMBER(pop()) + 1));
+			}
+			else RUNTIME_ERR("Operands must be two numbers, got %s and number.", valueTypeToStr(peek(0)).c_str());
+			DISPATCH();
+		}
+		CASE(OP_SUBTRACT_1): {
+			if (IS_INT(peek(0))) {
+				push(INT_OR_NUMBER_VAL((int64_t)AS_INT(pop()) - 1));
+			}
+			else if (IS_NUMBER(peek(0))) {
+				push(NUMBER_VAL(AS_NUMBER(pop()) - 1));
+			}
+			else RUNTIME_ERR("Operands must be two numbers, got %s and number.", valueTypeToStr(peek(0)).c_str());
+			DISPATCH();
 		}
 		#pragma endregion
 
 		#pragma region Binary that returns bools
-		case OP_EQUAL: {
+		CASE(OP_EQUAL): {
 			Value b = pop();
 			Value a = pop();
-			push(BOOL_VAL(valuesEqual(a, b)));
-			break;
+			if (ARE_INTS(a, b)) push(BOOL_VAL(AS_INT(a) == AS_INT(b)));
+			else push(BOOL_VAL(valuesEqual(a, b)));
+			DISPATCH();
 		}
-		case OP_NOT_EQUAL: {
+		CASE(OP_NOT_EQUAL): {
 			Value b = pop();
 			Value a = pop();
-			push(BOOL_VAL(!valuesEqual(a, b)));
-			break;
-		}
-		case OP_GREATER: BINARY_OP(BOOL_VAL, > ); break;
-		case OP_LESS: {
-			Value a = peek(1);
-			Value b = peek(0);
-			BINARY_OP(BOOL_VAL, < ); break; }
-		case OP_GREATER_EQUAL: {
+			if (ARE_INTS(a, b)) push(BOOL_VAL(AS_INT(a) != AS_INT(b)));
+			else push(BOOL_VAL(!valuesEqual(a, b)));
+			DISPATCH();
+		}
+		CASE(OP_GREATER): COMPARISON_OP(> ); DISPATCH();
+		CASE(OP_LESS):
+			if (ARE_INTS(peek(0), peek(1))) QUICKEN(OP_LESS_INT_INT);
+			else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) QUICKEN(OP_LESS_NUM_NUM);
+			COMPARISON_OP(< );
+			DISPATCH();
+		CASE(OP_GREATER_EQUAL): {
+			if (ARE_INTS(peek(0), peek(1))) {
+				int32_t b = AS_INT(pop());
+				int32_t a = AS_INT(pop());
+				push(BOOL_VAL(a >= b));
+				DISPATCH();
+			}
 			//Have to do this because of floating point comparisons
 			if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
-				return runtimeError("Operands must be two numbers, got %s and %s.", 
+				RUNTIME_ERR("Operands must be two numbers, got %s and %s.", 
 					valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str());
 			}
 			double b = AS_NUMBER(pop());
 			double a = AS_NUMBER(pop());
 			if (a > b || FLOAT_EQ(a, b)) push(BOOL_VAL(true));
 			else push(BOOL_VAL(false));
-			break;
-		}
-		case OP_LESS_EQUAL: {
+			DISPATCH();
+		}
+		CASE(OP_LESS_EQUAL): {
+			if (ARE_INTS(peek(0), peek(1))) {
+				int32_t b = AS_INT(pop());
+				int32_t a = AS_INT(pop());
+				push(BOOL_VAL(a <= b));
+				DISPATCH();
+			}
 			if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
-				return runtimeError("Operands must be two numbers, got %s and %s.",
+				RUNTIME_ERR("Operands must be two numbers, got %s and %s.",
 					valueTypeToStr(peek(1)).c_str(), valueTypeToStr(peek(0)).c_str());
 			}
 			double b = AS_NUMBER(pop());
 			double a = AS_NUMBER(pop());
 			if (a < b || FLOAT_EQ(a, b)) push(BOOL_VAL(true));
 			else push(BOOL_VAL(false));
-			break;
+			DISPATCH();
 		}
 		#pragma endregion
 
 		#pragma region Statements and vars
-		case OP_PRINT: {
+		CASE(OP_PRINT): {
 			printValue(pop());
 			std::cout << "\n";
-			break;
+			DISPATCH();
 		}
 
-		case OP_TO_STRING: {
+		CASE(OP_TO_STRING): {
+			STORE_FRAME();
 			if (!pushValToStr(this, pop())) return RUNTIME_ERROR;
 			//in case pushValToStr encountered a instance of a class that has defined a toString method
 			//we need to update the frame pointer
-			frame = &frames[frameCount - 1];
-			break;
+			LOAD_FRAME();
+			DISPATCH();
 		}
 
-		case OP_DEFINE_GLOBAL: {
-			objString* name = READ_STRING();
-			VM->curModule->vars.set(name, peek(0));
-			pop();
-			break;
+		//globals live in slots of the module they were declared in, the compiler resolves every name to it's slot
+		CASE(OP_DEFINE_GLOBAL): {
+			globalVar* var = &VM->curModule->globals.data()[READ_BYTE()];
+			var->val = pop();
+			WRITE_BARRIER(VM->curModule, var->val);
+			var->state = globalState::DEFINED;
+			DISPATCH();
 		}
-		case OP_DEFINE_GLOBAL_LONG: {
-			objString* name = READ_STRING_LONG();
-			VM->curModule->vars.set(name, peek(0));
-			pop();
-			break;
+		CASE(OP_DEFINE_GLOBAL_LONG): {
+			globalVar* var = &VM->curModule->globals.data()[READ_SHORT()];
+			var->val = pop();
+			WRITE_BARRIER(VM->curModule, var->val);
+			var->state = globalState::DEFINED;
+			DISPATCH();
 		}
 
-		case OP_GET_GLOBAL: {
-			objString* name = READ_STRING();
+		CASE(OP_GET_GLOBAL): {
 			objModule* mod = AS_MODULE(READ_CONSTANT());
-			Value value;
-			if (!mod->vars.get(name, &value)) {
-				if(!VM->globals.get(name, &value)) return runtimeError("Undefined variable '%s'.", name->str);
-			}
-			push(value);
-			break;
+			uint8_t slot = READ_BYTE();
+			globalVar* var = &mod->globals.data()[slot];
+			if (var->state == globalState::UNDEFINED) RUNTIME_ERR("Undefined variable '%s'.", mod->slotName(slot)->str);
+			push(var->val);
+			DISPATCH();
 		}
-		case OP_GET_GLOBAL_LONG: {
-			objString* name = READ_STRING_LONG();
+		CASE(OP_GET_GLOBAL_LONG): {
 			objModule* mod = AS_MODULE(READ_CONSTANT_LONG());
-			Value value;
-			if (!mod->vars.get(name, &value)) {
-				if (!VM->globals.get(name, &value)) return runtimeError("Undefined variable '%s'.", name->str);
-			}
-			push(value);
-			break;
+			uInt16 slot = READ_SHORT();
+			globalVar* var = &mod->globals.data()[slot];
+			if (var->state == globalState::UNDEFINED) RUNTIME_ERR("Undefined variable '%s'.", mod->slotName(slot)->str);
+			push(var->val);
+			DISPATCH();
 		}
 
-		case OP_SET_GLOBAL: {
-			objString* name = READ_STRING();
+		//natives can be read through a slot, but assigning to one requires the module to declare the variable first
+		CASE(OP_SET_GLOBAL): {
 			objModule* mod = AS_MODULE(READ_CONSTANT());
-			if (mod->vars.set(name, peek(0))) {
-				mod->vars.del(name);
-				return runtimeError("Undefined variable '%s'.", name->str);
-			}
-			break;
+			uint8_t slot = READ_BYTE();
+			globalVar* var = &mod->globals.data()[slot];
+			if (var->state != globalState::DEFINED) RUNTIME_ERR("Undefined variable '%s'.", mod->slotName(slot)->str);
+			var->val = peek(0);
+			WRITE_BARRIER(mod, var->val);
+			DISPATCH();
 		}
-		case OP_SET_GLOBAL_LONG: {
-			objString* name = READ_STRING_LONG();
+		CASE(OP_SET_GLOBAL_LONG): {
 			objModule* mod = AS_MODULE(READ_CONSTANT_LONG());
-			if (mod->vars.set(name, peek(0))) {
-				mod->vars.del(name);
-				return runtimeError("Undefined variable '%s'.", name->str);
-			}
-			break;
+			uInt16 slot = READ_SHORT();
+			globalVar* var = &mod->globals.data()[slot];
+			if (var->state != globalState::DEFINED) RUNTIME_ERR("Undefined variable '%s'.", mod->slotName(slot)->str);
+			var->val = peek(0);
+			WRITE_BARRIER(mod, var->val);
+			DISPATCH();
 		}
 
-		case OP_GET_LOCAL: {
+		CASE(OP_GET_LOCAL): {
 			uint8_t slot = READ_BYTE();
 			push(frame->slots[slot]);
-			break;
+			DISPATCH();
 		}
 
-		case OP_SET_LOCAL: {
+		CASE(OP_SET_LOCAL): {
 			uint8_t slot = READ_BYTE();
 			frame->slots[slot] = peek(0);
-			break;
+			DISPATCH();
 		}
 		 //upvals[slot]->location can be a pointer to either a stack slot, or a closed upvalue in a functions closure
-		case OP_GET_UPVALUE: {
+		CASE(OP_GET_UPVALUE): {
 			uint8_t slot = READ_BYTE();
 			push(*frame->closure->upvals[slot]->location);
-			break;
+			DISPATCH();
 		}
 
-		case OP_SET_UPVALUE: {
+		CASE(OP_SET_UPVALUE): {
 			uint8_t slot = READ_BYTE();
 			*frame->closure->upvals[slot]->location = peek(0);
-			break;
+			WRITE_BARRIER(frame->closure->upvals[slot], peek(0));
+			DISPATCH();
 		}
 
-		case OP_CLOSE_UPVALUE: {
+		CASE(OP_CLOSE_UPVALUE): {
 			closeUpvalues(stackTop - 1);
 			pop();
-			break;
+			DISPATCH();
 		}
 
-		case OP_MODULE_GET: {
-			if (!IS_MODULE(peek(0))) return runtimeError("Expected a module for the left side of '::'.");
+		CASE(OP_MODULE_GET): {
+			if (!IS_MODULE(peek(0))) RUNTIME_ERR("Expected a module for the left side of '::'.");
 			objModule* mod = AS_MODULE(pop());
 			objString* name = READ_STRING();
-			Value val;
-			if (!mod->vars.get(name, &val)) return runtimeError("Undefined variable %s in file '%s'", name->str, mod->name->str);
-			push(val);
-			break;
+			Value slot;
+			//only variables the module itself defined are visible from the outside
+			if (!mod->vars.get(name, &slot) || mod->globals[AS_NUMBER(slot)].state != globalState::DEFINED) {
+				RUNTIME_ERR("Undefined variable %s in file '%s'", name->str, mod->name->str);
+			}
+			push(mod->globals[AS_NUMBER(slot)].val);
+			DISPATCH();
 		}
-		case OP_MODULE_GET_LONG: {
-			if(!IS_MODULE(peek(0))) return runtimeError("Expected a module for the left side of '::'.");
+		CASE(OP_MODULE_GET_LONG): {
+			if(!IS_MODULE(peek(0))) RUNTIME_ERR("Expected a module for the left side of '::'.");
 			objModule* mod = AS_MODULE(pop());
 			objString* name = READ_STRING_LONG();
-			Value val;
-			if (!mod->vars.get(name, &val)) return runtimeError("Undefined variable %s in file '%s'", name->str, mod->name->str);
-			push(val);
-			break;
+			Value slot;
+			//only variables the module itself defined are visible from the outside
+			if (!mod->vars.get(name, &slot) || mod->globals[AS_NUMBER(slot)].state != globalState::DEFINED) {
+				RUNTIME_ERR("Undefined variable %s in file '%s'", name->str, mod->name->str);
+			}
+			push(mod->globals[AS_NUMBER(slot)].val);
+			DISPATCH();
 		}
 		#pragma endregion
 
 		#pragma region Control flow
-		case OP_JUMP_IF_TRUE: {
+		CASE(OP_JUMP_IF_TRUE): {
 			uint16_t offset = READ_SHORT();
-			if (!isFalsey(peek(0))) frame->ip += offset;
-			break;
+			if (!isFalsey(peek(0))) ip += offset;
+			DISPATCH();
 		}
 
-		case OP_JUMP_IF_FALSE: {
+		CASE(OP_JUMP_IF_FALSE): {
 			uint16_t offset = READ_SHORT();
-			if (isFalsey(peek(0))) frame->ip += offset;
-			break;
+			if (isFalsey(peek(0))) ip += offset;
+			DISPATCH();
 		}
 
-		case OP_JUMP_IF_FALSE_POP: {
+		CASE(OP_JUMP_IF_FALSE_POP): {
 			uint16_t offset = READ_SHORT();
-			if (isFalsey(pop())) frame->ip += offset;
-			break;
+			if (isFalsey(pop())) ip += offset;
+			DISPATCH();
 		}
 
-		case OP_JUMP: {
+		CASE(OP_JUMP): {
 			uint16_t offset = READ_SHORT();
-			frame->ip += offset;
-			break;
+			ip += offset;
+			DISPATCH();
 		}
 
-		case OP_LOOP: {
+		CASE(OP_LOOP): {
 			uint16_t offset = READ_SHORT();
-			frame->ip -= offset;
-			break;
+			ip -= offset;
+			TRACE_LOOP(ip - code + offset - 3);
+			JIT_ENTER(true);
+			DISPATCH();
 		}
 
-		case OP_JUMP_POPN: {
+		CASE(OP_JUMP_POPN): {
 			uint16_t toPop = READ_SHORT();
-			int i = 0;
-			while (i < toPop) {
-				pop();
-				i++;
-			}
+			stackTop -= toPop;
 			uint16_t offset = READ_SHORT();
-			frame->ip += offset;
-			break;
+			ip += offset;
+			DISPATCH();
 		}
 
-		case OP_SWITCH: {
+		CASE(OP_SWITCH): {
 			if (IS_STRING(peek(0)) || IS_NUMBER(peek(0))) {
 				int pos = READ_BYTE();
-				switchTable& _table = frames[frameCount - 1].closure->func->body.switchTables[pos];
+				switchTable& _table = frame->closure->func->body.switchTables[pos];
 				//default jump exists for every switch, and if it's not user defined it jumps to the end of switch
 				switch (_table.type) {
 				case switchType::NUM: {
@@ -707,11 +1498,11 @@ interpretResult objFiber::execute() {
 						int num = AS_NUMBER(pop());
 						long jumpLength = _table.getJump(num);
 						if (jumpLength != -1) {
-							frame->ip += jumpLength;
+							ip += jumpLength;
 							break;
 						}
 					}
-					frame->ip += _table.defaultJump;
+					ip += _table.defaultJump;
 					break;
 				}
 				case switchType::STRING: {
@@ -721,11 +1512,11 @@ interpretResult objFiber::execute() {
 						key.assign(str->str, str->length + 1);
 						long jumpLength = _table.getJump(key);
 						if (jumpLength != -1) {
-							frame->ip += jumpLength;
+							ip += jumpLength;
 							break;
 						}
 					}
-					frame->ip += _table.defaultJump;
+					ip += _table.defaultJump;
 					break;
 				}
 				case switchType::MIXED: {
@@ -738,34 +1529,38 @@ interpretResult objFiber::execute() {
 					else str = std::to_string((int)AS_NUMBER(pop()));
 					long jumpLength = _table.getJump(str);
 					if (jumpLength != -1) {
-						frame->ip += jumpLength;
+						ip += jumpLength;
 						break;
 					}
-					frame->ip += _table.defaultJump;
+					ip += _table.defaultJump;
 					break;
 				}
 				}
 			}
 			else {
-				return runtimeError("Switch expression can be only string or number, got %s.", valueTypeToStr(peek(0)).c_str());
+				RUNTIME_ERR("Switch expression can be only string or number, got %s.", valueTypeToStr(peek(0)).c_str());
 			}
-			break;
+			DISPATCH();
 		}
 		#pragma endregion
 
 		#pragma region Functions
-		case OP_CALL: {
+		CASE(OP_CALL): {
+			//the arg count hasn't been read yet, it tells us where the callee is
+			if (IS_CLOSURE(peek(*ip))) QUICKEN(OP_CALL_CLOSURE);
 			//how many values are on the stack right now
 			int argCount = READ_BYTE();
+			STORE_FRAME();
 			if (!callValue(peek(argCount), argCount)) {
 				return RUNTIME_ERROR;
 			}
 			//if the call is succesful, there is a new call frame, so we need to update the pointer
-			frame = &frames[frameCount - 1];
-			break;
+			LOAD_FRAME();
+			JIT_ENTER(true);
+			DISPATCH();
 		}
 
-		case OP_RETURN: {
+		CASE(OP_RETURN): {
 			Value result = pop();
 			closeUpvalues(frame->slots);
 			frameCount--;
@@ -786,54 +1581,65 @@ interpretResult objFiber::execute() {
 
 			stackTop = frame->slots;
 			push(result);
-			//if the call is succesful, there is a new call frame, so we need to update the pointer
-			frame = &frames[frameCount - 1];
-			break;
-		}
-
-		case OP_CLOSURE: {
-			//doing this to avoid cached pointers
-			objClosure* closure = new objClosure(AS_FUNCTION(READ_CONSTANT()));
-			push(OBJ_VAL(closure));
-			for (int i = 0; i < closure->upvals.size(); i++) {
+			//the frame we're returning to has it's ip stored, so we just need to reload it
+			LOAD_FRAME();
+			JIT_ENTER(false);
+			DISPATCH();
+		}
+
+		CASE(OP_CLOSURE): {
+			uint8_t funcIndex = READ_BYTE();
+			STORE_FRAME();
+			push(OBJ_VAL(new objClosure(AS_FUNCTION(FRAME_CONSTANT(funcIndex)))));
+			LOAD_FRAME();
+			int upvalCount = AS_CLOSURE(peek(0))->upvals.size();
+			for (int i = 0; i < upvalCount; i++) {
 				uint8_t isLocal = READ_BYTE();
 				uint8_t index = READ_BYTE();
+				objUpval* upval;
 				if (isLocal) {
-					closure->upvals[i] = captureUpvalue(frame->slots + index);
+					STORE_FRAME();
+					upval = captureUpvalue(frame->slots + index);
+					LOAD_FRAME();
 				}
-				else {
-					closure->upvals[i] = frame->closure->upvals[index];
-				}
-				//this serves to satisfy the GC, since we can't have any cached pointers when we collect
-				closure = AS_CLOSURE(peek(0));
+				else upval = frame->closure->upvals[index];
+				//the closure is read from the stack after capturing, since capturing can cause a collection
+				AS_CLOSURE(peek(0))->upvals[i] = upval;
+				WRITE_BARRIER(AS_CLOSURE(peek(0)), upval);
 			}
-			break;
-		}
-		case OP_CLOSURE_LONG: {
-			//doing this to avoid cached pointers
-			objClosure* closure = new objClosure(AS_FUNCTION(READ_CONSTANT_LONG()));
-			push(OBJ_VAL(closure));
-			for (int i = 0; i < closure->upvals.size(); i++) {
+			DISPATCH();
+		}
+		CASE(OP_CLOSURE_LONG): {
+			uint16_t funcIndex = READ_SHORT();
+			STORE_FRAME();
+			push(OBJ_VAL(new objClosure(AS_FUNCTION(FRAME_CONSTANT(funcIndex)))));
+			LOAD_FRAME();
+			int upvalCount = AS_CLOSURE(peek(0))->upvals.size();
+			for (int i = 0; i < upvalCount; i++) {
 				uint8_t isLocal = READ_BYTE();
 				uint8_t index = READ_BYTE();
+				objUpval* upval;
 				if (isLocal) {
-					closure->upvals[i] = captureUpvalue(frame->slots + index);
+					STORE_FRAME();
+					upval = captureUpvalue(frame->slots + index);
+					LOAD_FRAME();
 				}
-				else {
-					closure->upvals[i] = frame->closure->upvals[index];
-				}
-				//this serves to satisfy the GC, since we can't have any cached pointers when we collect
-				closure = AS_CLOSURE(peek(0));
+				else upval = frame->closure->upvals[index];
+				//the closure is read from the stack after capturing, since capturing can cause a collection
+				AS_CLOSURE(peek(0))->upvals[i] = upval;
+				WRITE_BARRIER(AS_CLOSURE(peek(0)), upval);
 			}
-			break;
+			DISPATCH();
 		}
 		#pragma endregion
 
 		#pragma region Objects, arrays and maps
-		case OP_CREATE_ARRAY: {
+		CASE(OP_CREATE_ARRAY): {
 			uInt64 size = READ_BYTE();
 			uInt64 i = 0;
+			STORE_FRAME();
 			objArray* arr = new objArray(size);
+			LOAD_FRAME();
 			while (i < size) {
 				//size-i to because the values on the stack are in reverse order compared to how they're supposed to be in a array
 				Value val = pop();
@@ -844,17 +1650,18 @@ interpretResult objFiber::execute() {
 				i++;
 			}
 			push(OBJ_VAL(arr));
-			break;
+			DISPATCH();
 		}
 
-		case OP_GET: {
+		CASE(OP_GET): {
 			//structs and objects also get their own OP_GET_PROPERTY operator for access using '.'
 			//use peek because in case this is a get call to a instance that has a defined "access" method
 			//we want to use these 2 values as args and receiver
 			Value field = peek(0);
 			Value callee = peek(1);
+			if (IS_ARRAY(callee) && IS_NUMBER(field)) QUICKEN(OP_GET_ARRAY_NUM);
 			if (!IS_ARRAY(callee) && !IS_INSTANCE(callee))
-				return runtimeError("Expected a array or struct, got %s.", valueTypeToStr(callee).c_str());
+				RUNTIME_ERR("Expected a array or struct, got %s.", valueTypeToStr(callee).c_str());
 
 			switch (AS_OBJ(callee)->type) {
 			case OBJ_ARRAY: {
@@ -862,331 +1669,483 @@ interpretResult objFiber::execute() {
 				//but in order to maintain stack balance we need to get rid of these 2 vars if this is not a get call to a access method
 				pop();
 				pop();
-				if (!IS_NUMBER(field)) return runtimeError("Index must be a number, got %s.", valueTypeToStr(field).c_str());
-				double index = AS_NUMBER(field);
 				objArray* arr = AS_ARRAY(callee);
+				if (IS_INT(field)) {
+					int32_t index = AS_INT(field);
+					if (index < 0 || (uInt)index >= arr->values.count())
+						RUNTIME_ERR("Index %d outside of range [0, %d].", index, arr->values.count() - 1);
+					push(arr->values.data()[index]);
+					break;
+				}
+				if (!IS_NUMBER(field)) RUNTIME_ERR("Index must be a number, got %s.", valueTypeToStr(field).c_str());
+				double index = AS_NUMBER(field);
 				//Trying to access a variable using a float is a error
-				if ((uInt64)index != index) return runtimeError("Expected interger, got float.");
+				if ((uInt64)index != index) RUNTIME_ERR("Expected interger, got float.");
 				if (index < 0 || index > arr->values.count() - 1)
-					return runtimeError("Index %d outside of range [0, %d].", (uInt64)index, AS_ARRAY(callee)->values.count() - 1);
+					RUNTIME_ERR("Index %d outside of range [0, %d].", (uInt64)index, AS_ARRAY(callee)->values.count() - 1);
 
 				push(arr->values[(uInt64)index]);
 				break;
 			}
 			case OBJ_INSTANCE: {
+				objInstance* instance = AS_INSTANCE(callee);
 				//check if this instance has a access method, and if it does it transfer control over to the user defined method
 				//the 'field' value becomes the argument for the method 
-				objString* temp = copyString("access", 6);
-				if (!invoke(temp, 1)) {
-					return RUNTIME_ERROR;
-				}
-				else {
-					frame = &frames[frameCount - 1];
+				if (instance->klass != nullptr && instance->klass->metamethods[METAMETHOD_ACCESS] != nullptr) {
+					STORE_FRAME();
+					if (!call(instance->klass->metamethods[METAMETHOD_ACCESS], 1)) return RUNTIME_ERROR;
+					LOAD_FRAME();
 					break;
 				}
+				if (!IS_STRING(field)) RUNTIME_ERR("Expected a string for field name, got %s.", valueTypeToStr(field).c_str());
 				//pop if this instance doesn't contain a access method to maintain stack balance
 				pop();
 				pop();
-				if (!IS_STRING(field)) return runtimeError("Expected a string for field name, got %s.", valueTypeToStr(field).c_str());
-
-				objInstance* instance = AS_INSTANCE(callee);
 				objString* name = AS_STRING(field);
 				Value value;
 
-				if (instance->table.get(name, &value)) {
+				if (instance->getField(name, &value)) {
 					push(value);
 					break;
 				}
 
-				if (instance->klass && bindMethod(instance->klass, name)) break;
+				if (instance->klass != nullptr && instance->klass->methods.get(name, &value)) {
+					//bindMethod expects the receiver on top of the stack
+					push(callee);
+					STORE_FRAME();
+					bindMethod(AS_CLOSURE(value));
+					LOAD_FRAME();
+					break;
+				}
 				//if the field doesn't exist, we push nil as a sentinel value, since this is not considered a runtime error
 				push(NIL_VAL());
 				break;
 			}
 			}
-			break;
+			DISPATCH();
 		}
 
-		case OP_SET: {
+		CASE(OP_SET): {
 			//structs and objects also get their own OP_SET_PROPERTY operator for setting using '.'
 			Value val = peek(0);
 			Value field = peek(1);
 			Value callee = peek(2);
 			//if we encounter a user defined set expr, we will want to exit early and not pop all of the above values as they will be used as args
 			bool earlyExit = false;
+			if (IS_ARRAY(callee) && IS_NUMBER(field)) QUICKEN(OP_SET_ARRAY_NUM);
 
 			if (!IS_ARRAY(callee) && !IS_INSTANCE(callee))
-				return runtimeError("Expected a array or struct, got %s.", valueTypeToStr(callee).c_str());
+				RUNTIME_ERR("Expected a array or struct, got %s.", valueTypeToStr(callee).c_str());
 
 			switch (AS_OBJ(callee)->type) {
 			case OBJ_ARRAY: {
 				objArray* arr = AS_ARRAY(callee);
-
-				if (!IS_NUMBER(field)) return runtimeError("Index has to be a number, got %s.", valueTypeToStr(field).c_str());
-				double index = AS_NUMBER(field);
-				//accessing array with a float is a error
-				if (index != (uInt64)index) return runtimeError("Index has to be a integer.");
-				if (index < 0 || index > arr->values.count() - 1)
-					return runtimeError("Index %d outside of range [0, %d].", (uInt64)index, arr->values.count() - 1);
+				uInt64 index;
+				if (IS_INT(field)) {
+					if (AS_INT(field) < 0 || (uInt)AS_INT(field) >= arr->values.count())
+						RUNTIME_ERR("Index %d outside of range [0, %d].", AS_INT(field), arr->values.count() - 1);
+					index = AS_INT(field);
+				}
+				else {
+					if (!IS_NUMBER(field)) RUNTIME_ERR("Index has to be a number, got %s.", valueTypeToStr(field).c_str());
+					double num = AS_NUMBER(field);
+					//accessing array with a float is a error
+					if (num != (uInt64)num) RUNTIME_ERR("Index has to be a integer.");
+					if (num < 0 || num > arr->values.count() - 1)
+						RUNTIME_ERR("Index %d outside of range [0, %d].", (uInt64)num, arr->values.count() - 1);
+					index = num;
+				}
 
 				//if numOfHeapPtr is 0 we don't trace or update the array when garbage collecting
 				if (IS_OBJ(val)) arr->numOfHeapPtr++;
 				else if (IS_OBJ(arr->values[index])) arr->numOfHeapPtr--;
-				arr->values[(uInt64)index] = val;
+				arr->values[index] = val;
+				ARRAY_WRITE_BARRIER(arr, index, index + 1, val);
 				break;
 			}
 			case OBJ_INSTANCE: {
+				objInstance* instance = AS_INSTANCE(callee);
 				//check if this instance has a defined set method, if it does, transfer control to it and set the field and value as args to the method
-				objString* temp = copyString("set", 3);
-				if (!invoke(temp, 2)) {
-					return RUNTIME_ERROR;
-				}
-				else {
-					frame = &frames[frameCount - 1];
+				if (instance->klass != nullptr && instance->klass->metamethods[METAMETHOD_SET] != nullptr) {
+					STORE_FRAME();
+					if (!call(instance->klass->metamethods[METAMETHOD_SET], 2)) return RUNTIME_ERROR;
+					LOAD_FRAME();
 					earlyExit = true;
 					break;
 				}
 				//if the instance doesn't have a defined set method, proceed as normal
-				if (!IS_STRING(field)) return runtimeError("Expected a string for field name, got %s.", valueTypeToStr(field).c_str());
+				if (!IS_STRING(field)) RUNTIME_ERR("Expected a string for field name, got %s.", valueTypeToStr(field).c_str());
 
-				objInstance* instance = AS_INSTANCE(callee);
 				objString* str = AS_STRING(field);
 				//settting will always succeed, and we don't care if we're overriding an existing field, or creating a new one
-				instance->table.set(str, val);
+				STORE_FRAME();
+				setField(instance, str, val);
+				LOAD_FRAME();
 				break;
 			}
 			}
-			if (earlyExit) break;
+			if (earlyExit) DISPATCH();
 			//we want only the value to remain on the stack, since set is a assignment expr
-			pop();
+			//the value is read from the stack again since setField might have moved it
+			val = pop();
 			pop();
 			pop();
 			push(val);
-			break;
+			DISPATCH();
 		}
 
-		case OP_CLASS: {
-			push(OBJ_VAL(new objClass(READ_STRING_LONG())));
-			break;
+		CASE(OP_CLASS): {
+			uint16_t index = READ_SHORT();
+			STORE_FRAME();
+			push(OBJ_VAL(new objClass(AS_STRING(FRAME_CONSTANT(index)))));
+			LOAD_FRAME();
+			DISPATCH();
 		}
 
-		case OP_GET_PROPERTY: {
+		CASE(OP_GET_PROPERTY): {
 			if (!IS_INSTANCE(peek(0))) {
-				return runtimeError("Only instances/structs have properties, got %s.", valueTypeToStr(peek(0)).c_str());
+				RUNTIME_ERR("Only instances/structs have properties, got %s.", valueTypeToStr(peek(0)).c_str());
 			}
 
 			objInstance* instance = AS_INSTANCE(peek(0));
 			objString* name = READ_STRING();
-
-			Value value;
-			if (instance->table.get(name, &value)) {
-				pop(); // Instance.
-				push(value);
-				break;
+			inlineCache* cache = READ_CACHE();
+			cacheEntry* entry = cache->find(instance->shape);
+			if (entry != nullptr && entry->method == nullptr) {
+				cache->hits++;
+				stackTop[-1] = *instance->slot(entry->slot);
+				DISPATCH();
 			}
-			//first check is because structs(instances with no class) are also represented using objInstance
-			if (instance->klass && bindMethod(instance->klass, name)) break;
-			//if 'name' isn't a field property, nor is it a method, we push nil as a sentinel value
-			push(NIL_VAL());
-			break;
+			STORE_FRAME();
+			if (!getProperty(name, cache)) return RUNTIME_ERROR;
+			LOAD_FRAME();
+			DISPATCH();
 		}
-		case OP_GET_PROPERTY_LONG: {
+		CASE(OP_GET_PROPERTY_LONG): {
 			if (!IS_INSTANCE(peek(0))) {
-				return runtimeError("Only instances/structs have properties, got %s.", valueTypeToStr(peek(0)).c_str());
+				RUNTIME_ERR("Only instances/structs have properties, got %s.", valueTypeToStr(peek(0)).c_str());
 			}
 
 			objInstance* instance = AS_INSTANCE(peek(0));
 			objString* name = READ_STRING_LONG();
-
-			Value value;
-			if (instance->table.get(name, &value)) {
-				pop(); // Instance.
-				push(value);
-				break;
+			inlineCache* cache = READ_CACHE();
+			cacheEntry* entry = cache->find(instance->shape);
+			if (entry != nullptr && entry->method == nullptr) {
+				cache->hits++;
+				stackTop[-1] = *instance->slot(entry->slot);
+				DISPATCH();
 			}
-			//first check is because structs(instances with no class) are also represented using objInstance
-			if (instance->klass && bindMethod(instance->klass, name)) break;
-			//if 'name' isn't a field property, nor is it a method, we push nil as a sentinel value
-			push(NIL_VAL());
-			break;
+			STORE_FRAME();
+			if (!getProperty(name, cache)) return RUNTIME_ERROR;
+			LOAD_FRAME();
+			DISPATCH();
 		}
 
-		case OP_SET_PROPERTY: {
+		CASE(OP_SET_PROPERTY): {
 			if (!IS_INSTANCE(peek(1))) {
-				return runtimeError("Only instances/structs have properties, got %s.", valueTypeToStr(peek(1)).c_str());
+				RUNTIME_ERR("Only instances/structs have properties, got %s.", valueTypeToStr(peek(1)).c_str());
 			}
 
 			objInstance* instance = AS_INSTANCE(peek(1));
-			//we don't care if we're overriding or creating a new field
-			instance->table.set(READ_STRING(), peek(0));
+			objString* name = READ_STRING();
+			inlineCache* cache = READ_CACHE();
+			cacheEntry* entry = cache->find(instance->shape);
+			//stores that add a field can only use the cache if the new slot is inline, pushing to overflow can allocate
+			if (entry != nullptr && (entry->next == nullptr || entry->slot < instance->inlineCapacity)) {
+				cache->hits++;
+				*instance->slot(entry->slot) = peek(0);
+				WRITE_BARRIER(instance, peek(0));
+				if (entry->next != nullptr) {
+					instance->shape = entry->next;
+					WRITE_BARRIER(instance, entry->next);
+				}
+			}
+			else {
+				STORE_FRAME();
+				setProperty(name, cache);
+				LOAD_FRAME();
+			}
 
 			Value value = pop();
 			pop();
 			push(value);
-			break;
+			DISPATCH();
 		}
-		case OP_SET_PROPERTY_LONG: {
+		CASE(OP_SET_PROPERTY_LONG): {
 			if (!IS_INSTANCE(peek(1))) {
-				return runtimeError("Only instances/structs have properties, got %s.", valueTypeToStr(peek(1)).c_str());
+				RUNTIME_ERR("Only instances/structs have properties, got %s.", valueTypeToStr(peek(1)).c_str());
 			}
 
 			objInstance* instance = AS_INSTANCE(peek(1));
-			//we don't care if we're overriding or creating a new field
-			instance->table.set(READ_STRING_LONG(), peek(0));
+			objString* name = READ_STRING_LONG();
+			inlineCache* cache = READ_CACHE();
+			cacheEntry* entry = cache->find(instance->shape);
+			//stores that add a field can only use the cache if the new slot is inline, pushing to overflow can allocate
+			if (entry != nullptr && (entry->next == nullptr || entry->slot < instance->inlineCapacity)) {
+				cache->hits++;
+				*instance->slot(entry->slot) = peek(0);
+				WRITE_BARRIER(instance, peek(0));
+				if (entry->next != nullptr) {
+					instance->shape = entry->next;
+					WRITE_BARRIER(instance, entry->next);
+				}
+			}
+			else {
+				STORE_FRAME();
+				setProperty(name, cache);
+				LOAD_FRAME();
+			}
 
 			Value value = pop();
 			pop();
 			push(value);
-			break;
+			DISPATCH();
 		}
 
-		case OP_CREATE_STRUCT: {
+		CASE(OP_CREATE_STRUCT): {
 			int numOfFields = READ_BYTE();
+			//ip can't be kept across allocations, so we remember where the field names start as a offset
+			uInt64 fieldNames = ip - code;
 
+			//struct literals with the same fields share a shape, so the transitions are walked before allocating the instance
+			objShape* shape = VM->structShape;
+			for (int i = 0; i < numOfFields && shape != nullptr; i++) {
+				objString* name = READ_STRING();
+				STORE_FRAME();
+				shape = shapeTransition(shape, name);
+				LOAD_FRAME();
+			}
 			//passing null instead of class signals to the VM that this is a struct, and not a instance of a class
-			objInstance* inst = new objInstance(nullptr);
+			STORE_FRAME();
+			objInstance* inst;
+			if (shape != nullptr) {
+				uInt inlineSlots = shape->fieldCount;
+				global::gc.cachePtr(shape);
+				inst = new(inlineSlots) objInstance(nullptr, dynamic_cast<objShape*>(global::gc.getCachedPtr()), inlineSlots);
+			}
+			else inst = new(0) objInstance(nullptr, nullptr, 0);
+			LOAD_FRAME();
+			ip = code + fieldNames;
 
 			//the compiler emits the fields in reverse order, so we can loop through them normally and pop the values on the stack
-			for (int i = 0; i < numOfFields; i++) {
-				objString* name = READ_STRING();
-				inst->table.set(name, pop());
+			if (inst->shape != nullptr) {
+				for (int i = 0; i < numOfFields; i++) {
+					uInt slot;
+					inst->shape->lookup(READ_STRING(), &slot);
+					*inst->slot(slot) = pop();
+				}
+			}
+			else {
+				//too many fields for a shape, the struct starts out in dictionary mode
+				for (int i = 0; i < numOfFields; i++) {
+					objString* name = READ_STRING();
+					STORE_FRAME();
+					global::gc.cachePtr(inst);
+					inst->table.set(name, peek(0));
+					inst = dynamic_cast<objInstance*>(global::gc.getCachedPtr());
+					LOAD_FRAME();
+					pop();
+				}
 			}
 			push(OBJ_VAL(inst));
-			break;
+			DISPATCH();
 		}
-		case OP_CREATE_STRUCT_LONG: {
+		CASE(OP_CREATE_STRUCT_LONG): {
 			int numOfFields = READ_BYTE();
+			//ip can't be kept across allocations, so we remember where the field names start as a offset
+			uInt64 fieldNames = ip - code;
 
+			//struct literals with the same fields share a shape, so the transitions are walked before allocating the instance
+			objShape* shape = VM->structShape;
+			for (int i = 0; i < numOfFields && shape != nullptr; i++) {
+				objString* name = READ_STRING_LONG();
+				STORE_FRAME();
+				shape = shapeTransition(shape, name);
+				LOAD_FRAME();
+			}
 			//passing null instead of class signals to the VM that this is a struct, and not a instance of a class
-			objInstance* inst = new objInstance(nullptr);
+			STORE_FRAME();
+			objInstance* inst;
+			if (shape != nullptr) {
+				uInt inlineSlots = shape->fieldCount;
+				global::gc.cachePtr(shape);
+				inst = new(inlineSlots) objInstance(nullptr, dynamic_cast<objShape*>(global::gc.getCachedPtr()), inlineSlots);
+			}
+			else inst = new(0) objInstance(nullptr, nullptr, 0);
+			LOAD_FRAME();
+			ip = code + fieldNames;
 
 			//the compiler emits the fields in reverse order, so we can loop through them normally and pop the values on the stack
-			for (int i = 0; i < numOfFields; i++) {
-				objString* name = READ_STRING_LONG();
-				inst->table.set(name, pop());
+			if (inst->shape != nullptr) {
+				for (int i = 0; i < numOfFields; i++) {
+					uInt slot;
+					inst->shape->lookup(READ_STRING_LONG(), &slot);
+					*inst->slot(slot) = pop();
+				}
+			}
+			else {
+				//too many fields for a shape, the struct starts out in dictionary mode
+				for (int i = 0; i < numOfFields; i++) {
+					objString* name = READ_STRING_LONG();
+					STORE_FRAME();
+					global::gc.cachePtr(inst);
+					inst->table.set(name, peek(0));
+					inst = dynamic_cast<objInstance*>(global::gc.getCachedPtr());
+					LOAD_FRAME();
+					pop();
+				}
 			}
 			push(OBJ_VAL(inst));
-			break;
+			DISPATCH();
 		}
 
-		case OP_METHOD: {
+		CASE(OP_METHOD): {
 			//class that this method binds too
-			defineMethod(READ_STRING_LONG());
-			break;
+			objString* name = READ_STRING_LONG();
+			STORE_FRAME();
+			defineMethod(name);
+			LOAD_FRAME();
+			DISPATCH();
 		}
 
-		case OP_INVOKE: {
+		CASE(OP_INVOKE): {
 			//gets the method and calls it immediatelly, without converting it to a objBoundMethod
 			objString* method = READ_STRING();
 			int argCount = READ_BYTE();
-			if (!invoke(method, argCount)) {
+			inlineCache* cache = READ_CACHE();
+			STORE_FRAME();
+			if (!invoke(method, argCount, cache)) {
 				return RUNTIME_ERROR;
 			}
-			frame = &frames[frameCount - 1];
-			break;
+			LOAD_FRAME();
+			JIT_ENTER(true);
+			DISPATCH();
 		}
-		case OP_INVOKE_LONG: {
+		CASE(OP_INVOKE_LONG): {
 			//gets the method and calls it immediatelly, without converting it to a objBoundMethod
 			objString* method = READ_STRING_LONG();
 			int argCount = READ_BYTE();
-			if (!invoke(method, argCount)) {
+			inlineCache* cache = READ_CACHE();
+			STORE_FRAME();
+			if (!invoke(method, argCount, cache)) {
 				return RUNTIME_ERROR;
 			}
-			frame = &frames[frameCount - 1];
-			break;
+			LOAD_FRAME();
+			JIT_ENTER(true);
+			DISPATCH();
 		}
 
-		case OP_INHERIT: {
+		CASE(OP_INHERIT): {
 			Value superclass = peek(1);
 			if (!IS_CLASS(superclass)) {
-				return runtimeError("Superclass must be a class, got %s.", valueTypeToStr(superclass).c_str());
+				RUNTIME_ERR("Superclass must be a class, got %s.", valueTypeToStr(superclass).c_str());
 			}
 			objClass* subclass = AS_CLASS(peek(0));
-			//copy down inheritance
-			subclass->methods.tableAddAll(&subclass->methods);
-			break;
+			//copy down inheritance, methods defined by the subclass come after this and override the inherited ones
+			STORE_FRAME();
+			subclass->methods.tableAddAll(&AS_CLASS(superclass)->methods);
+			LOAD_FRAME();
+			for (int i = 0; i < METAMETHOD_COUNT; i++) subclass->metamethods[i] = AS_CLASS(superclass)->metamethods[i];
+			#ifdef GENERATIONAL_GC
+			//the inherited methods(and their names) can be younger than the subclass
+			for (int i = 0; i < subclass->methods.capacity; i++) {
+				WRITE_BARRIER(subclass, subclass->methods.entries[i].key);
+				WRITE_BARRIER(subclass, subclass->methods.entries[i].val);
+			}
+			#endif
+			DISPATCH();
 		}
 
-		case OP_GET_SUPER: {
+		CASE(OP_GET_SUPER): {
 			//super is ALWAYS followed by a field and is a call expr
 			objString* name = READ_STRING();
 			objClass* superclass = AS_CLASS(pop());
 
+			STORE_FRAME();
 			if (!bindMethod(superclass, name)) {
 				return RUNTIME_ERROR;
 			}
-			break;
+			LOAD_FRAME();
+			DISPATCH();
 		}
-		case OP_GET_SUPER_LONG: {
+		CASE(OP_GET_SUPER_LONG): {
 			//super is ALWAYS followed by a field and is a call expr
 			objString* name = READ_STRING_LONG();
 			objClass* superclass = AS_CLASS(pop());
 
+			STORE_FRAME();
 			if (!bindMethod(superclass, name)) {
 				return RUNTIME_ERROR;
 			}
-			break;
+			LOAD_FRAME();
+			DISPATCH();
 		}
 
-		case OP_SUPER_INVOKE: {
+		CASE(OP_SUPER_INVOKE): {
 			//works same as OP_INVOKE, but uses invokeFromClass() to specify the superclass
 			objString* method = READ_STRING();
 			int argCount = READ_BYTE();
 			objClass* superclass = AS_CLASS(pop());
 
+			STORE_FRAME();
 			if (!invokeFromClass(superclass, method, argCount)) {
 				return RUNTIME_ERROR;
 			}
-			frame = &frames[frameCount - 1];
-			break;
+			LOAD_FRAME();
+			DISPATCH();
 		}
-		case OP_SUPER_INVOKE_LONG: {
+		CASE(OP_SUPER_INVOKE_LONG): {
 			//works same as OP_INVOKE, but uses invokeFromClass() to specify the superclass
 			objString* method = READ_STRING_LONG();
 			int argCount = READ_BYTE();
 			objClass* superclass = AS_CLASS(pop());
 
+			STORE_FRAME();
 			if (!invokeFromClass(superclass, method, argCount)) {
 				return RUNTIME_ERROR;
 			}
-			frame = &frames[frameCount - 1];
-			break;
+			LOAD_FRAME();
+			DISPATCH();
 		}
 		#pragma endregion
 
 		#pragma region Fibers
-		case OP_FIBER_CREATE: {
-			global::gc.cachePtr(new objClosure(AS_FUNCTION(READ_CONSTANT_LONG())));
-			objFiber* newFiber = new objFiber(dynamic_cast<objClosure*>(global::gc.getCachedPtr()), VM, READ_BYTE());
+		CASE(OP_FIBER_CREATE): {
+			uint16_t index = READ_SHORT();
+			uint8_t startValuesNum = READ_BYTE();
+			STORE_FRAME();
+			global::gc.cachePtr(new objClosure(AS_FUNCTION(FRAME_CONSTANT(index))));
+			objFiber* newFiber = new objFiber(dynamic_cast<objClosure*>(global::gc.getCachedPtr()), VM, startValuesNum);
 			push(OBJ_VAL(newFiber));
-			break;
+			LOAD_FRAME();
+			DISPATCH();
 		}
 
-		case OP_FIBER_RUN: {
+		CASE(OP_FIBER_RUN): {
 			uInt argNum = READ_BYTE();
 			Value val = pop();
 			if (!IS_FIBER(val)) {
-				return runtimeError("Expected a fiber, got %s.", valueTypeToStr(val).c_str());
+				RUNTIME_ERR("Expected a fiber, got %s.", valueTypeToStr(val).c_str());
 			}
 			objFiber* fiber = AS_FIBER(val);
 
 			//if we are switching to this fiber while it's already on "stack"(meaning this has been called inside it's execute method),
 			//we treat it as a error, since recursive calls to the same fiber is prohibited
 			if (fiber->prevFiber != nullptr) {
-				return runtimeError("Fiber already in use.");
+				RUNTIME_ERR("Fiber already in use.");
 			}
 			if (fiber->isFinished()) {
 				//pops the args
-				for (int i = 0; i < argNum ; i++) pop();
+				stackTop -= argNum;
 				push(NIL_VAL());
-				break;
+				DISPATCH();
 			}
 			//transfers the values to the fiber we're starting/resuming, if no values are specified it transfers nil
 			if (!fiber->hasStarted() && argNum != fiber->startValuesNum) {
-				return runtimeError("Incorrect number of starting values for a fiber, expected %d, got %d.", fiber->startValuesNum, argNum);
+				RUNTIME_ERR("Incorrect number of starting values for a fiber, expected %d, got %d.", fiber->startValuesNum, argNum);
 			}
 			else if (fiber->hasStarted() && argNum != 1) {
-				return runtimeError("Can only pass 1 value when resuming a fiber, passed %d.", argNum);
+				RUNTIME_ERR("Can only pass 1 value when resuming a fiber, passed %d.", argNum);
 			}
 			//pops and transfers the args to the other fiber
 			for (int i = 0; i < argNum; i++) {
@@ -1194,43 +2153,271 @@ interpretResult objFiber::execute() {
 			}
 			//who to yield to
 			fiber->prevFiber = this;
+			STORE_FRAME();
 			VM->switchToFiber(fiber);
-			break;
+			return interpretResult::INTERPRETER_PAUSED;
 		}
 
-		case OP_FIBER_YIELD: {
+		CASE(OP_FIBER_YIELD): {
 			Value val = pop();
 			if (prevFiber == nullptr) {
-				return runtimeError("Trying to yield to a nonexisting fiber.");
+				RUNTIME_ERR("Trying to yield to a nonexisting fiber.");
 			}
 			//works like return, if we have "yield;" then we yield nil
 			prevFiber->transferValue(val);
+			STORE_FRAME();
 			VM->switchToFiber(prevFiber);
 			prevFiber = nullptr;
-			break;
+			return interpretResult::INTERPRETER_PAUSED;
 		}
 		#pragma endregion
 
 		#pragma region Modules
-		case OP_START_MODULE: {
+		CASE(OP_START_MODULE): {
 			//dictates which module will OP_DEFINE_GLOBAL look for
 			VM->curModule = AS_MODULE(pop());
-			break;
+			DISPATCH();
+		}
+		#pragma endregion
+
+		#pragma region Quickened
+		CASE(OP_ADD_INT_INT): INT_INT_OP(OP_ADD, INT_OR_NUMBER_VAL, +); DISPATCH();
+		CASE(OP_ADD_NUM_NUM): NUM_NUM_OP(OP_ADD, INT_OR_NUMBER_VAL, NUMBER_VAL, +); DISPATCH();
+		CASE(OP_SUBTRACT_INT_INT): INT_INT_OP(OP_SUBTRACT, INT_OR_NUMBER_VAL, -); DISPATCH();
+		CASE(OP_SUBTRACT_NUM_NUM): NUM_NUM_OP(OP_SUBTRACT, INT_OR_NUMBER_VAL, NUMBER_VAL, -); DISPATCH();
+		CASE(OP_LESS_INT_INT): INT_INT_OP(OP_LESS, BOOL_VAL, < ); DISPATCH();
+		CASE(OP_LESS_NUM_NUM): NUM_NUM_OP(OP_LESS, BOOL_VAL, BOOL_VAL, < ); DISPATCH();
+
+		CASE(OP_GET_ARRAY_NUM): {
+			if (!IS_ARRAY(peek(1)) || !IS_NUMBER(peek(0))) DEQUICKEN(OP_GET);
+			Value field = pop();
+			objArray* arr = AS_ARRAY(pop());
+			if (IS_INT(field)) {
+				int32_t index = AS_INT(field);
+				if (index < 0 || (uInt)index >= arr->values.count())
+					RUNTIME_ERR("Index %d outside of range [0, %d].", index, arr->values.count() - 1);
+				push(arr->values.data()[index]);
+				DISPATCH();
+			}
+			double index = AS_NUMBER(field);
+			if ((uInt64)index != index) RUNTIME_ERR("Expected interger, got float.");
+			if (index < 0 || index > arr->values.count() - 1)
+				RUNTIME_ERR("Index %d outside of range [0, %d].", (uInt64)index, arr->values.count() - 1);
+			push(arr->values[(uInt64)index]);
+			DISPATCH();
+		}
+		CASE(OP_SET_ARRAY_NUM): {
+			if (!IS_ARRAY(peek(2)) || !IS_NUMBER(peek(1))) DEQUICKEN(OP_SET);
+			Value val = pop();
+			Value field = pop();
+			objArray* arr = AS_ARRAY(pop());
+			uInt64 index;
+			if (IS_INT(field)) {
+				if (AS_INT(field) < 0 || (uInt)AS_INT(field) >= arr->values.count())
+					RUNTIME_ERR("Index %d outside of range [0, %d].", AS_INT(field), arr->values.count() - 1);
+				index = AS_INT(field);
+			}
+			else {
+				double num = AS_NUMBER(field);
+				if (num != (uInt64)num) RUNTIME_ERR("Index has to be a integer.");
+				if (num < 0 || num > arr->values.count() - 1)
+					RUNTIME_ERR("Index %d outside of range [0, %d].", (uInt64)num, arr->values.count() - 1);
+				index = num;
+			}
+			Value& slot = arr->values.data()[index];
+			//if numOfHeapPtr is 0 we don't trace or update the array when garbage collecting
+			if (IS_OBJ(val)) arr->numOfHeapPtr++;
+			else if (IS_OBJ(slot)) arr->numOfHeapPtr--;
+			slot = val;
+			ARRAY_WRITE_BARRIER(arr, index, index + 1, val);
+			push(val);
+			DISPATCH();
+		}
+		CASE(OP_CALL_CLOSURE): {
+			if (!IS_CLOSURE(peek(*ip))) DEQUICKEN(OP_CALL);
+			int argCount = READ_BYTE();
+			STORE_FRAME();
+			if (!call(AS_CLOSURE(peek(argCount)), argCount)) {
+				return RUNTIME_ERROR;
+			}
+			LOAD_FRAME();
+			JIT_ENTER(true);
+			DISPATCH();
 		}
 		#pragma endregion
 
+		#pragma region Typed
+		CASE(OP_ADD_NUM): NUM_OP(INT_OR_NUMBER_VAL, NUMBER_VAL, +); DISPATCH();
+		CASE(OP_ADD_STRING):
+			STORE_FRAME();
+			concatenate();
+			LOAD_FRAME();
+			DISPATCH();
+		CASE(OP_SUBTRACT_NUM): NUM_OP(INT_OR_NUMBER_VAL, NUMBER_VAL, -); DISPATCH();
+		CASE(OP_MULTIPLY_NUM): NUM_OP(INT_OR_NUMBER_VAL, NUMBER_VAL, *); DISPATCH();
+		CASE(OP_DIVIDE_NUM): {
+			double b = AS_NUMBER(pop());
+			double a = AS_NUMBER(pop());
+			push(NUMBER_VAL(a / b));
+			DISPATCH();
+		}
+		CASE(OP_ADD_1_NUM):
+			if (IS_INT(peek(0))) push(INT_OR_NUMBER_VAL((int64_t)AS_INT(pop()) + 1));
+			else push(NUMBER_VAL(AS_NUMBER(pop()) + 1));
+			DISPATCH();
+		CASE(OP_SUBTRACT_1_NUM):
+			if (IS_INT(peek(0))) push(INT_OR_NUMBER_VAL((int64_t)AS_INT(pop()) - 1));
+			else push(NUMBER_VAL(AS_NUMBER(pop()) - 1));
+			DISPATCH();
+		CASE(OP_GREATER_NUM): NUM_OP(BOOL_VAL, BOOL_VAL, > ); DISPATCH();
+		CASE(OP_GREATER_EQUAL_NUM): NUM_OR_EQUAL_OP(> ); DISPATCH();
+		CASE(OP_LESS_NUM): NUM_OP(BOOL_VAL, BOOL_VAL, < ); DISPATCH();
+		CASE(OP_LESS_EQUAL_NUM): NUM_OR_EQUAL_OP(< ); DISPATCH();
+		#pragma endregion
+
+		#pragma region Register
+		CASE(OP_REG_MOVE): {
+			uint8_t dst = READ_BYTE();
+			REG_STORE(dst, frame->slots[READ_BYTE()]);
+			DISPATCH();
+		}
+		CASE(OP_REG_LOAD): {
+			uint8_t dst = READ_BYTE();
+			REG_STORE(dst, READ_CONSTANT());
+			DISPATCH();
+		}
+		CASE(OP_REG_ADD): REG_ADD_OP(false); DISPATCH();
+		CASE(OP_REG_SUBTRACT): REG_BINARY_OP(false, -); DISPATCH();
+		CASE(OP_REG_MULTIPLY): REG_BINARY_OP(false, *); DISPATCH();
+		CASE(OP_REG_DIVIDE): REG_DIVIDE_OP(false); DISPATCH();
+		CASE(OP_REG_MOD): REG_MOD_OP(false); DISPATCH();
+		CASE(OP_REG_EQUAL): REG_EQUALITY_OP(false, false); DISPATCH();
+		CASE(OP_REG_NOT_EQUAL): REG_EQUALITY_OP(false, true); DISPATCH();
+		CASE(OP_REG_GREATER): REG_COMPARISON_OP(false, >); DISPATCH();
+		CASE(OP_REG_GREATER_EQUAL): REG_OR_EQUAL_OP(false, >); DISPATCH();
+		CASE(OP_REG_LESS): REG_COMPARISON_OP(false, <); DISPATCH();
+		CASE(OP_REG_LESS_EQUAL): REG_OR_EQUAL_OP(false, <); DISPATCH();
+		CASE(OP_REG_ADD_K): REG_ADD_OP(true); DISPATCH();
+		CASE(OP_REG_SUBTRACT_K): REG_BINARY_OP(true, -); DISPATCH();
+		CASE(OP_REG_MULTIPLY_K): REG_BINARY_OP(true, *); DISPATCH();
+		CASE(OP_REG_DIVIDE_K): REG_DIVIDE_OP(true); DISPATCH();
+		CASE(OP_REG_MOD_K): REG_MOD_OP(true); DISPATCH();
+		CASE(OP_REG_EQUAL_K): REG_EQUALITY_OP(true, false); DISPATCH();
+		CASE(OP_REG_NOT_EQUAL_K): REG_EQUALITY_OP(true, true); DISPATCH();
+		CASE(OP_REG_GREATER_K): REG_COMPARISON_OP(true, >); DISPATCH();
+		CASE(OP_REG_GREATER_EQUAL_K): REG_OR_EQUAL_OP(true, >); DISPATCH();
+		CASE(OP_REG_LESS_K): REG_COMPARISON_OP(true, <); DISPATCH();
+		CASE(OP_REG_LESS_EQUAL_K): REG_OR_EQUAL_OP(true, <); DISPATCH();
+		#pragma endregion
 
+		#pragma region Fused branches
+		CASE(OP_LESS_JUMP):
+			if (ARE_INTS(peek(0), peek(1))) FUSED_BRANCH((int32_t)AS_INT(peek(1)) < (int32_t)AS_INT(peek(0)));
+			else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) FUSED_BRANCH(AS_NUMBER(peek(1)) < AS_NUMBER(peek(0)));
+			else DEQUICKEN(OP_LESS);
+			DISPATCH();
+		CASE(OP_EQUAL_JUMP): {
+			Value b = peek(0);
+			Value a = peek(1);
+			FUSED_BRANCH(ARE_INTS(a, b) ? AS_INT(a) == AS_INT(b) : valuesEqual(a, b));
+			DISPATCH();
 		}
+		CASE(OP_FOR_INCR_LOOP): FOR_INCR_LOOP_OP(false); DISPATCH();
+		CASE(OP_FOR_INCR_LOOP_K): FOR_INCR_LOOP_OP(true); DISPATCH();
+		#pragma endregion
+
+		#pragma region Superinstructions
+		SUPERINSTRUCTION_LIST(SUPER_CASE)
+		#pragma endregion
 	}
 
 	#undef READ_BYTE
+	#undef READ_SHORT
 	#undef READ_CONSTANT
+	#undef READ_CONSTANT_LONG
+	#undef READ_STRING
+	#undef READ_STRING_LONG
+	#undef READ_CACHE
+	#undef FRAME_CONSTANT
+	#undef STORE_FRAME
+	#undef LOAD_FRAME
+	#undef RUNTIME_ERR
 	#undef BINARY_OP
+	#undef COMPARISON_OP
 	#undef INT_BINARY_OP
-	#undef READ_STRING
-	#undef READ_SHORT
-
-	//this is hit *only* when we pause the fiber, when a fiber finishes executing all it's code it hits the implicit return which handles that
-	return interpretResult::INTERPRETER_PAUSED;
+	#undef INT_INT_OP
+	#undef NUM_NUM_OP
+	#undef NUM_OP
+	#undef NUM_OR_EQUAL_OP
+	#undef REG_OPERANDS
+	#undef REG_STORE
+	#undef REG_ADD_OP
+	#undef REG_BINARY_OP
+	#undef REG_DIVIDE_OP
+	#undef REG_MOD_OP
+	#undef REG_EQUALITY_OP
+	#undef REG_COMPARISON_OP
+	#undef REG_OR_EQUAL_OP
+	#undef QUICKEN
+	#undef DEQUICKEN
+	#undef JIT_ENTER
+	#undef RECORD_INSTRUCTION
+	#undef TRACE_LOOP
+	#undef AOT_ENTER
+	#undef COUNT_INSTRUCTION
+	#undef TRACE_INSTRUCTION
+	#undef PROFILE_INSTRUCTION
+	#undef SUPER_FALLBACK
+	#undef SUPER_PUSH_OPERAND
+	#undef SUPER_ARITH_STEP
+	#undef SUPER_INCREMENT_STEP
+	#undef SUPER_COMPARISON_STEP
+	#undef SUPER_EQUALITY_STEP
+	#undef SUPER_JUMP_STEP
+	#undef SUPER_STEP_SUPER_NONE
+	#undef SUPER_STEP_OP_GET_LOCAL
+	#undef SUPER_STEP_OP_SET_LOCAL
+	#undef SUPER_STEP_OP_GET_UPVALUE
+	#undef SUPER_STEP_OP_SET_UPVALUE
+	#undef SUPER_STEP_OP_GET_GLOBAL
+	#undef SUPER_STEP_OP_SET_GLOBAL
+	#undef SUPER_STEP_OP_CONSTANT
+	#undef SUPER_STEP_OP_NIL
+	#undef SUPER_STEP_OP_TRUE
+	#undef SUPER_STEP_OP_FALSE
+	#undef SUPER_STEP_OP_POP
+	#undef SUPER_STEP_OP_POPN
+	#undef SUPER_STEP_OP_ADD
+	#undef SUPER_STEP_OP_SUBTRACT
+	#undef SUPER_STEP_OP_MULTIPLY
+	#undef SUPER_STEP_OP_DIVIDE
+	#undef SUPER_STEP_OP_MOD
+	#undef SUPER_STEP_OP_ADD_1
+	#undef SUPER_STEP_OP_SUBTRACT_1
+	#undef SUPER_STEP_OP_EQUAL
+	#undef SUPER_STEP_OP_NOT_EQUAL
+	#undef SUPER_STEP_OP_GREATER
+	#undef SUPER_STEP_OP_GREATER_EQUAL
+	#undef SUPER_STEP_OP_LESS
+	#undef SUPER_STEP_OP_LESS_EQUAL
+	#undef SUPER_STEP_OP_NOT
+	#undef SUPER_STEP_OP_GET
+	#undef SUPER_STEP_OP_SET
+	#undef SUPER_STEP_OP_JUMP
+	#undef SUPER_STEP_OP_JUMP_IF_FALSE
+	#undef SUPER_STEP_OP_JUMP_IF_TRUE
+	#undef SUPER_STEP_OP_JUMP_IF_FALSE_POP
+	#undef SUPER_RECORDING_EXIT
+	#undef SUPER_CASE
+	#undef FUSED_RECORDING
+	#undef FOR_INCR_BACK_EDGE
+	#undef FUSED_BRANCH
+	#undef FOR_INCR_LOOP_OP
+	#undef DISPATCH
+	#undef INTERPRET_LOOP
+	#undef CASE
+
+	//every instruction either dispatches the next one or returns, so this is only hit if the switch encounters a unknown opcode
+	return runtimeError("Unknown instruction.");
 }
 #pragma endregion
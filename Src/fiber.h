@@ -61,6 +61,10 @@ private:
 	Value pop();
 	Value peek(int depth);
 	bool friend pushValToStr(objFiber* fiber, Value val);
+	#ifdef TRACING_JIT
+	//the recorder reads the stack and frames of the fiber it's recording
+	friend class traceJit;
+	#endif
 
 	void resetStack();
 	interpretResult runtimeError(const char* format, ...);
@@ -74,7 +78,11 @@ private:
 
 	void defineMethod(objString* name);
 	bool bindMethod(objClass* klass, objString* name);
-	bool invoke(objString* methodName, int argCount);
+	void bindMethod(objClosure* method);
+	void addCacheEntry(inlineCache* cache, cacheEntry entry);
+	bool getProperty(objString* name, inlineCache* cache);
+	void setProperty(objString* name, inlineCache* cache);
+	bool invoke(objString* methodName, int argCount, inlineCache* cache = nullptr);
 	bool invokeFromClass(objClass* klass, objString* fieldName, int argCount);
 
 	Value stack[STACK_MAX];
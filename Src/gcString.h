@@ -11,7 +11,7 @@ public:
 	void* operator new(size_t size, size_t strLen);
 
 	void move(byte* to);
-	size_t getSize() { return sizeof(stringHeader) + len; }
+	size_t getSize() { return ALIGN_OBJ_SIZE(sizeof(stringHeader) + len); }
 	void updatePtrs() { raw = reinterpret_cast<char*>(reinterpret_cast<byte*>(moveTo) + sizeof(stringHeader)); }
 	void trace(std::vector<managed*>& stack) {}
 
@@ -13,7 +13,7 @@ public:
 	arrHeader(uInt _capacity, uInt _sizeofType);
 
 	void move(byte* to){ memmove(to, this, sizeof(arrHeader) + sizeofType * capacity); }
-	size_t getSize() { return sizeof(arrHeader) + (sizeofType * capacity); }
+	size_t getSize() { return ALIGN_OBJ_SIZE(sizeof(arrHeader) + (sizeofType * capacity)); }
 	void updatePtrs() { arr = reinterpret_cast<byte*>(moveTo) + sizeof(arrHeader); }
 	//nothing happens here because the arr follows this header can contain any element
 	void trace(std::vector<managed*>& stack) {}
@@ -171,6 +171,8 @@ public:
 	uInt count() { return header == nullptr ? 0 : header->count; }
 	uInt capacity() { return header == nullptr ? 0 : header->capacity; }
 	bool isEmpty() { return header == nullptr || header->count == 0; }
+	//raw pointer to the elements, it's invalidated by anything that can cause a collection
+	T* data() { return header == nullptr ? nullptr : getArr(); }
 private:
 	arrHeader* header;
 
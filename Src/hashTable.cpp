@@ -11,12 +11,14 @@ hashTable::hashTable() {
 
 bool hashTable::set(objString* key, Value val) {
 	//adjust array size based on load factor, array size should be power of 2 for best performance
+	//the key stays marked while resizing, the mark it had before is restored since objects outside of the nursery stay marked
+	managed* mark = key->moveTo;
 	key->moveTo = key;
 	if (count + 1 >= capacity*TABLE_LOAD_FACTOR) {
 		//arbitrary value, should be tested and changed
 		resize(((capacity) < 8 ? 8 : (capacity) * 2));
 	}
-	key->moveTo = nullptr;
+	key->moveTo = mark;
 	entry* _entry = findEntry(entries, key);
 	bool isNewKey = _entry->key == nullptr || _entry->key == TOMBSTONE;
 	if (isNewKey && _entry->key == nullptr) count++;
@@ -51,6 +53,12 @@ bool hashTable::del(objString* key) {
 	return true;
 }
 
+void hashTable::replaceKey(objString* key, objString* newKey) {
+	if (count == 0) return;
+	entry* _entry = findEntry(entries, key);
+	if (_entry->key == key) _entry->key = newKey;
+}
+
 entry* hashTable::findEntry(gcVector<entry> &_entries, objString* key) {
 	size_t bitMask = _entries.count() - 1 ;
 	uInt64 index = key->hash & bitMask;
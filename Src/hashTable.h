@@ -30,6 +30,8 @@ public:
 	bool get(objString* key, Value* val);
 	objString* getKey(Value val);
 	bool del(objString* key);
+	//used by the GC when a key moves, both have the same hash
+	void replaceKey(objString* key, objString* newKey);
 	void tableAddAll(hashTable* src);
 private:
 	void resize(uInt64 _capacity);
@@ -4,7 +4,7 @@
 #include "object.h"
 
 void updateVal(Value* val) {
-	if (val->type == VAL_OBJ) val->as.object = (obj*)(val->as.object->moveTo);
+	if (IS_OBJ(*val)) *val = OBJ_VAL((obj*)(AS_OBJ(*val)->moveTo));
 }
 
 void updateTable(hashTable* table) {
@@ -42,10 +42,14 @@ movingHeapBlock::movingHeapBlock() {
 	heapTop = heapBuffer;
 
 	heapSize = HEAP_START_SIZE;
+	liveSize = 0;
 }
 
 void* movingHeapBlock::allocate(size_t size) {
 	void* ptr = heapTop;
+	#ifdef PARALLEL_GC
+	if (chunkObjects.size() != 0) recordChunks(heapTop, size);
+	#endif
 	heapTop += size;
 	return ptr;
 }
@@ -74,6 +78,9 @@ void movingHeapBlock::resize(size_t size) {
 		exit(64);
 	}
 	heapSize = newHeapSize;
+	#ifdef PARALLEL_GC
+	if (chunkObjects.size() != 0) trackChunks();
+	#endif
 }
 
 void movingHeapBlock::shrink() {
@@ -87,6 +94,9 @@ void movingHeapBlock::shrink() {
 		exit(64);
 	}
 	heapSize = newHeapSize;
+	#ifdef PARALLEL_GC
+	if (chunkObjects.size() != 0) trackChunks();
+	#endif
 }
 
 void movingHeapBlock::clear() {
@@ -108,12 +118,14 @@ void movingHeapBlock::clear() {
 }
 
 void movingHeapBlock::computeAddress() {
-	//we scan the heap linearly, for each marked object(those whose moveTo field isn't null), we calculate a new(compacted) position
 	//"to" can point either to start of the same memory block, or to a entirely memory block
 	if (oldHeapBuffer == nullptr) oldHeapBuffer = heapBuffer;
-	byte* to = heapBuffer;
-	byte* from = oldHeapBuffer;
-	while (from < heapTop) {
+	computeAddress(oldHeapBuffer, heapTop, heapBuffer);
+}
+
+//we scan the objects linearly, for each marked object(those whose moveTo field isn't null), we calculate a new(compacted) position
+byte* movingHeapBlock::computeAddress(byte* from, byte* end, byte* to) {
+	while (from < end) {
 		managed* temp = reinterpret_cast<managed*>(from);
 		if (forwardAddress(reinterpret_cast<managed*>(from))) {
 			temp->moveTo = reinterpret_cast<managed*>(to);
@@ -123,13 +135,16 @@ void movingHeapBlock::computeAddress() {
 		//get the next object from old heap
 		from += temp->getSize();
 	}
+	return to;
 }
 
 void movingHeapBlock::updatePtrs() {
-	//sort of like marking, we scan the heap lineraly, and for each marked object we update it's pointers
-	byte* current = oldHeapBuffer == nullptr ? heapBuffer : oldHeapBuffer;
+	updatePtrs(oldHeapBuffer == nullptr ? heapBuffer : oldHeapBuffer, heapTop);
+}
 
-	while (current < heapTop) {
+//sort of like marking, we scan the objects lineraly, and for each marked object we update it's pointers
+void movingHeapBlock::updatePtrs(byte* current, byte* end) {
+	while (current < end) {
 		managed* temp = reinterpret_cast<managed*>(current);
 		if (forwardAddress(temp)) {
 			temp->updatePtrs();
@@ -149,38 +164,129 @@ void movingHeapBlock::clearFlags() {
 	}
 }
 
+//clears the marks of the objects starting at 'from' until 'bytes' worth of them are cleared, returns where it stopped
+byte* movingHeapBlock::clearFlags(byte* from, size_t bytes) {
+	byte* end = bytes < (size_t)(heapTop - from) ? from + bytes : heapTop;
+	while (from < end) {
+		managed* temp = reinterpret_cast<managed*>(from);
+		temp->moveTo = nullptr;
+		from += temp->getSize();
+	}
+	return from;
+}
+
 void movingHeapBlock::compact() {
 	//heap can be either the same memory buffer, or a completely different one
 	//we're always copy FROM old heap
-	byte* from = oldHeapBuffer;
-	byte* newTop = heapBuffer;
-
 	//heapTop points to the top of the old heap, we ONLY update heapTop once we're done with compacting
-	while (from < heapTop) {
+	compacted(compact(oldHeapBuffer, heapTop, heapBuffer));
+}
+
+//moves the marked objects in [from, end) to the addresses computeAddress gave them and destroys the rest, returns where the last one ends
+byte* movingHeapBlock::compact(byte* from, byte* end, byte* newTop) {
+	while (from < end) {
 		managed* curObject = reinterpret_cast<managed*>(from);
 		size_t sizeOfObj = curObject->getSize();
 		byte* nextObj = from + sizeOfObj;
 
 		if (forwardAddress(curObject)) {
 			byte* to = reinterpret_cast<byte*>(curObject->moveTo);
+			//the copy keeps moveTo pointing at itself, objects stay marked between collections(see GC::minorCollect)
+			#ifndef GENERATIONAL_GC
 			curObject->moveTo = nullptr;//reset the marked flag
+			#endif
 			//this is a simple optimization, if the object doesn't move in memory at all, there's no need to copy it
 			if (from != to) curObject->move(to);
 			newTop = to + sizeOfObj;
+			#ifdef PARALLEL_GC
+			recordChunks(to, sizeOfObj);
+			#endif
 		}
 		else {
 			curObject->~managed();
 		}
 		from = nextObj;
 	}
-	//only update heapTop once we're done compacting
+	return newTop;
+}
+
+//only update heapTop once we're done compacting
+void movingHeapBlock::compacted(byte* newTop) {
 	heapTop = newTop;
+	liveSize = heapTop - heapBuffer;
 	#ifdef DEBUG_GC
 	//this way any unupdated pointers won't point to vaild memory that the GC considers unoccupied
 	memset(heapTop, 0, heapSize - (heapTop - heapBuffer));
 	#endif // DEBUG_GC
 }
 
+//every marked object gets a address on top of 'heap', returns where the last one ends
+byte* movingHeapBlock::forwardTo(movingHeapBlock& heap) {
+	byte* to = heap.heapTop;
+	byte* current = heapBuffer;
+	while (current < heapTop) {
+		managed* temp = reinterpret_cast<managed*>(current);
+		size_t size = temp->getSize();
+		if (forwardAddress(temp)) {
+			temp->moveTo = reinterpret_cast<managed*>(to);
+			#ifdef PARALLEL_GC
+			heap.recordChunks(to, size);
+			#endif
+			to += size;
+		}
+		current += size;
+	}
+	return to;
+}
+
+//copies every marked object to the address forwardTo gave it and destroys the rest, which leaves the heap empty
+void movingHeapBlock::evacuate() {
+	byte* current = heapBuffer;
+	while (current < heapTop) {
+		managed* temp = reinterpret_cast<managed*>(current);
+		size_t size = temp->getSize();
+		//same as compact, the copy ends up marked
+		if (forwardAddress(temp)) temp->move(reinterpret_cast<byte*>(temp->moveTo));
+		else temp->~managed();
+		current += size;
+	}
+	heapTop = heapBuffer;
+}
+
+#ifdef PARALLEL_GC
+//the heap is split into HEAP_CHUNK_SIZE big chunks, so that it can be walked from the start of any of them
+void movingHeapBlock::trackChunks() {
+	chunkObjects.resize(heapSize / HEAP_CHUNK_SIZE + 1, 0);
+}
+
+//'ptr' is where a object of 'size' bytes now starts on this heap, every chunk that starts inside of it has it's first object right after it
+void movingHeapBlock::recordChunks(byte* ptr, size_t size) {
+	size_t start = ptr - heapBuffer;
+	size_t end = start + size;
+	for (size_t i = start / HEAP_CHUNK_SIZE + 1; i <= end / HEAP_CHUNK_SIZE; i++) chunkObjects[i] = end;
+}
+
+//the first object of every chunk on the buffer that's being collected, followed by the top of the heap
+void movingHeapBlock::chunkStarts(std::vector<byte*>& starts) {
+	byte* buffer = oldHeapBuffer == nullptr ? heapBuffer : oldHeapBuffer;
+	size_t top = heapTop - buffer;
+	starts.clear();
+	for (size_t i = 0; i * HEAP_CHUNK_SIZE < top; i++) starts.push_back(buffer + std::min(chunkObjects[i], top));
+	starts.push_back(heapTop);
+}
+
+size_t movingHeapBlock::liveBytes(byte* from, byte* end) {
+	size_t live = 0;
+	while (from < end) {
+		managed* temp = reinterpret_cast<managed*>(from);
+		size_t size = temp->getSize();
+		if (forwardAddress(temp)) live += size;
+		from += size;
+	}
+	return live;
+}
+#endif
+
 void movingHeapBlock::dump(bool isPost) {
 	byte* from = isPost ? heapBuffer : oldHeapBuffer;
 	byte* inc = from;
@@ -246,6 +352,8 @@ void staticHeapBlock::sweep() {
 				objects.erase(objects.begin() + i);
 			}
 		}
+		#ifndef GENERATIONAL_GC
 		else objects[i].block->moveTo = nullptr;
+		#endif
 	}
 }
\ No newline at end of file
@@ -24,6 +24,17 @@ public:
 	void updatePtrs();
 	void compact();
 	void clearFlags();
+	byte* clearFlags(byte* from, size_t bytes);
+	//the same walks over only the objects in [from, end), 'to' is where the first marked object moves
+	byte* computeAddress(byte* from, byte* end, byte* to);
+	void updatePtrs(byte* from, byte* end);
+	byte* compact(byte* from, byte* end, byte* to);
+	void compacted(byte* newTop);
+
+	//used for the nursery, whose survivors are copied to another heap instead of sliding down
+	byte* forwardTo(movingHeapBlock& heap);
+	void evacuate();
+	bool contains(void* ptr) { return reinterpret_cast<byte*>(ptr) >= heapBuffer && reinterpret_cast<byte*>(ptr) < heapTop; }
 
 	void dump(bool isPost);
 
@@ -35,6 +46,17 @@ public:
 	byte* heapTop;
 
 	size_t heapSize;
+	//how much was left after the last compaction
+	size_t liveSize;
+
+	#ifdef PARALLEL_GC
+	//offset of the first object that starts at or after the start of each chunk, the nursery doesn't keep track of it's chunks
+	std::vector<size_t> chunkObjects;
+	void trackChunks();
+	void recordChunks(byte* ptr, size_t size);
+	void chunkStarts(std::vector<byte*>& starts);
+	size_t liveBytes(byte* from, byte* end);
+	#endif
 };
 
 
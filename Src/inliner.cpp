@@ -0,0 +1,194 @@
+#include "inliner.h"
+
+std::unordered_map<string, ASTFunc*> inlineScanner::scan(vector<ASTNode*>& stmts) {
+	assigned.clear();
+	std::unordered_map<string, int> declCount;
+	std::unordered_map<string, ASTFunc*> candidates;
+	for (ASTNode* stmt : stmts) {
+		scanNode(stmt);
+		switch (stmt->type) {
+		case ASTType::VAR_DECL: declCount[((ASTVarDecl*)stmt)->getToken().getLexeme()]++; break;
+		case ASTType::CLASS: declCount[((ASTClass*)stmt)->getName().getLexeme()]++; break;
+		case ASTType::FUNC: {
+			ASTFunc* decl = (ASTFunc*)stmt;
+			string name = decl->getName().getLexeme();
+			declCount[name]++;
+			ASTNode* expr = returnedExpr(decl);
+			if (expr == nullptr) break;
+			nodeCount = 0;
+			inlinable = true;
+			scanNode(expr);
+			if (inlinable && nodeCount <= INLINE_MAX_NODES) candidates[name] = decl;
+			break;
+		}
+		}
+	}
+	//if the name is assigned to or declared again, a call might not end up calling this function
+	for (auto it = candidates.begin(); it != candidates.end();) {
+		if (assigned.count(it->first) > 0 || declCount[it->first] > 1) it = candidates.erase(it);
+		else it++;
+	}
+	return candidates;
+}
+
+#pragma region Helpers
+void inlineScanner::scanNode(ASTNode* node) {
+	if (node == nullptr) return;
+	nodeCount++;
+	node->accept(this);
+}
+
+void inlineScanner::scanAll(vector<ASTNode*> nodes) {
+	for (ASTNode* node : nodes) scanNode(node);
+}
+
+//body has to be exactly '{ return <expr>; }'
+ASTNode* inlineScanner::returnedExpr(ASTFunc* decl) {
+	if (decl->getBody()->type != ASTType::BLOCK_STMT) return nullptr;
+	vector<ASTNode*> stmts = ((ASTBlockStmt*)decl->getBody())->getStmts();
+	if (stmts.size() != 1 || stmts[0]->type != ASTType::RETURN) return nullptr;
+	return ((ASTReturn*)stmts[0])->getExpr();
+}
+#pragma endregion
+
+#pragma region Expressions
+void inlineScanner::visitAssignmentExpr(ASTAssignmentExpr* expr) {
+	assigned.insert(expr->getToken().getLexeme());
+	scanNode(expr->getVal());
+}
+
+void inlineScanner::visitSetExpr(ASTSetExpr* expr) {
+	scanNode(expr->getCallee());
+	scanNode(expr->getField());
+	scanNode(expr->getValue());
+}
+
+void inlineScanner::visitConditionalExpr(ASTConditionalExpr* expr) {
+	scanNode(expr->getCondition());
+	scanNode(expr->getThenBranch());
+	scanNode(expr->getElseBranch());
+}
+
+void inlineScanner::visitBinaryExpr(ASTBinaryExpr* expr) {
+	scanNode(expr->getLeft());
+	scanNode(expr->getRight());
+}
+
+void inlineScanner::visitUnaryExpr(ASTUnaryExpr* expr) {
+	scanNode(expr->getRight());
+}
+
+void inlineScanner::visitUnaryVarAlterExpr(ASTUnaryVarAlterExpr* expr) {
+	scanNode(expr->getIncrementExpr());
+}
+
+void inlineScanner::visitCallExpr(ASTCallExpr* expr) {
+	scanNode(expr->getCallee());
+	scanAll(expr->getArgs());
+}
+
+void inlineScanner::visitGroupingExpr(ASTGroupingExpr* expr) {
+	scanNode(expr->getExpr());
+}
+
+void inlineScanner::visitArrayDeclExpr(ASTArrayDeclExpr* expr) {
+	scanAll(expr->getMembers());
+}
+
+void inlineScanner::visitStructLiteralExpr(ASTStructLiteral* expr) {
+	for (structEntry& entry : expr->getEntries()) scanNode(entry.expr);
+}
+
+//'this' would resolve to the receiver of the caller
+void inlineScanner::visitLiteralExpr(ASTLiteralExpr* expr) {
+	if (expr->getToken().type == TOKEN_THIS) inlinable = false;
+}
+
+//yielding and fibers are left to real calls, a fiber literal would also capture the parameters
+void inlineScanner::visitYieldExpr(ASTYieldExpr* expr) {
+	inlinable = false;
+	scanNode(expr->getExpr());
+}
+
+void inlineScanner::visitFiberRunExpr(ASTFiberRunExpr* expr) {
+	inlinable = false;
+	scanAll(expr->getArgs());
+}
+
+void inlineScanner::visitFiberLiteralExpr(ASTFiberLiteral* expr) {
+	inlinable = false;
+	scanNode(expr->getBody());
+}
+
+void inlineScanner::visitSuperExpr(ASTSuperExpr* expr) {
+	inlinable = false;
+}
+#pragma endregion
+
+#pragma region Statements
+void inlineScanner::visitVarDecl(ASTVarDecl* decl) {
+	scanNode(decl->getExpr());
+}
+
+void inlineScanner::visitFuncDecl(ASTFunc* decl) {
+	scanNode(decl->getBody());
+}
+
+void inlineScanner::visitClassDecl(ASTClass* decl) {
+	scanAll(decl->getMethods());
+}
+
+void inlineScanner::visitPrintStmt(ASTPrintStmt* stmt) {
+	scanNode(stmt->getExpr());
+}
+
+void inlineScanner::visitExprStmt(ASTExprStmt* stmt) {
+	scanNode(stmt->getExpr());
+}
+
+void inlineScanner::visitBlockStmt(ASTBlockStmt* stmt) {
+	scanAll(stmt->getStmts());
+}
+
+void inlineScanner::visitIfStmt(ASTIfStmt* stmt) {
+	scanNode(stmt->getCondition());
+	scanNode(stmt->getThen());
+	scanNode(stmt->getElse());
+}
+
+void inlineScanner::visitWhileStmt(ASTWhileStmt* stmt) {
+	scanNode(stmt->getCondition());
+	scanNode(stmt->getBody());
+}
+
+void inlineScanner::visitForStmt(ASTForStmt* stmt) {
+	scanNode(stmt->getInit());
+	scanNode(stmt->getCondition());
+	scanNode(stmt->getIncrement());
+	scanNode(stmt->getBody());
+}
+
+void inlineScanner::visitForeachStmt(ASTForeachStmt* stmt) {
+	//the loop variable is assigned to on every iteration
+	assigned.insert(stmt->getVarName().getLexeme());
+	scanNode(stmt->getCollection());
+	scanNode(stmt->getBody());
+}
+
+void inlineScanner::visitBreakStmt(ASTBreakStmt* stmt) {}
+
+void inlineScanner::visitContinueStmt(ASTContinueStmt* stmt) {}
+
+void inlineScanner::visitSwitchStmt(ASTSwitchStmt* stmt) {
+	scanNode(stmt->getExpr());
+	scanAll(stmt->getCases());
+}
+
+void inlineScanner::visitCase(ASTCase* _case) {
+	scanAll(_case->getStmts());
+}
+
+void inlineScanner::visitReturnStmt(ASTReturn* stmt) {
+	scanNode(stmt->getExpr());
+}
+#pragma endregion
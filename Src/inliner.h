@@ -0,0 +1,62 @@
+#pragma once
+#include "common.h"
+#include "AST.h"
+#include <unordered_map>
+#include <unordered_set>
+
+//max number of AST nodes in the returned expression of a function that gets inlined
+#define INLINE_MAX_NODES 24
+
+//finds module level functions that the compiler can compile in place of a call to them
+//a function qualifies if it's body is a single 'return <expr>;', the expression is small and doesn't use 'this', 'super' or fibers,
+//and the name it's bound to is never assigned to or declared again in the same file(other files can't assign to it)
+//
+//since the function never captures anything and it's name always refers to it, the only thing the compiler needs to take care of is
+//that the expression sees the parameters and globals, and not the locals of the caller
+class inlineScanner : public visitor {
+public:
+	std::unordered_map<string, ASTFunc*> scan(vector<ASTNode*>& stmts);
+
+	void visitAssignmentExpr(ASTAssignmentExpr* expr);
+	void visitSetExpr(ASTSetExpr* expr);
+	void visitConditionalExpr(ASTConditionalExpr* expr);
+	void visitBinaryExpr(ASTBinaryExpr* expr);
+	void visitUnaryExpr(ASTUnaryExpr* expr);
+	void visitUnaryVarAlterExpr(ASTUnaryVarAlterExpr* expr);
+	void visitCallExpr(ASTCallExpr* expr);
+	void visitGroupingExpr(ASTGroupingExpr* expr);
+	void visitArrayDeclExpr(ASTArrayDeclExpr* expr);
+	void visitStructLiteralExpr(ASTStructLiteral* expr);
+	void visitLiteralExpr(ASTLiteralExpr* expr);
+	void visitYieldExpr(ASTYieldExpr* expr);
+	void visitFiberRunExpr(ASTFiberRunExpr* expr);
+	void visitFiberLiteralExpr(ASTFiberLiteral* expr);
+	void visitSuperExpr(ASTSuperExpr* expr);
+
+	void visitVarDecl(ASTVarDecl* decl);
+	void visitFuncDecl(ASTFunc* decl);
+	void visitClassDecl(ASTClass* decl);
+
+	void visitPrintStmt(ASTPrintStmt* stmt);
+	void visitExprStmt(ASTExprStmt* stmt);
+	void visitBlockStmt(ASTBlockStmt* stmt);
+	void visitIfStmt(ASTIfStmt* stmt);
+	void visitWhileStmt(ASTWhileStmt* stmt);
+	void visitForStmt(ASTForStmt* stmt);
+	void visitForeachStmt(ASTForeachStmt* stmt);
+	void visitBreakStmt(ASTBreakStmt* stmt);
+	void visitContinueStmt(ASTContinueStmt* stmt);
+	void visitSwitchStmt(ASTSwitchStmt* stmt);
+	void visitCase(ASTCase* _case);
+	void visitReturnStmt(ASTReturn* stmt);
+private:
+	//every name that's the target of a assignment somewhere in the file, locals included
+	std::unordered_set<string> assigned;
+	//number of AST nodes visited so far, and whether any of them can't be inlined
+	int nodeCount;
+	bool inlinable;
+
+	void scanNode(ASTNode* node);
+	void scanAll(vector<ASTNode*> nodes);
+	ASTNode* returnedExpr(ASTFunc* decl);
+};
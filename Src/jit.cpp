@@ -0,0 +1,878 @@
+#include "jit.h"
+#include "namespaces.h"
+
+#if defined(BASELINE_JIT) || defined(TRACING_JIT)
+#include <sys/mman.h>
+#include <cstring>
+#include <cfloat>
+
+typedef uInt(*jitEntry)(uint8_t* target, Value* slots, Value** stackTop, Value* constants, objUpval** upvals);
+
+#pragma region Emitter
+static int num(x64Reg reg) {
+	return (int)reg;
+}
+
+void x64Emitter::rex(bool wide, int reg, int rm, bool force) {
+	uint8_t prefix = 0x40 | (wide << 3) | (((reg >> 3) & 1) << 2) | ((rm >> 3) & 1);
+	if (prefix != 0x40 || force) code.push_back(prefix);
+}
+
+void x64Emitter::modrm(int reg, int rm) {
+	code.push_back(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void x64Emitter::memOperand(int reg, x64Reg base, int32_t disp) {
+	code.push_back(0x80 | ((reg & 7) << 3) | (num(base) & 7));
+	//rsp and r12 as a base need a SIB byte
+	if ((num(base) & 7) == 4) code.push_back(0x24);
+	for (int i = 0; i < 4; i++) code.push_back((uint8_t)(disp >> (i * 8)));
+}
+
+void x64Emitter::load(x64Reg dst, x64Reg base, int32_t disp) {
+	rex(true, num(dst), num(base));
+	code.push_back(0x8B);
+	memOperand(num(dst), base, disp);
+}
+
+void x64Emitter::store(x64Reg base, int32_t disp, x64Reg src) {
+	rex(true, num(src), num(base));
+	code.push_back(0x89);
+	memOperand(num(src), base, disp);
+}
+
+void x64Emitter::movImm(x64Reg dst, uInt64 imm) {
+	rex(true, 0, num(dst));
+	code.push_back(0xB8 + (num(dst) & 7));
+	for (int i = 0; i < 8; i++) code.push_back((uint8_t)(imm >> (i * 8)));
+}
+
+void x64Emitter::mov(x64Reg dst, x64Reg src) {
+	alu(0x89, dst, src);
+}
+
+void x64Emitter::mov32(x64Reg dst, x64Reg src) {
+	rex(false, num(src), num(dst));
+	code.push_back(0x89);
+	modrm(num(src), num(dst));
+}
+
+void x64Emitter::movsxd(x64Reg dst, x64Reg src) {
+	rex(true, num(dst), num(src));
+	code.push_back(0x63);
+	modrm(num(dst), num(src));
+}
+
+void x64Emitter::alu(uint8_t opcode, x64Reg dst, x64Reg src) {
+	rex(true, num(src), num(dst));
+	code.push_back(opcode);
+	modrm(num(src), num(dst));
+}
+
+void x64Emitter::alu32(uint8_t opcode, x64Reg dst, x64Reg src) {
+	rex(false, num(src), num(dst));
+	code.push_back(opcode);
+	modrm(num(src), num(dst));
+}
+
+void x64Emitter::imul32(x64Reg dst, x64Reg src) {
+	rex(false, num(dst), num(src));
+	code.push_back(0x0F);
+	code.push_back(0xAF);
+	modrm(num(dst), num(src));
+}
+
+void x64Emitter::cmp32(x64Reg a, x64Reg b) {
+	rex(false, num(b), num(a));
+	code.push_back(ALU_CMP);
+	modrm(num(b), num(a));
+}
+
+void x64Emitter::imul(x64Reg dst, x64Reg src) {
+	rex(true, num(dst), num(src));
+	code.push_back(0x0F);
+	code.push_back(0xAF);
+	modrm(num(dst), num(src));
+}
+
+void x64Emitter::addImm(x64Reg dst, int32_t imm) {
+	if (imm == 0) return;
+	rex(true, 0, num(dst));
+	code.push_back(0x81);
+	modrm(0, num(dst));
+	for (int i = 0; i < 4; i++) code.push_back((uint8_t)(imm >> (i * 8)));
+}
+
+void x64Emitter::setBool(uint8_t cc) {
+	//setcc al, movzx eax, al, then offset FALSE_BITS by it(TRUE_BITS is FALSE_BITS + 1)
+	code.push_back(0x0F);
+	code.push_back(0x90 + cc);
+	code.push_back(0xC0);
+	code.push_back(0x0F);
+	code.push_back(0xB6);
+	code.push_back(0xC0);
+	movImm(x64Reg::rcx, FALSE_BITS);
+	alu(ALU_ADD, x64Reg::rax, x64Reg::rcx);
+}
+
+void x64Emitter::movqToXmm(int xmm, x64Reg src) {
+	code.push_back(0x66);
+	rex(true, xmm, num(src));
+	code.push_back(0x0F);
+	code.push_back(0x6E);
+	modrm(xmm, num(src));
+}
+
+void x64Emitter::movqFromXmm(x64Reg dst, int xmm) {
+	code.push_back(0x66);
+	rex(true, xmm, num(dst));
+	code.push_back(0x0F);
+	code.push_back(0x7E);
+	modrm(xmm, num(dst));
+}
+
+void x64Emitter::sse(uint8_t opcode, int dst, int src) {
+	code.push_back(0xF2);
+	rex(false, dst, src);
+	code.push_back(0x0F);
+	code.push_back(opcode);
+	modrm(dst, src);
+}
+
+void x64Emitter::ucomisd(int a, int b) {
+	code.push_back(0x66);
+	rex(false, a, b);
+	code.push_back(0x0F);
+	code.push_back(0x2E);
+	modrm(a, b);
+}
+
+void x64Emitter::cvtsi2sd(int xmm, x64Reg src) {
+	code.push_back(0xF2);
+	rex(true, xmm, num(src));
+	code.push_back(0x0F);
+	code.push_back(0x2A);
+	modrm(xmm, num(src));
+}
+
+void x64Emitter::push(x64Reg r) {
+	rex(false, 0, num(r));
+	code.push_back(0x50 + (num(r) & 7));
+}
+
+void x64Emitter::pop(x64Reg r) {
+	rex(false, 0, num(r));
+	code.push_back(0x58 + (num(r) & 7));
+}
+
+void x64Emitter::callAbs(void* func) {
+	movImm(x64Reg::rax, (uInt64)(uintptr_t)func);
+	code.push_back(0xFF);
+	code.push_back(0xD0);
+}
+
+void x64Emitter::jmpReg(x64Reg r) {
+	rex(false, 0, num(r));
+	code.push_back(0xFF);
+	modrm(4, num(r));
+}
+
+void x64Emitter::ret() {
+	code.push_back(0xC3);
+}
+
+uInt x64Emitter::jcc(uint8_t cc) {
+	code.push_back(0x0F);
+	code.push_back(0x80 + cc);
+	uInt at = pos();
+	for (int i = 0; i < 4; i++) code.push_back(0);
+	return at;
+}
+
+uInt x64Emitter::jmp() {
+	code.push_back(0xE9);
+	uInt at = pos();
+	for (int i = 0; i < 4; i++) code.push_back(0);
+	return at;
+}
+
+void x64Emitter::patch(uInt at, uInt target) {
+	int32_t rel = (int32_t)target - (int32_t)(at + 4);
+	memcpy(&code[at], &rel, sizeof(int32_t));
+}
+#pragma endregion
+
+#pragma region Helpers
+//helpers are called from machine code with the raw bits of the values, they only handle the cases
+//where the interpreter wouldn't allocate, call or throw, and return JIT_FAIL for everything else
+static Value fromBits(uInt64 bits) {
+	Value val;
+	val.bits = bits;
+	return val;
+}
+
+static bool isFalsey(Value value) {
+	return ((IS_BOOL(value) && !AS_BOOL(value)) || IS_NIL(value));
+}
+
+uInt64 jitUnary(uInt64 bits, uInt64 op) {
+	Value val = fromBits(bits);
+	switch (op) {
+	case OP_NEGATE:
+		if (IS_INT(val) && AS_INT(val) != 0) return INT_OR_NUMBER_VAL(-(int64_t)AS_INT(val)).bits;
+		if (!IS_NUMBER(val)) return JIT_FAIL;
+		return NUMBER_VAL(-AS_NUMBER(val)).bits;
+	case OP_NOT: return BOOL_VAL(isFalsey(val)).bits;
+	case OP_BIN_NOT: {
+		if (!IS_NUMBER(val)) return JIT_FAIL;
+		int num = AS_NUMBER(val);
+		return INT_VAL(~num).bits;
+	}
+	}
+	return JIT_FAIL;
+}
+
+//same as INT_BINARY_OP in the interpreter, division by zero is left to the interpreter
+static uInt64 intBinary(Value a, Value b, uInt64 op) {
+	if (ARE_INTS(a, b)) {
+		int64_t x = AS_INT(a);
+		int64_t y = AS_INT(b);
+		switch (op) {
+		case OP_MOD: return y == 0 ? JIT_FAIL : INT_OR_NUMBER_VAL(x % y).bits;
+		case OP_BITSHIFT_LEFT: return INT_OR_NUMBER_VAL(x << y).bits;
+		case OP_BITSHIFT_RIGHT: return INT_OR_NUMBER_VAL(x >> y).bits;
+		case OP_BITWISE_AND: return INT_OR_NUMBER_VAL(x & y).bits;
+		case OP_BITWISE_OR: return INT_OR_NUMBER_VAL(x | y).bits;
+		case OP_BITWISE_XOR: return INT_OR_NUMBER_VAL(x ^ y).bits;
+		}
+		return JIT_FAIL;
+	}
+	if (!IS_NUMBER(a) || !IS_NUMBER(b)) return JIT_FAIL;
+	uInt64 x = AS_NUMBER(a);
+	uInt64 y = AS_NUMBER(b);
+	switch (op) {
+	case OP_MOD: return y == 0 ? JIT_FAIL : NUMBER_VAL((double)(x % y)).bits;
+	case OP_BITSHIFT_LEFT: return NUMBER_VAL((double)(x << y)).bits;
+	case OP_BITSHIFT_RIGHT: return NUMBER_VAL((double)(x >> y)).bits;
+	case OP_BITWISE_AND: return NUMBER_VAL((double)(x & y)).bits;
+	case OP_BITWISE_OR: return NUMBER_VAL((double)(x | y)).bits;
+	case OP_BITWISE_XOR: return NUMBER_VAL((double)(x ^ y)).bits;
+	}
+	return JIT_FAIL;
+}
+
+//equality and the integer only operators, arithmetic and ordering on numbers is done inline
+uInt64 jitBinary(uInt64 aBits, uInt64 bBits, uInt64 op) {
+	Value a = fromBits(aBits);
+	Value b = fromBits(bBits);
+	switch (op) {
+	case OP_EQUAL:
+		if (ARE_INTS(a, b)) return BOOL_VAL(AS_INT(a) == AS_INT(b)).bits;
+		return BOOL_VAL(valuesEqual(a, b)).bits;
+	case OP_NOT_EQUAL:
+		if (ARE_INTS(a, b)) return BOOL_VAL(AS_INT(a) != AS_INT(b)).bits;
+		return BOOL_VAL(!valuesEqual(a, b)).bits;
+	case OP_MOD:
+	case OP_BITSHIFT_LEFT:
+	case OP_BITSHIFT_RIGHT:
+	case OP_BITWISE_AND:
+	case OP_BITWISE_OR:
+	case OP_BITWISE_XOR:
+		return intBinary(a, b, op);
+	}
+	return JIT_FAIL;
+}
+
+uInt64 jitGetGlobal(uInt64 module, uInt64 slot) {
+	globalVar* var = &AS_MODULE(fromBits(module))->globals.data()[slot];
+	if (var->state == globalState::UNDEFINED) return JIT_FAIL;
+	return var->val.bits;
+}
+
+uInt64 jitSetGlobal(uInt64 module, uInt64 slot, uInt64 val) {
+	globalVar* var = &AS_MODULE(fromBits(module))->globals.data()[slot];
+	if (var->state != globalState::DEFINED) return JIT_FAIL;
+	var->val = fromBits(val);
+	WRITE_BARRIER(AS_MODULE(fromBits(module)), var->val);
+	return 0;
+}
+
+uInt64 jitGetUpvalue(objUpval** upvals, uInt64 slot) {
+	return upvals[slot]->location->bits;
+}
+
+uInt64 jitSetUpvalue(objUpval** upvals, uInt64 slot, uInt64 val) {
+	*upvals[slot]->location = fromBits(val);
+	WRITE_BARRIER(upvals[slot], fromBits(val));
+	return 0;
+}
+
+//index into the array the same way OP_GET and OP_SET do, returns -1 if the interpreter has to take over
+static int64_t arrayIndex(objArray* arr, Value field) {
+	if (IS_INT(field)) {
+		if (AS_INT(field) < 0 || (uInt)AS_INT(field) >= arr->values.count()) return -1;
+		return AS_INT(field);
+	}
+	if (!IS_NUMBER(field)) return -1;
+	double num = AS_NUMBER(field);
+	if (num != (uInt64)num) return -1;
+	if (num < 0 || num > arr->values.count() - 1) return -1;
+	return (uInt64)num;
+}
+
+uInt64 jitGetIndex(uInt64 callee, uInt64 field) {
+	Value arrVal = fromBits(callee);
+	if (!IS_ARRAY(arrVal)) return JIT_FAIL;
+	objArray* arr = AS_ARRAY(arrVal);
+	int64_t index = arrayIndex(arr, fromBits(field));
+	if (index < 0) return JIT_FAIL;
+	return arr->values[index].bits;
+}
+
+uInt64 jitSetIndex(uInt64 callee, uInt64 field, uInt64 bits) {
+	Value arrVal = fromBits(callee);
+	if (!IS_ARRAY(arrVal)) return JIT_FAIL;
+	objArray* arr = AS_ARRAY(arrVal);
+	int64_t index = arrayIndex(arr, fromBits(field));
+	if (index < 0) return JIT_FAIL;
+	Value val = fromBits(bits);
+	//if numOfHeapPtr is 0 we don't trace or update the array when garbage collecting
+	if (IS_OBJ(val)) arr->numOfHeapPtr++;
+	else if (IS_OBJ(arr->values[index])) arr->numOfHeapPtr--;
+	arr->values[index] = val;
+	ARRAY_WRITE_BARRIER(arr, index, index + 1, val);
+	return bits;
+}
+#pragma endregion
+
+#pragma region Arena
+jitArena::jitArena() {
+	memory = nullptr;
+	used = 0;
+	trampoline = nullptr;
+	commonExit = nullptr;
+}
+
+//the arena is only mapped once the first function or loop gets hot
+bool jitArena::init() {
+	if (memory != nullptr) return true;
+	void* mem = mmap(nullptr, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) return false;
+	memory = (uint8_t*)mem;
+
+	x64Emitter as;
+	//System V: target in rdi, slots in rsi, stackTop in rdx, constants in rcx, upvals in r8
+	as.push(x64Reg::rbx);
+	as.push(x64Reg::rbp);
+	as.push(x64Reg::r12);
+	as.push(x64Reg::r13);
+	as.push(x64Reg::r14);
+	as.push(x64Reg::r15);
+	//keeps the stack 16 byte aligned for the helper calls
+	as.addImm(x64Reg::rsp, -8);
+	as.mov(x64Reg::r12, x64Reg::rsi);
+	as.mov(x64Reg::r14, x64Reg::rdx);
+	as.load(x64Reg::rbx, x64Reg::rdx, 0);
+	as.mov(x64Reg::r13, x64Reg::rcx);
+	as.mov(x64Reg::r15, x64Reg::r8);
+	as.jmpReg(x64Reg::rdi);
+	uInt exitPos = as.pos();
+	//eax already holds the offset to resume at
+	as.store(x64Reg::r14, 0, x64Reg::rbx);
+	as.addImm(x64Reg::rsp, 8);
+	as.pop(x64Reg::r15);
+	as.pop(x64Reg::r14);
+	as.pop(x64Reg::r13);
+	as.pop(x64Reg::r12);
+	as.pop(x64Reg::rbp);
+	as.pop(x64Reg::rbx);
+	as.ret();
+
+	memcpy(memory, as.code.data(), as.pos());
+	trampoline = memory;
+	commonExit = memory + exitPos;
+	used = (as.pos() + 15) & ~15;
+	return true;
+}
+
+uint8_t* jitArena::place(x64Emitter& as, vector<uInt>& exitStubs) {
+	if (!init() || used + as.pos() > JIT_ARENA_SIZE) return nullptr;
+	uint8_t* start = memory + used;
+	for (uInt at : exitStubs) {
+		int32_t rel = (int32_t)(commonExit - (start + at + 4));
+		memcpy(&as.code[at], &rel, sizeof(int32_t));
+	}
+	memcpy(start, as.code.data(), as.pos());
+	used = (used + as.pos() + 15) & ~15;
+	return start;
+}
+
+uInt jitArena::enter(uint8_t* target, Value* slots, Value** stackTop, Value* constants, objUpval** upvals) {
+	return ((jitEntry)trampoline)(target, slots, stackTop, constants, upvals);
+}
+#pragma endregion
+#endif
+
+#ifdef BASELINE_JIT
+baselineJit::baselineJit() {
+	stats = false;
+	entries = 0;
+}
+
+jitCode* baselineJit::compile(objFunc* func) {
+	chunk& body = func->body;
+	uInt size = body.code.count();
+	compiledFunc info;
+	info.name = func->name == nullptr ? "script" : func->name->str;
+	info.bytecode = size;
+	info.native = 0;
+	info.helpers = 0;
+	info.exits = 0;
+
+	x64Emitter as;
+	jitCode* native = new jitCode();
+	//offsets that aren't the start of a instruction are never entered
+	native->entries.assign(size, UINT32_MAX);
+	jumps.clear();
+	exits.clear();
+	exitStubs.clear();
+	for (uInt offset = 0; offset < size; offset += body.instructionLength(offset)) {
+		native->entries[offset] = as.pos();
+		if (emitInstruction(as, body, offset, body.code[offset], info)) continue;
+		//everything else is ran by the interpreter
+		exits.push_back(std::make_pair(as.jmp(), offset));
+		info.exits++;
+	}
+	for (auto& jump : jumps) {
+		if (jump.second < size && native->entries[jump.second] != UINT32_MAX) as.patch(jump.first, native->entries[jump.second]);
+		else exits.push_back(jump);
+	}
+	//every offset the machine code leaves at gets one stub that loads it into eax
+	std::map<uInt, uInt> stubs;
+	for (auto& exit : exits) {
+		auto it = stubs.find(exit.second);
+		if (it == stubs.end()) {
+			uInt stub = as.pos();
+			as.movImm(x64Reg::rax, exit.second);
+			exitStubs.push_back(as.jmp());
+			it = stubs.insert(std::make_pair(exit.second, stub)).first;
+		}
+		as.patch(exit.first, it->second);
+	}
+
+	uint8_t* start = global::codeArena.place(as, exitStubs);
+	if (start == nullptr) {
+		delete native;
+		return nullptr;
+	}
+	native->start = start;
+	native->size = as.pos();
+	info.machineCode = as.pos();
+	compiled.push_back(info);
+	return native;
+}
+
+uInt baselineJit::run(objFunc* func, uInt ip, Value* slots, Value** stackTop, Value* constants, objUpval** upvals) {
+	entries++;
+	uint8_t* target = func->native->start + func->native->entries[ip];
+	uInt resume = global::codeArena.enter(target, slots, stackTop, constants, upvals);
+	if (stats) exitOps[func->body.code[resume]]++;
+	return resume;
+}
+
+#pragma region Templates
+static uInt16 readShort(chunk& body, uInt offset) {
+	return (uInt16)((body.code[offset] << 8) | body.code[offset + 1]);
+}
+
+//push rax
+static void pushRax(x64Emitter& as) {
+	as.store(x64Reg::rbx, 0, x64Reg::rax);
+	as.addImm(x64Reg::rbx, sizeof(Value));
+}
+
+//jumps to target if rax is nil or false
+static void jumpIfFalsey(x64Emitter& as, vector<std::pair<uInt, uInt>>& jumps, uInt target) {
+	as.movImm(x64Reg::rcx, NIL_BITS);
+	as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+	jumps.push_back(std::make_pair(as.jcc(CC_E), target));
+	as.movImm(x64Reg::rcx, FALSE_BITS);
+	as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+	jumps.push_back(std::make_pair(as.jcc(CC_E), target));
+}
+
+static void patchAll(x64Emitter& as, vector<uInt>& at) {
+	for (uInt pos : at) as.patch(pos, as.pos());
+	at.clear();
+}
+
+//returns false if the instruction has no template
+bool baselineJit::emitInstruction(x64Emitter& as, chunk& body, uInt offset, uint8_t op, compiledFunc& info) {
+	//the templates check the types anyway
+	op = genericOpcode(op);
+	uint8_t* code = body.code.data();
+	const int32_t slot = sizeof(Value);
+	switch (op) {
+	case OP_POP: as.addImm(x64Reg::rbx, -slot); break;
+	case OP_POPN: as.addImm(x64Reg::rbx, -slot * code[offset + 1]); break;
+	case OP_CONSTANT:
+		as.load(x64Reg::rax, x64Reg::r13, slot * code[offset + 1]);
+		pushRax(as);
+		break;
+	case OP_CONSTANT_LONG:
+		as.load(x64Reg::rax, x64Reg::r13, slot * readShort(body, offset + 1));
+		pushRax(as);
+		break;
+	case OP_NIL:
+	case OP_TRUE:
+	case OP_FALSE:
+		as.movImm(x64Reg::rax, op == OP_NIL ? NIL_BITS : (op == OP_TRUE ? TRUE_BITS : FALSE_BITS));
+		pushRax(as);
+		break;
+	case OP_GET_LOCAL:
+		as.load(x64Reg::rax, x64Reg::r12, slot * code[offset + 1]);
+		pushRax(as);
+		break;
+	case OP_SET_LOCAL:
+		as.load(x64Reg::rax, x64Reg::rbx, -slot);
+		as.store(x64Reg::r12, slot * code[offset + 1], x64Reg::rax);
+		break;
+
+	case OP_JUMP: jumps.push_back(std::make_pair(as.jmp(), offset + 3 + readShort(body, offset + 1))); break;
+	case OP_LOOP: jumps.push_back(std::make_pair(as.jmp(), offset + 3 - readShort(body, offset + 1))); break;
+	case OP_JUMP_POPN:
+		as.addImm(x64Reg::rbx, -slot * readShort(body, offset + 1));
+		jumps.push_back(std::make_pair(as.jmp(), offset + 5 + readShort(body, offset + 3)));
+		break;
+	case OP_JUMP_IF_FALSE:
+		as.load(x64Reg::rax, x64Reg::rbx, -slot);
+		jumpIfFalsey(as, jumps, offset + 3 + readShort(body, offset + 1));
+		break;
+	case OP_JUMP_IF_FALSE_POP:
+		as.addImm(x64Reg::rbx, -slot);
+		as.load(x64Reg::rax, x64Reg::rbx, 0);
+		jumpIfFalsey(as, jumps, offset + 3 + readShort(body, offset + 1));
+		break;
+	case OP_JUMP_IF_TRUE: {
+		vector<uInt> falsey;
+		as.load(x64Reg::rax, x64Reg::rbx, -slot);
+		as.movImm(x64Reg::rcx, NIL_BITS);
+		as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+		falsey.push_back(as.jcc(CC_E));
+		as.movImm(x64Reg::rcx, FALSE_BITS);
+		as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+		falsey.push_back(as.jcc(CC_E));
+		jumps.push_back(std::make_pair(as.jmp(), offset + 3 + readShort(body, offset + 1)));
+		patchAll(as, falsey);
+		break;
+	}
+
+	case OP_ADD:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+		emitArith(as, op, offset);
+		break;
+	case OP_ADD_1:
+	case OP_SUBTRACT_1:
+		emitIncrement(as, op, offset);
+		break;
+	case OP_EQUAL:
+	case OP_NOT_EQUAL:
+	case OP_GREATER:
+	case OP_GREATER_EQUAL:
+	case OP_LESS:
+	case OP_LESS_EQUAL:
+		emitCompare(as, op, offset);
+		break;
+
+	case OP_NEGATE:
+	case OP_NOT:
+	case OP_BIN_NOT:
+		as.load(x64Reg::rdi, x64Reg::rbx, -slot);
+		as.movImm(x64Reg::rsi, op);
+		as.callAbs((void*)jitUnary);
+		emitHelperCheck(as, offset);
+		as.store(x64Reg::rbx, -slot, x64Reg::rax);
+		info.helpers++;
+		return true;
+	case OP_MOD:
+	case OP_BITSHIFT_LEFT:
+	case OP_BITSHIFT_RIGHT:
+	case OP_BITWISE_AND:
+	case OP_BITWISE_OR:
+	case OP_BITWISE_XOR:
+		as.load(x64Reg::rdi, x64Reg::rbx, -2 * slot);
+		as.load(x64Reg::rsi, x64Reg::rbx, -slot);
+		as.movImm(x64Reg::rdx, op);
+		as.callAbs((void*)jitBinary);
+		emitHelperCheck(as, offset);
+		as.store(x64Reg::rbx, -2 * slot, x64Reg::rax);
+		as.addImm(x64Reg::rbx, -slot);
+		info.helpers++;
+		return true;
+
+	case OP_GET_GLOBAL:
+	case OP_GET_GLOBAL_LONG:
+		if (op == OP_GET_GLOBAL) {
+			as.load(x64Reg::rdi, x64Reg::r13, slot * code[offset + 1]);
+			as.movImm(x64Reg::rsi, code[offset + 2]);
+		}
+		else {
+			as.load(x64Reg::rdi, x64Reg::r13, slot * readShort(body, offset + 1));
+			as.movImm(x64Reg::rsi, readShort(body, offset + 3));
+		}
+		as.callAbs((void*)jitGetGlobal);
+		emitHelperCheck(as, offset);
+		pushRax(as);
+		info.helpers++;
+		return true;
+	case OP_SET_GLOBAL:
+	case OP_SET_GLOBAL_LONG:
+		if (op == OP_SET_GLOBAL) {
+			as.load(x64Reg::rdi, x64Reg::r13, slot * code[offset + 1]);
+			as.movImm(x64Reg::rsi, code[offset + 2]);
+		}
+		else {
+			as.load(x64Reg::rdi, x64Reg::r13, slot * readShort(body, offset + 1));
+			as.movImm(x64Reg::rsi, readShort(body, offset + 3));
+		}
+		as.load(x64Reg::rdx, x64Reg::rbx, -slot);
+		as.callAbs((void*)jitSetGlobal);
+		emitHelperCheck(as, offset);
+		info.helpers++;
+		return true;
+	case OP_GET_UPVALUE:
+		as.mov(x64Reg::rdi, x64Reg::r15);
+		as.movImm(x64Reg::rsi, code[offset + 1]);
+		as.callAbs((void*)jitGetUpvalue);
+		pushRax(as);
+		info.helpers++;
+		return true;
+	case OP_SET_UPVALUE:
+		as.mov(x64Reg::rdi, x64Reg::r15);
+		as.movImm(x64Reg::rsi, code[offset + 1]);
+		as.load(x64Reg::rdx, x64Reg::rbx, -slot);
+		as.callAbs((void*)jitSetUpvalue);
+		info.helpers++;
+		return true;
+	//only arrays, instances can run user code through their metamethods
+	case OP_GET:
+		as.load(x64Reg::rdi, x64Reg::rbx, -2 * slot);
+		as.load(x64Reg::rsi, x64Reg::rbx, -slot);
+		as.callAbs((void*)jitGetIndex);
+		emitHelperCheck(as, offset);
+		as.store(x64Reg::rbx, -2 * slot, x64Reg::rax);
+		as.addImm(x64Reg::rbx, -slot);
+		info.helpers++;
+		return true;
+	case OP_SET:
+		as.load(x64Reg::rdi, x64Reg::rbx, -3 * slot);
+		as.load(x64Reg::rsi, x64Reg::rbx, -2 * slot);
+		as.load(x64Reg::rdx, x64Reg::rbx, -slot);
+		as.callAbs((void*)jitSetIndex);
+		emitHelperCheck(as, offset);
+		as.store(x64Reg::rbx, -3 * slot, x64Reg::rax);
+		as.addImm(x64Reg::rbx, -2 * slot);
+		info.helpers++;
+		return true;
+	default:
+		return false;
+	}
+	info.native++;
+	return true;
+}
+
+//exits to the interpreter at offset if the helper returned JIT_FAIL
+void baselineJit::emitHelperCheck(x64Emitter& as, uInt offset) {
+	as.movImm(x64Reg::rcx, JIT_FAIL);
+	as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+	exits.push_back(std::make_pair(as.jcc(CC_E), offset));
+}
+
+//checks rax(and rcx) for integers, expects INT_BITS in r8
+void baselineJit::emitIntCheck(x64Emitter& as, vector<uInt>& notInt, bool both) {
+	as.movImm(x64Reg::rdx, INT_MASK);
+	as.mov(x64Reg::rsi, x64Reg::rax);
+	as.alu(ALU_AND, x64Reg::rsi, x64Reg::rdx);
+	as.alu(ALU_CMP, x64Reg::rsi, x64Reg::r8);
+	notInt.push_back(as.jcc(CC_NE));
+	if (!both) return;
+	as.mov(x64Reg::rsi, x64Reg::rcx);
+	as.alu(ALU_AND, x64Reg::rsi, x64Reg::rdx);
+	as.alu(ALU_CMP, x64Reg::rsi, x64Reg::r8);
+	notInt.push_back(as.jcc(CC_NE));
+}
+
+//converts the number in reg to a double in xmm, exits to the interpreter at offset if it isn't a number
+//expects INT_BITS in r8 and clobbers reg if it's a integer
+void baselineJit::emitToDouble(x64Emitter& as, x64Reg reg, int xmm, uInt offset) {
+	as.movImm(x64Reg::rdx, INT_MASK);
+	as.mov(x64Reg::rsi, reg);
+	as.alu(ALU_AND, x64Reg::rsi, x64Reg::rdx);
+	as.alu(ALU_CMP, x64Reg::rsi, x64Reg::r8);
+	uInt notInt = as.jcc(CC_NE);
+	as.movsxd(reg, reg);
+	as.cvtsi2sd(xmm, reg);
+	uInt done = as.jmp();
+	as.patch(notInt, as.pos());
+	as.movImm(x64Reg::rdx, QNAN);
+	as.mov(x64Reg::rsi, reg);
+	as.alu(ALU_AND, x64Reg::rsi, x64Reg::rdx);
+	as.alu(ALU_CMP, x64Reg::rsi, x64Reg::rdx);
+	exits.push_back(std::make_pair(as.jcc(CC_E), offset));
+	as.movqToXmm(xmm, reg);
+	as.patch(done, as.pos());
+}
+
+//int64 result in rax becomes a integer if it fits in 32 bits, otherwise a double
+static void boxIntResult(x64Emitter& as, vector<uInt>& done) {
+	as.movsxd(x64Reg::rdx, x64Reg::rax);
+	as.alu(ALU_CMP, x64Reg::rdx, x64Reg::rax);
+	uInt overflow = as.jcc(CC_NE);
+	as.mov32(x64Reg::rax, x64Reg::rax);
+	as.alu(ALU_OR, x64Reg::rax, x64Reg::r8);
+	done.push_back(as.jmp());
+	as.patch(overflow, as.pos());
+	as.cvtsi2sd(0, x64Reg::rax);
+	as.movqFromXmm(x64Reg::rax, 0);
+	done.push_back(as.jmp());
+}
+
+//a in rax, b in rcx, the result replaces a and b
+//2 integers stay integers(except for division), any other pair of numbers is done in doubles, everything else goes to the interpreter
+void baselineJit::emitArith(x64Emitter& as, uint8_t op, uInt offset) {
+	const int32_t slot = sizeof(Value);
+	vector<uInt> notInt;
+	vector<uInt> done;
+	uint8_t sseOp = op == OP_ADD ? SSE_ADD : (op == OP_SUBTRACT ? SSE_SUB : (op == OP_MULTIPLY ? SSE_MUL : SSE_DIV));
+	as.load(x64Reg::rax, x64Reg::rbx, -2 * slot);
+	as.load(x64Reg::rcx, x64Reg::rbx, -slot);
+	as.movImm(x64Reg::r8, INT_BITS);
+
+	//division always produces a double
+	if (op != OP_DIVIDE) {
+		emitIntCheck(as, notInt, true);
+		as.movsxd(x64Reg::rax, x64Reg::rax);
+		as.movsxd(x64Reg::rcx, x64Reg::rcx);
+		if (op == OP_MULTIPLY) as.imul(x64Reg::rax, x64Reg::rcx);
+		else as.alu(op == OP_ADD ? ALU_ADD : ALU_SUB, x64Reg::rax, x64Reg::rcx);
+		boxIntResult(as, done);
+		patchAll(as, notInt);
+	}
+	emitToDouble(as, x64Reg::rax, 0, offset);
+	emitToDouble(as, x64Reg::rcx, 1, offset);
+	as.sse(sseOp, 0, 1);
+	as.movqFromXmm(x64Reg::rax, 0);
+
+	patchAll(as, done);
+	as.store(x64Reg::rbx, -2 * slot, x64Reg::rax);
+	as.addImm(x64Reg::rbx, -slot);
+}
+
+void baselineJit::emitIncrement(x64Emitter& as, uint8_t op, uInt offset) {
+	const int32_t slot = sizeof(Value);
+	vector<uInt> notInt;
+	vector<uInt> done;
+	as.load(x64Reg::rax, x64Reg::rbx, -slot);
+	as.movImm(x64Reg::r8, INT_BITS);
+
+	emitIntCheck(as, notInt, false);
+	as.movsxd(x64Reg::rax, x64Reg::rax);
+	as.addImm(x64Reg::rax, op == OP_ADD_1 ? 1 : -1);
+	boxIntResult(as, done);
+
+	patchAll(as, notInt);
+	emitToDouble(as, x64Reg::rax, 0, offset);
+	as.movImm(x64Reg::rcx, ONE_BITS);
+	as.movqToXmm(1, x64Reg::rcx);
+	as.sse(op == OP_ADD_1 ? SSE_ADD : SSE_SUB, 0, 1);
+	as.movqFromXmm(x64Reg::rax, 0);
+
+	patchAll(as, done);
+	as.store(x64Reg::rbx, -slot, x64Reg::rax);
+}
+
+void baselineJit::emitCompare(x64Emitter& as, uint8_t op, uInt offset) {
+	const int32_t slot = sizeof(Value);
+	vector<uInt> notInt;
+	vector<uInt> done;
+	uint8_t cc = CC_E;
+	switch (op) {
+	case OP_NOT_EQUAL: cc = CC_NE; break;
+	case OP_GREATER: cc = CC_G; break;
+	case OP_GREATER_EQUAL: cc = CC_GE; break;
+	case OP_LESS: cc = CC_L; break;
+	case OP_LESS_EQUAL: cc = CC_LE; break;
+	}
+	as.load(x64Reg::rax, x64Reg::rbx, -2 * slot);
+	as.load(x64Reg::rcx, x64Reg::rbx, -slot);
+	as.movImm(x64Reg::r8, INT_BITS);
+
+	emitIntCheck(as, notInt, true);
+	as.cmp32(x64Reg::rax, x64Reg::rcx);
+	as.setBool(cc);
+	done.push_back(as.jmp());
+	patchAll(as, notInt);
+
+	if (op == OP_EQUAL || op == OP_NOT_EQUAL) {
+		as.mov(x64Reg::rdi, x64Reg::rax);
+		as.mov(x64Reg::rsi, x64Reg::rcx);
+		as.movImm(x64Reg::rdx, op);
+		as.callAbs((void*)jitBinary);
+	}
+	else {
+		emitToDouble(as, x64Reg::rax, 0, offset);
+		emitToDouble(as, x64Reg::rcx, 1, offset);
+		//'above' is false for NaN, same as the C++ comparison, a < b is b > a
+		bool less = op == OP_LESS || op == OP_LESS_EQUAL;
+		as.ucomisd(less ? 1 : 0, less ? 0 : 1);
+		if (op == OP_LESS || op == OP_GREATER) as.setBool(CC_A);
+		else {
+			//a > b || FLOAT_EQ(a, b), |a - b| <= DBL_EPSILON is checked as -DBL_EPSILON <= a - b <= DBL_EPSILON
+			vector<uInt> isTrue;
+			vector<uInt> isFalse;
+			double epsilon = DBL_EPSILON;
+			double negEpsilon = -DBL_EPSILON;
+			uInt64 bits;
+			isTrue.push_back(as.jcc(CC_A));
+			as.sse(SSE_SUB, 0, 1);
+			memcpy(&bits, &epsilon, sizeof(double));
+			as.movImm(x64Reg::rcx, bits);
+			as.movqToXmm(1, x64Reg::rcx);
+			as.ucomisd(1, 0);
+			isFalse.push_back(as.jcc(CC_B));
+			memcpy(&bits, &negEpsilon, sizeof(double));
+			as.movImm(x64Reg::rcx, bits);
+			as.movqToXmm(1, x64Reg::rcx);
+			as.ucomisd(0, 1);
+			isFalse.push_back(as.jcc(CC_B));
+			patchAll(as, isTrue);
+			as.movImm(x64Reg::rax, TRUE_BITS);
+			done.push_back(as.jmp());
+			patchAll(as, isFalse);
+			as.movImm(x64Reg::rax, FALSE_BITS);
+		}
+	}
+
+	patchAll(as, done);
+	as.store(x64Reg::rbx, -2 * slot, x64Reg::rax);
+	as.addImm(x64Reg::rbx, -slot);
+}
+#pragma endregion
+
+void baselineJit::dumpStats() {
+	uInt64 totalExits = 0;
+	uInt totalCode = 0;
+	for (auto& exit : exitOps) totalExits += exit.second;
+	for (compiledFunc& func : compiled) totalCode += func.machineCode;
+	std::cout << "==== JIT ====\n";
+	printf("%-20s %10s %12s %8s %8s %8s\n", "function", "bytecode", "machine code", "native", "helpers", "exits");
+	for (compiledFunc& func : compiled) {
+		printf("%-20s %10u %12u %8u %8u %8u\n", func.name.c_str(), func.bytecode, func.machineCode, func.native, func.helpers, func.exits);
+	}
+	printf("compiled %u functions into %u bytes, entered machine code %llu times\n", (uInt)compiled.size(), totalCode, entries);
+	printf("returned to the interpreter %llu times, by opcode(see chunk.h):\n", totalExits);
+	for (auto& exit : exitOps) printf("  %3u %12llu\n", (uInt)exit.first, exit.second);
+}
+#endif // BASELINE_JIT
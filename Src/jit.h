@@ -0,0 +1,184 @@
+#pragma once
+#include "common.h"
+
+#if defined(BASELINE_JIT) || defined(TRACING_JIT)
+#include "object.h"
+#include <map>
+
+//every compiled function and trace is placed in this much executable memory, once it's full nothing else gets compiled
+#define JIT_ARENA_SIZE (64 * 1024 * 1024)
+
+//condition codes, added to the base opcode of jcc/setcc
+#define CC_O	0x0
+#define CC_B	0x2
+#define CC_E	0x4
+#define CC_NE	0x5
+#define CC_A	0x7
+#define CC_L	0xC
+#define CC_GE	0xD
+#define CC_LE	0xE
+#define CC_G	0xF
+
+//'r/m, reg' forms of the ALU instructions
+#define ALU_ADD	0x01
+#define ALU_OR	0x09
+#define ALU_AND	0x21
+#define ALU_SUB	0x29
+#define ALU_CMP	0x39
+
+#define SSE_ADD	0x58
+#define SSE_MUL	0x59
+#define SSE_SUB	0x5C
+#define SSE_DIV	0x5E
+
+//returned by helpers when the interpreter has to run the instruction, this is a NaN with the sign bit set
+//that no value ever uses(objects also set the sign bit, but pointers are never 0)
+#define JIT_FAIL (SIGN_BIT | QNAN)
+//all bits that have to be equal to INT_BITS for the value to be a integer
+#define INT_MASK (SIGN_BIT | QNAN | TAG_INT)
+//bit pattern of 1.0
+#define ONE_BITS ((uInt64)0x3ff0000000000000)
+
+enum class x64Reg : uint8_t {
+	rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi,
+	r8, r9, r10, r11, r12, r13, r14, r15
+};
+
+//writes the handful of x86-64 instructions the templates need, every memory operand is [base + disp32]
+class x64Emitter {
+public:
+	vector<uint8_t> code;
+	uInt pos() { return code.size(); }
+
+	void load(x64Reg dst, x64Reg base, int32_t disp);
+	void store(x64Reg base, int32_t disp, x64Reg src);
+	void movImm(x64Reg dst, uInt64 imm);
+	void mov(x64Reg dst, x64Reg src);
+	//mov r32, r32, clears the upper half
+	void mov32(x64Reg dst, x64Reg src);
+	void movsxd(x64Reg dst, x64Reg src);
+	//add/or/and/sub/xor/cmp dst, src, opcode is the 'r/m, reg' form
+	void alu(uint8_t opcode, x64Reg dst, x64Reg src);
+	//32 bit versions, these set the overflow flag for int32 results and clear the upper half of dst
+	void alu32(uint8_t opcode, x64Reg dst, x64Reg src);
+	void imul32(x64Reg dst, x64Reg src);
+	void cmp32(x64Reg a, x64Reg b);
+	void imul(x64Reg dst, x64Reg src);
+	void addImm(x64Reg dst, int32_t imm);
+	//rax = bool value of the condition code
+	void setBool(uint8_t cc);
+	void movqToXmm(int xmm, x64Reg src);
+	void movqFromXmm(x64Reg dst, int xmm);
+	//scalar double op(addsd, subsd...) xmm dst, xmm src
+	void sse(uint8_t opcode, int dst, int src);
+	void ucomisd(int a, int b);
+	void cvtsi2sd(int xmm, x64Reg src);
+	void push(x64Reg r);
+	void pop(x64Reg r);
+	void callAbs(void* func);
+	void jmpReg(x64Reg r);
+	void ret();
+	//jumps are emitted with a rel32 of 0, the returned position is patched once the target is known
+	uInt jcc(uint8_t cc);
+	uInt jmp();
+	void patch(uInt at, uInt target);
+private:
+	void rex(bool wide, int reg, int rm, bool force = false);
+	void modrm(int reg, int rm);
+	void memOperand(int reg, x64Reg base, int32_t disp);
+};
+
+//executable memory shared by every compiled function and trace, along with the code that enters and leaves it:
+//the trampoline saves the callee saved registers, loads rbx with stackTop, r12 with the slots, r13 with the constants,
+//r14 with the address of stackTop and r15 with the upvalues, then jumps to the machine code
+//machine code leaves through commonExit with the offset the interpreter continues at in eax, which stores rbx back to stackTop
+class jitArena {
+public:
+	jitArena();
+	//copies the code into the arena and links the exit stubs to commonExit, nullptr if the arena is full
+	uint8_t* place(x64Emitter& as, vector<uInt>& exitStubs);
+	uInt enter(uint8_t* target, Value* slots, Value** stackTop, Value* constants, objUpval** upvals);
+private:
+	uint8_t* memory;
+	uInt used;
+	uint8_t* trampoline;
+	uint8_t* commonExit;
+
+	bool init();
+};
+
+//helpers called from machine code with the raw bits of values, they only handle the cases
+//where the interpreter wouldn't allocate, call or throw, and return JIT_FAIL for everything else
+uInt64 jitUnary(uInt64 bits, uInt64 op);
+//equality and the integer only operators
+uInt64 jitBinary(uInt64 aBits, uInt64 bBits, uInt64 op);
+uInt64 jitGetGlobal(uInt64 module, uInt64 slot);
+uInt64 jitSetGlobal(uInt64 module, uInt64 slot, uInt64 val);
+uInt64 jitGetUpvalue(objUpval** upvals, uInt64 slot);
+uInt64 jitSetUpvalue(objUpval** upvals, uInt64 slot, uInt64 val);
+//only arrays, instances can run user code through their metamethods
+uInt64 jitGetIndex(uInt64 callee, uInt64 field);
+uInt64 jitSetIndex(uInt64 callee, uInt64 field, uInt64 bits);
+#endif
+
+#ifdef BASELINE_JIT
+//number of calls and loop iterations a function runs in the interpreter before it's compiled
+#define JIT_THRESHOLD 1000
+//machine code never checks for stack overflow, so it's only entered if at least this many slots are free
+#define JIT_STACK_RESERVE 512
+
+//machine code of a function, and where every instruction of it's bytecode starts in it
+struct jitCode {
+	uint8_t* start;
+	uInt size;
+	vector<uInt> entries;
+	jitCode() : start(nullptr), size(0) {}
+};
+
+//baseline compiler from bytecode to x86-64, every instruction is turned into a fixed template that works on the same
+//stack and slots as the interpreter: rbx holds stackTop, r12 the slots of the frame, r13 the constants and r15 the upvalues
+//
+//the interpreter enters the machine code of a function on calls, returns and loop back edges, at whatever instruction it's at,
+//and the machine code returns the offset of the first instruction it couldn't run, which the interpreter then runs itself
+//calls, returns, allocation and anything that can throw a runtime error go back to the interpreter,
+//a template whose type checks fail does the same before it touches the stack, so every error is reported by the interpreter
+//the templates handle integers and doubles inline, globals, upvalues and array indexing call small helpers that never allocate
+class baselineJit {
+public:
+	baselineJit();
+	//print the report once the program finishes
+	bool stats;
+
+	//nullptr if the function couldn't be compiled
+	jitCode* compile(objFunc* func);
+	//runs the function's machine code from ip until it returns to the interpreter, returns the ip to continue from
+	uInt run(objFunc* func, uInt ip, Value* slots, Value** stackTop, Value* constants, objUpval** upvals);
+	void dumpStats();
+private:
+	struct compiledFunc {
+		string name;
+		uInt bytecode;
+		uInt machineCode;
+		uInt native;
+		uInt helpers;
+		uInt exits;
+	};
+	vector<compiledFunc> compiled;
+	uInt64 entries;
+	//number of times the interpreter took over at each opcode
+	std::map<uint8_t, uInt64> exitOps;
+
+	bool emitInstruction(x64Emitter& as, chunk& body, uInt offset, uint8_t op, compiledFunc& info);
+	void emitArith(x64Emitter& as, uint8_t op, uInt offset);
+	void emitCompare(x64Emitter& as, uint8_t op, uInt offset);
+	void emitIncrement(x64Emitter& as, uint8_t op, uInt offset);
+	void emitHelperCheck(x64Emitter& as, uInt offset);
+	void emitIntCheck(x64Emitter& as, vector<uInt>& notInt, bool both);
+	void emitToDouble(x64Emitter& as, x64Reg reg, int xmm, uInt offset);
+
+	//positions of jumps to patch: to another instruction, to the interpreter at a offset, and to commonExit
+	vector<std::pair<uInt, uInt>> jumps;
+	vector<std::pair<uInt, uInt>> exits;
+	vector<uInt> exitStubs;
+};
+#endif
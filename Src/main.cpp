@@ -7,6 +7,8 @@
 #include "compiler.h"
 #include "namespaces.h"
 #include "memory.h"
+#include "bytecodeImage.h"
+#include "aot.h"
 
 using std::cout;
 using std::cin;
@@ -15,6 +17,18 @@ using std::cin;
 hashTable global::internedStrings = hashTable();
 GC global::gc = GC();
 std::mt19937 global::rng(0);
+#if defined(BASELINE_JIT) || defined(TRACING_JIT)
+jitArena global::codeArena = jitArena();
+#endif
+#ifdef BASELINE_JIT
+baselineJit global::jit = baselineJit();
+#endif
+#ifdef TRACING_JIT
+traceJit global::tracer = traceJit();
+#endif
+#ifdef PROFILE_SEQUENCES
+sequenceProfiler global::profiler = sequenceProfiler();
+#endif
 
 string dirPath(string path) {
 	string mainFileName = path.substr(path.find_last_of('\\') + 1, path.size() - path.find_last_of('\\'));
@@ -29,6 +43,52 @@ string dirPath(string path) {
 	return path.substr(0, path.find_last_of('\\') + 1);
 }
 
+//compiles the program into main.ifsc next to main.ifs without running it
+void emitImage(string path) {
+	string dir = dirPath(path);
+	compiler* comp = new compiler(dir, "main", funcType::TYPE_SCRIPT);
+	if (comp->compiled) {
+		string imagePath = dir + "main.ifsc";
+		if (bytecodeImage::write(imagePath, dir, comp->endFuncDecl(), comp->modules)) cout << "Wrote " << imagePath << "\n";
+		else cout << "Couldn't write " << imagePath << "\n";
+	}
+	global::gc.compilerSession = nullptr;
+	delete comp;
+}
+
+//compiles the program into main.ifsc and translates the image to C++ in main.aot.cpp(see aot.h)
+void emitAot(string path) {
+	emitImage(path);
+	string dir = dirPath(path);
+	bytecodeImage* image = new bytecodeImage();
+	if (!image->read(dir + "main.ifsc", dir)) {
+		cout << "Couldn't read back " << dir << "main.ifsc\n";
+		delete image;
+		return;
+	}
+	string cppPath = dir + "main.aot.cpp";
+	if (aotCompiler::write(cppPath, image->funcs)) cout << "Wrote " << cppPath << "\n";
+	else cout << "Couldn't write " << cppPath << "\n";
+	global::gc.imageSession = nullptr;
+	delete image;
+}
+
+//images are only ran if none of the source files they were compiled from changed, otherwise we compile from source
+void run(string path) {
+	string dir = dirPath(path);
+	if (path.size() > 5 && path.substr(path.size() - 5) == ".ifsc") {
+		bytecodeImage* image = new bytecodeImage();
+		if (image->read(path, dir)) {
+			vm newVm(image);
+			return;
+		}
+		delete image;
+		cout << "Bytecode image is out of date or corrupt, compiling from source.\n";
+	}
+	compiler* comp = new compiler(dir, "main", funcType::TYPE_SCRIPT);
+	vm newVm(comp);
+}
+
 int main(int argc, char* argv[]) {
 	string path;
 	if (argc == 1) {
@@ -36,12 +96,63 @@ int main(int argc, char* argv[]) {
 		cin >> path;
 	}
 	else if (argc == 2) path = string(argv[1]);
+	else if (argc == 3 && string(argv[1]) == "--jit-stats") {
+		#if defined(BASELINE_JIT) || defined(TRACING_JIT)
+		#ifdef BASELINE_JIT
+		global::jit.stats = true;
+		#endif
+		#ifdef TRACING_JIT
+		global::tracer.stats = true;
+		#endif
+		#else
+		cout << "Built without BASELINE_JIT or TRACING_JIT, --jit-stats is ignored.\n";
+		#endif
+		path = string(argv[2]);
+	}
+	else if (argc == 3 && string(argv[1]) == "-emit") {
+		emitImage(string(argv[2]));
+		return 0;
+	}
+	else if (argc == 4 && string(argv[1]) == "--profile") {
+		#ifdef PROFILE_SEQUENCES
+		global::profiler.path = string(argv[2]);
+		#else
+		cout << "Built without PROFILE_SEQUENCES, --profile is ignored.\n";
+		#endif
+		path = string(argv[3]);
+	}
+	//picks the superinstructions from a profile made with --profile, the interpreter has to be rebuilt with the header it writes
+	else if ((argc == 4 || argc == 5) && string(argv[1]) == "--superinstructions") {
+		uInt count = argc == 5 ? atoi(argv[4]) : SUPERINSTRUCTION_DEFAULT_COUNT;
+		if (superinstructionGenerator::write(string(argv[2]), string(argv[3]), count)) cout << "Wrote " << argv[3] << "\n";
+		else cout << "Couldn't read " << argv[2] << " or write " << argv[3] << "\n";
+		return 0;
+	}
+	//how many threads full collections use, the default is one for every core
+	else if (argc == 4 && string(argv[1]) == "--gc-threads") {
+		#ifdef PARALLEL_GC
+		global::gc.setThreads(atoi(argv[2]));
+		#else
+		cout << "Built without PARALLEL_GC, --gc-threads is ignored.\n";
+		#endif
+		path = string(argv[3]);
+	}
+	else if (argc == 3 && string(argv[1]) == "-aot") {
+		emitAot(string(argv[2]));
+		return 0;
+	}
+	else if (argc == 3 && (string(argv[1]) == "--no-aot" || string(argv[1]) == "--aot-test")) {
+		#ifdef AOT_BUILD
+		if (string(argv[1]) == "--aot-test") return aot::test(string(argv[0]), string(argv[2]));
+		aot::enabled = false;
+		#else
+		cout << "Built without AOT_BUILD, " << argv[1] << " is ignored.\n";
+		#endif
+		path = string(argv[2]);
+	}
 	else cout << "Too many arguments.";
 	cout << "Output:\n\n";
-	if (!path.empty()) {
-		compiler* comp = new compiler(dirPath(path), "main", funcType::TYPE_SCRIPT);
-		vm newVm(comp);
-	}
+	if (!path.empty()) run(path);
 	system("Pause");
 	return 0;
 }
\ No newline at end of file
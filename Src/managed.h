@@ -5,6 +5,10 @@
 
 void* __allocObj(size_t size);
 
+//every object on the heaps starts 8 byte aligned, so objects with a size that isn't a multiple of 8(strings, arrays of bytes) round it up,
+//parallel marking sets moveTo atomically and a atomic that straddles a cache line locks the whole bus
+#define ALIGN_OBJ_SIZE(size) (((size) + 7) & ~(size_t)7)
+
 //The header part of every heap allocated object
 class managed {
 public:
@@ -2,7 +2,10 @@
 #include "namespaces.h"
 #include "VM.h"
 #include "compiler.h"
+#include "bytecodeImage.h"
 #include <immintrin.h>
+#include <algorithm>
+#include <chrono>
 
 GC::GC() {
 	collecting = false;
@@ -12,26 +15,79 @@ GC::GC() {
 
 	VM = nullptr;
 	compilerSession = nullptr;
+	imageSession = nullptr;
+
+	#ifdef INCREMENTAL_GC
+	marking = false;
+	clearing = false;
+	clearingHeap = nullptr;
+	clearCursor = nullptr;
+	finishing = false;
+	greyArray = nullptr;
+	greyArrayIndex = 0;
+	markingHeap = nullptr;
+	sliceBytes = 0;
+	collectMicrosPerByte = 0;
+	#endif
 
 	//debug stuff
 	#ifdef DEBUG_GC
 	nCollections = 0;
 	nReallocations = 0;
+	nMinorCollections = 0;
 	#endif // DEBUG_GC
+	#ifdef PARALLEL_GC
+	parallel = false;
+	//the nursery is never compacted
+	normalHeap.trackChunks();
+	LOH.trackChunks();
+	#endif
 }
 
 //we call this in the overwritten new operator of obj
 //it should also be used explicitly for allocating header + raw data(strings, arrays), this is allocated on Large Object Heap(LOH)
 void* GC::allocRaw(size_t size, bool shouldLOHAlloc) {
+	size = ALIGN_OBJ_SIZE(size);
 	activeHeap = shouldLOHAlloc ? &LOH : &normalHeap;
 	inactiveHeap = shouldLOHAlloc ? &normalHeap : &LOH;
 
+	#ifdef GENERATIONAL_GC
+	if (!shouldLOHAlloc && size < NURSERY_OBJECT_MAX && nurseryActive()) {
+		#ifdef DEBUG_STRESS_GC
+		#ifdef INCREMENTAL_GC
+		//cycles are left halfway through clearing and then halfway through marking, so minor collections run during both
+		minorCollect();
+		if (!clearing) {
+			collect();
+			startMarking(&normalHeap);
+			clearSlice(1024);
+		}
+		else {
+			while (!clearSlice(1024));
+			markSlice(1);
+		}
+		#else
+		collect();
+		minorCollect();
+		#endif
+		#endif // DEBUG_STRESS_GC
+		#ifdef INCREMENTAL_GC
+		if ((clearing || marking) && (sliceBytes += size) >= MARK_SLICE_BYTES) markStep();
+		#endif
+		if (!nursery.canAllocate(size)) minorCollect();
+		return nursery.allocate(size);
+	}
+	#endif
+
 	#ifdef DEBUG_STRESS_GC
 	std::cout << "GC ran ";
 	if (activeHeap == &LOH) std::cout << "LOH\n";
 	else std::cout << "normal\n";
 	collect();
 	#endif // DEBUG_STRESS_GC
+	#ifdef INCREMENTAL_GC
+	if ((clearing || marking) && (sliceBytes += size) >= MARK_SLICE_BYTES) markStep();
+	#endif
 
 	//we only collect/resize if we're full
 	if (!activeHeap->canAllocate(size)) {
@@ -48,23 +104,55 @@ void* GC::allocRaw(size_t size, bool shouldLOHAlloc) {
 	if(!activeHeap->canAllocate(size)) {
 		resize(size);
 	}else if (activeHeap->canShrink(size)) shrink();
-	
-	return activeHeap->allocate(size);
+
+	#ifdef INCREMENTAL_GC
+	if (!marking && !clearing && nurseryActive() && shouldStartMarking(activeHeap, MARK_START_RATIO)) startMarking(activeHeap);
+	#endif
+	void* ptr = activeHeap->allocate(size);
+	#ifdef GENERATIONAL_GC
+	//a object that's too big for the nursery starts out old, but it's constructor stores pointers into it without a write barrier
+	if (!shouldLOHAlloc && nurseryActive()) remembered.push_back(reinterpret_cast<obj*>(ptr));
+	#endif
+	#ifdef INCREMENTAL_GC
+	//array headers are stored into their owner without the write barrier
+	if (marking) allocatedBlack.push_back(reinterpret_cast<managed*>(ptr));
+	#endif
+	return ptr;
 }
 
 void* GC::allocRawStatic(size_t size) {
 	if (staticHeap.shouldSweep()) {
 		mark();
 		staticHeap.sweep();
+		#ifdef GENERATIONAL_GC
+		updateRemembered();
+		nursery.clearFlags();
+		#else
 		LOH.clearFlags();
 		normalHeap.clearFlags();
+		#endif
 	}
+	#ifdef INCREMENTAL_GC
+	void* ptr = staticHeap.allocate(size);
+	if (marking) allocatedBlack.push_back(reinterpret_cast<managed*>(ptr));
+	return ptr;
+	#else
 	return staticHeap.allocate(size);
+	#endif
 }
 
 void GC::collect() {
-	if (collecting || (VM == nullptr && compilerSession == nullptr)) return;
+	if (collecting || (VM == nullptr && compilerSession == nullptr && imageSession == nullptr)) return;
+	#if defined(DEBUG_GC_PAUSES) || defined(INCREMENTAL_GC)
+	auto start = std::chrono::steady_clock::now();
+	#endif
+	#ifdef INCREMENTAL_GC
+	size_t used = (normalHeap.heapTop - normalHeap.heapBuffer) + (LOH.heapTop - LOH.heapBuffer);
+	#endif
 	collecting = true;
+	#ifdef PARALLEL_GC
+	parallel = shouldCollectInParallel();
+	#endif
 	mark();
 	//calculate the address of each marked object after compaction
 	computeAddress();
@@ -75,17 +163,33 @@ void GC::collect() {
 	compact();
 	activeHeap->oldHeapBuffer = nullptr;
 	collecting = false;
+	#ifdef PARALLEL_GC
+	parallel = false;
+	#endif
 
 	//debug stuff
 	#ifdef DEBUG_GC
 	nCollections ++;
 	#endif // DEBUG_GC
+	#ifdef DEBUG_GC_PAUSES
+	addPause(majorPauses, start);
+	#endif
+	#ifdef INCREMENTAL_GC
+	collectMicrosPerByte = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / used;
+	#endif
 }
 
 void GC::resize(size_t size) {
-	if (collecting || (VM == nullptr && compilerSession == nullptr)) return;
+	if (collecting || (VM == nullptr && compilerSession == nullptr && imageSession == nullptr)) return;
+	#ifdef DEBUG_GC_PAUSES
+	auto start = std::chrono::steady_clock::now();
+	#endif
 	collecting = true;
 
+	#ifdef PARALLEL_GC
+	//before the heap gets a new buffer
+	parallel = shouldCollectInParallel();
+	#endif
 	activeHeap->resize(size);
 
 	mark();
@@ -99,15 +203,28 @@ void GC::resize(size_t size) {
 	delete[] activeHeap->oldHeapBuffer;
 	activeHeap->oldHeapBuffer = nullptr;
 	collecting = false;
+	#ifdef PARALLEL_GC
+	parallel = false;
+	#endif
 	//debug stuff
 	#ifdef DEBUG_GC
 	nReallocations++;
 	#endif // DEBUG_GC
+	#ifdef DEBUG_GC_PAUSES
+	addPause(majorPauses, start);
+	#endif
 }
 
 void GC::shrink() {
-	if (collecting || (VM == nullptr && compilerSession == nullptr)) return;
+	if (collecting || (VM == nullptr && compilerSession == nullptr && imageSession == nullptr)) return;
+	#ifdef DEBUG_GC_PAUSES
+	auto start = std::chrono::steady_clock::now();
+	#endif
 	collecting = true;
+	#ifdef PARALLEL_GC
+	//before the heap gets a new buffer
+	parallel = shouldCollectInParallel();
+	#endif
 	activeHeap->shrink();
 
 	mark();
@@ -121,10 +238,16 @@ void GC::shrink() {
 	delete[] activeHeap->oldHeapBuffer;
 	activeHeap->oldHeapBuffer = nullptr;
 	collecting = false;
+	#ifdef PARALLEL_GC
+	parallel = false;
+	#endif
 	//debug stuff
 	#ifdef DEBUG_GC
 	nReallocations++;
 	#endif // DEBUG_GC
+	#ifdef DEBUG_GC_PAUSES
+	addPause(majorPauses, start);
+	#endif
 }
 
 
@@ -159,7 +282,8 @@ void GC::markRoots() {
 		markObj(VM->curModule);
 		markObj(VM->curFiber);
 		markTable(&VM->globals);
-		markObj(VM->toString);
+		for (int i = 0; i < METAMETHOD_COUNT; i++) markObj(VM->metamethodNames[i]);
+		markObj(VM->structShape);
 	}
 	//since a GC collection can be triggered during the compilation, we must also mark all function which are currently being compiled
 	if (compilerSession != nullptr) {
@@ -172,14 +296,41 @@ void GC::markRoots() {
 			markObj(mod);
 		}
 	}
+	//same goes for everything that's been loaded from a bytecode image
+	if (imageSession != nullptr) {
+		for (objFunc* func : imageSession->funcs) markObj(func);
+		for (objModule* mod : imageSession->modules) markObj(mod);
+		for (objString* str : imageSession->strings) markObj(str);
+	}
 }
 
 void GC::mark() {
+	#ifdef INCREMENTAL_GC
+	if (marking) {
+		finishMarking();
+		return;
+	}
+	//the marks are about to be cleared anyway
+	clearing = false;
+	whitened.clear();
+	#endif
+	#ifdef GENERATIONAL_GC
+	//everything outside of the nursery is still marked from the last collection
+	clearFlags();
+	#endif
 	markRoots();
 	//cached pointers are also considered root nodes(since such cached pointers may be a direct result of things like the pop() operation on the stack)
 	for (managed* ptr : cachedPtrs) {
 		markObj(ptr);
 	}
+	#ifdef PARALLEL_GC
+	if (parallel) {
+		parallelMark task(workers.count, stack, false);
+		stack.clear();
+		workers.run(&task);
+		return;
+	}
+	#endif
 	//we use a stack to avoid going into a deep recursion(which might fail)
 	while (stack.size() != 0) {
 		managed* ptr = stack.back();
@@ -195,6 +346,19 @@ void GC::traceObj(managed* object) {
 }
 
 void GC::computeAddress() {
+	#ifdef PARALLEL_GC
+	if (parallel) {
+		if (activeHeap->oldHeapBuffer == nullptr) activeHeap->oldHeapBuffer = activeHeap->heapBuffer;
+		activeChunks.find(activeHeap);
+		//the live bytes in the chunks before a chunk give the address it's first object moves to
+		parallelHeapWalk live(activeHeap, activeChunks, heapWalkPhase::LIVE_BYTES);
+		workers.run(&live);
+		activeChunks.prefixSum(activeHeap->heapBuffer);
+		parallelHeapWalk forward(activeHeap, activeChunks, heapWalkPhase::COMPUTE_ADDRESS);
+		workers.run(&forward);
+		return;
+	}
+	#endif
 	activeHeap->computeAddress();
 }
 
@@ -204,23 +368,29 @@ void updateObjectPtrs(managed* object) {
 }
 
 void GC::updatePtrs() {
+	//we update the interned strings, but don't mark them, that's because the strings in this hash map are "weak" pointers
+	//if no reference to a string exists, there's no point in keeping it in memory
+	updateTable(&global::internedStrings);
 	updateRootPtrs();
 	updateHeapPtrs();
 	//updating cached pointers
 	for (int i = 0; i < cachedPtrs.size(); i++) {
 		cachedPtrs[i] = cachedPtrs[i]->moveTo;
 	}
+	#ifdef GENERATIONAL_GC
+	updateRemembered();
+	#endif
 }
 
 void GC::updateRootPtrs() {
-	//we update the interned strings, but don't mark them, that's because the strings in this hash map are "weak" pointers
-	//if no reference to a string exists, there's no point in keeping it in memory
-	updateTable(&global::internedStrings);
 	if (VM != nullptr) {
 		if(VM->curFiber != nullptr) VM->curFiber = reinterpret_cast<objFiber*>(VM->curFiber->moveTo);
 		updateTable(&VM->globals);
 		if(VM->curModule != nullptr) VM->curModule = reinterpret_cast<objModule*>(VM->curModule->moveTo);
-		VM->toString = reinterpret_cast<objString*>(VM->toString->moveTo);
+		for (int i = 0; i < METAMETHOD_COUNT; i++) {
+			if (VM->metamethodNames[i] != nullptr) VM->metamethodNames[i] = reinterpret_cast<objString*>(VM->metamethodNames[i]->moveTo);
+		}
+		if (VM->structShape != nullptr) VM->structShape = reinterpret_cast<objShape*>(VM->structShape->moveTo);
 
 	}
 	//the GC can also be called during the compilation process, so we need to update it's compiler info
@@ -234,19 +404,53 @@ void GC::updateRootPtrs() {
 			compilerSession->modules[i] = reinterpret_cast<objModule*>(compilerSession->modules[i]->moveTo);
 		}
 	}
+	if (imageSession != nullptr) {
+		for (objFunc*& func : imageSession->funcs) func = reinterpret_cast<objFunc*>(func->moveTo);
+		for (objModule*& mod : imageSession->modules) mod = reinterpret_cast<objModule*>(mod->moveTo);
+		for (objString*& str : imageSession->strings) str = reinterpret_cast<objString*>(str->moveTo);
+	}
 }
 
 void GC::updateHeapPtrs() {
+	#ifdef PARALLEL_GC
+	if (parallel) {
+		#ifdef GENERATIONAL_GC
+		nursery.updatePtrs();
+		#endif
+		updateInParallel(&normalHeap);
+		updateInParallel(&LOH);
+		staticHeap.updatePtrs();
+		return;
+	}
+	#endif
 	normalHeap.updatePtrs();
+	//has to happen before the LOH headers are updated, otherwise reading arrays and tables reads from where they'll be moved to
+	#ifdef GENERATIONAL_GC
+	nursery.updatePtrs();
+	#endif
 	LOH.updatePtrs();
 	staticHeap.updatePtrs();
 }
 
 
 void GC::compact() {
+	#ifdef PARALLEL_GC
+	if (parallel) {
+		parallelHeapWalk task(activeHeap, activeChunks, heapWalkPhase::COMPACT);
+		workers.run(&task);
+		activeHeap->compacted(activeChunks.dests[activeChunks.count()]);
+	}
+	else activeHeap->compact();
+	#else
 	activeHeap->compact();
+	#endif
+	#ifdef GENERATIONAL_GC
+	//the other heaps keep their marks, but young objects have to be unmarked for the next minor collection
+	nursery.clearFlags();
+	#else
 	inactiveHeap->clearFlags();
 	staticHeap.clearFlags();
+	#endif
 }
 
 
@@ -254,6 +458,9 @@ void GC::compact() {
 
 //deallocates the entire heap
 void GC::clear() {
+	#ifdef GENERATIONAL_GC
+	nursery.clear();
+	#endif
 	normalHeap.clear();
 	LOH.clear();
 
@@ -261,8 +468,16 @@ void GC::clear() {
 	#ifdef DEBUG_GC
 	std::cout << "GC ran " << nCollections << " times\n";
 	std::cout << "GC realloacted the heap " << nReallocations << " times\n";
+	std::cout << "GC ran " << nMinorCollections << " minor collections\n";
 	#endif // DEBUG_GC
-	
+	#ifdef DEBUG_GC_PAUSES
+	printPauses("Minor", minorPauses);
+	printPauses("Major", majorPauses);
+	#ifdef INCREMENTAL_GC
+	printPauses("Mark slice", slicePauses);
+	#endif
+	#endif
+
 }
 
 //these 2 functions are for handling potential cached pointers(such pointers may appear in native functions/while executing bytecode)
@@ -285,4 +500,401 @@ void GC::clearASTNodes() {
 		delete node;
 	}
 	ast.clear();
-}
\ No newline at end of file
+}
+#pragma region Generational
+#ifdef GENERATIONAL_GC
+//everything the compiler and image loader allocate lives until the program ends, so objects only start out young once it runs
+bool GC::nurseryActive() {
+	return VM != nullptr && compilerSession == nullptr && imageSession == nullptr;
+}
+
+void GC::remember(obj* owner) {
+	if (owner->remembered) return;
+	owner->remembered = true;
+	remembered.push_back(owner);
+}
+
+//a array that's remembered for the first time had no young objects in it, so only the range that was written to needs tracing
+void GC::rememberRange(objArray* arr, uInt64 start, uInt64 end) {
+	if (!arr->remembered) {
+		remember(arr);
+		arr->dirtyStart = start;
+		arr->dirtyEnd = end;
+		return;
+	}
+	arr->dirtyStart = std::min(arr->dirtyStart, start);
+	arr->dirtyEnd = std::max(arr->dirtyEnd, end);
+}
+
+//young objects that were already in the array might have moved out of the range
+void GC::shiftBarrier(objArray* arr, uInt64 start) {
+	if (arr->remembered) rememberRange(arr, start, arr->values.count());
+	#ifdef INCREMENTAL_GC
+	//and so might the ones marking hasn't gotten to yet
+	if (arr == greyArray) greyArrayIndex = std::min(greyArrayIndex, start);
+	#endif
+}
+
+//copies every young object that's reachable to the top of the normal heap, which leaves the nursery empty
+void GC::minorCollect() {
+	if (collecting) return;
+	//the normal heap needs room for the entire nursery, in case nothing in it is garbage
+	size_t used = nursery.heapTop - nursery.heapBuffer;
+	activeHeap = &normalHeap;
+	inactiveHeap = &LOH;
+	if (!normalHeap.canAllocate(used)) collect();
+	if (!normalHeap.canAllocate(used)) resize(used);
+	else if (normalHeap.canShrink(used)) shrink();
+
+	#ifdef DEBUG_GC_PAUSES
+	auto start = std::chrono::steady_clock::now();
+	#endif
+	collecting = true;
+	markYoung();
+	byte* top = nursery.forwardTo(normalHeap);
+	updateYoungPtrs();
+	nursery.evacuate();
+	normalHeap.heapTop = top;
+	//nothing is young anymore, so no old object points into the nursery
+	for (obj* ptr : remembered) ptr->remembered = false;
+	remembered.clear();
+	collecting = false;
+
+	#ifdef DEBUG_GC
+	nMinorCollections++;
+	#endif // DEBUG_GC
+	#ifdef DEBUG_GC_PAUSES
+	addPause(minorPauses, start);
+	#endif
+	#ifdef INCREMENTAL_GC
+	//survivors were just moved to the normal heap
+	if (!marking && !clearing && shouldStartMarking(&normalHeap, MARK_START_RATIO)) startMarking(&normalHeap);
+	#endif
+}
+
+void GC::markYoung() {
+	//objects that were allocated straight on the normal heap were remembered before their constructor cleared the flag,
+	//so they can be in the remembered set twice
+	for (obj* ptr : remembered) ptr->remembered = false;
+	size_t count = 0;
+	for (obj* ptr : remembered) {
+		if (ptr->remembered) continue;
+		ptr->remembered = true;
+		remembered[count++] = ptr;
+	}
+	remembered.resize(count);
+
+	markRoots();
+	for (managed* ptr : cachedPtrs) markObj(ptr);
+	//fibers are written to all the time(their stack), so instead of going through the write barrier they're always traced
+	for (memBlock& block : staticHeap.objects) {
+		setMarked(block.block);
+		block.block->trace(stack);
+	}
+	for (obj* ptr : remembered) {
+		#ifdef INCREMENTAL_GC
+		//only the dirty range of a array is traced here, the cycle still has to trace the rest
+		if (marking && ptr->moveTo == nullptr) grey.push_back(ptr);
+		//and if the marks are being cleared it might already be past it
+		else if (clearing) whitened.push_back(ptr);
+		#endif
+		setMarked(ptr);
+		if (ptr->type == OBJ_ARRAY) reinterpret_cast<objArray*>(ptr)->traceDirty(stack);
+		else ptr->trace(stack);
+	}
+	while (stack.size() != 0) {
+		managed* ptr = stack.back();
+		stack.pop_back();
+		if (ptr->moveTo != nullptr) continue;
+		setMarked(ptr);
+		//old objects are only marked so that updating a pointer to them doesn't change it,
+		//anything young they point to was reached through the remembered set
+		if (nursery.contains(ptr)) ptr->trace(stack);
+		#ifdef INCREMENTAL_GC
+		//which makes them grey if marking hasn't reached them yet
+		else if (marking) grey.push_back(ptr);
+		else if (clearing) whitened.push_back(ptr);
+		#endif
+	}
+}
+
+//everything that was traced by markYoung has it's pointers updated
+void GC::updateYoungPtrs() {
+	updateRootPtrs();
+	for (int i = 0; i < cachedPtrs.size(); i++) {
+		cachedPtrs[i] = cachedPtrs[i]->moveTo;
+	}
+	for (memBlock& block : staticHeap.objects) block.block->updatePtrs();
+	for (obj* ptr : remembered) {
+		if (ptr->type == OBJ_ARRAY) reinterpret_cast<objArray*>(ptr)->updateDirty();
+		else ptr->updatePtrs();
+	}
+	nursery.updatePtrs();
+	//interned strings are weak pointers, young ones that died are removed and the rest are replaced with the address they're moving to
+	byte* current = nursery.heapBuffer;
+	while (current < nursery.heapTop) {
+		obj* object = reinterpret_cast<obj*>(current);
+		if (object->type == OBJ_STRING) {
+			objString* str = reinterpret_cast<objString*>(object);
+			if (str->moveTo == nullptr) global::internedStrings.del(str);
+			else global::internedStrings.replaceKey(str, reinterpret_cast<objString*>(str->moveTo));
+		}
+		current += object->getSize();
+	}
+}
+
+//drops the remembered objects that a full collection didn't mark and updates the rest
+void GC::updateRemembered() {
+	size_t count = 0;
+	for (obj* ptr : remembered) {
+		if (ptr->moveTo == nullptr) continue;
+		remembered[count++] = reinterpret_cast<obj*>(ptr->moveTo);
+	}
+	remembered.resize(count);
+}
+
+//the nursery is never marked outside of a collection
+void GC::clearFlags() {
+	normalHeap.clearFlags();
+	LOH.clearFlags();
+	staticHeap.clearFlags();
+}
+#endif
+#pragma endregion
+
+#pragma region Incremental
+#ifdef INCREMENTAL_GC
+//'ratio' is how much of the space that was free after the last compaction has been used up since
+bool GC::shouldStartMarking(movingHeapBlock* heap, double ratio) {
+	size_t used = heap->heapTop - heap->heapBuffer;
+	return used > heap->liveSize + (heap->heapSize - heap->liveSize) * ratio;
+}
+
+//clearing the marks of a big heap in one go takes as long as marking it, so it's done in slices too
+void GC::startMarking(movingHeapBlock* heap) {
+	if (marking || clearing || collecting) return;
+	clearing = true;
+	markingHeap = heap;
+	sliceBytes = 0;
+	clearingHeap = &LOH;
+	clearCursor = LOH.heapBuffer;
+}
+
+//the normal heap goes last since that's where minor collections put the objects they mark, returns true once marking has started
+bool GC::clearSlice(size_t bytes) {
+	clearCursor = clearingHeap->clearFlags(clearCursor, bytes);
+	if (clearCursor < clearingHeap->heapTop) return false;
+	if (clearingHeap == &LOH) {
+		clearingHeap = &normalHeap;
+		clearCursor = normalHeap.heapBuffer;
+		return false;
+	}
+	beginMarking();
+	return true;
+}
+
+//young objects are left unmarked, they're traced by minor collections or when marking finishes
+void GC::beginMarking() {
+	clearing = false;
+	marking = true;
+	staticHeap.clearFlags();
+	for (managed* ptr : whitened) ptr->moveTo = nullptr;
+	whitened.clear();
+	markRoots();
+	for (managed* ptr : cachedPtrs) markObj(ptr);
+	shadeStack();
+}
+
+void GC::shade(void* ptr) {
+	managed* object = reinterpret_cast<managed*>(ptr);
+	if (object == nullptr || object->moveTo != nullptr) return;
+	if (!finishing && nursery.contains(object)) return;
+	setMarked(object);
+	grey.push_back(object);
+}
+
+//greys everything markRoots or trace() pushed onto the stack
+void GC::shadeStack() {
+	for (managed* ptr : stack) shade(ptr);
+	stack.clear();
+}
+
+//traces grey objects until 'work' objects and pointers have been gone through, returns true once there's nothing left to trace
+//everything on the grey stack is a obj, array headers are marked by their arrays
+bool GC::markSlice(size_t work) {
+	size_t done = 0;
+	while (done < work) {
+		if (greyArray != nullptr) {
+			done += traceGreyArray(work - done);
+			continue;
+		}
+		if (grey.size() == 0) break;
+		obj* object = reinterpret_cast<obj*>(grey.back());
+		grey.pop_back();
+		if (object->type == OBJ_ARRAY) {
+			greyArray = reinterpret_cast<objArray*>(object);
+			greyArrayIndex = 0;
+			greyArray->values.mark();
+			continue;
+		}
+		object->trace(stack);
+		done += stack.size() + 1;
+		shadeStack();
+	}
+	return greyArray == nullptr && grey.size() == 0;
+}
+
+//goes through at most 'work' elements of greyArray, returns how much work that was
+size_t GC::traceGreyArray(size_t work) {
+	uInt64 count = greyArray->numOfHeapPtr == 0 ? 0 : greyArray->values.count();
+	//elements could have been removed since the last slice
+	greyArrayIndex = std::min(greyArrayIndex, count);
+	uInt64 end = count - greyArrayIndex > work ? greyArrayIndex + work : count;
+	for (uInt64 i = greyArrayIndex; i < end; i++) markVal(&greyArray->values[i]);
+	size_t done = end - greyArrayIndex + 1;
+	greyArrayIndex = end;
+	shadeStack();
+	if (end == count) greyArray = nullptr;
+	return done;
+}
+
+//ran from allocRaw, once there's nothing left to trace the cycle waits for a heap to fill up(or step()) to finish the collection,
+//compacting is what frees memory and it costs the same no matter when it happens
+void GC::markStep() {
+	sliceBytes = 0;
+	if (!clearing && greyArray == nullptr && grey.size() == 0) return;
+	#ifdef DEBUG_GC_PAUSES
+	auto start = std::chrono::steady_clock::now();
+	#endif
+	if (clearing) clearSlice(CLEAR_SLICE_BYTES);
+	else markSlice(MARK_SLICE_WORK);
+	#ifdef DEBUG_GC_PAUSES
+	addPause(slicePauses, start);
+	#endif
+}
+
+//everything the program could have changed without going through the write barrier is traced again
+void GC::finishMarking() {
+	finishing = true;
+	markRoots();
+	for (managed* ptr : cachedPtrs) markObj(ptr);
+	shadeStack();
+	//old objects that a young object was stored into after they were traced
+	for (obj* ptr : remembered) {
+		if (ptr->moveTo == nullptr) continue;
+		ptr->trace(stack);
+		shadeStack();
+	}
+	//these include array headers, so they're traced here instead of going on the grey stack
+	for (managed* ptr : allocatedBlack) {
+		setMarked(ptr);
+		ptr->trace(stack);
+		shadeStack();
+	}
+	allocatedBlack.clear();
+	//a fiber's stack changes without the write barrier, every marked fiber is traced again until no new fiber gets marked
+	size_t fibers = 0;
+	while (true) {
+		drainGrey();
+		size_t marked = 0;
+		for (memBlock& block : staticHeap.objects) {
+			if (block.block->moveTo != nullptr) marked++;
+		}
+		if (marked == fibers) break;
+		fibers = marked;
+		for (memBlock& block : staticHeap.objects) {
+			if (block.block->moveTo == nullptr) continue;
+			block.block->trace(stack);
+			shadeStack();
+		}
+	}
+	finishing = false;
+	marking = false;
+}
+
+//traces everything that's left while finishing
+void GC::drainGrey() {
+	#ifdef PARALLEL_GC
+	if (parallel) {
+		if (greyArray != nullptr) traceGreyArray(SIZE_MAX);
+		parallelMark task(workers.count, grey, true);
+		grey.clear();
+		workers.run(&task);
+		return;
+	}
+	#endif
+	markSlice(SIZE_MAX);
+}
+#endif
+
+//with time to spare cycles start earlier than they would from allocating
+bool GC::step(double microseconds) {
+	#ifdef INCREMENTAL_GC
+	if (collecting || !nurseryActive()) return false;
+	auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::micro>(microseconds);
+	if (!marking && !clearing) {
+		if (shouldStartMarking(&normalHeap, MARK_START_RATIO / 2)) startMarking(&normalHeap);
+		else if (shouldStartMarking(&LOH, MARK_START_RATIO / 2)) startMarking(&LOH);
+		else return false;
+	}
+	while (clearing && !clearSlice(CLEAR_SLICE_BYTES)) {
+		if (std::chrono::steady_clock::now() >= end) return false;
+	}
+	while (!markSlice(MARK_SLICE_WORK)) {
+		if (std::chrono::steady_clock::now() >= end) return false;
+	}
+	//finishing is left to allocRaw if the last collection says it won't fit in the time that's left
+	size_t used = (normalHeap.heapTop - normalHeap.heapBuffer) + (LOH.heapTop - LOH.heapBuffer);
+	if (used * collectMicrosPerByte > std::chrono::duration<double, std::micro>(end - std::chrono::steady_clock::now()).count()) return false;
+	activeHeap = markingHeap;
+	inactiveHeap = markingHeap == &LOH ? &normalHeap : &LOH;
+	collect();
+	return true;
+	#else
+	return false;
+	#endif
+}
+#pragma endregion
+
+#pragma region Parallel
+#ifdef PARALLEL_GC
+//waking the workers up costs more than a small heap takes to collect
+bool GC::shouldCollectInParallel() {
+	size_t used = (normalHeap.heapTop - normalHeap.heapBuffer) + (LOH.heapTop - LOH.heapBuffer);
+	return workers.count > 1 && used >= PARALLEL_GC_MIN_BYTES;
+}
+
+//the chunks of the heap that's being compacted are already known
+void GC::updateInParallel(movingHeapBlock* heap) {
+	heapChunks& chunks = heap == activeHeap ? activeChunks : otherChunks;
+	if (heap != activeHeap) chunks.find(heap);
+	parallelHeapWalk task(heap, chunks, heapWalkPhase::UPDATE_PTRS);
+	workers.run(&task);
+}
+#endif
+
+void GC::setThreads(uInt count) {
+	#ifdef PARALLEL_GC
+	workers.count = std::max(count, 1u);
+	#endif
+}
+#pragma endregion
+
+#ifdef DEBUG_GC_PAUSES
+void GC::addPause(std::vector<double>& pauses, std::chrono::steady_clock::time_point start) {
+	pauses.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+}
+
+void GC::printPauses(const char* name, std::vector<double>& pauses) {
+	std::cout << name << " collections: " << pauses.size();
+	if (pauses.empty()) {
+		std::cout << "\n";
+		return;
+	}
+	std::sort(pauses.begin(), pauses.end());
+	double total = 0;
+	for (double pause : pauses) total += pause;
+	std::cout << ", total " << total / 1000 << "ms, median " << pauses[pauses.size() / 2] << "us, 99th percentile "
+		<< pauses[(pauses.size() * 99) / 100] << "us, max " << pauses.back() << "us\n";
+}
+#endif
@@ -2,14 +2,49 @@
 
 #include "common.h"
 #include "heapBlock.h"
+#include "parallelGC.h"
+#include "value.h"
+#ifdef DEBUG_GC_PAUSES
+#include <chrono>
+#endif
 
 //handpicked values, need adjusting
-#define HEAP_START_SIZE (1024)//Starting size of both heaps are 512KB(1MB in total)
+#define HEAP_START_SIZE (1024*512)//Starting size of both heaps are 512KB(1MB in total)
+//objects this big or bigger skip the nursery(which is HEAP_START_SIZE big) and are allocated on the normal heap
+#define NURSERY_OBJECT_MAX (1024*16)
+//incremental marking starts once this much of the space the normal heap or the LOH had free after it was last compacted is used up
+#define MARK_START_RATIO 0.5
+//bytes allocated between 2 slices of incremental marking, and how many objects and pointers a slice goes through
+#define MARK_SLICE_BYTES (1024*32)
+#define MARK_SLICE_WORK 4096
+//bytes of the normal heap and the LOH that a slice clears the marks of before marking starts
+#define CLEAR_SLICE_BYTES (1024*256)
+//full collections only use more than one thread once the normal heap and the LOH have this much on them,
+//which are walked in chunks of HEAP_CHUNK_SIZE, a worker shares half of it's mark stack once it's MARK_SHARE_SIZE big
+#define PARALLEL_GC_MIN_BYTES (1024*1024)
+#define HEAP_CHUNK_SIZE (1024*64)
+#define MARK_SHARE_SIZE 64
+
+//every store of a pointer into a object that's already on the heap needs to go through this(see GC::writeBarrier)
+#ifdef GENERATIONAL_GC
+#define WRITE_BARRIER(owner, val) global::gc.writeBarrier(owner, val)
+//stores into arrays only remember the indices that were written, so minor collections don't go through the whole array
+#define ARRAY_WRITE_BARRIER(arr, start, end, val) global::gc.writeBarrier(arr, start, end, val)
+//elements from 'start' on moved to a different index(insert/delete)
+#define ARRAY_SHIFT_BARRIER(arr, start) global::gc.shiftBarrier(arr, start)
+#else
+#define WRITE_BARRIER(owner, val) ((void)0)
+#define ARRAY_WRITE_BARRIER(arr, start, end, val) ((void)0)
+#define ARRAY_SHIFT_BARRIER(arr, start) ((void)0)
+#endif
 
 
 class vm;
 class compiler;
+class bytecodeImage;
 class ASTNode;
+class obj;
+class objArray;
 
 //Lisp 2 style mark-compact GC,
 //utilizes 2 heaps, one for small objects(defined in  object.h) and one(LOH) for (potentially)larger objects such as strings and arrays
@@ -20,11 +55,27 @@ class ASTNode;
 //It also uses a single static heap for fibers, as moving them in memory would be very hard
 //Possible change(Andrea): save yourself the trouble and go with a in-place GC(something akin to a Boehm-Demers-Weiser collector) for the small objs
 //and then use a mark compact for arrays and strings
+//
+//With GENERATIONAL_GC objects that would go on the normal heap are bump allocated in a nursery once the program runs, when it fills up
+//a minor collection copies the objects in it that are still reachable to the top of the normal heap and empties it
+//A minor collection only traces young objects, so every old object that might point into the nursery has to be in the remembered set,
+//which is what the write barrier is for, the roots and fibers are always traced in full
+//Objects outside of the nursery stay marked between collections so pointers to them can be updated without tracing them,
+//full collections clear the marks before marking and the nursery's marks afterwards
+//
+//With INCREMENTAL_GC marking is spread out in slices(tri-color, marked objects on the grey stack haven't been traced yet),
+//a cycle clears the marks and then greys the roots and traces, both a slice every MARK_SLICE_BYTES of allocations or when the program calls gcStep()
+//The write barrier greys old objects that get stored while marking, young objects are left to minor collections,
+//which grey the old objects they reach, everything that survives one is black(see GC::markYoung)
+//Once the grey stack is empty the cycle waits until a heap fills up(or step() has enough time) and finishes the collection in a single pause:
+//the roots, fibers, remembered objects and everything that was allocated outside of the nursery are traced again,
+//and then the heap is compacted like before
 class GC {
 public:
 	GC();
 	vm* VM;
 	compiler* compilerSession;
+	bytecodeImage* imageSession;
 	void* allocRaw(size_t size, bool shouldLOHAlloc);
 	void* allocRawStatic(size_t size);
 	void clear();
@@ -32,6 +83,36 @@ public:
 	void addASTNode(ASTNode* _node) { ast.push_back(_node); }
 	void clearASTNodes();
 	managed* getCachedPtr();
+	#ifdef GENERATIONAL_GC
+	//'ptr' was stored into 'owner', remembers owner if it's old and ptr is young
+	void writeBarrier(obj* owner, void* ptr) {
+		if (nursery.contains(ptr)) {
+			if (!nursery.contains(owner)) remember(owner);
+		}
+		#ifdef INCREMENTAL_GC
+		else if (marking) shade(ptr);
+		#endif
+	}
+	void writeBarrier(obj* owner, Value val) {
+		if (IS_OBJ(val)) writeBarrier(owner, AS_OBJ(val));
+	}
+	//'val' was stored somewhere in [start, end) of 'arr'
+	void writeBarrier(objArray* arr, uInt64 start, uInt64 end, Value val) {
+		if (!IS_OBJ(val)) return;
+		if (nursery.contains(AS_OBJ(val))) {
+			if (!nursery.contains(arr)) rememberRange(arr, start, end);
+		}
+		#ifdef INCREMENTAL_GC
+		else if (marking) shade(AS_OBJ(val));
+		#endif
+	}
+	void shiftBarrier(objArray* arr, uInt64 start);
+	#endif
+	//spends at most 'microseconds' on incremental marking and finishes the collection if there's nothing left to mark and compacting
+	//should fit in the time that's left, returns true if it did, does nothing without INCREMENTAL_GC
+	bool step(double microseconds);
+	//does nothing without PARALLEL_GC
+	void setThreads(uInt count);
 private:
 	//LOH is used for arrays/strings, normal heap is used for obj* objects
 	movingHeapBlock normalHeap;
@@ -39,6 +120,42 @@ private:
 	movingHeapBlock* activeHeap;
 	movingHeapBlock* inactiveHeap;
 	staticHeapBlock staticHeap;
+	#ifdef GENERATIONAL_GC
+	movingHeapBlock nursery;
+	//old objects that had a pointer to a young object stored into them since the last minor collection
+	std::vector<obj*> remembered;
+	#endif
+	#ifdef INCREMENTAL_GC
+	bool marking;
+	//marks are cleared in slices before marking starts, old objects that minor collections mark in the meantime are in 'whitened'
+	bool clearing;
+	movingHeapBlock* clearingHeap;
+	byte* clearCursor;
+	std::vector<managed*> whitened;
+	//set during the pause that finishes marking, young objects are only marked then
+	bool finishing;
+	//marked objects that still need to be traced
+	std::vector<managed*> grey;
+	//big arrays would make for one long slice, so they're traced a slice at a time, this is the one that's partway through
+	objArray* greyArray;
+	uInt64 greyArrayIndex;
+	//objects allocated outside of the nursery while marking, they're black but their constructors don't go through the write barrier
+	std::vector<managed*> allocatedBlack;
+	//heap that was filling up when marking started, it's the one that gets compacted
+	movingHeapBlock* markingHeap;
+	size_t sliceBytes;
+	//how long the last collection took for every byte used on the normal heap and the LOH
+	double collectMicrosPerByte;
+	#endif
+
+	#ifdef PARALLEL_GC
+	gcWorkers workers;
+	//set for a collection that's big enough to be split between the workers
+	bool parallel;
+	//chunks of the heap that's being compacted, found when computing the addresses
+	heapChunks activeChunks;
+	heapChunks otherChunks;
+	#endif
 
 	bool collecting;
 	//used to prevent deep recursion
@@ -54,7 +171,16 @@ private:
 	#ifdef DEBUG_GC
 	size_t nCollections;
 	size_t nReallocations;
+	size_t nMinorCollections;
 	#endif // DEBUG_GC
+	#ifdef DEBUG_GC_PAUSES
+	//in microseconds
+	std::vector<double> minorPauses;
+	std::vector<double> majorPauses;
+	std::vector<double> slicePauses;
+	void addPause(std::vector<double>& pauses, std::chrono::steady_clock::time_point start);
+	void printPauses(const char* name, std::vector<double>& pauses);
+	#endif
 
 	void resize(size_t size);
 	void collect();
@@ -74,4 +200,34 @@ private:
 	void updateHeapPtrs();
 
 	void compact();
+
+	#ifdef GENERATIONAL_GC
+	bool nurseryActive();
+	void remember(obj* owner);
+	void rememberRange(objArray* arr, uInt64 start, uInt64 end);
+	void minorCollect();
+	void markYoung();
+	void updateYoungPtrs();
+	void updateRemembered();
+	void clearFlags();
+	#endif
+
+	#ifdef INCREMENTAL_GC
+	bool shouldStartMarking(movingHeapBlock* heap, double ratio);
+	void startMarking(movingHeapBlock* heap);
+	bool clearSlice(size_t bytes);
+	void beginMarking();
+	void shade(void* ptr);
+	void shadeStack();
+	bool markSlice(size_t work);
+	size_t traceGreyArray(size_t work);
+	void markStep();
+	void finishMarking();
+	void drainGrey();
+	#endif
+
+	#ifdef PARALLEL_GC
+	bool shouldCollectInParallel();
+	void updateInParallel(movingHeapBlock* heap);
+	#endif
 };
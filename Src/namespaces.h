@@ -2,6 +2,8 @@
 #include "hashTable.h"
 #include "memory.h"
 #include "object.h"
+#include "jit.h"
+#include "trace.h"
 #include <random>
 #include <chrono>
 
@@ -11,4 +13,16 @@ namespace global {
 	extern hashTable internedStrings;
 	extern GC gc;
 	extern std::mt19937 rng; // Random number generator, used by the native functions for generating random numbers
+	#if defined(BASELINE_JIT) || defined(TRACING_JIT)
+	extern jitArena codeArena;
+	#endif
+	#ifdef BASELINE_JIT
+	extern baselineJit jit;
+	#endif
+	#ifdef TRACING_JIT
+	extern traceJit tracer;
+	#endif
+	#ifdef PROFILE_SEQUENCES
+	extern sequenceProfiler profiler;
+	#endif
 };
\ No newline at end of file
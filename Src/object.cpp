@@ -43,6 +43,8 @@ string objectToStr(Value object) {
 	}
 	case OBJ_FIBER: 
 		return "<fiber>";
+	case OBJ_SHAPE:
+		return "<shape>";
 	}
 }
 
@@ -132,7 +134,7 @@ void markObj(std::vector<managed*>& stack, obj* ptr) {
 }
 
 void markVal(std::vector<managed*>& stack, Value& val) {
-	if (val.type == VAL_OBJ) markObj(stack, AS_OBJ(val));
+	if (IS_OBJ(val)) markObj(stack, AS_OBJ(val));
 }
 
 void markTable(std::vector<managed*>& stack, hashTable& table) {
@@ -175,6 +177,13 @@ void objString::move(byte* to) {
 objFunc::objFunc() {
 	arity = 0;
 	upvalueCount = 0;
+	#ifdef BASELINE_JIT
+	hotness = 0;
+	native = nullptr;
+	#endif
+	#ifdef AOT_BUILD
+	aot = nullptr;
+	#endif
 	type = OBJ_FUNC;
 	moveTo = nullptr;
 	name = nullptr;
@@ -195,6 +204,14 @@ void objFunc::trace(std::vector<managed*>& stack) {
 	for (int i = 0; i < body.switchTables.size(); i++) {
 		body.switchTables[i].arr.mark();
 	}
+	//inline caches keep the shapes and methods they've seen alive, otherwise a new shape could end up at the address of a dead one
+	for (inlineCache& cache : body.caches) {
+		for (uInt i = 0; i < cache.count; i++) {
+			markObj(stack, (obj*)cache.entries[i].shape);
+			markObj(stack, (obj*)cache.entries[i].next);
+			markObj(stack, (obj*)cache.entries[i].method);
+		}
+	}
 }
 
 void objFunc::updatePtrs() {
@@ -208,6 +225,14 @@ void objFunc::updatePtrs() {
 	for (int i = 0; i < body.switchTables.size(); i++) {
 		body.switchTables[i].arr.update();
 	}
+	for (inlineCache& cache : body.caches) {
+		for (uInt i = 0; i < cache.count; i++) {
+			cacheEntry& entry = cache.entries[i];
+			entry.shape = (objShape*)entry.shape->moveTo;
+			if (entry.next != nullptr) entry.next = (objShape*)entry.next->moveTo;
+			if (entry.method != nullptr) entry.method = (objClosure*)entry.method->moveTo;
+		}
+	}
 }
 #pragma endregion
 
@@ -265,6 +290,9 @@ objUpval::objUpval(Value* slot) {
 
 void objUpval::move(byte* to) {
 	memmove(to, this, sizeof(objUpval));
+	//a closed upvalue points to it's own 'closed' field
+	objUpval* moved = reinterpret_cast<objUpval*>(to);
+	if (!moved->isOpen) moved->location = &moved->closed;
 }
 
 void objUpval::trace(std::vector<managed*>& stack) {
@@ -282,6 +310,10 @@ objArray::objArray() {
 	moveTo = nullptr;
 	numOfHeapPtr = 0;
 	values = gcVector<Value>();
+	#ifdef GENERATIONAL_GC
+	dirtyStart = 0;
+	dirtyEnd = 0;
+	#endif
 }
 
 objArray::objArray(size_t size) {
@@ -289,6 +321,10 @@ objArray::objArray(size_t size) {
 	type = OBJ_ARRAY;
 	moveTo = nullptr;
 	numOfHeapPtr = 0;
+	#ifdef GENERATIONAL_GC
+	dirtyStart = 0;
+	dirtyEnd = 0;
+	#endif
 }
 
 void objArray::move(byte* to) {
@@ -312,11 +348,32 @@ void objArray::updatePtrs() {
 	}
 	values.update();
 }
+
+#ifdef GENERATIONAL_GC
+void objArray::traceDirty(std::vector<managed*>& stack) {
+	if (numOfHeapPtr == 0) return;
+	uInt64 end = std::min(dirtyEnd, (uInt64)values.count());
+	for (uInt64 i = dirtyStart; i < end; i++) {
+		markVal(stack, values[i]);
+	}
+}
+
+void objArray::updateDirty() {
+	if (numOfHeapPtr == 0) return;
+	uInt64 end = std::min(dirtyEnd, (uInt64)values.count());
+	for (uInt64 i = dirtyStart; i < end; i++) {
+		updateVal(&values[i]);
+	}
+}
+#endif
 #pragma endregion
 
 #pragma region objClass
 objClass::objClass(objString* _name) {
 	name = _name;
+	shape = nullptr;
+	expectedFields = 0;
+	for (int i = 0; i < METAMETHOD_COUNT; i++) metamethods[i] = nullptr;
 	type = OBJ_CLASS;
 	moveTo = nullptr;
 }
@@ -328,33 +385,168 @@ void objClass::move(byte* to) {
 void objClass::trace(std::vector<managed*>& stack) {
 	name->moveTo = name;
 	markTable(stack, methods);
+	markObj(stack, shape);
+	for (int i = 0; i < METAMETHOD_COUNT; i++) markObj(stack, metamethods[i]);
 }
 
 void objClass::updatePtrs() {
 	name = (objString*)name->moveTo;
+	if (shape != nullptr) shape = (objShape*)shape->moveTo;
+	for (int i = 0; i < METAMETHOD_COUNT; i++) {
+		if (metamethods[i] != nullptr) metamethods[i] = (objClosure*)metamethods[i]->moveTo;
+	}
 	updateTable(&methods);
 }
 #pragma endregion
 
+#pragma region objShape
+objShape::objShape(uInt _fieldCount) {
+	fieldCount = _fieldCount;
+	type = OBJ_SHAPE;
+	moveTo = nullptr;
+}
+
+bool objShape::lookup(objString* name, uInt* slot) {
+	Value index;
+	if (!slots.get(name, &index)) return false;
+	*slot = (uInt)AS_NUMBER(index);
+	return true;
+}
+
+void objShape::move(byte* to) {
+	memmove(to, this, sizeof(objShape));
+}
+
+void objShape::trace(std::vector<managed*>& stack) {
+	markTable(stack, slots);
+	markTable(stack, transitions);
+}
+
+void objShape::updatePtrs() {
+	updateTable(&slots);
+	updateTable(&transitions);
+}
+
+//returns the shape we get by adding 'name' to 'shape', or nullptr if the instance should go into dictionary mode instead
+//can allocate a new shape on the normal heap, in which case both 'shape' and 'name' might move
+objShape* shapeTransition(objShape* shape, objString* name) {
+	Value next;
+	if (shape->transitions.get(name, &next)) return AS_SHAPE(next);
+	if (shape->fieldCount >= SHAPE_MAX_FIELDS) return nullptr;
+	//root shapes are exempt since every struct literal starts from the same one
+	if (shape->fieldCount > 0 && shape->transitions.count >= SHAPE_MAX_TRANSITIONS) return nullptr;
+
+	uInt fieldCount = shape->fieldCount + 1;
+	gc.cachePtr(shape);
+	gc.cachePtr(name);
+	objShape* child = new objShape(fieldCount);
+	name = dynamic_cast<objString*>(gc.getCachedPtr());
+	shape = dynamic_cast<objShape*>(gc.getCachedPtr());
+	//link the child first so that it's reachable while it's tables are being allocated on the LOH
+	shape->transitions.set(name, OBJ_VAL(child));
+	WRITE_BARRIER(shape, name);
+	WRITE_BARRIER(shape, child);
+	child->slots.tableAddAll(&shape->slots);
+	child->slots.set(name, NUMBER_VAL(fieldCount - 1));
+	return child;
+}
+#pragma endregion
+
 #pragma region objInstance
-objInstance::objInstance(objClass* _klass) {
+objInstance::objInstance(objClass* _klass, objShape* _shape, uInt _inlineCapacity) {
 	klass = _klass;
+	shape = _shape;
+	inlineCapacity = _inlineCapacity;
 	moveTo = nullptr;
 	type = OBJ_INSTANCE;
+	overflow = gcVector<Value>();
 	table = hashTable();
+	for (uInt i = 0; i < inlineCapacity; i++) *slot(i) = NIL_VAL();
+}
+
+void* objInstance::operator new(size_t size, size_t inlineSlots) {
+	return gc.allocRaw(size + inlineSlots * sizeof(Value), false);
+}
+
+bool objInstance::getField(objString* name, Value* val) {
+	if (shape == nullptr) return table.get(name, val);
+	uInt index;
+	if (!shape->lookup(name, &index)) return false;
+	*val = *slot(index);
+	return true;
+}
+
+//copies every field into table, only allocates on the LOH so the instance itself doesn't move
+void objInstance::toDictionary() {
+	for (int i = 0; i < shape->slots.capacity; i++) {
+		entry _entry = shape->slots.entries[i];
+		if (_entry.key == nullptr || _entry.key == TOMBSTONE) continue;
+		table.set(_entry.key, *slot((uInt)AS_NUMBER(_entry.val)));
+		WRITE_BARRIER(this, _entry.key);
+	}
+	for (uInt i = 0; i < inlineCapacity; i++) *slot(i) = NIL_VAL();
+	overflow.clear();
+	shape = nullptr;
+}
+
+//'inst' and 'val' need to be reachable by the GC(on the stack), since adding a field can allocate
+void setField(objInstance* inst, objString* name, Value val) {
+	uInt index;
+	if (inst->shape == nullptr) {
+		inst->table.set(name, val);
+		WRITE_BARRIER(inst, name);
+		WRITE_BARRIER(inst, val);
+		return;
+	}
+	if (inst->shape->lookup(name, &index)) {
+		*inst->slot(index) = val;
+		WRITE_BARRIER(inst, val);
+		return;
+	}
+
+	gc.cachePtr(inst);
+	if (IS_OBJ(val)) gc.cachePtr(AS_OBJ(val));
+	objShape* next = shapeTransition(inst->shape, name);
+	if (IS_OBJ(val)) val = OBJ_VAL(dynamic_cast<obj*>(gc.getCachedPtr()));
+	inst = dynamic_cast<objInstance*>(gc.getCachedPtr());
+	//shapeTransition doesn't allocate when it fails, so 'name' is still valid here
+	if (next == nullptr) {
+		inst->toDictionary();
+		inst->table.set(name, val);
+		WRITE_BARRIER(inst, name);
+		WRITE_BARRIER(inst, val);
+		return;
+	}
+
+	index = next->fieldCount - 1;
+	if (index < inst->inlineCapacity) *inst->slot(index) = val;
+	else inst->overflow.push(val);
+	inst->shape = next;
+	WRITE_BARRIER(inst, val);
+	WRITE_BARRIER(inst, next);
+	if (inst->klass != nullptr && next->fieldCount > inst->klass->expectedFields) inst->klass->expectedFields = next->fieldCount;
 }
 
 void objInstance::move(byte* to) {
-	memmove(to, this, sizeof(objInstance));
+	memmove(to, this, getSize());
 }
 
+//both the slots and the table are traced since a collection can happen while a instance is being turned into a dictionary
 void objInstance::trace(std::vector<managed*>& stack) {
+	if (shape != nullptr) markObj(stack, shape);
+	for (uInt i = 0; i < inlineCapacity; i++) markVal(stack, *slot(i));
+	for (uInt i = 0; i < overflow.count(); i++) markVal(stack, overflow[i]);
+	overflow.mark();
 	markTable(stack, table);
 	if (klass != nullptr) markObj(stack, klass);
 }
 
 void objInstance::updatePtrs() {
 	if (klass != nullptr) klass = (objClass*)klass->moveTo;
+	if (shape != nullptr) shape = (objShape*)shape->moveTo;
+	for (uInt i = 0; i < inlineCapacity; i++) updateVal(slot(i));
+	for (uInt i = 0; i < overflow.count(); i++) updateVal(&overflow[i]);
+	overflow.update();
 	updateTable(&table);
 }
 #pragma endregion
@@ -389,18 +581,49 @@ objModule::objModule(objString* _name) {
 	moveTo = nullptr;
 }
 
+uInt objModule::resolveSlot(objString* varName) {
+	Value slot;
+	if (vars.get(varName, &slot)) return AS_NUMBER(slot);
+	uInt index = globals.count();
+	//the name might not be reachable from anywhere else yet, both allocations only happen on the LOH so neither this nor the name move
+	gc.cachePtr(varName);
+	globals.push(globalVar());
+	vars.set(varName, NUMBER_VAL(index));
+	WRITE_BARRIER(this, varName);
+	gc.getCachedPtr();
+	return index;
+}
+
+void objModule::bindNatives(hashTable* natives) {
+	for (int i = 0; i < vars.capacity; i++) {
+		entry* _entry = &vars.entries[i];
+		if (!_entry->key || _entry->key == TOMBSTONE) continue;
+		globalVar& var = globals[AS_NUMBER(_entry->val)];
+		if (var.state == globalState::UNDEFINED && natives->get(_entry->key, &var.val)) var.state = globalState::NATIVE;
+	}
+}
+
+//only used for error messages
+objString* objModule::slotName(uInt slot) {
+	return vars.getKey(NUMBER_VAL(slot));
+}
+
 void objModule::move(byte* to) {
 	memmove(to, this, sizeof(objModule));
 }
 
 void objModule::updatePtrs() {
 	updateTable(&vars);
+	for (uInt i = 0; i < globals.count(); i++) updateVal(&globals[i].val);
+	globals.update();
 	name = reinterpret_cast<objString*>(name->moveTo);
 }
 
 void objModule::trace(std::vector<managed*>& stack) {
 	markObj(stack, name);
 	markTable(stack, vars);
+	for (uInt i = 0; i < globals.count(); i++) markVal(stack, globals[i].val);
+	globals.mark();
 }
 
 #pragma endregion
@@ -20,18 +20,28 @@ enum objType {
 	OBJ_BOUND_METHOD,
 	OBJ_FIBER,
 	OBJ_MODULE,
-	OBJ_FILE
+	OBJ_FILE,
+	OBJ_SHAPE
 };
 
 class objFiber;
+class objUpval;
+struct jitCode;
 
 //pointer to a native function
 typedef bool(*NativeFn)(objFiber* fiber, int argCount, Value* args);
+#ifdef AOT_BUILD
+//C++ translation of a function written by -aot(see aot.h), runs from ip and returns the offset the interpreter continues at
+typedef uInt(*aotFunction)(uInt ip, Value* slots, Value** stackTop, Value* constants, objUpval** upvals);
+#endif
 
 
 class obj : public managed{
 public:
 	objType type;
+	//set while the object is in the GC's remembered set
+	bool remembered;
+	obj() { remembered = false; }
 };
 
 //Headers
@@ -45,7 +55,7 @@ public:
 	bool compare(string& str);
 
 	void move(byte* to);
-	size_t getSize() { return sizeof(objString) + length + 1; }
+	size_t getSize() { return ALIGN_OBJ_SIZE(sizeof(objString) + length + 1); }
 	void updatePtrs();
 	void trace(std::vector<managed*>& stack) {};
 };
@@ -56,6 +66,11 @@ class objArray : public obj {
 public:
 	gcVector<Value> values;
 	uInt numOfHeapPtr;
+	#ifdef GENERATIONAL_GC
+	//indices that can hold young objects while the array is remembered(see GC::rememberRange)
+	uInt64 dirtyStart;
+	uInt64 dirtyEnd;
+	#endif
 	objArray();
 	objArray(size_t size);
 
@@ -63,6 +78,11 @@ public:
 	size_t getSize() { return sizeof(objArray); }
 	void updatePtrs();
 	void trace(std::vector<managed*>& stack);
+	#ifdef GENERATIONAL_GC
+	//minor collections only go through the dirty range, the backing store doesn't move during them
+	void traceDirty(std::vector<managed*>& stack);
+	void updateDirty();
+	#endif
 };
 
 class objFunc : public obj {
@@ -72,6 +92,14 @@ public:
 	objString* name;
 	int arity;
 	int upvalueCount;
+	#ifdef BASELINE_JIT
+	//calls and loop iterations so far, the function is compiled once this reaches JIT_THRESHOLD
+	uInt hotness;
+	jitCode* native;
+	#endif
+	#ifdef AOT_BUILD
+	aotFunction aot;
+	#endif
 	objFunc();
 
 	void move(byte* to);
@@ -120,10 +148,26 @@ public:
 	void trace(std::vector<managed*>& stack);
 };
 
+class objShape;
+
+//methods the VM calls implicitly, classes keep direct pointers to them so they never have to be looked up by name
+enum metamethodType {
+	METAMETHOD_ACCESS,
+	METAMETHOD_SET,
+	METAMETHOD_TO_STRING,
+	METAMETHOD_COUNT
+};
+
 class objClass : public obj {
 public:
 	objString* name;
 	hashTable methods;
+	//nullptr if the class(or it's superclass) doesn't define the method, filled in by OP_METHOD and OP_INHERIT
+	objClosure* metamethods[METAMETHOD_COUNT];
+	//root of the shape tree for instances of this class, created when the first instance is made
+	objShape* shape;
+	//largest number of fields any instance of this class has had, used to size the inline slots of new instances
+	uInt expectedFields;
 	objClass(objString* _name);
 
 	void move(byte* to);
@@ -144,27 +188,86 @@ public:
 	void trace(std::vector<managed*>& stack);
 };
 
+//past these limits instances stop using shapes and keep their fields in a hash table(dictionary mode)
+#define SHAPE_MAX_FIELDS 64
+#define SHAPE_MAX_TRANSITIONS 16
+
+//shapes(hidden classes) describe the layout of instances, every instance that got the same fields in the same order shares a shape
+//adding a new field moves the instance along a transition to the next shape in the tree, creating it if needed
+class objShape : public obj {
+public:
+	//number of slots an instance with this shape uses
+	uInt fieldCount;
+	//field name -> slot index
+	hashTable slots;
+	//field name -> shape that results from adding that field
+	hashTable transitions;
+	objShape(uInt _fieldCount);
+
+	bool lookup(objString* name, uInt* slot);
+
+	void move(byte* to);
+	size_t getSize() { return sizeof(objShape); }
+	void updatePtrs();
+	void trace(std::vector<managed*>& stack);
+};
+
 class objInstance : public obj {
 public:
 	objClass* klass;
+	//nullptr if the instance is in dictionary mode, in which case the fields are stored in table
+	objShape* shape;
+	//number of slots stored right after the object, fields that don't fit go into overflow
+	uInt inlineCapacity;
+	gcVector<Value> overflow;
 	hashTable table;
-	objInstance(objClass* _klass);
+	objInstance(objClass* _klass, objShape* _shape, uInt _inlineCapacity);
+
+	Value* slot(uInt index) {
+		if (index < inlineCapacity) return reinterpret_cast<Value*>(reinterpret_cast<byte*>(this) + sizeof(objInstance)) + index;
+		return &overflow[index - inlineCapacity];
+	}
+	bool getField(objString* name, Value* val);
+	void toDictionary();
 
 	void move(byte* to);
-	size_t getSize() { return sizeof(objInstance); }
+	size_t getSize() { return sizeof(objInstance) + inlineCapacity * sizeof(Value); }
 	void updatePtrs();
 	void trace(std::vector<managed*>& stack);
+
+	void* operator new(size_t size, size_t inlineSlots);
 };
 
 class objFiber;
 
+enum class globalState : uint8_t {
+	UNDEFINED,
+	//holds a native function, readable but not assignable until the module defines a variable with the same name
+	NATIVE,
+	DEFINED
+};
+
+struct globalVar {
+	Value val;
+	globalState state;
+	globalVar() : val(NIL_VAL()), state(globalState::UNDEFINED) {};
+};
+
 class objModule : public obj {
 public:
+	//name -> index into globals, the compiler gives every global name used inside the module a slot
 	hashTable vars;
+	gcVector<globalVar> globals;
 	objString* name;
 
 	objModule(objString* _name);
 
+	//returns the slot of the variable, adding a new one if needed, only ever allocates on the LOH
+	uInt resolveSlot(objString* varName);
+	//pre binds the natives to slots of the same name, done once compilation is finished
+	void bindNatives(hashTable* natives);
+	objString* slotName(uInt slot);
+
 	void move(byte* to);
 	size_t getSize() { return sizeof(objModule); }
 	void updatePtrs();
@@ -208,6 +311,7 @@ static inline bool isObjType(Value value, objType type) {
 #define	IS_FIBER(value)		   isObjType(value, OBJ_FIBER)
 #define IS_MODULE(value)	   isObjType(value, OBJ_MODULE)
 #define IS_FILE(value)		   isObjType(value, OBJ_FILE)
+#define IS_SHAPE(value)		   isObjType(value, OBJ_SHAPE)
 
 #define AS_STRING(value)       ((objString*)(AS_OBJ(value)))
 #define AS_CSTRING(value)      (((objString*)AS_OBJ(value))->str)//gets raw string
@@ -221,6 +325,7 @@ static inline bool isObjType(Value value, objType type) {
 #define AS_FIBER(value)		   ((objFiber*)AS_OBJ(value))
 #define AS_MODULE(value)	   ((objModule*)AS_OBJ(value))
 #define AS_FILE(value)		   ((objFile*)AS_OBJ(value))
+#define AS_SHAPE(value)		   ((objShape*)AS_OBJ(value))
 
 objString* copyString(char* str, uInt length);
 objString* copyString(const char* str, uInt length);
@@ -229,6 +334,9 @@ objString* takeString(char* str, uInt length);
 
 string objectToStr(Value object);
 
+objShape* shapeTransition(objShape* shape, objString* name);
+void setField(objInstance* inst, objString* name, Value val);
+
 void setMarked(obj* ptr);
 void markObj(std::vector<managed*>& stack, obj* ptr);
 void markVal(std::vector<managed*>& stack, Value& val);
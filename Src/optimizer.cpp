@@ -0,0 +1,426 @@
+#include "optimizer.h"
+#include "value.h"
+#include <cmath>
+
+void ASTOptimizer::optimize(vector<ASTNode*>& stmts) {
+	foldAll(stmts);
+}
+
+#pragma region Helpers
+//visiting the children of a node overwrites 'result', so it's reset after every node
+ASTNode* ASTOptimizer::fold(ASTNode* node) {
+	if (node == nullptr) return nullptr;
+	result = nullptr;
+	node->accept(this);
+	ASTNode* folded = result == nullptr ? node : result;
+	result = nullptr;
+	return folded;
+}
+
+void ASTOptimizer::foldAll(vector<ASTNode*>& nodes) {
+	for (int i = 0; i < nodes.size(); i++) nodes[i] = fold(nodes[i]);
+}
+
+static foldedConst intConst(long long num) {
+	foldedConst val;
+	val.type = foldedConst::kind::INT;
+	val.integer = num;
+	return val;
+}
+
+static foldedConst doubleConst(double num) {
+	foldedConst val;
+	val.type = foldedConst::kind::DOUBLE;
+	val.number = num;
+	return val;
+}
+
+static foldedConst boolConst(bool b) {
+	foldedConst val;
+	val.type = foldedConst::kind::BOOL;
+	val.boolean = b;
+	return val;
+}
+
+//same as INT_OR_NUMBER_VAL, results that don't fit into 32 bits become doubles
+static foldedConst intOrNumber(long long num) {
+	if (num < INT32_MIN || num > INT32_MAX) return doubleConst((double)num);
+	return intConst(num);
+}
+
+//reads the value of a literal the same way compiler::visitLiteralExpr does
+bool ASTOptimizer::getConst(ASTNode* node, foldedConst& val) {
+	if (node->type != ASTType::LITERAL) return false;
+	Token token = ((ASTLiteralExpr*)node)->getToken();
+	switch (token.type) {
+	case TOKEN_NUMBER: {
+		string lexeme = token.getLexeme();
+		if (lexeme.find('.') == string::npos && lexeme.size() <= 11) {
+			long long num = std::stoll(lexeme);
+			if (num >= INT32_MIN && num <= INT32_MAX) {
+				val = intConst(num);
+				return true;
+			}
+		}
+		val = doubleConst(std::stod(lexeme));
+		return true;
+	}
+	case TOKEN_TRUE: val = boolConst(true); return true;
+	case TOKEN_FALSE: val = boolConst(false); return true;
+	case TOKEN_NIL: val = foldedConst(); return true;
+	case TOKEN_STRING: {
+		string lexeme = token.getLexeme();
+		val.type = foldedConst::kind::STRING;
+		val.str = lexeme.substr(1, lexeme.size() - 2);
+		return true;
+	}
+	default: return false;
+	}
+}
+
+//the new literal reuses the token of the expression it replaces(line, span and macro info), only the lexeme is synthetic
+ASTNode* ASTOptimizer::makeLiteral(foldedConst& val, Token source) {
+	Token token = source;
+	string lexeme;
+	switch (val.type) {
+	case foldedConst::kind::NIL: token.type = TOKEN_NIL; lexeme = "nil"; break;
+	case foldedConst::kind::BOOL:
+		token.type = val.boolean ? TOKEN_TRUE : TOKEN_FALSE;
+		lexeme = val.boolean ? "true" : "false";
+		break;
+	case foldedConst::kind::INT: token.type = TOKEN_NUMBER; lexeme = std::to_string(val.integer); break;
+	case foldedConst::kind::DOUBLE: {
+		token.type = TOKEN_NUMBER;
+		//17 significant digits round trip exactly, the '.' is what tells the compiler this is a double
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%.17g", val.number);
+		lexeme = buffer;
+		size_t exponent = lexeme.find('e');
+		if (lexeme.find('.') == string::npos) lexeme.insert(exponent == string::npos ? lexeme.size() : exponent, ".0");
+		break;
+	}
+	case foldedConst::kind::STRING: token.type = TOKEN_STRING; lexeme = "\"" + val.str + "\""; break;
+	}
+	lexemes.push_back(lexeme);
+	token.isSynthetic = true;
+	token.ptr = lexemes.back().c_str();
+	return new ASTLiteralExpr(token);
+}
+
+ASTNode* ASTOptimizer::emptyStmt() {
+	vector<ASTNode*> stmts;
+	return new ASTBlockStmt(stmts);
+}
+#pragma endregion
+
+#pragma region Folding
+//mirrors the handlers in objFiber::execute, returns false if the VM would throw(or the result isn't finite)
+bool ASTOptimizer::foldBinary(TokenType op, foldedConst& a, foldedConst& b, foldedConst& res) {
+	bool ints = a.type == foldedConst::kind::INT && b.type == foldedConst::kind::INT;
+	bool numbers = a.isNumber() && b.isNumber();
+	switch (op) {
+	case TOKEN_PLUS:
+		if (ints) res = intOrNumber(a.integer + b.integer);
+		else if (numbers) res = doubleConst(a.asNumber() + b.asNumber());
+		else if (a.type == foldedConst::kind::STRING && b.type == foldedConst::kind::STRING) {
+			res.type = foldedConst::kind::STRING;
+			res.str = a.str + b.str;
+		}
+		else return false;
+		break;
+	case TOKEN_MINUS:
+		if (ints) res = intOrNumber(a.integer - b.integer);
+		else if (numbers) res = doubleConst(a.asNumber() - b.asNumber());
+		else return false;
+		break;
+	case TOKEN_STAR:
+		if (ints) res = intOrNumber(a.integer * b.integer);
+		else if (numbers) res = doubleConst(a.asNumber() * b.asNumber());
+		else return false;
+		break;
+	//division always produces a double
+	case TOKEN_SLASH:
+		if (!numbers) return false;
+		res = doubleConst(a.asNumber() / b.asNumber());
+		break;
+	//integer ops on doubles go through a uInt64 cast in the VM, so only pairs of ints are folded
+	case TOKEN_PERCENTAGE:
+		if (!ints || b.integer == 0) return false;
+		res = intOrNumber(a.integer % b.integer);
+		break;
+	case TOKEN_BITSHIFT_LEFT:
+	case TOKEN_BITSHIFT_RIGHT:
+		if (!ints || a.integer < 0 || b.integer < 0 || b.integer >= 32) return false;
+		res = intOrNumber(op == TOKEN_BITSHIFT_LEFT ? a.integer << b.integer : a.integer >> b.integer);
+		break;
+	case TOKEN_BITWISE_AND:
+		if (!ints) return false;
+		res = intOrNumber(a.integer & b.integer);
+		break;
+	case TOKEN_BITWISE_OR:
+		if (!ints) return false;
+		res = intOrNumber(a.integer | b.integer);
+		break;
+	case TOKEN_BITWISE_XOR:
+		if (!ints) return false;
+		res = intOrNumber(a.integer ^ b.integer);
+		break;
+	case TOKEN_GREATER:
+		if (!numbers) return false;
+		res = boolConst(a.asNumber() > b.asNumber());
+		break;
+	case TOKEN_LESS:
+		if (!numbers) return false;
+		res = boolConst(a.asNumber() < b.asNumber());
+		break;
+	//doubles use FLOAT_EQ for the equal part, same as the VM
+	case TOKEN_GREATER_EQUAL:
+		if (!numbers) return false;
+		res = boolConst(ints ? a.integer >= b.integer : (a.asNumber() > b.asNumber() || FLOAT_EQ(a.asNumber(), b.asNumber())));
+		break;
+	case TOKEN_LESS_EQUAL:
+		if (!numbers) return false;
+		res = boolConst(ints ? a.integer <= b.integer : (a.asNumber() < b.asNumber() || FLOAT_EQ(a.asNumber(), b.asNumber())));
+		break;
+	//same rules as valuesEqual(), nil isn't equal to anything
+	case TOKEN_EQUAL_EQUAL:
+	case TOKEN_BANG_EQUAL: {
+		bool equal = false;
+		if (ints) equal = a.integer == b.integer;
+		else if (numbers) equal = FLOAT_EQ(a.asNumber(), b.asNumber());
+		else if (a.type == foldedConst::kind::BOOL && b.type == foldedConst::kind::BOOL) equal = a.boolean == b.boolean;
+		else if (a.type == foldedConst::kind::STRING && b.type == foldedConst::kind::STRING) equal = a.str == b.str;
+		res = boolConst(op == TOKEN_EQUAL_EQUAL ? equal : !equal);
+		break;
+	}
+	default: return false;
+	}
+	return isFoldable(res);
+}
+
+//inf and nan can't be written as literals, and the constant table merges doubles that are FLOAT_EQ
+//so a folded zero(or anything within DBL_EPSILON of it) could be swapped for a different constant in the same chunk
+bool ASTOptimizer::isFoldable(foldedConst& res) {
+	return res.type != foldedConst::kind::DOUBLE || (std::isfinite(res.number) && std::fabs(res.number) > DBL_EPSILON);
+}
+
+bool ASTOptimizer::foldUnary(TokenType op, foldedConst& a, foldedConst& res) {
+	switch (op) {
+	case TOKEN_MINUS:
+		if (a.type == foldedConst::kind::INT && a.integer != 0) res = intOrNumber(-a.integer);
+		else if (a.isNumber()) res = doubleConst(-a.asNumber());
+		else return false;
+		return isFoldable(res);
+	case TOKEN_BANG:
+		res = boolConst(a.isFalsey());
+		return true;
+	case TOKEN_TILDA:
+		if (a.type != foldedConst::kind::INT) return false;
+		res = intConst(~(int)a.integer);
+		return true;
+	default: return false;
+	}
+}
+
+//x / 2^n gives the exact same result as x * 2^-n, as long as 2^-n isn't a subnormal
+//n is capped at 51 so that the constant table can't merge 2^-n with some other small constant(see isFoldable)
+bool ASTOptimizer::reciprocalOfPow2(foldedConst& val, double& res) {
+	if (!val.isNumber()) return false;
+	int exponent;
+	double mantissa = std::frexp(val.asNumber(), &exponent);
+	if (std::fabs(mantissa) != 0.5 || exponent - 1 > 51 || exponent - 1 < -1022) return false;
+	res = 1 / val.asNumber();
+	return true;
+}
+#pragma endregion
+
+#pragma region Expressions
+void ASTOptimizer::visitAssignmentExpr(ASTAssignmentExpr* expr) {
+	expr->value = fold(expr->value);
+}
+
+void ASTOptimizer::visitSetExpr(ASTSetExpr* expr) {
+	expr->callee = fold(expr->callee);
+	expr->field = fold(expr->field);
+	expr->value = fold(expr->value);
+}
+
+void ASTOptimizer::visitConditionalExpr(ASTConditionalExpr* expr) {
+	expr->condition = fold(expr->condition);
+	expr->thenBranch = fold(expr->thenBranch);
+	expr->elseBranch = fold(expr->elseBranch);
+	foldedConst cond;
+	if (getConst(expr->condition, cond)) result = cond.isFalsey() ? expr->elseBranch : expr->thenBranch;
+	else result = expr;
+}
+
+void ASTOptimizer::visitBinaryExpr(ASTBinaryExpr* expr) {
+	//right side of '::' is a name, not a value
+	if (expr->op.type == TOKEN_DOUBLE_COLON) return;
+	expr->left = fold(expr->left);
+	expr->right = fold(expr->right);
+	result = expr;
+
+	foldedConst a;
+	foldedConst b;
+	bool constLeft = getConst(expr->left, a);
+	bool constRight = getConst(expr->right, b);
+	//'and' and 'or' evaluate to one of the operands, so only the left side needs to be known
+	if (expr->op.type == TOKEN_AND || expr->op.type == TOKEN_OR) {
+		if (!constLeft) return;
+		bool pickLeft = expr->op.type == TOKEN_AND ? a.isFalsey() : !a.isFalsey();
+		result = pickLeft ? expr->left : expr->right;
+		return;
+	}
+	foldedConst res;
+	if (constLeft && constRight && foldBinary(expr->op.type, a, b, res)) {
+		result = makeLiteral(res, expr->op);
+		return;
+	}
+	//strength reduction, multiplication is a lot cheaper than division
+	double reciprocal;
+	if (expr->op.type == TOKEN_SLASH && constRight && reciprocalOfPow2(b, reciprocal)) {
+		expr->op.type = TOKEN_STAR;
+		foldedConst factor = doubleConst(reciprocal);
+		expr->right = makeLiteral(factor, ((ASTLiteralExpr*)expr->right)->getToken());
+	}
+}
+
+void ASTOptimizer::visitUnaryExpr(ASTUnaryExpr* expr) {
+	expr->right = fold(expr->right);
+	result = expr;
+	foldedConst a;
+	foldedConst res;
+	if (getConst(expr->right, a) && foldUnary(expr->op.type, a, res)) result = makeLiteral(res, expr->op);
+}
+
+void ASTOptimizer::visitUnaryVarAlterExpr(ASTUnaryVarAlterExpr* expr) {
+	expr->incrementExpr = fold(expr->incrementExpr);
+}
+
+void ASTOptimizer::visitCallExpr(ASTCallExpr* expr) {
+	expr->callee = fold(expr->callee);
+	//argument of '.' is the field name
+	if (expr->accessor.type != TOKEN_DOT) foldAll(expr->args);
+}
+
+//groupings only matter for parsing, but the compiler still looks at them when deciding if a call is a invoke
+void ASTOptimizer::visitGroupingExpr(ASTGroupingExpr* expr) {
+	expr->expr = fold(expr->expr);
+	result = expr->expr->type == ASTType::LITERAL ? expr->expr : expr;
+}
+
+void ASTOptimizer::visitArrayDeclExpr(ASTArrayDeclExpr* expr) {
+	foldAll(expr->members);
+}
+
+void ASTOptimizer::visitStructLiteralExpr(ASTStructLiteral* expr) {
+	for (structEntry& entry : expr->fields) entry.expr = fold(entry.expr);
+}
+
+void ASTOptimizer::visitLiteralExpr(ASTLiteralExpr* expr) {}
+
+void ASTOptimizer::visitYieldExpr(ASTYieldExpr* expr) {
+	expr->expr = fold(expr->expr);
+}
+
+void ASTOptimizer::visitFiberRunExpr(ASTFiberRunExpr* expr) {
+	foldAll(expr->args);
+}
+
+void ASTOptimizer::visitFiberLiteralExpr(ASTFiberLiteral* expr) {
+	expr->body = fold(expr->body);
+}
+
+void ASTOptimizer::visitSuperExpr(ASTSuperExpr* expr) {}
+#pragma endregion
+
+#pragma region Statements
+void ASTOptimizer::visitVarDecl(ASTVarDecl* decl) {
+	decl->setExpr = fold(decl->setExpr);
+}
+
+void ASTOptimizer::visitFuncDecl(ASTFunc* decl) {
+	decl->body = fold(decl->body);
+}
+
+void ASTOptimizer::visitClassDecl(ASTClass* decl) {
+	foldAll(decl->methods);
+}
+
+void ASTOptimizer::visitPrintStmt(ASTPrintStmt* stmt) {
+	stmt->expr = fold(stmt->expr);
+}
+
+void ASTOptimizer::visitExprStmt(ASTExprStmt* stmt) {
+	stmt->expr = fold(stmt->expr);
+}
+
+void ASTOptimizer::visitBlockStmt(ASTBlockStmt* stmt) {
+	foldAll(stmt->statements);
+}
+
+//branches are statements(never declarations), so replacing the if with one of them doesn't change any scoping
+void ASTOptimizer::visitIfStmt(ASTIfStmt* stmt) {
+	stmt->condition = fold(stmt->condition);
+	stmt->thenBranch = fold(stmt->thenBranch);
+	stmt->elseBranch = fold(stmt->elseBranch);
+	result = stmt;
+	foldedConst cond;
+	if (!getConst(stmt->condition, cond)) return;
+	if (!cond.isFalsey()) result = stmt->thenBranch;
+	else result = stmt->elseBranch != nullptr ? stmt->elseBranch : emptyStmt();
+}
+
+//a loop that never runs is removed, a condition that's always true isn't checked at all
+void ASTOptimizer::visitWhileStmt(ASTWhileStmt* stmt) {
+	stmt->condition = fold(stmt->condition);
+	stmt->body = fold(stmt->body);
+	result = stmt;
+	foldedConst cond;
+	if (!getConst(stmt->condition, cond)) return;
+	if (cond.isFalsey()) result = emptyStmt();
+	else stmt->condition = nullptr;
+}
+
+void ASTOptimizer::visitForStmt(ASTForStmt* stmt) {
+	stmt->init = fold(stmt->init);
+	stmt->condition = fold(stmt->condition);
+	stmt->increment = fold(stmt->increment);
+	stmt->body = fold(stmt->body);
+	result = stmt;
+	foldedConst cond;
+	if (stmt->condition == nullptr || !getConst(stmt->condition, cond)) return;
+	if (!cond.isFalsey()) {
+		stmt->condition = nullptr;
+		return;
+	}
+	//the initializer still runs once, the block keeps it in it's own scope like the loop did
+	vector<ASTNode*> init;
+	if (stmt->init != nullptr) init.push_back(stmt->init);
+	result = new ASTBlockStmt(init);
+}
+
+void ASTOptimizer::visitForeachStmt(ASTForeachStmt* stmt) {
+	stmt->collection = fold(stmt->collection);
+	stmt->body = fold(stmt->body);
+}
+
+void ASTOptimizer::visitBreakStmt(ASTBreakStmt* stmt) {}
+
+void ASTOptimizer::visitContinueStmt(ASTContinueStmt* stmt) {}
+
+//case labels are left alone since the switch table is built from their tokens
+void ASTOptimizer::visitSwitchStmt(ASTSwitchStmt* stmt) {
+	stmt->expr = fold(stmt->expr);
+	foldAll(stmt->cases);
+}
+
+void ASTOptimizer::visitCase(ASTCase* _case) {
+	foldAll(_case->stmts);
+}
+
+void ASTOptimizer::visitReturnStmt(ASTReturn* stmt) {
+	stmt->expr = fold(stmt->expr);
+}
+#pragma endregion
@@ -0,0 +1,85 @@
+#pragma once
+#include "common.h"
+#include "AST.h"
+#include <deque>
+
+//value of a literal as the VM would see it, only these are ever folded
+struct foldedConst {
+	enum class kind {
+		NIL,
+		BOOL,
+		INT,
+		DOUBLE,
+		STRING
+	};
+	kind type;
+	bool boolean;
+	long long integer;
+	double number;
+	string str;
+
+	foldedConst() : type(kind::NIL), boolean(false), integer(0), number(0), str("") {};
+	bool isNumber() { return type == kind::INT || type == kind::DOUBLE; }
+	double asNumber() { return type == kind::INT ? integer : number; }
+	bool isFalsey() { return type == kind::NIL || (type == kind::BOOL && !boolean); }
+};
+
+//runs between parsing and compilation, rewrites the AST in place:
+//folds constant expressions, prunes branches and loops whose condition is known and replaces division by a power of 2 with multiplication
+//
+//every fold follows the exact rules of the VM instructions it replaces, anything that could error or produce inf/nan at runtime is left alone
+//folded literals keep the token of the expression they replace, so line numbers stay correct
+class ASTOptimizer : public visitor {
+public:
+	void optimize(vector<ASTNode*>& stmts);
+
+	void visitAssignmentExpr(ASTAssignmentExpr* expr);
+	void visitSetExpr(ASTSetExpr* expr);
+	void visitConditionalExpr(ASTConditionalExpr* expr);
+	void visitBinaryExpr(ASTBinaryExpr* expr);
+	void visitUnaryExpr(ASTUnaryExpr* expr);
+	void visitUnaryVarAlterExpr(ASTUnaryVarAlterExpr* expr);
+	void visitCallExpr(ASTCallExpr* expr);
+	void visitGroupingExpr(ASTGroupingExpr* expr);
+	void visitArrayDeclExpr(ASTArrayDeclExpr* expr);
+	void visitStructLiteralExpr(ASTStructLiteral* expr);
+	void visitLiteralExpr(ASTLiteralExpr* expr);
+	void visitYieldExpr(ASTYieldExpr* expr);
+	void visitFiberRunExpr(ASTFiberRunExpr* expr);
+	void visitFiberLiteralExpr(ASTFiberLiteral* expr);
+	void visitSuperExpr(ASTSuperExpr* expr);
+
+	void visitVarDecl(ASTVarDecl* decl);
+	void visitFuncDecl(ASTFunc* decl);
+	void visitClassDecl(ASTClass* decl);
+
+	void visitPrintStmt(ASTPrintStmt* stmt);
+	void visitExprStmt(ASTExprStmt* stmt);
+	void visitBlockStmt(ASTBlockStmt* stmt);
+	void visitIfStmt(ASTIfStmt* stmt);
+	void visitWhileStmt(ASTWhileStmt* stmt);
+	void visitForStmt(ASTForStmt* stmt);
+	void visitForeachStmt(ASTForeachStmt* stmt);
+	void visitBreakStmt(ASTBreakStmt* stmt);
+	void visitContinueStmt(ASTContinueStmt* stmt);
+	void visitSwitchStmt(ASTSwitchStmt* stmt);
+	void visitCase(ASTCase* _case);
+	void visitReturnStmt(ASTReturn* stmt);
+private:
+	//set by a visit method if the visited node should be replaced
+	ASTNode* result;
+	//lexemes of folded literals, synthetic tokens only hold a pointer so these need to outlive the AST
+	std::deque<string> lexemes;
+
+	ASTNode* fold(ASTNode* node);
+	void foldAll(vector<ASTNode*>& nodes);
+
+	bool getConst(ASTNode* node, foldedConst& val);
+	ASTNode* makeLiteral(foldedConst& val, Token source);
+	ASTNode* emptyStmt();
+
+	bool foldBinary(TokenType op, foldedConst& a, foldedConst& b, foldedConst& res);
+	bool foldUnary(TokenType op, foldedConst& a, foldedConst& res);
+	bool isFoldable(foldedConst& res);
+	bool reciprocalOfPow2(foldedConst& val, double& res);
+};
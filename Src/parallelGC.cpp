@@ -0,0 +1,210 @@
+#include "parallelGC.h"
+#include "heapBlock.h"
+#include "memory.h"
+#include <algorithm>
+
+#ifdef PARALLEL_GC
+#pragma region Workers
+gcWorkers::gcWorkers() {
+	count = std::max(std::thread::hardware_concurrency(), 1u);
+	task = nullptr;
+	generation = 0;
+	running = 0;
+	stopping = false;
+}
+
+gcWorkers::~gcWorkers() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& thread : threads) thread.join();
+}
+
+void gcWorkers::run(gcTask* _task) {
+	if (count <= 1) {
+		_task->run(0);
+		return;
+	}
+	std::unique_lock<std::mutex> guard(lock);
+	while (threads.size() < count - 1) threads.push_back(std::thread(&gcWorkers::loop, this, (uInt)threads.size() + 1, generation));
+	task = _task;
+	generation++;
+	running = count - 1;
+	guard.unlock();
+	wake.notify_all();
+	//the thread that started the collection is worker 0
+	_task->run(0);
+	guard.lock();
+	while (running != 0) finished.wait(guard);
+	task = nullptr;
+}
+
+void gcWorkers::loop(uInt worker, uInt64 seen) {
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		while (!stopping && generation == seen) wake.wait(guard);
+		if (stopping) return;
+		seen = generation;
+		gcTask* current = task;
+		guard.unlock();
+		current->run(worker);
+		guard.lock();
+		if (--running == 0) finished.notify_one();
+	}
+}
+#pragma endregion
+
+#pragma region Marking
+//an object is marked by whichever worker sets it's moveTo first, strings, natives and array headers are still marked by simply
+//setting moveTo(see object.cpp), which is fine since every worker writes the same value and nothing traces them
+static bool claim(managed* ptr) {
+	std::atomic<managed*>* moveTo = reinterpret_cast<std::atomic<managed*>*>(&ptr->moveTo);
+	if (moveTo->load(std::memory_order_relaxed) != nullptr) return false;
+	managed* expected = nullptr;
+	return moveTo->compare_exchange_strong(expected, ptr);
+}
+
+parallelMark::parallelMark(uInt workers, std::vector<managed*>& roots, bool claimed) {
+	count = workers;
+	stacks = std::unique_ptr<workerStack[]>(new workerStack[count]);
+	for (uInt i = 0; i < count; i++) stacks[i].sharedCount = 0;
+	idle = 0;
+	for (size_t i = 0; i < roots.size(); i++) {
+		workerStack& stack = stacks[i % count];
+		if (claimed) stack.claimed.push_back(roots[i]);
+		else stack.local.push_back(roots[i]);
+	}
+}
+
+void parallelMark::run(uInt worker) {
+	workerStack& own = stacks[worker];
+	std::vector<managed*>& local = own.local;
+	for (managed* ptr : own.claimed) ptr->trace(local);
+	while (true) {
+		while (local.size() != 0) {
+			managed* ptr = local.back();
+			local.pop_back();
+			if (!claim(ptr)) continue;
+			ptr->trace(local);
+			//only what's been shared can be stolen, which is only worth doing once another worker is out of objects
+			if (idle != 0 && local.size() >= MARK_SHARE_SIZE && own.sharedCount == 0) share(own);
+		}
+		if (take(worker)) continue;
+		std::unique_lock<std::mutex> guard(idleLock);
+		idle++;
+		while (true) {
+			if (idle == count) {
+				idleWake.notify_all();
+				return;
+			}
+			if (anyShared()) {
+				idle--;
+				break;
+			}
+			idleWake.wait(guard);
+		}
+	}
+}
+
+void parallelMark::share(workerStack& stack) {
+	size_t half = stack.local.size() / 2;
+	{
+		std::lock_guard<std::mutex> guard(stack.lock);
+		stack.shared.insert(stack.shared.end(), stack.local.end() - half, stack.local.end());
+		stack.sharedCount = stack.shared.size();
+	}
+	stack.local.resize(stack.local.size() - half);
+	std::lock_guard<std::mutex> idleGuard(idleLock);
+	idleWake.notify_all();
+}
+
+//takes back everything the worker shared, or half of what another worker shared
+bool parallelMark::take(uInt worker) {
+	for (uInt i = 0; i < count; i++) {
+		workerStack& victim = stacks[(worker + i) % count];
+		if (victim.sharedCount == 0) continue;
+		std::lock_guard<std::mutex> guard(victim.lock);
+		size_t size = victim.shared.size();
+		if (size == 0) continue;
+		size_t taken = i == 0 ? size : (size + 1) / 2;
+		std::vector<managed*>& local = stacks[worker].local;
+		local.insert(local.end(), victim.shared.end() - taken, victim.shared.end());
+		victim.shared.resize(size - taken);
+		victim.sharedCount = victim.shared.size();
+		return true;
+	}
+	return false;
+}
+
+bool parallelMark::anyShared() {
+	for (uInt i = 0; i < count; i++) {
+		if (stacks[i].sharedCount != 0) return true;
+	}
+	return false;
+}
+#pragma endregion
+
+#pragma region Heap walks
+void heapChunks::find(movingHeapBlock* heap) {
+	heap->chunkStarts(starts);
+	live.assign(count(), 0);
+	dests.assign(count() + 1, nullptr);
+}
+
+void heapChunks::prefixSum(byte* to) {
+	for (size_t i = 0; i < count(); i++) {
+		dests[i] = to;
+		to += live[i];
+	}
+	dests[count()] = to;
+}
+
+parallelHeapWalk::parallelHeapWalk(movingHeapBlock* _heap, heapChunks& _chunks, heapWalkPhase _phase) : chunks(_chunks) {
+	heap = _heap;
+	phase = _phase;
+	next = 0;
+	if (phase == heapWalkPhase::COMPACT) {
+		done = std::unique_ptr<std::atomic<bool>[]>(new std::atomic<bool>[chunks.count()]);
+		for (size_t i = 0; i < chunks.count(); i++) done[i] = false;
+	}
+}
+
+void parallelHeapWalk::run(uInt worker) {
+	while (true) {
+		size_t i = next++;
+		if (i >= chunks.count()) return;
+		byte* from = chunks.starts[i];
+		byte* end = chunks.starts[i + 1];
+		switch (phase) {
+		case heapWalkPhase::LIVE_BYTES: chunks.live[i] = heap->liveBytes(from, end); break;
+		case heapWalkPhase::COMPUTE_ADDRESS: heap->computeAddress(from, end, chunks.dests[i]); break;
+		case heapWalkPhase::UPDATE_PTRS: heap->updatePtrs(from, end); break;
+		case heapWalkPhase::COMPACT:
+			waitForOverlap(i);
+			heap->compact(from, end, chunks.dests[i]);
+			{
+				std::lock_guard<std::mutex> guard(doneLock);
+				done[i] = true;
+			}
+			chunkDone.notify_all();
+			break;
+		}
+	}
+}
+
+//chunks are taken in order, so the ones this waits for are already being compacted by another worker
+void parallelHeapWalk::waitForOverlap(size_t chunk) {
+	//resizing copies into a new buffer, so nothing can be overwritten
+	if (heap->oldHeapBuffer != heap->heapBuffer) return;
+	//the first chunk that ends after where this one moves to
+	size_t first = std::upper_bound(chunks.starts.begin(), chunks.starts.begin() + chunk + 1, chunks.dests[chunk]) - chunks.starts.begin();
+	for (size_t i = first == 0 ? 0 : first - 1; i < chunk; i++) {
+		if (done[i]) continue;
+		std::unique_lock<std::mutex> guard(doneLock);
+		while (!done[i]) chunkDone.wait(guard);
+	}
+}
+#pragma endregion
+#endif
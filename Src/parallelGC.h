@@ -0,0 +1,102 @@
+#pragma once
+
+#include "common.h"
+#include "managed.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+#ifdef PARALLEL_GC
+class movingHeapBlock;
+
+//a part of a full collection that every worker runs at the same time, 'worker' is 0 on the thread that started the collection
+class gcTask {
+public:
+	virtual void run(uInt worker) = 0;
+};
+
+//threads that sleep between collections, they're only started once a collection needs them
+class gcWorkers {
+public:
+	gcWorkers();
+	~gcWorkers();
+	//how many threads a collection uses, including the one that started it
+	uInt count;
+	//runs 'task' on every worker and returns once all of them are done with it
+	void run(gcTask* task);
+private:
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	gcTask* task;
+	//every task gets a new generation, so a worker never runs the same one twice
+	uInt64 generation;
+	uInt running;
+	bool stopping;
+	void loop(uInt worker, uInt64 seen);
+};
+
+//every worker marks from it's own stack and shares half of it once another worker runs out, which then steals from it,
+//marking ends once every worker is out of objects and nothing is shared
+class parallelMark : public gcTask {
+public:
+	//'claimed' objects are already marked and only need to be traced(the grey stack of incremental marking), the rest get marked first
+	parallelMark(uInt workers, std::vector<managed*>& roots, bool claimed);
+	void run(uInt worker);
+private:
+	struct workerStack {
+		std::vector<managed*> local;
+		std::vector<managed*> claimed;
+		std::mutex lock;
+		std::vector<managed*> shared;
+		std::atomic<size_t> sharedCount;
+	};
+	std::unique_ptr<workerStack[]> stacks;
+	uInt count;
+	//workers that are out of objects sleep until something gets shared or every worker is out
+	std::atomic<uInt> idle;
+	std::mutex idleLock;
+	std::condition_variable idleWake;
+	void share(workerStack& stack);
+	bool take(uInt worker);
+	bool anyShared();
+};
+
+//where the chunks of a heap start(see movingHeapBlock::chunkStarts), how many live bytes each has and where those will move to
+struct heapChunks {
+	std::vector<byte*> starts;
+	std::vector<size_t> live;
+	std::vector<byte*> dests;
+	size_t count() { return starts.size() - 1; }
+	void find(movingHeapBlock* heap);
+	//every chunk's objects move to right after the ones of the chunk before it
+	void prefixSum(byte* to);
+};
+
+enum class heapWalkPhase {
+	LIVE_BYTES,
+	COMPUTE_ADDRESS,
+	UPDATE_PTRS,
+	COMPACT
+};
+
+//one of the linear walks of a full collection, workers take the chunks of the heap in order
+class parallelHeapWalk : public gcTask {
+public:
+	parallelHeapWalk(movingHeapBlock* heap, heapChunks& chunks, heapWalkPhase phase);
+	void run(uInt worker);
+private:
+	movingHeapBlock* heap;
+	heapChunks& chunks;
+	heapWalkPhase phase;
+	std::atomic<size_t> next;
+	//objects of a chunk can slide over the chunks before it, so those have to be compacted first
+	std::unique_ptr<std::atomic<bool>[]> done;
+	std::mutex doneLock;
+	std::condition_variable chunkDone;
+	void waitForOverlap(size_t chunk);
+};
+#endif
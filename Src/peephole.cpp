@@ -0,0 +1,579 @@
+#include "peephole.h"
+#include "object.h"
+
+//how many jumps are followed when threading a single jump, guards against cycles of unconditional jumps
+#define MAX_THREAD_STEPS 16
+
+static uInt16 readShort(chunk* body, uInt offset) {
+	return (uInt16)((body->code[offset] << 8) | body->code[offset + 1]);
+}
+
+peephole::peephole(chunk* _chunk) {
+	body = _chunk;
+	newSize = 0;
+}
+
+void peephole::optimize() {
+	if (body->code.count() == 0) return;
+	decode();
+	threadJumps();
+	markReachable();
+	markTargets();
+	removeJumpsToNext();
+	mergePops();
+	removePushPop();
+	removeDiscardedPostfix();
+	#ifdef REGISTER_ISA
+	fuseRegisters();
+	#endif
+	emit();
+	#ifdef FUSED_BRANCHES
+	fuseBranches();
+	#endif
+	#ifdef SUPERINSTRUCTIONS
+	fuseSuperinstructions();
+	#endif
+}
+
+#pragma region Decoding
+void peephole::decode() {
+	uInt size = body->code.count();
+	instrAt.assign(size + 1, -1);
+	for (uInt offset = 0; offset < size;) {
+		peepholeInstr instr(offset, body->instructionLength(offset), body->code[offset]);
+		uInt end = offset + instr.length;
+		switch (instr.op) {
+		case OP_POP: instr.count = 1; break;
+		case OP_POPN: instr.count = body->code[offset + 1]; break;
+		case OP_JUMP:
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+		case OP_JUMP_IF_FALSE_POP:
+			instr.target = end + readShort(body, offset + 1);
+			break;
+		case OP_LOOP: instr.target = end - readShort(body, offset + 1); break;
+		case OP_JUMP_POPN:
+			instr.count = readShort(body, offset + 1);
+			instr.target = end + readShort(body, offset + 3);
+			//breaks and continues that don't leave any scope still pop 0 values
+			if (instr.count == 0) instr.op = OP_JUMP;
+			break;
+		}
+		instrAt[offset] = instrs.size();
+		instrs.push_back(instr);
+		offset = end;
+	}
+}
+
+bool peephole::isJump(uint8_t op) {
+	switch (op) {
+	case OP_JUMP:
+	case OP_JUMP_IF_FALSE:
+	case OP_JUMP_IF_TRUE:
+	case OP_JUMP_IF_FALSE_POP:
+	case OP_LOOP:
+	case OP_JUMP_POPN:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool peephole::isUnconditional(uint8_t op) {
+	return op == OP_JUMP || op == OP_LOOP || op == OP_JUMP_POPN;
+}
+#pragma endregion
+
+#pragma region Analysis
+//a jump that lands on another jump can go straight to where that jump goes
+void peephole::threadJumps() {
+	uInt size = body->code.count();
+	for (peepholeInstr& instr : instrs) {
+		if (!isJump(instr.op)) continue;
+		uInt end = instr.start + instr.length;
+		for (int i = 0; i < MAX_THREAD_STEPS && instr.target < size; i++) {
+			peepholeInstr& next = instrs[instrAt[instr.target]];
+			uInt newTarget;
+			uInt newCount = instr.count;
+			if (next.op == OP_JUMP || next.op == OP_LOOP) newTarget = next.target;
+			//2 scope exits in a row pop both scopes
+			else if (instr.op == OP_JUMP_POPN && next.op == OP_JUMP_POPN) {
+				newTarget = next.target;
+				newCount += next.count;
+			}
+			//conditional jumps don't pop, so the condition is still the same when the next conditional jump checks it
+			else if ((instr.op == OP_JUMP_IF_FALSE || instr.op == OP_JUMP_IF_TRUE)
+				&& (next.op == OP_JUMP_IF_FALSE || next.op == OP_JUMP_IF_TRUE)) {
+				newTarget = next.op == instr.op ? next.target : next.start + next.length;
+			}
+			else break;
+
+			if (newTarget == instr.target) break;
+			bool forward = newTarget >= end;
+			//only OP_JUMP can be turned into OP_LOOP(and vice versa), everything else can only jump forward
+			if (!forward && instr.op != OP_JUMP && instr.op != OP_LOOP) break;
+			//optimized code is never longer than the original, so distances that fit now will still fit after emitting
+			if ((forward ? newTarget - end : end - newTarget) > UINT16_MAX || newCount > UINT16_MAX) break;
+			instr.target = newTarget;
+			instr.count = newCount;
+			if (instr.op == OP_JUMP || instr.op == OP_LOOP) instr.op = forward ? OP_JUMP : OP_LOOP;
+		}
+	}
+}
+
+//anything that can't be reached from the start of the function is dead code(eg. code after a return or break)
+void peephole::markReachable() {
+	vector<int> worklist;
+	worklist.push_back(0);
+	while (!worklist.empty()) {
+		int index = worklist.back();
+		worklist.pop_back();
+		//jumps past the last instruction(functions whose only return is inside a branch) don't lead anywhere
+		if (index == -1 || instrs[index].alive) continue;
+		peepholeInstr& instr = instrs[index];
+		instr.alive = true;
+
+		if (isJump(instr.op)) worklist.push_back(instrAt[instr.target]);
+		if (instr.op == OP_SWITCH) {
+			for (uInt target : switchTargets(instr)) worklist.push_back(instrAt[target]);
+			continue;
+		}
+		if (isUnconditional(instr.op) || instr.op == OP_RETURN) continue;
+		if (index + 1 < instrs.size()) worklist.push_back(index + 1);
+	}
+}
+
+//instructions that can be jumped to can't be merged with the instruction before them
+void peephole::markTargets() {
+	for (peepholeInstr& instr : instrs) {
+		if (!instr.alive) continue;
+		if (isJump(instr.op) && instrAt[instr.target] != -1) instrs[instrAt[instr.target]].isTarget = true;
+		if (instr.op == OP_SWITCH) {
+			for (uInt target : switchTargets(instr)) {
+				if (instrAt[target] != -1) instrs[instrAt[target]].isTarget = true;
+			}
+		}
+	}
+}
+
+//absolute offsets of every case and the default case, the table holds them relative to the end of OP_SWITCH
+vector<uInt> peephole::switchTargets(peepholeInstr& instr) {
+	switchTable& table = body->switchTables[body->code[instr.start + 1]];
+	uInt base = instr.start + instr.length;
+	vector<uInt> targets;
+	for (uInt i = 0; i < table.arr.count(); i++) targets.push_back(base + table.arr[i].ip);
+	for (auto& it : table.table) targets.push_back(base + it.second);
+	targets.push_back(base + table.defaultJump);
+	return targets;
+}
+#pragma endregion
+
+#pragma region Rewriting
+//going backwards so that a jump to a jump which is removed sees the instruction after it
+void peephole::removeJumpsToNext() {
+	for (int i = instrs.size() - 1; i >= 0; i--) {
+		peepholeInstr& instr = instrs[i];
+		if (!instr.alive || !isJump(instr.op)) continue;
+		if (firstAliveFrom(instr.target) != nextAlive(i)) continue;
+		switch (instr.op) {
+		case OP_JUMP:
+		case OP_LOOP:
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+			instr.alive = false;
+			break;
+		//the condition still needs to be popped
+		case OP_JUMP_IF_FALSE_POP:
+			instr.op = OP_POP;
+			instr.count = 1;
+			break;
+		case OP_JUMP_POPN:
+			if (instr.count <= UINT8_MAX) instr.op = OP_POPN;
+			break;
+		}
+	}
+}
+
+//OP_POP OP_POP OP_POPN 2 -> OP_POPN 4
+void peephole::mergePops() {
+	for (int i = 0; i < instrs.size(); i++) {
+		peepholeInstr& instr = instrs[i];
+		if (!instr.alive || (instr.op != OP_POP && instr.op != OP_POPN)) continue;
+		int next = nextAlive(i);
+		while (next != -1 && (instrs[next].op == OP_POP || instrs[next].op == OP_POPN) && !instrs[next].isTarget
+			&& instr.count + instrs[next].count <= UINT8_MAX) {
+			instr.count += instrs[next].count;
+			instrs[next].alive = false;
+			next = nextAlive(next);
+		}
+		instr.op = instr.count == 1 ? OP_POP : OP_POPN;
+	}
+}
+
+//values that are pushed and then immediately popped(eg. a expression statement that's just a variable) are never pushed
+void peephole::removePushPop() {
+	for (int i = instrs.size() - 1; i >= 0; i--) {
+		peepholeInstr& instr = instrs[i];
+		if (!instr.alive) continue;
+		switch (instr.op) {
+		case OP_GET_LOCAL:
+		case OP_GET_UPVALUE:
+		case OP_CONSTANT:
+		case OP_CONSTANT_LONG:
+		case OP_NIL:
+		case OP_TRUE:
+		case OP_FALSE:
+			break;
+		default:
+			continue;
+		}
+		int next = nextAlive(i);
+		if (next == -1 || instrs[next].isTarget || (instrs[next].op != OP_POP && instrs[next].op != OP_POPN)) continue;
+		instr.alive = false;
+		peepholeInstr& pop = instrs[next];
+		pop.count--;
+		if (pop.count == 0) pop.alive = false;
+		pop.op = pop.count == 1 ? OP_POP : OP_POPN;
+	}
+}
+
+//i++ as a statement is GET_LOCAL i CONSTANT 1 OP_ADD SET_LOCAL i OP_SUBTRACT_1 OP_POP, the old value is computed only to be popped
+//adding a number constant either raises a error or leaves a number, and taking 1 from that number can't fail
+void peephole::removeDiscardedPostfix() {
+	for (int i = 0; i < instrs.size(); i++) {
+		peepholeInstr& instr = instrs[i];
+		uint8_t op = genericOpcode(instr.op);
+		if (!instr.alive || instr.isTarget || (op != OP_ADD_1 && op != OP_SUBTRACT_1)) continue;
+		int pop = nextAlive(i);
+		if (pop == -1 || instrs[pop].isTarget || (instrs[pop].op != OP_POP && instrs[pop].op != OP_POPN)) continue;
+		int store = previousAlive(i);
+		int binary = store == -1 ? -1 : previousAlive(store);
+		int constant = binary == -1 ? -1 : previousAlive(binary);
+		if (constant == -1 || instrs[store].isTarget || instrs[binary].isTarget) continue;
+		switch (instrs[store].op) {
+		case OP_SET_LOCAL:
+		case OP_SET_UPVALUE:
+		case OP_SET_GLOBAL:
+		case OP_SET_GLOBAL_LONG:
+			break;
+		default:
+			continue;
+		}
+		op = genericOpcode(instrs[binary].op);
+		if ((op != OP_ADD && op != OP_SUBTRACT) || instrs[constant].op != OP_CONSTANT) continue;
+		if (!IS_NUMBER(body->constants[body->code[instrs[constant].start + 1]])) continue;
+		instr.alive = false;
+	}
+}
+
+#ifdef REGISTER_ISA
+//register version of a generic binary instruction, -1 if it doesn't have one
+static int registerOpcode(uint8_t op, bool constant) {
+	int regOp;
+	switch (op) {
+	case OP_ADD: regOp = OP_REG_ADD; break;
+	case OP_SUBTRACT: regOp = OP_REG_SUBTRACT; break;
+	case OP_MULTIPLY: regOp = OP_REG_MULTIPLY; break;
+	case OP_DIVIDE: regOp = OP_REG_DIVIDE; break;
+	case OP_MOD: regOp = OP_REG_MOD; break;
+	case OP_EQUAL: regOp = OP_REG_EQUAL; break;
+	case OP_NOT_EQUAL: regOp = OP_REG_NOT_EQUAL; break;
+	case OP_GREATER: regOp = OP_REG_GREATER; break;
+	case OP_GREATER_EQUAL: regOp = OP_REG_GREATER_EQUAL; break;
+	case OP_LESS: regOp = OP_REG_LESS; break;
+	case OP_LESS_EQUAL: regOp = OP_REG_LESS_EQUAL; break;
+	default: return -1;
+	}
+	//the constant versions are in the same order
+	return constant ? regOp + (OP_REG_ADD_K - OP_REG_ADD) : regOp;
+}
+
+//GET_LOCAL b GET_LOCAL c OP_ADD SET_LOCAL a OP_POP -> OP_REG_ADD a b c, without the store the result is pushed(OP_REG_ADD top b c)
+//GET_LOCAL b SET_LOCAL a OP_POP -> OP_REG_MOVE a b, and CONSTANT k SET_LOCAL a OP_POP -> OP_REG_LOAD a k
+void peephole::fuseRegisters() {
+	for (int i = 0; i < instrs.size(); i++) {
+		peepholeInstr& first = instrs[i];
+		if (!first.alive || (first.op != OP_GET_LOCAL && first.op != OP_CONSTANT)) continue;
+		uint8_t firstOperand = body->code[first.start + 1];
+		int second = nextFusable(i);
+		if (second == -1 || firstOperand == REG_TOP) continue;
+
+		if (instrs[second].op == OP_SET_LOCAL) {
+			int pop = nextFusable(second);
+			uint8_t dst = body->code[instrs[second].start + 1];
+			if (pop == -1 || (instrs[pop].op != OP_POP && instrs[pop].op != OP_POPN) || dst == REG_TOP) continue;
+			if (splitsInlinedCall(first.start, instrs[second].start + instrs[second].length)) continue;
+			first.op = first.op == OP_GET_LOCAL ? OP_REG_MOVE : OP_REG_LOAD;
+			first.operands[0] = dst;
+			first.operands[1] = firstOperand;
+			first.operandCount = 2;
+			instrs[second].alive = false;
+			consumePop(instrs[pop]);
+			continue;
+		}
+
+		if (first.op != OP_GET_LOCAL || (instrs[second].op != OP_GET_LOCAL && instrs[second].op != OP_CONSTANT)) continue;
+		uint8_t secondOperand = body->code[instrs[second].start + 1];
+		int binary = nextFusable(second);
+		if (binary == -1) continue;
+		int regOp = registerOpcode(genericOpcode(instrs[binary].op), instrs[second].op == OP_CONSTANT);
+		if (regOp == -1 || (instrs[second].op == OP_GET_LOCAL && secondOperand == REG_TOP)) continue;
+		//errors are reported on the line of the fused instruction
+		if (body->getLine(first.start).line != body->getLine(instrs[binary].start).line) continue;
+		uint8_t dst = REG_TOP;
+		int last = binary;
+		int store = nextFusable(binary);
+		if (store != -1 && instrs[store].op == OP_SET_LOCAL && body->code[instrs[store].start + 1] != REG_TOP) {
+			int pop = nextFusable(store);
+			if (pop != -1 && (instrs[pop].op == OP_POP || instrs[pop].op == OP_POPN)
+				&& body->getLine(instrs[store].start).line == body->getLine(first.start).line) {
+				dst = body->code[instrs[store].start + 1];
+				last = store;
+			}
+		}
+		if (splitsInlinedCall(first.start, instrs[last].start + instrs[last].length)) continue;
+		first.op = regOp;
+		first.operands[0] = dst;
+		first.operands[1] = firstOperand;
+		first.operands[2] = secondOperand;
+		first.operandCount = 3;
+		instrs[second].alive = false;
+		instrs[binary].alive = false;
+		if (dst != REG_TOP) {
+			instrs[store].alive = false;
+			consumePop(instrs[nextFusable(store)]);
+		}
+	}
+}
+
+//next alive instruction, -1 if there is none or if anything before it can be jumped to
+int peephole::nextFusable(int index) {
+	for (int i = index + 1; i < instrs.size(); i++) {
+		if (instrs[i].isTarget) return -1;
+		if (instrs[i].alive) return i;
+	}
+	return -1;
+}
+
+//the fused instruction doesn't push, so the pop after the store has one value less to pop
+void peephole::consumePop(peepholeInstr& pop) {
+	pop.count--;
+	if (pop.count == 0) pop.alive = false;
+	pop.op = pop.count == 1 ? OP_POP : OP_POPN;
+}
+
+//the callstack of inlined code(see inliner.h) needs it's bounds to stay between instructions
+bool peephole::splitsInlinedCall(uInt start, uInt end) {
+	for (inlinedCall& call : body->inlined) {
+		if ((call.start > start && call.start < end) || (call.end > start && call.end < end)) return true;
+	}
+	return false;
+}
+#endif
+
+void peephole::emit() {
+	newSize = 0;
+	for (peepholeInstr& instr : instrs) {
+		instr.newStart = newSize;
+		if (instr.alive) newSize += newLength(instr);
+	}
+
+	vector<uint8_t> out;
+	out.reserve(newSize);
+	for (peepholeInstr& instr : instrs) {
+		if (!instr.alive) continue;
+		if (instr.operandCount != 0) {
+			out.push_back(instr.op);
+			for (uInt i = 0; i < instr.operandCount; i++) out.push_back(instr.operands[i]);
+			continue;
+		}
+		uInt end = instr.newStart + newLength(instr);
+		uInt target = isJump(instr.op) ? mapTarget(instr.target) : 0;
+		switch (instr.op) {
+		case OP_POP:
+			out.push_back(OP_POP);
+			break;
+		case OP_POPN:
+			out.push_back(OP_POPN);
+			out.push_back(instr.count);
+			break;
+		case OP_JUMP:
+		case OP_LOOP: {
+			uInt offset = target >= end ? target - end : end - target;
+			out.push_back(target >= end ? OP_JUMP : OP_LOOP);
+			out.push_back((offset >> 8) & 0xff);
+			out.push_back(offset & 0xff);
+			break;
+		}
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+		case OP_JUMP_IF_FALSE_POP:
+			out.push_back(instr.op);
+			out.push_back(((target - end) >> 8) & 0xff);
+			out.push_back((target - end) & 0xff);
+			break;
+		case OP_JUMP_POPN:
+			out.push_back(OP_JUMP_POPN);
+			out.push_back((instr.count >> 8) & 0xff);
+			out.push_back(instr.count & 0xff);
+			out.push_back(((target - end) >> 8) & 0xff);
+			out.push_back((target - end) & 0xff);
+			break;
+		case OP_SWITCH: {
+			//switch ips are relative to the end of OP_SWITCH
+			switchTable& table = body->switchTables[body->code[instr.start + 1]];
+			uInt base = instr.start + instr.length;
+			for (uInt i = 0; i < table.arr.count(); i++) table.arr[i].ip = mapTarget(base + table.arr[i].ip) - end;
+			for (auto& it : table.table) it.second = mapTarget(base + it.second) - end;
+			table.defaultJump = mapTarget(base + table.defaultJump) - end;
+			//fallthrough
+		}
+		default:
+			for (uInt i = 0; i < instr.length; i++) out.push_back(body->code[instr.start + i]);
+			break;
+		}
+	}
+
+	for (inlineCache& cache : body->caches) cache.offset = mapOffset(cache.offset);
+	//lines that lost all of their code are dropped
+	vector<codeLine> lines;
+	for (codeLine& line : body->lines) {
+		line.end = mapOffset(line.end);
+		if (!lines.empty() && lines.back().end == line.end) continue;
+		lines.push_back(line);
+	}
+	lines.back().end = newSize;
+	body->lines = lines;
+	//inlined code that was removed completely doesn't need a entry in the callstack
+	vector<inlinedCall> inlined;
+	for (inlinedCall& call : body->inlined) {
+		call.start = mapOffset(call.start);
+		call.end = mapOffset(call.end);
+		if (call.start != call.end) inlined.push_back(call);
+	}
+	body->inlined = inlined;
+
+	for (uInt i = 0; i < newSize; i++) body->code[i] = out[i];
+	body->code.resize(newSize);
+}
+
+#ifdef FUSED_BRANCHES
+//only the opcode of the instruction that starts the fused code changes, the rest stays in place for the JITs, -aot
+//and for falling back to when the operands aren't numbers
+void peephole::fuseBranches() {
+	uint8_t* code = body->code.data();
+	uInt size = body->code.count();
+	for (uInt offset = 0; offset < size; offset += body->instructionLength(offset)) {
+		uint8_t op = genericOpcode(code[offset]);
+		if (op == OP_GET_LOCAL) {
+			int loop = countedLoop(offset);
+			if (loop != -1) code[offset] = loop;
+			continue;
+		}
+		if ((op != OP_LESS && op != OP_EQUAL) || offset + 1 >= size || code[offset + 1] != OP_JUMP_IF_FALSE_POP) continue;
+		code[offset] = op == OP_LESS ? OP_LESS_JUMP : OP_EQUAL_JUMP;
+	}
+}
+
+//OP_FOR_INCR_LOOP(or the _K version) if the code at 'offset' is the end of a counted loop, -1 otherwise:
+//GET_LOCAL i CONSTANT step OP_ADD SET_LOCAL i OP_POP OP_LOOP header, where the header is
+//GET_LOCAL i GET_LOCAL/CONSTANT limit OP_LESS OP_JUMP_IF_FALSE_POP and jumps to right after the OP_LOOP
+int peephole::countedLoop(uInt offset) {
+	uint8_t* code = body->code.data();
+	uInt end = offset + 11;
+	if (end > body->code.count()) return -1;
+	//every instruction is checked before the length of the next one is relied on
+	if (genericOpcode(code[offset + 2]) != OP_CONSTANT || genericOpcode(code[offset + 4]) != OP_ADD) return -1;
+	if (code[offset + 5] != OP_SET_LOCAL || code[offset + 6] != code[offset + 1]) return -1;
+	if (code[offset + 7] != OP_POP || code[offset + 8] != OP_LOOP) return -1;
+	if (!IS_NUMBER(body->constants[code[offset + 3]])) return -1;
+	uInt loopBack = (code[offset + 9] << 8) | code[offset + 10];
+	//the header has to fit before the increment
+	if (loopBack > end || end - loopBack + 8 > offset) return -1;
+	uInt header = end - loopBack;
+	if (genericOpcode(code[header]) != OP_GET_LOCAL || code[header + 1] != code[offset + 1]) return -1;
+	uint8_t limit = genericOpcode(code[header + 2]);
+	if (limit != OP_GET_LOCAL && limit != OP_CONSTANT) return -1;
+	if (genericOpcode(code[header + 4]) != OP_LESS || code[header + 5] != OP_JUMP_IF_FALSE_POP) return -1;
+	if (header + 8 + ((code[header + 6] << 8) | code[header + 7]) != end) return -1;
+	return limit == OP_CONSTANT ? OP_FOR_INCR_LOOP_K : OP_FOR_INCR_LOOP;
+}
+#endif
+
+#ifdef SUPERINSTRUCTIONS
+//sequences can overlap, the ones that start inside of another are only ran if something jumps to them or the superinstruction
+//stops before finishing the sequence
+void peephole::fuseSuperinstructions() {
+	uint8_t* code = body->code.data();
+	uInt size = body->code.count();
+	for (uInt offset = 0; offset < size; offset += body->instructionLength(offset)) {
+		uint8_t ops[SEQUENCE_MAX_LENGTH];
+		uInt count = 0;
+		for (uInt next = offset; count < SEQUENCE_MAX_LENGTH && next < size && !isFusedBranch(code[next]); next += body->instructionLength(next)) {
+			ops[count++] = genericOpcode(code[next]);
+		}
+		uInt length;
+		int super = findSuperinstruction(ops, count, length);
+		if (super != -1) code[offset] = super;
+	}
+}
+#endif
+#pragma endregion
+
+#pragma region Helpers
+//first instruction that's still in the code at or after 'offset'(in the unoptimized code), -1 if there is none
+int peephole::firstAliveFrom(uInt offset) {
+	if (offset >= body->code.count()) return -1;
+	for (int i = instrAt[offset]; i < instrs.size(); i++) {
+		if (instrs[i].alive) return i;
+	}
+	return -1;
+}
+
+int peephole::nextAlive(int index) {
+	for (int i = index + 1; i < instrs.size(); i++) {
+		if (instrs[i].alive) return i;
+	}
+	return -1;
+}
+
+int peephole::previousAlive(int index) {
+	for (int i = index - 1; i >= 0; i--) {
+		if (instrs[i].alive) return i;
+	}
+	return -1;
+}
+
+uInt peephole::newLength(peepholeInstr& instr) {
+	if (instr.operandCount != 0) return 1 + instr.operandCount;
+	switch (instr.op) {
+	case OP_POP: return 1;
+	case OP_POPN: return 2;
+	case OP_JUMP:
+	case OP_LOOP:
+	case OP_JUMP_IF_FALSE:
+	case OP_JUMP_IF_TRUE:
+	case OP_JUMP_IF_FALSE_POP:
+		return 3;
+	case OP_JUMP_POPN: return 5;
+	default: return instr.length;
+	}
+}
+
+//removed instructions jump to whatever comes after them
+uInt peephole::mapTarget(uInt offset) {
+	int index = firstAliveFrom(offset);
+	if (index == -1) return newSize;
+	return instrs[index].newStart;
+}
+
+//same as mapTarget, but 'offset' doesn't have to be the start of a instruction(line ends can be in the middle of one)
+uInt peephole::mapOffset(uInt offset) {
+	if (offset >= body->code.count()) return mapTarget(offset);
+	uInt start = offset;
+	while (instrAt[start] == -1) start--;
+	peepholeInstr& instr = instrs[instrAt[start]];
+	if (start == offset || !instr.alive) return mapTarget(start == offset ? offset : instr.start + instr.length);
+	return instr.newStart + std::min(offset - start, newLength(instr));
+}
+#pragma endregion
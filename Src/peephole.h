@@ -0,0 +1,89 @@
+#pragma once
+#include "common.h"
+#include "chunk.h"
+
+//a single decoded instruction of the chunk that's being optimized
+struct peepholeInstr {
+	//offset and length in the unoptimized code
+	uInt start;
+	uInt length;
+	uint8_t op;
+	//absolute offset(in the unoptimized code) this jump goes to
+	uInt target;
+	//number of values popped by OP_POP, OP_POPN and OP_JUMP_POPN
+	uInt count;
+	bool alive;
+	//set if some jump or switch can land on this instruction
+	bool isTarget;
+	//offset in the optimized code
+	uInt newStart;
+	//set once the instruction is fused into a register instruction, which is emitted as op followed by these
+	uint8_t operands[3];
+	uInt operandCount;
+
+	peepholeInstr(uInt _start, uInt _length, uint8_t _op)
+		: start(_start), length(_length), op(_op), target(0), count(0), alive(false), isTarget(false), newStart(0),
+		operands{ 0, 0, 0 }, operandCount(0) {};
+};
+
+//cleans up the bytecode of a finished function: jump threading, removing unreachable code and jumps to the next instruction,
+//removing values that are pushed only to be popped and merging runs of pops into a single OP_POPN
+//
+//the code is only ever shrunk and written back into the same gcVector, so running this never allocates on the GC heap
+//jump offsets, switch table ips, inline cache offsets and the lines table are all rewritten to match the new code
+//
+//with REGISTER_ISA defined it also fuses the instructions that load 2 locals(or a local and a constant), combine them and store
+//the result in a local into a single three-address register instruction(see the Register opcodes in chunk.h),
+//the operands and result never touch the stack, which is where most of the instructions in arithmetic heavy code go
+//
+//with FUSED_BRANCHES defined a comparison followed by OP_JUMP_IF_FALSE_POP is replaced with one that also jumps, and the increment at the
+//end of a counted loop with OP_FOR_INCR_LOOP which also jumps back and checks the loop's condition(see the Fused branches in chunk.h)
+//
+//with SUPERINSTRUCTIONS defined the first instruction of every sequence in superinstructionSet.h is replaced with it's superinstruction
+//once the code is emitted, only the opcode changes so nothing has to be moved
+class peephole {
+public:
+	peephole(chunk* _chunk);
+	void optimize();
+private:
+	chunk* body;
+	vector<peepholeInstr> instrs;
+	//maps every offset in the unoptimized code to the instruction that starts there, -1 for operand bytes
+	vector<int> instrAt;
+	//size of the optimized code
+	uInt newSize;
+
+	void decode();
+	bool isJump(uint8_t op);
+	bool isUnconditional(uint8_t op);
+
+	void threadJumps();
+	void markReachable();
+	void markTargets();
+	vector<uInt> switchTargets(peepholeInstr& instr);
+	void removeJumpsToNext();
+	void mergePops();
+	void removePushPop();
+	void removeDiscardedPostfix();
+	#ifdef REGISTER_ISA
+	void fuseRegisters();
+	int nextFusable(int index);
+	void consumePop(peepholeInstr& pop);
+	bool splitsInlinedCall(uInt start, uInt end);
+	#endif
+	void emit();
+	#ifdef FUSED_BRANCHES
+	void fuseBranches();
+	int countedLoop(uInt offset);
+	#endif
+	#ifdef SUPERINSTRUCTIONS
+	void fuseSuperinstructions();
+	#endif
+
+	int firstAliveFrom(uInt offset);
+	int nextAlive(int index);
+	int previousAlive(int index);
+	uInt newLength(peepholeInstr& instr);
+	uInt mapOffset(uInt offset);
+	uInt mapTarget(uInt offset);
+};
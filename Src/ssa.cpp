@@ -0,0 +1,1177 @@
+#include "ssa.h"
+#include "object.h"
+#include "debug.h"
+#include <algorithm>
+#include <map>
+
+//natives that only look at their arguments and never call back into user code,
+//a call to one of these with invariant arguments gives the same result on every iteration of a loop
+static const char* pureNatives[] = { "arrayLength", "stringLength", "floor", "ceil", "round", "sin", "dsin", "cos", "dcos", "tan", "dtan",
+	"logn", "log2", "log10", "ln", "pow", "sqrt", "sqr" };
+
+static uInt16 readShort(chunk* body, uInt offset) {
+	return (uInt16)((body->code[offset] << 8) | body->code[offset + 1]);
+}
+
+static bool isPureNative(string name) {
+	for (const char* native : pureNatives) {
+		if (name == native) return true;
+	}
+	return false;
+}
+
+ssaFunction::ssaFunction(chunk* _body, int _arity, std::unordered_map<string, std::unordered_set<string>>& _declared, string _name)
+	: declared(_declared) {
+	body = _body;
+	arity = _arity;
+	name = _name;
+}
+
+void ssaFunction::optimize() {
+	if (body->code.count() == 0) return;
+	//dead stores go first, the other passes read values out of slots and need to know which values the slots really hold
+	if (!build()) return;
+	eliminateDeadStores();
+	if (!lower() || !build()) return;
+	hoistInvariants();
+	replaceRedundant();
+	#ifdef DEBUG_PRINT_SSA
+	dump();
+	#endif
+	lower();
+}
+
+#pragma region Building
+bool ssaFunction::build() {
+	instrs.clear();
+	blocks.clear();
+	rpo.clear();
+	values.clear();
+	hoisted.clear();
+	numbers.clear();
+	if (!decode()) return false;
+	findBlocks();
+	if (!computeDepths()) return false;
+	orderBlocks();
+	buildValues();
+	removeTrivialPhis();
+	return true;
+}
+
+bool ssaFunction::decode() {
+	uInt size = body->code.count();
+	instrAt.assign(size + 1, -1);
+	for (uInt offset = 0; offset < size;) {
+		ssaInstr instr(offset, body->instructionLength(offset), body->code[offset]);
+		uInt end = offset + instr.length;
+		switch (instr.op) {
+		case OP_POPN:
+		case OP_GET_LOCAL:
+		case OP_SET_LOCAL:
+			instr.count = body->code[offset + 1];
+			break;
+		case OP_JUMP:
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+		case OP_JUMP_IF_FALSE_POP:
+			instr.target = end + readShort(body, offset + 1);
+			break;
+		case OP_LOOP: instr.target = end - readShort(body, offset + 1); break;
+		case OP_JUMP_POPN:
+			instr.count = readShort(body, offset + 1);
+			instr.target = end + readShort(body, offset + 3);
+			break;
+		//a captured local can change without this function ever writing to it
+		case OP_CLOSURE:
+		case OP_CLOSURE_LONG:
+			for (uInt i = offset + (instr.op == OP_CLOSURE ? 2 : 3); i < end; i += 2) {
+				if (body->code[i] == 1) return false;
+			}
+			break;
+		case OP_CLOSE_UPVALUE:
+		case OP_SWITCH:
+		case OP_FIBER_CREATE:
+		case OP_FIBER_RUN:
+		case OP_FIBER_YIELD:
+			return false;
+		}
+		instrAt[offset] = instrs.size();
+		instrs.push_back(instr);
+		offset = end;
+	}
+	for (ssaInstr& instr : instrs) {
+		if (isJump(instr.op) && instr.target < size && instrAt[instr.target] == -1) return false;
+	}
+	return true;
+}
+
+//pops: values removed from the stack, pushes: values pushed after that, reads: values at the top of the stack the instruction looks at
+bool ssaFunction::stackEffect(ssaInstr& instr, int& pops, int& pushes, int& reads) {
+	uint8_t* code = body->code.data() + instr.start;
+	pops = 0;
+	pushes = 0;
+	reads = 0;
+	switch (instr.op) {
+	case OP_POP: pops = 1; return true;
+	case OP_POPN:
+	case OP_JUMP_POPN:
+		pops = instr.count;
+		return true;
+	case OP_JUMP:
+	case OP_LOOP:
+		return true;
+	case OP_CONSTANT:
+	case OP_CONSTANT_LONG:
+	case OP_NIL:
+	case OP_TRUE:
+	case OP_FALSE:
+	case OP_GET_GLOBAL:
+	case OP_GET_GLOBAL_LONG:
+	case OP_GET_LOCAL:
+	case OP_GET_UPVALUE:
+	case OP_CLOSURE:
+	case OP_CLOSURE_LONG:
+	case OP_CLASS:
+		pushes = 1;
+		break;
+	case OP_NEGATE:
+	case OP_NOT:
+	case OP_BIN_NOT:
+	case OP_ADD_1:
+	case OP_SUBTRACT_1:
+	case OP_TO_STRING:
+	case OP_GET_PROPERTY:
+	case OP_GET_PROPERTY_LONG:
+	case OP_MODULE_GET:
+	case OP_MODULE_GET_LONG:
+		pops = 1;
+		pushes = 1;
+		break;
+	case OP_BITWISE_XOR:
+	case OP_BITWISE_OR:
+	case OP_BITWISE_AND:
+	case OP_ADD:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MOD:
+	case OP_BITSHIFT_LEFT:
+	case OP_BITSHIFT_RIGHT:
+	case OP_EQUAL:
+	case OP_NOT_EQUAL:
+	case OP_GREATER:
+	case OP_GREATER_EQUAL:
+	case OP_LESS:
+	case OP_LESS_EQUAL:
+	case OP_GET:
+	case OP_SET_PROPERTY:
+	case OP_SET_PROPERTY_LONG:
+	case OP_GET_SUPER:
+	case OP_GET_SUPER_LONG:
+		pops = 2;
+		pushes = 1;
+		break;
+	case OP_SET:
+		pops = 3;
+		pushes = 1;
+		break;
+	case OP_PRINT:
+	case OP_DEFINE_GLOBAL:
+	case OP_DEFINE_GLOBAL_LONG:
+	case OP_JUMP_IF_FALSE_POP:
+	case OP_RETURN:
+	case OP_START_MODULE:
+		pops = 1;
+		break;
+	case OP_SET_GLOBAL:
+	case OP_SET_GLOBAL_LONG:
+	case OP_SET_LOCAL:
+	case OP_SET_UPVALUE:
+	case OP_JUMP_IF_FALSE:
+	case OP_JUMP_IF_TRUE:
+		reads = 1;
+		return true;
+	case OP_CREATE_ARRAY:
+	case OP_CREATE_STRUCT:
+	case OP_CREATE_STRUCT_LONG:
+		pops = code[1];
+		pushes = 1;
+		break;
+	case OP_CALL: pops = code[1] + 1; pushes = 1; break;
+	case OP_INVOKE: pops = code[2] + 1; pushes = 1; break;
+	case OP_INVOKE_LONG: pops = code[3] + 1; pushes = 1; break;
+	case OP_SUPER_INVOKE: pops = code[2] + 2; pushes = 1; break;
+	case OP_SUPER_INVOKE_LONG: pops = code[3] + 2; pushes = 1; break;
+	//the class stays on the stack while it's methods are defined
+	case OP_METHOD: pops = 1; reads = 2; return true;
+	case OP_INHERIT: reads = 2; return true;
+	default:
+		return false;
+	}
+	reads = pops;
+	return true;
+}
+
+//blocks start at jump targets and after jumps/returns
+void ssaFunction::findBlocks() {
+	uInt size = body->code.count();
+	vector<bool> leader(instrs.size(), false);
+	leader[0] = true;
+	for (int i = 0; i < instrs.size(); i++) {
+		ssaInstr& instr = instrs[i];
+		if (isJump(instr.op) && instr.target < size) leader[instrAt[instr.target]] = true;
+		if ((isJump(instr.op) || instr.op == OP_RETURN) && i + 1 < instrs.size()) leader[i + 1] = true;
+	}
+	for (int i = 0; i < instrs.size(); i++) {
+		if (leader[i]) blocks.push_back(ssaBlock(i));
+		blocks.back().last = i;
+		instrs[i].block = blocks.size() - 1;
+	}
+	for (int i = 0; i < blocks.size(); i++) {
+		ssaInstr& last = instrs[blocks[i].last];
+		vector<int>& succs = blocks[i].succs;
+		//jumps past the last instruction don't lead anywhere
+		if (isJump(last.op) && last.target < size) succs.push_back(instrs[instrAt[last.target]].block);
+		bool fallsThrough = last.op != OP_JUMP && last.op != OP_LOOP && last.op != OP_JUMP_POPN && last.op != OP_RETURN;
+		if (fallsThrough && i + 1 < blocks.size() && (succs.empty() || succs[0] != i + 1)) succs.push_back(i + 1);
+	}
+}
+
+//every path to a block has to leave the stack at the same depth, which is always true for code the compiler emits
+bool ssaFunction::computeDepths() {
+	blocks[0].depth = arity + 1;
+	vector<int> worklist;
+	worklist.push_back(0);
+	while (!worklist.empty()) {
+		int index = worklist.back();
+		worklist.pop_back();
+		int depth = blocks[index].depth;
+		for (int i = blocks[index].first; i <= blocks[index].last; i++) {
+			ssaInstr& instr = instrs[i];
+			int pops, pushes, reads;
+			if (!stackEffect(instr, pops, pushes, reads) || depth < std::max(pops, reads)) return false;
+			if ((instr.op == OP_GET_LOCAL || instr.op == OP_SET_LOCAL) && instr.count >= depth) return false;
+			depth += pushes - pops;
+			if (depth > UINT8_MAX) return false;
+		}
+		for (int succ : blocks[index].succs) {
+			if (blocks[succ].depth == -1) {
+				blocks[succ].depth = depth;
+				worklist.push_back(succ);
+			}
+			else if (blocks[succ].depth != depth) return false;
+		}
+	}
+	//unreachable code doesn't flow into anything
+	for (int i = 0; i < blocks.size(); i++) {
+		if (blocks[i].depth == -1) continue;
+		for (int succ : blocks[i].succs) blocks[succ].preds.push_back(i);
+	}
+	return true;
+}
+
+//reverse postorder, every block comes after all of it's predecessors other than the ones that loop back to it
+void ssaFunction::orderBlocks() {
+	vector<bool> visited(blocks.size(), false);
+	vector<std::pair<int, int>> stack;
+	stack.push_back(std::make_pair(0, 0));
+	visited[0] = true;
+	while (!stack.empty()) {
+		int index = stack.back().first;
+		int next = stack.back().second;
+		if (next < blocks[index].succs.size()) {
+			stack.back().second++;
+			int succ = blocks[index].succs[next];
+			if (!visited[succ]) {
+				visited[succ] = true;
+				stack.push_back(std::make_pair(succ, 0));
+			}
+			continue;
+		}
+		rpo.push_back(index);
+		stack.pop_back();
+	}
+	std::reverse(rpo.begin(), rpo.end());
+}
+
+//simulates the stack of every block, blocks that can be reached from more than one place get a phi for every slot
+void ssaFunction::buildValues() {
+	vector<int> position(blocks.size(), -1);
+	for (int i = 0; i < rpo.size(); i++) position[rpo[i]] = i;
+	//the function(or receiver) and the arguments
+	vector<int> params;
+	for (int i = 0; i <= arity; i++) {
+		params.push_back(values.size());
+		values.push_back(ssaValue(-1, -1, i));
+	}
+
+	for (int index : rpo) {
+		ssaBlock& block = blocks[index];
+		vector<int> stack;
+		if (index == 0 && block.preds.empty()) stack = params;
+		else if (index != 0 && block.preds.size() == 1 && position[block.preds[0]] < position[index]) stack = blocks[block.preds[0]].exit;
+		else {
+			for (int slot = 0; slot < block.depth; slot++) {
+				stack.push_back(values.size());
+				values.push_back(ssaValue(-1, index, slot));
+			}
+		}
+		block.entry = stack;
+
+		for (int i = block.first; i <= block.last; i++) {
+			ssaInstr& instr = instrs[i];
+			instr.stack = stack;
+			int pops, pushes, reads;
+			stackEffect(instr, pops, pushes, reads);
+			if (instr.op == OP_GET_LOCAL) {
+				instr.result = stack[instr.count];
+				stack.push_back(instr.result);
+				continue;
+			}
+			if (instr.op == OP_SET_LOCAL) {
+				stack[instr.count] = stack.back();
+				continue;
+			}
+			stack.resize(stack.size() - pops);
+			if (pushes == 0) continue;
+			instr.result = values.size();
+			values.push_back(ssaValue(i, -1, -1));
+			stack.push_back(instr.result);
+		}
+		block.exit = stack;
+	}
+
+	for (int i = 0; i < values.size(); i++) {
+		if (values[i].block == -1) continue;
+		ssaBlock& block = blocks[values[i].block];
+		if (values[i].block == 0) values[i].operands.push_back(params[values[i].slot]);
+		for (int pred : block.preds) values[i].operands.push_back(blocks[pred].exit[values[i].slot]);
+	}
+}
+
+//a phi whose operands are all the same value(or the phi itself) is that value, this is what propagates copies between slots
+void ssaFunction::removeTrivialPhis() {
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int i = 0; i < values.size(); i++) {
+			ssaValue& phi = values[i];
+			if (phi.block == -1 || phi.forward != -1) continue;
+			int same = -1;
+			bool trivial = true;
+			for (int operand : phi.operands) {
+				int val = resolve(operand);
+				if (val == i || val == same) continue;
+				if (same != -1) {
+					trivial = false;
+					break;
+				}
+				same = val;
+			}
+			if (!trivial || same == -1) continue;
+			phi.forward = same;
+			changed = true;
+		}
+	}
+}
+
+int ssaFunction::resolve(int value) {
+	while (values[value].forward != -1) value = values[value].forward;
+	return value;
+}
+
+//pure instructions with the same operands get the same number as the first value that computed them
+int ssaFunction::valueNumber(int value) {
+	value = resolve(value);
+	ssaValue& val = values[value];
+	if (val.vn != -1) return val.vn;
+	val.vn = value;
+	if (val.def == -1 || !isPure(instrs[val.def].op)) return val.vn;
+
+	ssaInstr& instr = instrs[val.def];
+	int pops, pushes, reads;
+	stackEffect(instr, pops, pushes, reads);
+	string key = std::to_string(instr.op == OP_CONSTANT_LONG ? OP_CONSTANT : instr.op);
+	if (instr.op == OP_CONSTANT) key += ":" + std::to_string(body->code[instr.start + 1]);
+	else if (instr.op == OP_CONSTANT_LONG) key += ":" + std::to_string(readShort(body, instr.start + 1));
+	for (int i = instr.stack.size() - pops; i < instr.stack.size(); i++) key += ":" + std::to_string(valueNumber(instr.stack[i]));
+
+	auto it = numbers.find(key);
+	if (it != numbers.end()) val.vn = it->second;
+	else numbers[key] = value;
+	return val.vn;
+}
+#pragma endregion
+
+#pragma region Dead store elimination
+//a OP_SET_LOCAL is dead if the slot is popped or written to again before anything reads it
+void ssaFunction::eliminateDeadStores() {
+	//slots whose value is read before it's overwritten or popped, at the start of every block
+	vector<vector<bool>> liveIn(blocks.size(), vector<bool>(UINT8_MAX + 2, false));
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int i = rpo.size() - 1; i >= 0; i--) {
+			ssaBlock& block = blocks[rpo[i]];
+			vector<bool> live(UINT8_MAX + 2, false);
+			for (int succ : block.succs) {
+				for (int slot = 0; slot < live.size(); slot++) live[slot] = live[slot] || liveIn[succ][slot];
+			}
+			for (int j = block.last; j >= block.first; j--) liveBefore(instrs[j], live);
+			if (live == liveIn[rpo[i]]) continue;
+			liveIn[rpo[i]] = live;
+			changed = true;
+		}
+	}
+	//once the live sets are final, every block is walked once more to find the stores nothing reads
+	for (int index : rpo) {
+		ssaBlock& block = blocks[index];
+		vector<bool> live(UINT8_MAX + 2, false);
+		for (int succ : block.succs) {
+			for (int slot = 0; slot < live.size(); slot++) live[slot] = live[slot] || liveIn[succ][slot];
+		}
+		for (int j = block.last; j >= block.first; j--) {
+			ssaInstr& instr = instrs[j];
+			if (instr.op == OP_SET_LOCAL && instr.count < instr.stack.size() - 1 && !live[instr.count]) instr.removed = true;
+			liveBefore(instr, live);
+		}
+	}
+}
+
+void ssaFunction::liveBefore(ssaInstr& instr, vector<bool>& live) {
+	int depth = instr.stack.size();
+	int pops, pushes, reads;
+	stackEffect(instr, pops, pushes, reads);
+	switch (instr.op) {
+	case OP_GET_LOCAL:
+		live[depth] = false;
+		live[instr.count] = true;
+		return;
+	case OP_SET_LOCAL:
+		live[instr.count] = false;
+		live[depth - 1] = true;
+		return;
+	case OP_RETURN:
+		live.assign(live.size(), false);
+		live[depth - 1] = true;
+		return;
+	}
+	for (int slot = depth - pops; slot < std::max(depth, depth - pops + pushes); slot++) live[slot] = false;
+	for (int slot = depth - reads; slot < depth; slot++) live[slot] = true;
+}
+#pragma endregion
+
+#pragma region Loop invariant code motion
+//every loop is the code between it's header and the last OP_LOOP that goes back to it, loops are tried outermost first
+//and a loop that got something hoisted out of it isn't touched again(neither are the loops inside of it)
+void ssaFunction::hoistInvariants() {
+	std::map<int, uInt> loops;
+	for (ssaInstr& instr : instrs) {
+		if (instr.op != OP_LOOP || blocks[instr.block].depth == -1 || instr.target >= body->code.count()) continue;
+		uInt& end = loops[instrAt[instr.target]];
+		end = std::max(end, instr.start + instr.length);
+	}
+	uInt hoistedEnd = 0;
+	for (auto& loop : loops) {
+		if (instrs[loop.first].start < hoistedEnd) continue;
+		if (hoistFrom(loop.first, loop.second)) hoistedEnd = loop.second;
+	}
+}
+
+//moves the biggest invariant expression at the start of the loop condition in front of the loop,
+//the value stays in a new stack slot right under the locals of the loop, which get moved up by one slot
+bool ssaFunction::hoistFrom(int header, uInt end) {
+	ssaLoop loop(instrs[header].start, end);
+	ssaBlock& head = blocks[instrs[header].block];
+	int depth = head.depth;
+	//the loop has to be entered by falling into it from the code right before it
+	if (header == 0) return false;
+	int pre = header - 1;
+	int preBlock = instrs[pre].block;
+	if (blocks[preBlock].depth == -1 || isJump(instrs[pre].op) || instrs[pre].op == OP_RETURN) return false;
+	for (int pred : head.preds) {
+		uInt from = instrs[blocks[pred].last].start;
+		if (pred != preBlock && (from < loop.start || from >= loop.end)) return false;
+	}
+	for (int i = 0; i < blocks.size(); i++) {
+		uInt from = instrs[blocks[i].first].start;
+		if (blocks[i].depth == -1 || (from >= loop.start && from < loop.end)) continue;
+		for (int succ : blocks[i].succs) {
+			uInt to = instrs[blocks[succ].first].start;
+			if (succ != instrs[header].block && to >= loop.start && to < loop.end) return false;
+		}
+	}
+
+	for (int i = header; i < instrs.size() && instrs[i].start < loop.end; i++) {
+		ssaInstr& instr = instrs[i];
+		if (blocks[instr.block].depth == -1) continue;
+		if (instr.stack.size() < depth) return false;
+		if ((instr.op == OP_GET_LOCAL || instr.op == OP_SET_LOCAL) && instr.count >= depth && instr.count + 1 > UINT8_MAX) return false;
+		switch (instr.op) {
+		case OP_CALL:
+			if (!isPureNative(nativeName(instr.stack[instr.stack.size() - body->code[instr.start + 1] - 1]))) loop.userCode = true;
+			break;
+		case OP_INVOKE:
+		case OP_INVOKE_LONG:
+		case OP_SUPER_INVOKE:
+		case OP_SUPER_INVOKE_LONG:
+		case OP_TO_STRING:
+		case OP_DEFINE_GLOBAL:
+		case OP_DEFINE_GLOBAL_LONG:
+			loop.userCode = true;
+			break;
+		case OP_GET: loop.receivers.push_back(instr.stack[instr.stack.size() - 2]); break;
+		case OP_SET: loop.receivers.push_back(instr.stack[instr.stack.size() - 3]); break;
+		case OP_SET_GLOBAL:
+		case OP_SET_GLOBAL_LONG:
+			loop.stored.insert(globalKey(instr));
+			break;
+		}
+	}
+
+	//trees can only start after reads of locals and constants, anything else could have a side effect that has to happen first
+	int bound = header;
+	int first = -1;
+	int last = -1;
+	vector<int> treeStart(depth, -1);
+	for (int i = header; i <= head.last; i++) {
+		ssaInstr& instr = instrs[i];
+		bool leaf = instr.op == OP_GET_LOCAL || (instr.op >= OP_CONSTANT && instr.op <= OP_FALSE);
+		if (!isPure(instr.op) && !leaf && instr.op != OP_GET_GLOBAL && instr.op != OP_GET_GLOBAL_LONG && instr.op != OP_CALL) break;
+		int pops, pushes, reads;
+		stackEffect(instr, pops, pushes, reads);
+		int start = i;
+		for (int slot = treeStart.size() - pops; slot < treeStart.size(); slot++) {
+			if (treeStart[slot] == -1) start = -1;
+		}
+		if (pops > 0 && start != -1) start = treeStart[treeStart.size() - pops];
+		treeStart.resize(treeStart.size() - pops);
+		treeStart.push_back(start);
+		if (start != -1 && start <= bound && i - start >= 2 && i - start > last - first && invariantTree(start, i, loop)) {
+			first = start;
+			last = i;
+		}
+		if (leaf && bound == i) bound = i + 1;
+	}
+	if (first == -1) return false;
+
+	//the hoisted code reads the locals from the slots they're in at the end of the code before the loop
+	vector<int>& preExit = blocks[preBlock].exit;
+	vector<uint8_t> code;
+	for (int i = first; i <= last; i++) {
+		ssaInstr& instr = instrs[i];
+		if (instr.op != OP_GET_LOCAL) {
+			for (uInt j = 0; j < instr.length; j++) code.push_back(body->code[instr.start + j]);
+			continue;
+		}
+		int slot = -1;
+		if (instr.count < preExit.size() && resolve(preExit[instr.count]) == resolve(instr.result)) slot = instr.count;
+		for (int j = preExit.size() - 1; j >= 0 && slot == -1; j--) {
+			if (resolve(preExit[j]) == resolve(instr.result)) slot = j;
+		}
+		if (slot == -1) return false;
+		code.push_back(OP_GET_LOCAL);
+		code.push_back(slot);
+	}
+
+	//every way out of the loop needs to get rid of the value, breaks pop one more value
+	//anything else lands on code that only the loop jumps to and finds the value on top of the stack, so a OP_POP is put in front of that code
+	std::map<int, vector<int>> exits;
+	for (int i = 0; i < blocks.size(); i++) {
+		uInt from = instrs[blocks[i].last].start;
+		if (blocks[i].depth == -1 || from < loop.start || from >= loop.end) continue;
+		for (int succ : blocks[i].succs) {
+			uInt to = instrs[blocks[succ].first].start;
+			if (to < loop.start || to >= loop.end) exits[succ].push_back(i);
+		}
+	}
+	vector<int> breaks;
+	vector<int> landings;
+	for (auto& exit : exits) {
+		ssaBlock& target = blocks[exit.first];
+		bool prefix = false;
+		for (int from : exit.second) {
+			if (instrs[blocks[from].last].op != OP_JUMP_POPN) prefix = true;
+		}
+		if (!prefix) {
+			if (target.depth > depth) return false;
+			for (int from : exit.second) {
+				if (instrs[blocks[from].last].count + 1 > UINT16_MAX) return false;
+				breaks.push_back(blocks[from].last);
+			}
+			continue;
+		}
+		if (target.depth != depth) return false;
+		for (int pred : target.preds) {
+			uInt from = instrs[blocks[pred].last].start;
+			if (from < loop.start || from >= loop.end) return false;
+		}
+		landings.push_back(target.first);
+	}
+
+	instrs[pre].suffix = code;
+	instrs[pre].suffixLine = instrs[last].start;
+	for (int i = first; i < last; i++) instrs[i].removed = true;
+	instrs[last].newSlot = depth;
+	instrs[last].fixedSlot = true;
+	for (int index : breaks) instrs[index].countDelta++;
+	for (int index : landings) instrs[index].prefix.push_back(OP_POP);
+	hoisted.push_back(hoistedLoop(loop.start, loop.end, depth));
+	return true;
+}
+
+//values defined outside of the loop never change while it runs
+bool ssaFunction::invariant(int value, ssaLoop& loop) {
+	ssaValue& val = values[resolve(value)];
+	uInt start;
+	if (val.def != -1) start = instrs[val.def].start;
+	else if (val.block != -1) start = instrs[blocks[val.block].first].start;
+	else return true;
+	return start < loop.start || start >= loop.end;
+}
+
+bool ssaFunction::invariantTree(int first, int last, ssaLoop& loop) {
+	int array = -1;
+	bool needsNoUserCode = false;
+	for (int i = first; i <= last; i++) {
+		ssaInstr& instr = instrs[i];
+		switch (instr.op) {
+		case OP_GET_LOCAL:
+			if (!invariant(instr.result, loop)) return false;
+			break;
+		//globals other than natives can be changed by user code
+		case OP_GET_GLOBAL:
+		case OP_GET_GLOBAL_LONG:
+			if (nativeName(instr.result) != "") break;
+			if (loop.stored.count(globalKey(instr)) > 0) return false;
+			needsNoUserCode = true;
+			break;
+		case OP_CALL: {
+			string native = nativeName(instr.stack[instr.stack.size() - body->code[instr.start + 1] - 1]);
+			if (!isPureNative(native)) return false;
+			if (native != "arrayLength") break;
+			//the length of the array can only change if something in the loop calls code that could change it
+			if (array != -1 && !sameValue(array, instr.stack.back(), loop)) return false;
+			array = instr.stack.back();
+			needsNoUserCode = true;
+			break;
+		}
+		}
+	}
+	if (needsNoUserCode && runsUserCode(loop, array)) return false;
+	//inlined code can't be moved out of the range that gives runtime errors their callstack entry
+	uInt start = instrs[first].start;
+	uInt end = instrs[last].start + instrs[last].length;
+	for (inlinedCall& call : body->inlined) {
+		if (call.start < end && start < call.end) return false;
+	}
+	return true;
+}
+
+//indexing anything other than the array whose length is hoisted could be a instance with a access/set method
+bool ssaFunction::runsUserCode(ssaLoop& loop, int array) {
+	if (loop.userCode) return true;
+	for (int receiver : loop.receivers) {
+		if (array == -1 || !sameValue(receiver, array, loop)) return true;
+	}
+	return false;
+}
+
+//2 reads of a global the loop never writes to are the same value
+bool ssaFunction::sameValue(int a, int b, ssaLoop& loop) {
+	a = resolve(a);
+	b = resolve(b);
+	if (a == b) return true;
+	int defA = values[a].def;
+	int defB = values[b].def;
+	if (defA == -1 || defB == -1) return false;
+	uint8_t opA = instrs[defA].op;
+	uint8_t opB = instrs[defB].op;
+	if ((opA != OP_GET_GLOBAL && opA != OP_GET_GLOBAL_LONG) || (opB != OP_GET_GLOBAL && opB != OP_GET_GLOBAL_LONG)) return false;
+	uInt64 key = globalKey(instrs[defA]);
+	return key == globalKey(instrs[defB]) && loop.stored.count(key) == 0;
+}
+#pragma endregion
+
+#pragma region Global value numbering
+//a pure expression whose value is already in a slot below it is replaced by a read of that slot
+//
+//expressions are found as trees: a run of reads of locals, constants and pure operations that together push a single value
+void ssaFunction::replaceRedundant() {
+	for (int index : rpo) {
+		ssaBlock& block = blocks[index];
+		//first instruction of the tree that computed the value in each slot, -1 if it isn't part of a tree
+		vector<int> treeStart(block.depth, -1);
+		for (int i = block.first; i <= block.last; i++) {
+			ssaInstr& instr = instrs[i];
+			int pops, pushes, reads;
+			stackEffect(instr, pops, pushes, reads);
+			bool edited = instr.removed || instr.newSlot != -1 || !instr.prefix.empty() || !instr.suffix.empty() || instr.countDelta != 0;
+			if (edited || (!isPure(instr.op) && instr.op != OP_GET_LOCAL)) {
+				//code after anything else can't be part of the same tree as code before it
+				treeStart.assign(treeStart.size() - pops, -1);
+				treeStart.resize(treeStart.size() + pushes, -1);
+				continue;
+			}
+			int start = i;
+			for (int slot = treeStart.size() - pops; slot < treeStart.size(); slot++) {
+				if (treeStart[slot] == -1) start = -1;
+			}
+			if (pops > 0 && start != -1) start = treeStart[treeStart.size() - pops];
+			treeStart.resize(treeStart.size() - pops);
+			treeStart.push_back(start);
+			if (start == -1 || start == i) continue;
+
+			int vn = valueNumber(instr.result);
+			vector<int>& stack = instrs[start].stack;
+			for (int slot = stack.size() - 1; slot >= 0; slot--) {
+				if (valueNumber(stack[slot]) != vn) continue;
+				for (int j = start; j < i; j++) {
+					instrs[j].removed = true;
+					instrs[j].newSlot = -1;
+				}
+				instr.newSlot = slot;
+				break;
+			}
+		}
+	}
+}
+#pragma endregion
+
+#pragma region Type inference
+#ifdef DEBUG_TYPE_INFERENCE
+//arithmetic and comparison instructions seen and specialized in every function compiled so far
+static uInt sitesTotal = 0;
+static uInt specializedTotal = 0;
+#endif
+
+//replaces arithmetic and comparisons whose operands always have the right type with the unchecked instructions,
+//the opcode is the only thing that changes so the code is patched in place
+void ssaFunction::specializeTypes() {
+	if (body->code.count() == 0 || !build()) return;
+	vector<std::set<int>> entry(blocks.size());
+	vector<std::set<int>> exit(blocks.size());
+	provenNumbers(entry, exit);
+	inferTypes(entry, exit);
+
+	uInt sites = 0;
+	uInt specialized = 0;
+	for (int index : rpo) {
+		std::set<int> known = entry[index];
+		for (int i = blocks[index].first; i <= blocks[index].last; i++) {
+			ssaInstr& instr = instrs[i];
+			uint8_t typed = typedOpcode(instr, known);
+			if (typed != OP_POP) sites++;
+			if (typed != OP_POP && typed != instr.op) {
+				body->code[instr.start] = typed;
+				specialized++;
+			}
+			usedAsNumbers(instr, known);
+		}
+	}
+	#ifdef DEBUG_TYPE_INFERENCE
+	sitesTotal += sites;
+	specializedTotal += specialized;
+	std::cout << name << ": specialized " << specialized << " of " << sites << " arithmetic/comparison instructions, "
+		<< specializedTotal << " of " << sitesTotal << " so far\n";
+	#endif
+}
+
+//values that every path to the start/end of a block has already used as a number, blocks start out knowing everything
+//and lose what one of their predecessors doesn't know, the function itself starts knowing nothing
+void ssaFunction::provenNumbers(vector<std::set<int>>& entry, vector<std::set<int>>& exit) {
+	vector<bool> visited(blocks.size(), false);
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int index : rpo) {
+			ssaBlock& block = blocks[index];
+			std::set<int> known;
+			bool first = true;
+			for (int pred : block.preds) {
+				if (index == 0 || !visited[pred]) continue;
+				if (first) known = exit[pred];
+				else {
+					std::set<int> both;
+					for (int value : known) {
+						if (exit[pred].count(value) > 0) both.insert(value);
+					}
+					known = both;
+				}
+				first = false;
+			}
+			entry[index] = known;
+			for (int i = block.first; i <= block.last; i++) usedAsNumbers(instrs[i], known);
+			if (visited[index] && known == exit[index]) continue;
+			visited[index] = true;
+			exit[index] = known;
+			changed = true;
+		}
+	}
+}
+
+//if the instruction didn't throw, the operands it reads as numbers are numbers
+void ssaFunction::usedAsNumbers(ssaInstr& instr, std::set<int>& known) {
+	vector<int>& stack = instr.stack;
+	switch (instr.op) {
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MOD:
+	case OP_BITSHIFT_LEFT:
+	case OP_BITSHIFT_RIGHT:
+	case OP_BITWISE_AND:
+	case OP_BITWISE_OR:
+	case OP_BITWISE_XOR:
+	case OP_GREATER:
+	case OP_GREATER_EQUAL:
+	case OP_LESS:
+	case OP_LESS_EQUAL:
+		known.insert(resolve(stack[stack.size() - 2]));
+		known.insert(resolve(stack.back()));
+		break;
+	case OP_NEGATE:
+	case OP_BIN_NOT:
+	case OP_ADD_1:
+	case OP_SUBTRACT_1:
+		known.insert(resolve(stack.back()));
+		break;
+	}
+}
+
+//types only ever grow, so this settles once a pass over the function changes nothing
+void ssaFunction::inferTypes(vector<std::set<int>>& entry, vector<std::set<int>>& exit) {
+	//the function(or receiver) and the arguments can be anything
+	for (ssaValue& val : values) {
+		if (val.def == -1 && val.block == -1) val.type = SSA_ANY;
+	}
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int index : rpo) {
+			ssaBlock& block = blocks[index];
+			//a phi can be any of the values it merges, as seen at the end of the block each of them comes from
+			for (int slot = 0; slot < block.entry.size(); slot++) {
+				ssaValue& phi = values[block.entry[slot]];
+				if (phi.block != index || phi.forward != -1) continue;
+				int type = phi.type;
+				for (int i = 0; i < phi.operands.size(); i++) {
+					int operand = resolve(phi.operands[i]);
+					//the first operand of a phi at the start of the function is the parameter
+					if (index == 0 && i == 0) type |= values[operand].type;
+					else type |= operandType(operand, exit[block.preds[index == 0 ? i - 1 : i]]);
+				}
+				if (type == phi.type) continue;
+				phi.type = type;
+				changed = true;
+			}
+			std::set<int> known = entry[index];
+			for (int i = block.first; i <= block.last; i++) {
+				ssaInstr& instr = instrs[i];
+				if (instr.result != -1 && instr.op != OP_GET_LOCAL) {
+					ssaValue& val = values[instr.result];
+					int type = val.type | resultType(instr, known);
+					if (type != val.type) {
+						val.type = type;
+						changed = true;
+					}
+				}
+				usedAsNumbers(instr, known);
+			}
+		}
+	}
+}
+
+int ssaFunction::resultType(ssaInstr& instr, std::set<int>& known) {
+	vector<int>& stack = instr.stack;
+	switch (instr.op) {
+	case OP_CONSTANT:
+	case OP_CONSTANT_LONG: {
+		Value val = body->constants[instr.op == OP_CONSTANT ? body->code[instr.start + 1] : readShort(body, instr.start + 1)];
+		if (IS_NUMBER(val)) return SSA_NUMBER;
+		if (IS_STRING(val)) return SSA_STRING;
+		if (IS_BOOL(val)) return SSA_BOOL;
+		if (IS_NIL(val)) return SSA_NIL;
+		return SSA_OTHER;
+	}
+	case OP_NIL: return SSA_NIL;
+	case OP_TRUE:
+	case OP_FALSE:
+	case OP_NOT:
+	case OP_EQUAL:
+	case OP_NOT_EQUAL:
+	case OP_GREATER:
+	case OP_GREATER_EQUAL:
+	case OP_LESS:
+	case OP_LESS_EQUAL:
+		return SSA_BOOL;
+	case OP_NEGATE:
+	case OP_BIN_NOT:
+	case OP_ADD_1:
+	case OP_SUBTRACT_1:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MOD:
+	case OP_BITSHIFT_LEFT:
+	case OP_BITSHIFT_RIGHT:
+	case OP_BITWISE_AND:
+	case OP_BITWISE_OR:
+	case OP_BITWISE_XOR:
+		return SSA_NUMBER;
+	//adding anything to a number only works if it's a number, same for strings
+	case OP_ADD: {
+		int a = operandType(stack[stack.size() - 2], known);
+		int b = operandType(stack.back(), known);
+		if (a == SSA_NUMBER || b == SSA_NUMBER) return SSA_NUMBER;
+		if (a == SSA_STRING || b == SSA_STRING) return SSA_STRING;
+		return (a | b) & (SSA_NUMBER | SSA_STRING);
+	}
+	//every pure native returns a number
+	case OP_CALL:
+		if (isPureNative(nativeName(stack[stack.size() - body->code[instr.start + 1] - 1]))) return SSA_NUMBER;
+		return SSA_ANY;
+	default:
+		return SSA_ANY;
+	}
+}
+
+int ssaFunction::operandType(int value, std::set<int>& known) {
+	value = resolve(value);
+	if (known.count(value) > 0) return SSA_NUMBER;
+	return values[value].type;
+}
+
+//unchecked instruction to use in place of a arithmetic or comparison instruction, the same opcode if the types aren't certain
+//and OP_POP for instructions that can't be specialized
+uint8_t ssaFunction::typedOpcode(ssaInstr& instr, std::set<int>& known) {
+	vector<int>& stack = instr.stack;
+	int b = stack.empty() ? 0 : operandType(stack.back(), known);
+	int a = stack.size() < 2 ? 0 : operandType(stack[stack.size() - 2], known);
+	bool numbers = a == SSA_NUMBER && b == SSA_NUMBER;
+	switch (instr.op) {
+	case OP_ADD:
+		if (numbers) return OP_ADD_NUM;
+		if (a == SSA_STRING && b == SSA_STRING) return OP_ADD_STRING;
+		return OP_ADD;
+	case OP_SUBTRACT: return numbers ? OP_SUBTRACT_NUM : OP_SUBTRACT;
+	case OP_MULTIPLY: return numbers ? OP_MULTIPLY_NUM : OP_MULTIPLY;
+	case OP_DIVIDE: return numbers ? OP_DIVIDE_NUM : OP_DIVIDE;
+	case OP_GREATER: return numbers ? OP_GREATER_NUM : OP_GREATER;
+	case OP_GREATER_EQUAL: return numbers ? OP_GREATER_EQUAL_NUM : OP_GREATER_EQUAL;
+	case OP_LESS: return numbers ? OP_LESS_NUM : OP_LESS;
+	case OP_LESS_EQUAL: return numbers ? OP_LESS_EQUAL_NUM : OP_LESS_EQUAL;
+	case OP_ADD_1: return b == SSA_NUMBER ? OP_ADD_1_NUM : OP_ADD_1;
+	case OP_SUBTRACT_1: return b == SSA_NUMBER ? OP_SUBTRACT_1_NUM : OP_SUBTRACT_1;
+	default:
+		return OP_POP;
+	}
+}
+#pragma endregion
+
+#pragma region Lowering
+//writes the code with every edit applied back into the chunk, nothing changes if a jump doesn't fit anymore
+bool ssaFunction::lower() {
+	bool edited = false;
+	for (ssaInstr& instr : instrs) {
+		if (instr.removed || instr.newSlot != -1 || !instr.prefix.empty() || !instr.suffix.empty() || instr.countDelta != 0) edited = true;
+	}
+	if (!edited) return true;
+
+	newSize = 0;
+	for (ssaInstr& instr : instrs) {
+		instr.newStart = newSize;
+		newSize += instr.prefix.size() + instr.suffix.size();
+		if (!instr.removed) newSize += instr.newSlot != -1 ? 2 : instr.length;
+	}
+	//index into the lines table for every byte of the old code
+	uInt oldSize = body->code.count();
+	vector<int> lineAt(oldSize);
+	for (uInt i = 0, line = 0; i < oldSize; i++) {
+		while (body->lines[line].end <= i && line + 1 < body->lines.size()) line++;
+		lineAt[i] = line;
+	}
+
+	vector<uint8_t> out;
+	vector<int> outLines;
+	out.reserve(newSize);
+	for (int index = 0; index < instrs.size(); index++) {
+		ssaInstr& instr = instrs[index];
+		for (uint8_t byte : instr.prefix) out.push_back(byte);
+		if (instr.removed);
+		else if (instr.newSlot != -1) {
+			out.push_back(OP_GET_LOCAL);
+			out.push_back(instr.fixedSlot ? instr.newSlot : shiftSlot(index, instr.newSlot));
+		}
+		else {
+			uInt end = out.size() + instr.length;
+			uInt target = isJump(instr.op) ? mapTarget(instr.target) : 0;
+			switch (instr.op) {
+			case OP_GET_LOCAL:
+			case OP_SET_LOCAL:
+				out.push_back(instr.op);
+				out.push_back(shiftSlot(index, instr.count));
+				break;
+			case OP_JUMP:
+			case OP_JUMP_IF_FALSE:
+			case OP_JUMP_IF_TRUE:
+			case OP_JUMP_IF_FALSE_POP:
+				if (target < end || target - end > UINT16_MAX) return false;
+				out.push_back(instr.op);
+				out.push_back(((target - end) >> 8) & 0xff);
+				out.push_back((target - end) & 0xff);
+				break;
+			case OP_LOOP:
+				if (target > end || end - target > UINT16_MAX) return false;
+				out.push_back(OP_LOOP);
+				out.push_back(((end - target) >> 8) & 0xff);
+				out.push_back((end - target) & 0xff);
+				break;
+			case OP_JUMP_POPN: {
+				uInt count = instr.count + instr.countDelta;
+				if (target < end || target - end > UINT16_MAX) return false;
+				out.push_back(OP_JUMP_POPN);
+				out.push_back((count >> 8) & 0xff);
+				out.push_back(count & 0xff);
+				out.push_back(((target - end) >> 8) & 0xff);
+				out.push_back((target - end) & 0xff);
+				break;
+			}
+			default:
+				for (uInt i = 0; i < instr.length; i++) out.push_back(body->code[instr.start + i]);
+				break;
+			}
+		}
+		outLines.resize(out.size(), lineAt[instr.start]);
+		for (uint8_t byte : instr.suffix) out.push_back(byte);
+		outLines.resize(out.size(), lineAt[instr.suffixLine]);
+	}
+
+	vector<codeLine> lines;
+	for (uInt i = 0; i < newSize; i++) {
+		codeLine& line = body->lines[outLines[i]];
+		if (!lines.empty() && lines.back().line == line.line && lines.back().name == line.name) continue;
+		if (!lines.empty()) lines.back().end = i;
+		lines.push_back(line);
+	}
+	lines.back().end = newSize;
+	body->lines = lines;
+	for (inlineCache& cache : body->caches) {
+		ssaInstr& instr = instrs[instrAt[cache.offset]];
+		cache.offset = instr.newStart + instr.prefix.size();
+	}
+	vector<inlinedCall> inlined;
+	for (inlinedCall& call : body->inlined) {
+		call.start = mapTarget(call.start);
+		call.end = mapTarget(call.end);
+		if (call.start != call.end) inlined.push_back(call);
+	}
+	body->inlined = inlined;
+
+	body->code.resize(newSize);
+	for (uInt i = 0; i < newSize; i++) body->code[i] = out[i];
+	return true;
+}
+
+//jumps to a instruction land on it's prefix
+uInt ssaFunction::mapTarget(uInt offset) {
+	if (offset >= instrAt.size() - 1) return newSize;
+	return instrs[instrAt[offset]].newStart;
+}
+
+//locals of a loop that had something hoisted out of it are one slot higher
+uInt ssaFunction::shiftSlot(int index, uInt slot) {
+	for (hoistedLoop& loop : hoisted) {
+		if (instrs[index].start >= loop.start && instrs[index].start < loop.end && slot >= loop.slot) return slot + 1;
+	}
+	return slot;
+}
+#pragma endregion
+
+#pragma region Helpers
+//everything from OP_CONSTANT to OP_LESS_EQUAL only depends on it's operands, and can't do anything other than throw a runtime error
+bool ssaFunction::isPure(uint8_t op) {
+	return op >= OP_CONSTANT && op <= OP_LESS_EQUAL;
+}
+
+bool ssaFunction::isJump(uint8_t op) {
+	switch (op) {
+	case OP_JUMP:
+	case OP_JUMP_IF_FALSE:
+	case OP_JUMP_IF_TRUE:
+	case OP_JUMP_IF_FALSE_POP:
+	case OP_LOOP:
+	case OP_JUMP_POPN:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//name of the native a value always holds, only reads of globals the module never declares are bound to natives
+string ssaFunction::nativeName(int value) {
+	int def = values[resolve(value)].def;
+	if (def == -1) return "";
+	ssaInstr& instr = instrs[def];
+	uInt mod;
+	uInt slot;
+	if (instr.op == OP_GET_GLOBAL) {
+		mod = body->code[instr.start + 1];
+		slot = body->code[instr.start + 2];
+	}
+	else if (instr.op == OP_GET_GLOBAL_LONG) {
+		mod = readShort(body, instr.start + 1);
+		slot = readShort(body, instr.start + 3);
+	}
+	else return "";
+	objModule* module = AS_MODULE(body->constants[mod]);
+	objString* str = module->slotName(slot);
+	auto it = declared.find(string(module->name->str, module->name->length));
+	if (str == nullptr || it == declared.end()) return "";
+	string native(str->str, str->length);
+	if (it->second.count(native) > 0) return "";
+	return native;
+}
+
+//module constant and slot of a OP_GET_GLOBAL or OP_SET_GLOBAL
+uInt64 ssaFunction::globalKey(ssaInstr& instr) {
+	if (instr.op == OP_GET_GLOBAL || instr.op == OP_SET_GLOBAL) {
+		return ((uInt64)body->code[instr.start + 1] << 16) | body->code[instr.start + 2];
+	}
+	return ((uInt64)readShort(body, instr.start + 1) << 16) | readShort(body, instr.start + 3);
+}
+
+void ssaFunction::dump() {
+	std::cout << "=======" << name << " ssa=======\n";
+	for (int index : rpo) {
+		ssaBlock& block = blocks[index];
+		std::cout << "block " << index << ", depth " << block.depth << ", preds:";
+		for (int pred : block.preds) std::cout << " " << pred;
+		std::cout << "\n";
+		for (int slot = 0; slot < block.entry.size(); slot++) {
+			ssaValue& phi = values[block.entry[slot]];
+			if (phi.block != index || phi.forward != -1) continue;
+			std::cout << "                v" << block.entry[slot] << " = phi(";
+			for (int i = 0; i < phi.operands.size(); i++) std::cout << (i > 0 ? ", v" : "v") << resolve(phi.operands[i]);
+			std::cout << ") in slot " << slot << "\n";
+		}
+		for (int i = block.first; i <= block.last; i++) {
+			ssaInstr& instr = instrs[i];
+			disassembleInstruction(body, instr.start);
+			int pops, pushes, reads;
+			stackEffect(instr, pops, pushes, reads);
+			std::cout << "                ";
+			if (instr.op == OP_GET_UPVALUE) std::cout << "load upvalue " << (int)body->code[instr.start + 1] << " ";
+			if (instr.op == OP_SET_UPVALUE) std::cout << "store upvalue " << (int)body->code[instr.start + 1] << " ";
+			for (int slot = instr.stack.size() - reads; slot < instr.stack.size(); slot++) std::cout << "v" << resolve(instr.stack[slot]) << " ";
+			if (instr.result != -1) std::cout << "-> v" << resolve(instr.result);
+			if (!instr.prefix.empty()) std::cout << " [pop before]";
+			if (instr.removed) std::cout << " [removed]";
+			if (instr.newSlot != -1) std::cout << " [read slot " << instr.newSlot << "]";
+			if (instr.countDelta != 0) std::cout << " [pops " << instr.countDelta << " more]";
+			if (!instr.suffix.empty()) std::cout << " [hoisted " << instr.suffix.size() << " bytes after]";
+			std::cout << "\n";
+		}
+	}
+}
+#pragma endregion
@@ -0,0 +1,178 @@
+#pragma once
+#include "common.h"
+#include "chunk.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+
+//types a value can have, the type of a value is the set of every type it could have at runtime
+enum ssaType {
+	SSA_NUMBER = 1,
+	SSA_STRING = 2,
+	SSA_BOOL = 4,
+	SSA_NIL = 8,
+	SSA_OTHER = 16,
+	SSA_ANY = 31
+};
+
+//every value pushed onto the stack of the function gets it's own id, phis merge the values a stack slot holds at the end of each predecessor
+struct ssaValue {
+	//instruction that pushed the value, -1 for parameters and phis
+	int def;
+	//block and stack slot of a phi, -1 for everything else
+	int block;
+	int slot;
+	vector<int> operands;
+	//trivial phis forward every use to the one value they always hold
+	int forward;
+	//values with the same number are guaranteed to be equal, -1 until numbered
+	int vn;
+	//set of ssaType, 0 until the type inference reaches the value
+	int type;
+	ssaValue(int _def, int _block, int _slot) : def(_def), block(_block), slot(_slot), forward(-1), vn(-1), type(0) {}
+};
+
+struct ssaInstr {
+	//offset and length in the code before lowering
+	uInt start;
+	uInt length;
+	uint8_t op;
+	int block;
+	//absolute offset a jump goes to
+	uInt target;
+	//number of values popped by OP_POPN and OP_JUMP_POPN, slot of OP_GET_LOCAL/OP_SET_LOCAL
+	uInt count;
+	//values on the stack right before this instruction executes, slot 0 is the function/receiver
+	vector<int> stack;
+	//value this instruction pushes, -1 if it doesn't push anything
+	//OP_GET_LOCAL only copies the value in the slot, so it doesn't create a new one
+	int result;
+
+	//edits made by the passes, applied when lowering
+	bool removed;
+	//replaces the instruction with OP_GET_LOCAL newSlot, fixed slots aren't moved by a hoisted loop
+	int newSlot;
+	bool fixedSlot;
+	//added to the count of OP_JUMP_POPN
+	int countDelta;
+	//code emitted before/after the instruction, jumps to the instruction land on the prefix
+	vector<uint8_t> prefix;
+	vector<uint8_t> suffix;
+	//offset in the original code whose line the suffix belongs to
+	uInt suffixLine;
+	//offset in the lowered code
+	uInt newStart;
+
+	ssaInstr(uInt _start, uInt _length, uint8_t _op) : start(_start), length(_length), op(_op), block(-1), target(0), count(0), result(-1),
+		removed(false), newSlot(-1), fixedSlot(false), countDelta(0), suffixLine(0), newStart(0) {}
+};
+
+struct ssaBlock {
+	//index of the first and last instruction
+	int first;
+	int last;
+	vector<int> preds;
+	vector<int> succs;
+	//stack depth on entry, -1 if the block is unreachable
+	int depth;
+	vector<int> entry;
+	vector<int> exit;
+	ssaBlock(int _first) : first(_first), last(_first), depth(-1) {}
+};
+
+//a loop that has a invariant expression moved in front of it, the value lives in a new stack slot under the loop's locals
+struct hoistedLoop {
+	uInt start;
+	uInt end;
+	uInt slot;
+	hoistedLoop(uInt _start, uInt _end, uInt _slot) : start(_start), end(_end), slot(_slot) {}
+};
+
+//what a loop does that decides which of the values it uses can change while it runs
+struct ssaLoop {
+	//offsets of the header and the end of the last OP_LOOP back to it
+	uInt start;
+	uInt end;
+	//something in the loop can run user code(calls, invokes, toString, metamethods of instances)
+	bool userCode;
+	//receivers of OP_GET/OP_SET, these only stay out of user code if they're arrays
+	vector<int> receivers;
+	//global slots written by the loop
+	std::unordered_set<uInt64> stored;
+	ssaLoop(uInt _start, uInt _end) : start(_start), end(_end), userCode(false) {}
+};
+
+//SSA form of a finished function: basic blocks, values for every stack slot, phis where control flow merges
+//and explicit upvalue loads/stores(OP_GET_UPVALUE pushes a new value every time, OP_SET_UPVALUE is a store)
+//
+//the compiler emits a stack machine and decides the slot of every local, so the IR is lifted from the finished chunk:
+//locals are stack slots, OP_GET_LOCAL/OP_SET_LOCAL are copies between slots and removing trivial phis propagates the copies
+//passes only ever mark edits on the instructions(remove, replace with a read of a slot, prefix/suffix code), lowering
+//then writes the new code back into the chunk along with the jump offsets, lines, inline caches and inlined ranges
+//
+//functions that capture their own locals, switch or use fibers are left alone
+//
+//the type inference runs on the final code and only ever changes opcodes, a instruction is specialized if every value it uses
+//is always a number(or a string), either because of where the value came from or because a earlier instruction on every path
+//to it already used the value as a number and would have thrown a runtime error otherwise
+class ssaFunction {
+public:
+	ssaFunction(chunk* _body, int _arity, std::unordered_map<string, std::unordered_set<string>>& _declared, string _name);
+	void optimize();
+	void specializeTypes();
+private:
+	chunk* body;
+	int arity;
+	//names each module declares at the top level, reads of any other global are bound to the native with that name
+	std::unordered_map<string, std::unordered_set<string>>& declared;
+	string name;
+
+	vector<ssaInstr> instrs;
+	vector<int> instrAt;
+	vector<ssaBlock> blocks;
+	vector<int> rpo;
+	vector<ssaValue> values;
+	vector<hoistedLoop> hoisted;
+	//size of the code once it's lowered
+	uInt newSize;
+	//expression -> first value that computed it
+	std::unordered_map<string, int> numbers;
+
+	bool build();
+	bool decode();
+	bool stackEffect(ssaInstr& instr, int& pops, int& pushes, int& reads);
+	void findBlocks();
+	bool computeDepths();
+	void orderBlocks();
+	void buildValues();
+	void removeTrivialPhis();
+	int resolve(int value);
+	int valueNumber(int value);
+
+	void eliminateDeadStores();
+	void liveBefore(ssaInstr& instr, vector<bool>& live);
+	void hoistInvariants();
+	bool hoistFrom(int header, uInt end);
+	bool invariant(int value, ssaLoop& loop);
+	bool invariantTree(int first, int last, ssaLoop& loop);
+	bool runsUserCode(ssaLoop& loop, int array);
+	bool sameValue(int a, int b, ssaLoop& loop);
+	void replaceRedundant();
+
+	void provenNumbers(vector<std::set<int>>& entry, vector<std::set<int>>& exit);
+	void usedAsNumbers(ssaInstr& instr, std::set<int>& known);
+	void inferTypes(vector<std::set<int>>& entry, vector<std::set<int>>& exit);
+	int resultType(ssaInstr& instr, std::set<int>& known);
+	int operandType(int value, std::set<int>& known);
+	uint8_t typedOpcode(ssaInstr& instr, std::set<int>& known);
+
+	bool lower();
+	void dump();
+
+	bool isPure(uint8_t op);
+	bool isJump(uint8_t op);
+	string nativeName(int value);
+	uInt64 globalKey(ssaInstr& instr);
+	uInt mapTarget(uInt offset);
+	uInt shiftSlot(int index, uInt slot);
+};
@@ -0,0 +1,256 @@
+#include "superinstruction.h"
+#include "chunk.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+static const fusableInstr fusable[] = {
+	{ OP_GET_LOCAL, "OP_GET_LOCAL", false },
+	{ OP_SET_LOCAL, "OP_SET_LOCAL", false },
+	{ OP_GET_UPVALUE, "OP_GET_UPVALUE", false },
+	{ OP_SET_UPVALUE, "OP_SET_UPVALUE", false },
+	{ OP_GET_GLOBAL, "OP_GET_GLOBAL", false },
+	{ OP_SET_GLOBAL, "OP_SET_GLOBAL", false },
+	{ OP_CONSTANT, "OP_CONSTANT", false },
+	{ OP_NIL, "OP_NIL", false },
+	{ OP_TRUE, "OP_TRUE", false },
+	{ OP_FALSE, "OP_FALSE", false },
+	{ OP_POP, "OP_POP", false },
+	{ OP_POPN, "OP_POPN", false },
+	{ OP_ADD, "OP_ADD", false },
+	{ OP_SUBTRACT, "OP_SUBTRACT", false },
+	{ OP_MULTIPLY, "OP_MULTIPLY", false },
+	{ OP_DIVIDE, "OP_DIVIDE", false },
+	{ OP_MOD, "OP_MOD", false },
+	{ OP_ADD_1, "OP_ADD_1", false },
+	{ OP_SUBTRACT_1, "OP_SUBTRACT_1", false },
+	{ OP_EQUAL, "OP_EQUAL", false },
+	{ OP_NOT_EQUAL, "OP_NOT_EQUAL", false },
+	{ OP_GREATER, "OP_GREATER", false },
+	{ OP_GREATER_EQUAL, "OP_GREATER_EQUAL", false },
+	{ OP_LESS, "OP_LESS", false },
+	{ OP_LESS_EQUAL, "OP_LESS_EQUAL", false },
+	{ OP_NOT, "OP_NOT", false },
+	{ OP_GET, "OP_GET", false },
+	{ OP_SET, "OP_SET", false },
+	{ OP_JUMP, "OP_JUMP", true },
+	{ OP_JUMP_IF_FALSE, "OP_JUMP_IF_FALSE", true },
+	{ OP_JUMP_IF_TRUE, "OP_JUMP_IF_TRUE", true },
+	{ OP_JUMP_IF_FALSE_POP, "OP_JUMP_IF_FALSE_POP", true },
+};
+
+const fusableInstr* findFusable(uint8_t op) {
+	for (const fusableInstr& instr : fusable) {
+		if (instr.op == op) return &instr;
+	}
+	return nullptr;
+}
+
+const fusableInstr* findFusable(string name) {
+	for (const fusableInstr& instr : fusable) {
+		if (name == instr.name) return &instr;
+	}
+	return nullptr;
+}
+
+#pragma region Superinstructions
+struct superSequence {
+	uint8_t op;
+	uint8_t ops[SEQUENCE_MAX_LENGTH];
+};
+
+//ends with a entry that has no sequence, so the array is never empty
+#define SUPERINSTRUCTION_SEQUENCE(name, op0, op1, op2, op3) { name, { op0, op1, op2, op3 } },
+static const superSequence sequences[] = {
+	SUPERINSTRUCTION_LIST(SUPERINSTRUCTION_SEQUENCE)
+	{ SUPER_NONE, { SUPER_NONE, SUPER_NONE, SUPER_NONE, SUPER_NONE } }
+};
+#undef SUPERINSTRUCTION_SEQUENCE
+
+int findSuperinstruction(uint8_t* ops, uInt count, uInt& length) {
+	int best = -1;
+	length = 0;
+	for (const superSequence& seq : sequences) {
+		if (seq.op == SUPER_NONE) break;
+		uInt seqLength = 0;
+		while (seqLength < SEQUENCE_MAX_LENGTH && seq.ops[seqLength] != SUPER_NONE) seqLength++;
+		if (seqLength > count || seqLength <= length) continue;
+		if (!std::equal(seq.ops, seq.ops + seqLength, ops)) continue;
+		best = seq.op;
+		length = seqLength;
+	}
+	return best;
+}
+#pragma endregion
+
+#pragma region Profile
+//a line of the profile is the count followed by the names of the instructions
+static bool readProfile(string path, std::unordered_map<uInt64, uInt64>& counts) {
+	std::ifstream in(path);
+	if (!in.is_open()) return false;
+	string line;
+	while (std::getline(in, line)) {
+		std::stringstream stream(line);
+		uInt64 count;
+		if (!(stream >> count)) continue;
+		uInt64 key = 0;
+		uInt length = 0;
+		string name;
+		bool valid = true;
+		while (stream >> name) {
+			const fusableInstr* instr = findFusable(name);
+			if (instr == nullptr || length == SEQUENCE_MAX_LENGTH) {
+				valid = false;
+				break;
+			}
+			key = (key << 8) | instr->op;
+			length++;
+		}
+		//profiles made before a instruction was removed from the fusable set
+		if (!valid || length < 2) continue;
+		counts[key | ((uInt64)length << 56)] += count;
+	}
+	return true;
+}
+
+static uInt sequenceLength(uInt64 key) {
+	return key >> 56;
+}
+
+static uint8_t sequenceOp(uInt64 key, uInt i) {
+	return (key >> (8 * (sequenceLength(key) - 1 - i))) & 0xff;
+}
+
+#ifdef PROFILE_SEQUENCES
+static bool byCount(const std::pair<uInt64, uInt64>& a, const std::pair<uInt64, uInt64>& b) {
+	if (a.second != b.second) return a.second > b.second;
+	return a.first < b.first;
+}
+
+sequenceProfiler::sequenceProfiler() {
+	path = "";
+	next = nullptr;
+	windowSize = 0;
+}
+
+//code can move during a collection, which at worst starts a new window
+void sequenceProfiler::record(uint8_t* ip, uint8_t op, uInt length) {
+	if (ip != next) windowSize = 0;
+	next = ip + length;
+	const fusableInstr* instr = isFusedBranch(op) ? nullptr : findFusable(genericOpcode(op));
+	if (instr == nullptr) {
+		windowSize = 0;
+		return;
+	}
+	if (windowSize == SEQUENCE_MAX_LENGTH) {
+		for (uInt i = 1; i < SEQUENCE_MAX_LENGTH; i++) window[i - 1] = window[i];
+		windowSize--;
+	}
+	window[windowSize++] = instr->op;
+	//every sequence that ends with this instruction
+	for (uInt start = 0; start + 1 < windowSize; start++) {
+		uInt64 key = 0;
+		for (uInt i = start; i < windowSize; i++) key = (key << 8) | window[i];
+		counts[key | ((uInt64)(windowSize - start) << 56)]++;
+	}
+	if (instr->endsSequence) windowSize = 0;
+}
+
+bool sequenceProfiler::write() {
+	readProfile(path, counts);
+	vector<std::pair<uInt64, uInt64>> sorted(counts.begin(), counts.end());
+	std::sort(sorted.begin(), sorted.end(), byCount);
+	std::ofstream out(path);
+	if (!out.is_open()) return false;
+	for (auto& seq : sorted) {
+		out << seq.second;
+		for (uInt i = 0; i < sequenceLength(seq.first); i++) out << " " << findFusable(sequenceOp(seq.first, i))->name;
+		out << "\n";
+	}
+	return out.good();
+}
+#endif
+#pragma endregion
+
+#pragma region Generator
+//if b is no longer than a and shares at least 2 instructions with it, either inside of it or hanging over one of it's ends
+static bool overlaps(uInt64 a, uInt64 b) {
+	int aLength = sequenceLength(a);
+	int bLength = sequenceLength(b);
+	if (bLength > aLength) return false;
+	//b starts at 'start' relative to a
+	for (int start = 2 - bLength; start <= aLength - 2; start++) {
+		bool match = true;
+		for (int i = std::max(start, 0); i < std::min(aLength, start + bLength) && match; i++) {
+			match = sequenceOp(a, i) == sequenceOp(b, i - start);
+		}
+		if (match) return true;
+	}
+	return false;
+}
+
+//a sequence of n instructions saves n - 1 dispatches every time it runs, sequences are picked one at a time
+//and once one is picked the runs of the shorter sequences that overlap it no longer count, most of them were the same code
+bool superinstructionGenerator::write(string profilePath, string headerPath, uInt count) {
+	std::unordered_map<uInt64, uInt64> counts;
+	if (!readProfile(profilePath, counts)) return false;
+	vector<std::pair<uInt64, uInt64>> candidates(counts.begin(), counts.end());
+	if (count > SUPERINSTRUCTION_MAX_COUNT) count = SUPERINSTRUCTION_MAX_COUNT;
+	vector<std::pair<uInt64, uInt64>> sorted;
+	while (sorted.size() < count) {
+		int best = -1;
+		uInt64 bestSaved = 0;
+		for (uInt i = 0; i < candidates.size(); i++) {
+			uInt64 saved = candidates[i].second * (sequenceLength(candidates[i].first) - 1);
+			if (saved > bestSaved || (saved == bestSaved && saved != 0 && candidates[i].first < candidates[best].first)) {
+				best = i;
+				bestSaved = saved;
+			}
+		}
+		if (best == -1) break;
+		std::pair<uInt64, uInt64> picked = candidates[best];
+		sorted.push_back(std::make_pair(picked.first, bestSaved));
+		candidates.erase(candidates.begin() + best);
+		for (auto& candidate : candidates) {
+			if (overlaps(picked.first, candidate.first)) candidate.second -= std::min(candidate.second, picked.second);
+		}
+	}
+
+	//FNV-1a over the names, images compiled with a different set are never loaded
+	uInt hash = 2166136261u;
+	vector<string> names;
+	for (auto& seq : sorted) {
+		string name = "OP_SUPER";
+		for (uInt i = 0; i < sequenceLength(seq.first); i++) name += string(findFusable(sequenceOp(seq.first, i))->name).substr(2);
+		for (char c : name) {
+			hash ^= (uint8_t)c;
+			hash *= 16777619u;
+		}
+		names.push_back(name);
+	}
+
+	std::ofstream out(headerPath);
+	if (!out.is_open()) return false;
+	out << "#pragma once\n";
+	out << "//generated by --superinstructions from " << profilePath << ", regenerate it instead of editing(see superinstruction.h)\n";
+	out << "//dispatches each sequence saved while profiling:\n";
+	for (auto& seq : sorted) {
+		out << "//" << seq.second;
+		for (uInt i = 0; i < sequenceLength(seq.first); i++) out << " " << findFusable(sequenceOp(seq.first, i))->name;
+		out << "\n";
+	}
+	out << "#define SUPERINSTRUCTION_SET 0x" << std::hex << hash << std::dec << "u\n";
+	out << "#define SUPERINSTRUCTION_COUNT " << sorted.size() << "\n";
+	out << "#define SUPERINSTRUCTION_LIST(X)";
+	for (uInt i = 0; i < sorted.size(); i++) {
+		out << " \\\n\tX(" << names[i];
+		for (uInt j = 0; j < SEQUENCE_MAX_LENGTH; j++) {
+			if (j < sequenceLength(sorted[i].first)) out << ", " << findFusable(sequenceOp(sorted[i].first, j))->name;
+			else out << ", SUPER_NONE";
+		}
+		out << ")";
+	}
+	out << "\n";
+	return out.good();
+}
+#pragma endregion
@@ -0,0 +1,61 @@
+#pragma once
+#include "common.h"
+#include "superinstructionSet.h"
+#include <unordered_map>
+
+//most instructions that are ran come from a small set of sequences that repeat(loading 2 locals and adding them, comparing a local
+//with a constant and jumping...), a superinstruction runs a whole sequence with a single dispatch
+//
+//the set isn't picked by hand:
+//1. a build with PROFILE_SEQUENCES ran with '--profile <file> main.ifs' adds how often every sequence of 2 to SEQUENCE_MAX_LENGTH
+//   instructions that can be fused ran back to back to the profile, profiles of multiple programs add up
+//2. '--superinstructions <profile> <header> [count]' picks the sequences that save the most dispatches and writes them to
+//   superinstructionSet.h, which gives every one of them a opcode(see SUPERINSTRUCTION_LIST)
+//3. the peephole pass replaces the first instruction of every sequence it finds with the superinstruction(see peephole.h)
+//
+//the rest of the sequence stays in the code, so a superinstruction has the operands of the first instruction it fuses and jumps into
+//the middle of it still land on a normal instruction, when a instruction in the sequence needs it's slow path(strings, errors...)
+//the superinstruction stops and dispatches to the instruction itself, if that's the first one it's put back in place of the superinstruction
+#define SEQUENCE_MAX_LENGTH 4
+//superinstructions that are generated if the count isn't given
+#define SUPERINSTRUCTION_DEFAULT_COUNT 16
+//most that fit in the OpCode enum next to the other instructions
+#define SUPERINSTRUCTION_MAX_COUNT 64
+//padding for sequences shorter than SEQUENCE_MAX_LENGTH
+#define SUPER_NONE 255
+
+//instructions that can be fused, jumps only at the end of a sequence since nothing after them runs in order
+//every one of them has a SUPER_STEP_ macro in objFiber::execute
+struct fusableInstr {
+	uint8_t op;
+	const char* name;
+	bool endsSequence;
+};
+const fusableInstr* findFusable(uint8_t op);
+const fusableInstr* findFusable(string name);
+//opcode of the longest superinstruction that the generic instructions in ops start with and sets length to how many it fuses, -1 if none does
+int findSuperinstruction(uint8_t* ops, uInt count, uInt& length);
+
+#ifdef PROFILE_SEQUENCES
+class sequenceProfiler {
+public:
+	sequenceProfiler();
+	//profile file that's added to once the program finishes, set by --profile
+	string path;
+	//called before every instruction the interpreter dispatches
+	void record(uint8_t* ip, uint8_t op, uInt length);
+	bool write();
+private:
+	//where the instruction after the last recorded one starts, anything else wasn't ran in order
+	uint8_t* next;
+	uint8_t window[SEQUENCE_MAX_LENGTH];
+	uInt windowSize;
+	//the length is in the top byte, and the instructions in the ones below it
+	std::unordered_map<uInt64, uInt64> counts;
+};
+#endif
+
+class superinstructionGenerator {
+public:
+	static bool write(string profilePath, string headerPath, uInt count);
+};
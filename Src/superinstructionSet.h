@@ -0,0 +1,38 @@
+#pragma once
+//generated by --superinstructions from Benchmarks/sequences.profile, regenerate it instead of editing(see superinstruction.h)
+//dispatches each sequence saved while profiling:
+//112681287 OP_GET_LOCAL OP_GET_LOCAL
+//61610920 OP_GET_LOCAL OP_GET_LOCAL OP_GET_LOCAL
+//45082524 OP_GET_LOCAL OP_GET OP_GET_LOCAL OP_GET_LOCAL
+//38952824 OP_GET_LOCAL OP_CONSTANT OP_ADD
+//36707814 OP_SET OP_POP OP_GET_LOCAL
+//33254847 OP_CONSTANT OP_ADD OP_SET_LOCAL OP_POP
+//30686841 OP_SET OP_POP OP_GET_LOCAL OP_GET_LOCAL
+//24374880 OP_SET OP_POP OP_GET_LOCAL OP_CONSTANT
+//20865098 OP_GET_LOCAL OP_LESS_EQUAL OP_JUMP_IF_FALSE_POP
+//17912418 OP_GET_GLOBAL OP_GET_LOCAL
+//15361101 OP_GET_LOCAL OP_GET
+//12912064 OP_GET_LOCAL OP_GET OP_SET
+//11688153 OP_CONSTANT OP_ADD OP_GET OP_GREATER
+//9459846 OP_CONSTANT OP_SUBTRACT OP_SET_LOCAL OP_POP
+//8816996 OP_ADD OP_SET_GLOBAL OP_POP
+//8325624 OP_GET_GLOBAL OP_GET_LOCAL OP_TRUE OP_SET
+#define SUPERINSTRUCTION_SET 0xdc476653u
+#define SUPERINSTRUCTION_COUNT 16
+#define SUPERINSTRUCTION_LIST(X) \
+	X(OP_SUPER_GET_LOCAL_GET_LOCAL, OP_GET_LOCAL, OP_GET_LOCAL, SUPER_NONE, SUPER_NONE) \
+	X(OP_SUPER_GET_LOCAL_GET_LOCAL_GET_LOCAL, OP_GET_LOCAL, OP_GET_LOCAL, OP_GET_LOCAL, SUPER_NONE) \
+	X(OP_SUPER_GET_LOCAL_GET_GET_LOCAL_GET_LOCAL, OP_GET_LOCAL, OP_GET, OP_GET_LOCAL, OP_GET_LOCAL) \
+	X(OP_SUPER_GET_LOCAL_CONSTANT_ADD, OP_GET_LOCAL, OP_CONSTANT, OP_ADD, SUPER_NONE) \
+	X(OP_SUPER_SET_POP_GET_LOCAL, OP_SET, OP_POP, OP_GET_LOCAL, SUPER_NONE) \
+	X(OP_SUPER_CONSTANT_ADD_SET_LOCAL_POP, OP_CONSTANT, OP_ADD, OP_SET_LOCAL, OP_POP) \
+	X(OP_SUPER_SET_POP_GET_LOCAL_GET_LOCAL, OP_SET, OP_POP, OP_GET_LOCAL, OP_GET_LOCAL) \
+	X(OP_SUPER_SET_POP_GET_LOCAL_CONSTANT, OP_SET, OP_POP, OP_GET_LOCAL, OP_CONSTANT) \
+	X(OP_SUPER_GET_LOCAL_LESS_EQUAL_JUMP_IF_FALSE_POP, OP_GET_LOCAL, OP_LESS_EQUAL, OP_JUMP_IF_FALSE_POP, SUPER_NONE) \
+	X(OP_SUPER_GET_GLOBAL_GET_LOCAL, OP_GET_GLOBAL, OP_GET_LOCAL, SUPER_NONE, SUPER_NONE) \
+	X(OP_SUPER_GET_LOCAL_GET, OP_GET_LOCAL, OP_GET, SUPER_NONE, SUPER_NONE) \
+	X(OP_SUPER_GET_LOCAL_GET_SET, OP_GET_LOCAL, OP_GET, OP_SET, SUPER_NONE) \
+	X(OP_SUPER_CONSTANT_ADD_GET_GREATER, OP_CONSTANT, OP_ADD, OP_GET, OP_GREATER) \
+	X(OP_SUPER_CONSTANT_SUBTRACT_SET_LOCAL_POP, OP_CONSTANT, OP_SUBTRACT, OP_SET_LOCAL, OP_POP) \
+	X(OP_SUPER_ADD_SET_GLOBAL_POP, OP_ADD, OP_SET_GLOBAL, OP_POP, SUPER_NONE) \
+	X(OP_SUPER_GET_GLOBAL_GET_LOCAL_TRUE_SET, OP_GET_GLOBAL, OP_GET_LOCAL, OP_TRUE, OP_SET)
@@ -0,0 +1,659 @@
+#include "trace.h"
+
+#ifdef TRACING_JIT
+#include "namespaces.h"
+#include "fiber.h"
+#include <cstring>
+#include <cfloat>
+
+//offset of a stack slot from the frame's slots(r12)
+static int32_t at(uInt slot) {
+	return (int32_t)(sizeof(Value) * slot);
+}
+
+static uInt16 readShort(uint8_t* code, uInt offset) {
+	return (uInt16)((code[offset] << 8) | code[offset + 1]);
+}
+
+static bool isFalsey(Value value) {
+	return ((IS_BOOL(value) && !AS_BOOL(value)) || IS_NIL(value));
+}
+
+static traceType typeOf(Value val) {
+	if (IS_INT(val)) return traceType::INT;
+	if (IS_NUMBER(val)) return traceType::DOUBLE;
+	if (IS_BOOL(val)) return traceType::BOOL;
+	if (IS_NIL(val)) return traceType::NIL;
+	if (IS_STRING(val)) return traceType::STRING;
+	if (IS_ARRAY(val)) return traceType::ARRAY;
+	return traceType::OTHER;
+}
+
+static bool isNumber(traceType type) {
+	return type == traceType::INT || type == traceType::DOUBLE;
+}
+
+traceJit::traceJit() {
+	stats = false;
+	recording = false;
+	fiber = nullptr;
+	frameCount = 0;
+	code = nullptr;
+	loop = nullptr;
+	header = 0;
+	loopEnd = 0;
+	depth = 0;
+	line = 0;
+	guards = 0;
+}
+
+traceAnchor* traceJit::anchor(chunk& body, uInt header) {
+	for (traceAnchor& it : body.anchors) {
+		if (it.offset == header) return &it;
+	}
+	body.anchors.push_back(traceAnchor(header));
+	return &body.anchors.back();
+}
+
+#pragma region Recording
+bool traceJit::hot(objFiber* _fiber, traceAnchor* _loop, uInt _loopEnd) {
+	if (_loop->aborts >= TRACE_MAX_ABORTS || ++_loop->hotness < TRACE_THRESHOLD) return false;
+	_loop->hotness = 0;
+	callFrame* frame = &_fiber->frames[_fiber->frameCount - 1];
+	objFunc* func = frame->closure->func;
+	fiber = _fiber;
+	frameCount = _fiber->frameCount;
+	code = func->body.code.data();
+	loop = _loop;
+	header = _loop->offset;
+	loopEnd = _loopEnd;
+	depth = _fiber->stackTop - frame->slots;
+	name = func->name == nullptr ? "script" : func->name->str;
+	line = func->body.getLine(header).line;
+	instrs.clear();
+	recording = true;
+	return true;
+}
+
+void traceJit::record(objFiber* _fiber, uInt offset) {
+	if (_fiber != fiber || _fiber->frameCount != frameCount) {
+		abort("left the function of the loop");
+		return;
+	}
+	callFrame* frame = &fiber->frames[frameCount - 1];
+	chunk& body = frame->closure->func->body;
+	if (body.code.data() != code) {
+		abort("left the function of the loop");
+		return;
+	}
+	//a quickened instruction whose guard failed runs again as the generic one
+	if (!instrs.empty() && instrs.back().offset == offset) instrs.pop_back();
+	if (offset < header || offset > loopEnd) {
+		abort("loop exited before reaching the back edge");
+		return;
+	}
+	if (instrs.size() == TRACE_MAX_LENGTH) {
+		abort("iteration is too long");
+		return;
+	}
+
+	traceInstr instr;
+	instr.offset = offset;
+	instr.op = genericOpcode(code[offset]);
+	for (int i = 0; i < 3; i++) {
+		Value* val = fiber->stackTop - 1 - i;
+		instr.types[i] = val >= frame->slots ? typeOf(*val) : traceType::UNKNOWN;
+	}
+	instr.taken = false;
+	if (instr.op == OP_JUMP_IF_FALSE || instr.op == OP_JUMP_IF_FALSE_POP) instr.taken = isFalsey(fiber->stackTop[-1]);
+	else if (instr.op == OP_JUMP_IF_TRUE) instr.taken = !isFalsey(fiber->stackTop[-1]);
+
+	string reason = check(instr);
+	if (!reason.empty()) {
+		abort(reason);
+		return;
+	}
+	instrs.push_back(instr);
+	if (instr.op == OP_LOOP) finish(body);
+}
+
+string traceJit::check(traceInstr& instr) {
+	switch (instr.op) {
+	case OP_POP:
+	case OP_POPN:
+	case OP_CONSTANT:
+	case OP_CONSTANT_LONG:
+	case OP_NIL:
+	case OP_TRUE:
+	case OP_FALSE:
+	case OP_NEGATE:
+	case OP_NOT:
+	case OP_BIN_NOT:
+	case OP_EQUAL:
+	case OP_NOT_EQUAL:
+	case OP_GET_GLOBAL:
+	case OP_GET_GLOBAL_LONG:
+	case OP_SET_GLOBAL:
+	case OP_SET_GLOBAL_LONG:
+	case OP_GET_LOCAL:
+	case OP_SET_LOCAL:
+	case OP_GET_UPVALUE:
+	case OP_SET_UPVALUE:
+	case OP_JUMP:
+	case OP_JUMP_IF_FALSE:
+	case OP_JUMP_IF_TRUE:
+	case OP_JUMP_IF_FALSE_POP:
+	case OP_JUMP_POPN:
+		return "";
+
+	case OP_ADD:
+		if (instr.types[0] == traceType::STRING || instr.types[1] == traceType::STRING) return "string concatenation";
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MOD:
+	case OP_BITSHIFT_LEFT:
+	case OP_BITSHIFT_RIGHT:
+	case OP_BITWISE_AND:
+	case OP_BITWISE_OR:
+	case OP_BITWISE_XOR:
+	case OP_GREATER:
+	case OP_GREATER_EQUAL:
+	case OP_LESS:
+	case OP_LESS_EQUAL:
+		if (!isNumber(instr.types[0]) || !isNumber(instr.types[1])) return "arithmetic on something that isn't a number";
+		return "";
+	case OP_ADD_1:
+	case OP_SUBTRACT_1:
+		if (!isNumber(instr.types[0])) return "arithmetic on something that isn't a number";
+		return "";
+	//instances can run user code through their metamethods
+	case OP_GET:
+		if (instr.types[1] != traceType::ARRAY) return "indexing something that isn't a array";
+		return "";
+	case OP_SET:
+		if (instr.types[2] != traceType::ARRAY) return "indexing something that isn't a array";
+		return "";
+	case OP_LOOP:
+		if (instr.offset + 3 - readShort(code, instr.offset + 1) != header) return "inner loop";
+		return "";
+
+	case OP_ADD_STRING:
+	case OP_TO_STRING: return "string concatenation";
+	case OP_CALL:
+	case OP_INVOKE:
+	case OP_INVOKE_LONG:
+	case OP_SUPER_INVOKE:
+	case OP_SUPER_INVOKE_LONG: return "call";
+	case OP_RETURN: return "return";
+	case OP_GET_PROPERTY:
+	case OP_GET_PROPERTY_LONG:
+	case OP_SET_PROPERTY:
+	case OP_SET_PROPERTY_LONG:
+	case OP_GET_SUPER:
+	case OP_GET_SUPER_LONG: return "property access";
+	case OP_CREATE_ARRAY:
+	case OP_CREATE_STRUCT:
+	case OP_CREATE_STRUCT_LONG:
+	case OP_CLOSURE:
+	case OP_CLOSURE_LONG:
+	case OP_CLASS: return "allocation";
+	case OP_PRINT: return "print";
+	case OP_FIBER_CREATE:
+	case OP_FIBER_RUN:
+	case OP_FIBER_YIELD: return "fiber";
+	case OP_SWITCH: return "switch";
+	case OP_CLOSE_UPVALUE: return "closing a upvalue";
+	}
+	return "unsupported instruction";
+}
+
+void traceJit::abort(string reason) {
+	recording = false;
+	loop->aborts++;
+	aborts[name + ":" + std::to_string(line) + " " + reason]++;
+}
+
+void traceJit::finish(chunk& body) {
+	recording = false;
+	traceCode* compiled = compile(body);
+	if (compiled == nullptr) {
+		//there's no point in recording it again
+		loop->aborts = TRACE_MAX_ABORTS;
+		aborts[name + ":" + std::to_string(line) + " couldn't be compiled"]++;
+		return;
+	}
+	loop->compiled = compiled;
+	traces.push_back(compiled);
+}
+#pragma endregion
+
+uInt traceJit::run(traceCode* compiled, Value* slots, Value** stackTop, Value* constants, objUpval** upvals) {
+	compiled->entries++;
+	uInt resume = global::codeArena.enter(compiled->start, slots, stackTop, constants, upvals);
+	if (stats) compiled->exits[resume]++;
+	return resume;
+}
+
+#pragma region Compiling
+traceCode* traceJit::compile(chunk& body) {
+	x64Emitter as;
+	uInt top = depth;
+	uInt maxDepth = depth;
+	known.assign(depth + 1, traceType::UNKNOWN);
+	sideExits.clear();
+	exitStubs.clear();
+	guards = 0;
+
+	//rbp holds INT_BITS for the whole trace
+	as.movImm(x64Reg::rbp, INT_BITS);
+	uInt loopStart = as.pos();
+	for (uInt i = 0; i < instrs.size(); i++) {
+		traceInstr& instr = instrs[i];
+		uInt offset = instr.offset;
+		if (known.size() < top + 1) known.resize(top + 1, traceType::UNKNOWN);
+		switch (instr.op) {
+		case OP_POP: top--; break;
+		case OP_POPN: top -= code[offset + 1]; break;
+		case OP_CONSTANT:
+		case OP_CONSTANT_LONG: {
+			uInt index = instr.op == OP_CONSTANT ? code[offset + 1] : readShort(code, offset + 1);
+			as.load(x64Reg::rax, x64Reg::r13, at(index));
+			as.store(x64Reg::r12, at(top), x64Reg::rax);
+			known[top++] = typeOf(body.constants[index]);
+			break;
+		}
+		case OP_NIL:
+		case OP_TRUE:
+		case OP_FALSE:
+			as.movImm(x64Reg::rax, instr.op == OP_NIL ? NIL_BITS : (instr.op == OP_TRUE ? TRUE_BITS : FALSE_BITS));
+			as.store(x64Reg::r12, at(top), x64Reg::rax);
+			known[top++] = instr.op == OP_NIL ? traceType::NIL : traceType::BOOL;
+			break;
+		case OP_GET_LOCAL:
+			as.load(x64Reg::rax, x64Reg::r12, at(code[offset + 1]));
+			as.store(x64Reg::r12, at(top), x64Reg::rax);
+			known[top] = known[code[offset + 1]];
+			top++;
+			break;
+		case OP_SET_LOCAL:
+			as.load(x64Reg::rax, x64Reg::r12, at(top - 1));
+			as.store(x64Reg::r12, at(code[offset + 1]), x64Reg::rax);
+			known[code[offset + 1]] = known[top - 1];
+			break;
+
+		case OP_GET_GLOBAL:
+		case OP_GET_GLOBAL_LONG:
+		case OP_SET_GLOBAL:
+		case OP_SET_GLOBAL_LONG: {
+			bool isShort = instr.op == OP_GET_GLOBAL || instr.op == OP_SET_GLOBAL;
+			as.load(x64Reg::rdi, x64Reg::r13, at(isShort ? code[offset + 1] : readShort(code, offset + 1)));
+			as.movImm(x64Reg::rsi, isShort ? code[offset + 2] : readShort(code, offset + 3));
+			if (instr.op == OP_GET_GLOBAL || instr.op == OP_GET_GLOBAL_LONG) {
+				as.callAbs((void*)jitGetGlobal);
+				emitHelperCheck(as, offset, top);
+				as.store(x64Reg::r12, at(top), x64Reg::rax);
+				known[top++] = traceType::UNKNOWN;
+			}
+			else {
+				as.load(x64Reg::rdx, x64Reg::r12, at(top - 1));
+				as.callAbs((void*)jitSetGlobal);
+				emitHelperCheck(as, offset, top);
+			}
+			break;
+		}
+		case OP_GET_UPVALUE:
+			as.mov(x64Reg::rdi, x64Reg::r15);
+			as.movImm(x64Reg::rsi, code[offset + 1]);
+			as.callAbs((void*)jitGetUpvalue);
+			as.store(x64Reg::r12, at(top), x64Reg::rax);
+			known[top++] = traceType::UNKNOWN;
+			break;
+		case OP_SET_UPVALUE:
+			as.mov(x64Reg::rdi, x64Reg::r15);
+			as.movImm(x64Reg::rsi, code[offset + 1]);
+			as.load(x64Reg::rdx, x64Reg::r12, at(top - 1));
+			as.callAbs((void*)jitSetUpvalue);
+			break;
+		case OP_GET:
+			as.load(x64Reg::rdi, x64Reg::r12, at(top - 2));
+			as.load(x64Reg::rsi, x64Reg::r12, at(top - 1));
+			as.callAbs((void*)jitGetIndex);
+			emitHelperCheck(as, offset, top);
+			as.store(x64Reg::r12, at(top - 2), x64Reg::rax);
+			known[top - 2] = traceType::UNKNOWN;
+			top--;
+			break;
+		case OP_SET:
+			as.load(x64Reg::rdi, x64Reg::r12, at(top - 3));
+			as.load(x64Reg::rsi, x64Reg::r12, at(top - 2));
+			as.load(x64Reg::rdx, x64Reg::r12, at(top - 1));
+			as.callAbs((void*)jitSetIndex);
+			emitHelperCheck(as, offset, top);
+			as.store(x64Reg::r12, at(top - 3), x64Reg::rax);
+			known[top - 3] = known[top - 1];
+			top -= 2;
+			break;
+
+		case OP_NEGATE:
+		case OP_NOT:
+		case OP_BIN_NOT:
+			as.load(x64Reg::rdi, x64Reg::r12, at(top - 1));
+			as.movImm(x64Reg::rsi, instr.op);
+			as.callAbs((void*)jitUnary);
+			emitHelperCheck(as, offset, top);
+			as.store(x64Reg::r12, at(top - 1), x64Reg::rax);
+			known[top - 1] = instr.op == OP_NOT ? traceType::BOOL : traceType::UNKNOWN;
+			break;
+		case OP_MOD:
+		case OP_BITSHIFT_LEFT:
+		case OP_BITSHIFT_RIGHT:
+		case OP_BITWISE_AND:
+		case OP_BITWISE_OR:
+		case OP_BITWISE_XOR:
+			as.load(x64Reg::rdi, x64Reg::r12, at(top - 2));
+			as.load(x64Reg::rsi, x64Reg::r12, at(top - 1));
+			as.movImm(x64Reg::rdx, instr.op);
+			as.callAbs((void*)jitBinary);
+			emitHelperCheck(as, offset, top);
+			as.store(x64Reg::r12, at(top - 2), x64Reg::rax);
+			known[top - 2] = traceType::UNKNOWN;
+			top--;
+			break;
+		case OP_ADD:
+		case OP_SUBTRACT:
+		case OP_MULTIPLY:
+		case OP_DIVIDE:
+			emitArith(as, instr, top);
+			top--;
+			break;
+		case OP_ADD_1:
+		case OP_SUBTRACT_1:
+			emitIncrement(as, instr, top);
+			break;
+		case OP_EQUAL:
+		case OP_NOT_EQUAL:
+		case OP_GREATER:
+		case OP_GREATER_EQUAL:
+		case OP_LESS:
+		case OP_LESS_EQUAL: {
+			uint8_t cc = emitCompare(as, instr, top);
+			//a comparison that's only used by the next jump becomes the guard itself, if it fails
+			//the interpreter runs the comparison again since it's operands are still on the stack
+			if (i + 1 < instrs.size() && instrs[i + 1].op == OP_JUMP_IF_FALSE_POP) {
+				i++;
+				//flipping the lowest bit negates a condition code
+				exitIf(as, instrs[i].taken ? cc : cc ^ 1, offset, top);
+				guards++;
+				top -= 2;
+				break;
+			}
+			as.setBool(cc);
+			as.store(x64Reg::r12, at(top - 2), x64Reg::rax);
+			known[top - 2] = traceType::BOOL;
+			top--;
+			break;
+		}
+
+		case OP_JUMP: break;
+		case OP_JUMP_POPN: top -= readShort(code, offset + 1); break;
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+			emitBranch(as, instr, top);
+			break;
+		case OP_JUMP_IF_FALSE_POP:
+			emitBranch(as, instr, top);
+			top--;
+			break;
+		case OP_LOOP:
+			//the recorder only lets through back edges to the header, so the stack is the same as when the trace was entered
+			if (top != depth) return nullptr;
+			as.patch(as.jmp(), loopStart);
+			break;
+		default:
+			return nullptr;
+		}
+		if (top > maxDepth) maxDepth = top;
+	}
+
+	//every offset and stack depth the trace leaves at gets one stub that sets stackTop and loads the offset into eax
+	std::map<std::pair<uInt, uInt>, uInt> stubs;
+	for (sideExit& exit : sideExits) {
+		std::pair<uInt, uInt> key = std::make_pair(exit.offset, exit.top);
+		auto it = stubs.find(key);
+		if (it == stubs.end()) {
+			uInt stub = as.pos();
+			as.mov(x64Reg::rbx, x64Reg::r12);
+			as.addImm(x64Reg::rbx, at(exit.top));
+			as.movImm(x64Reg::rax, exit.offset);
+			exitStubs.push_back(as.jmp());
+			it = stubs.insert(std::make_pair(key, stub)).first;
+		}
+		as.patch(exit.jump, it->second);
+	}
+
+	uint8_t* start = global::codeArena.place(as, exitStubs);
+	if (start == nullptr) return nullptr;
+	traceCode* compiled = new traceCode();
+	compiled->start = start;
+	compiled->depth = depth;
+	compiled->maxDepth = maxDepth;
+	compiled->name = name;
+	compiled->line = line;
+	compiled->length = instrs.size();
+	compiled->machineCode = as.pos();
+	compiled->guards = guards;
+	compiled->entries = 0;
+	return compiled;
+}
+
+void traceJit::exitIf(x64Emitter& as, uint8_t cc, uInt offset, uInt top) {
+	sideExit exit;
+	exit.jump = as.jcc(cc);
+	exit.offset = offset;
+	exit.top = top;
+	sideExits.push_back(exit);
+}
+
+//leaves to the interpreter if the helper returned JIT_FAIL
+void traceJit::emitHelperCheck(x64Emitter& as, uInt offset, uInt top) {
+	as.movImm(x64Reg::rcx, JIT_FAIL);
+	as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+	exitIf(as, CC_E, offset, top);
+}
+
+//checks that the value in reg, loaded from slot, has the type the recorder saw, slots whose type is already known aren't checked again
+void traceJit::emitGuard(x64Emitter& as, x64Reg reg, uInt slot, traceType type, uInt offset, uInt top) {
+	if (known[slot] == type) return;
+	as.mov(x64Reg::rsi, reg);
+	switch (type) {
+	case traceType::INT:
+		as.movImm(x64Reg::rdx, INT_MASK);
+		as.alu(ALU_AND, x64Reg::rsi, x64Reg::rdx);
+		as.alu(ALU_CMP, x64Reg::rsi, x64Reg::rbp);
+		exitIf(as, CC_NE, offset, top);
+		break;
+	case traceType::DOUBLE:
+		as.movImm(x64Reg::rdx, QNAN);
+		as.alu(ALU_AND, x64Reg::rsi, x64Reg::rdx);
+		as.alu(ALU_CMP, x64Reg::rsi, x64Reg::rdx);
+		exitIf(as, CC_E, offset, top);
+		break;
+	default:
+		return;
+	}
+	known[slot] = type;
+	guards++;
+}
+
+void traceJit::emitLoadDouble(x64Emitter& as, uInt slot, traceType type, int xmm, uInt offset, uInt top) {
+	as.load(x64Reg::rax, x64Reg::r12, at(slot));
+	emitGuard(as, x64Reg::rax, slot, type, offset, top);
+	if (type == traceType::INT) {
+		as.movsxd(x64Reg::rax, x64Reg::rax);
+		as.cvtsi2sd(xmm, x64Reg::rax);
+	}
+	else as.movqToXmm(xmm, x64Reg::rax);
+}
+
+//2 integers are added in 32 bits and leave if the result overflows, so the interpreter can turn it into a double
+void traceJit::emitArith(x64Emitter& as, traceInstr& instr, uInt top) {
+	uInt offset = instr.offset;
+	traceType a = instr.types[1];
+	traceType b = instr.types[0];
+	if (instr.op != OP_DIVIDE && a == traceType::INT && b == traceType::INT) {
+		as.load(x64Reg::rax, x64Reg::r12, at(top - 2));
+		emitGuard(as, x64Reg::rax, top - 2, a, offset, top);
+		as.load(x64Reg::rcx, x64Reg::r12, at(top - 1));
+		emitGuard(as, x64Reg::rcx, top - 1, b, offset, top);
+		if (instr.op == OP_MULTIPLY) as.imul32(x64Reg::rax, x64Reg::rcx);
+		else as.alu32(instr.op == OP_ADD ? ALU_ADD : ALU_SUB, x64Reg::rax, x64Reg::rcx);
+		exitIf(as, CC_O, offset, top);
+		as.alu(ALU_OR, x64Reg::rax, x64Reg::rbp);
+		as.store(x64Reg::r12, at(top - 2), x64Reg::rax);
+		known[top - 2] = traceType::INT;
+		return;
+	}
+	uint8_t sseOp = instr.op == OP_ADD ? SSE_ADD : (instr.op == OP_SUBTRACT ? SSE_SUB : (instr.op == OP_MULTIPLY ? SSE_MUL : SSE_DIV));
+	emitLoadDouble(as, top - 2, a, 0, offset, top);
+	emitLoadDouble(as, top - 1, b, 1, offset, top);
+	as.sse(sseOp, 0, 1);
+	as.movqFromXmm(x64Reg::rax, 0);
+	as.store(x64Reg::r12, at(top - 2), x64Reg::rax);
+	known[top - 2] = traceType::DOUBLE;
+}
+
+void traceJit::emitIncrement(x64Emitter& as, traceInstr& instr, uInt top) {
+	uInt offset = instr.offset;
+	if (instr.types[0] == traceType::INT) {
+		as.load(x64Reg::rax, x64Reg::r12, at(top - 1));
+		emitGuard(as, x64Reg::rax, top - 1, traceType::INT, offset, top);
+		as.movImm(x64Reg::rcx, 1);
+		as.alu32(instr.op == OP_ADD_1 ? ALU_ADD : ALU_SUB, x64Reg::rax, x64Reg::rcx);
+		exitIf(as, CC_O, offset, top);
+		as.alu(ALU_OR, x64Reg::rax, x64Reg::rbp);
+		as.store(x64Reg::r12, at(top - 1), x64Reg::rax);
+		known[top - 1] = traceType::INT;
+		return;
+	}
+	emitLoadDouble(as, top - 1, traceType::DOUBLE, 0, offset, top);
+	as.movImm(x64Reg::rcx, ONE_BITS);
+	as.movqToXmm(1, x64Reg::rcx);
+	as.sse(instr.op == OP_ADD_1 ? SSE_ADD : SSE_SUB, 0, 1);
+	as.movqFromXmm(x64Reg::rax, 0);
+	as.store(x64Reg::r12, at(top - 1), x64Reg::rax);
+	known[top - 1] = traceType::DOUBLE;
+}
+
+uint8_t traceJit::emitCompare(x64Emitter& as, traceInstr& instr, uInt top) {
+	uInt offset = instr.offset;
+	uint8_t op = instr.op;
+	traceType a = instr.types[1];
+	traceType b = instr.types[0];
+	if (a == traceType::INT && b == traceType::INT) {
+		as.load(x64Reg::rax, x64Reg::r12, at(top - 2));
+		emitGuard(as, x64Reg::rax, top - 2, a, offset, top);
+		as.load(x64Reg::rcx, x64Reg::r12, at(top - 1));
+		emitGuard(as, x64Reg::rcx, top - 1, b, offset, top);
+		as.cmp32(x64Reg::rax, x64Reg::rcx);
+		switch (op) {
+		case OP_EQUAL: return CC_E;
+		case OP_NOT_EQUAL: return CC_NE;
+		case OP_GREATER: return CC_G;
+		case OP_GREATER_EQUAL: return CC_GE;
+		case OP_LESS: return CC_L;
+		}
+		return CC_LE;
+	}
+	if (op == OP_EQUAL || op == OP_NOT_EQUAL) {
+		as.load(x64Reg::rdi, x64Reg::r12, at(top - 2));
+		as.load(x64Reg::rsi, x64Reg::r12, at(top - 1));
+		as.movImm(x64Reg::rdx, op);
+		as.callAbs((void*)jitBinary);
+		as.movImm(x64Reg::rcx, TRUE_BITS);
+		as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+		return CC_E;
+	}
+
+	emitLoadDouble(as, top - 2, a, 0, offset, top);
+	emitLoadDouble(as, top - 1, b, 1, offset, top);
+	//'above' is false for NaN, same as the C++ comparison, a < b is b > a
+	bool less = op == OP_LESS || op == OP_LESS_EQUAL;
+	as.ucomisd(less ? 1 : 0, less ? 0 : 1);
+	if (op == OP_LESS || op == OP_GREATER) return CC_A;
+
+	//a > b || FLOAT_EQ(a, b), |a - b| <= DBL_EPSILON is checked as -DBL_EPSILON <= a - b <= DBL_EPSILON
+	vector<uInt> isFalse;
+	double epsilon = DBL_EPSILON;
+	double negEpsilon = -DBL_EPSILON;
+	uInt64 bits;
+	uInt isTrue = as.jcc(CC_A);
+	as.sse(SSE_SUB, 0, 1);
+	memcpy(&bits, &epsilon, sizeof(double));
+	as.movImm(x64Reg::rcx, bits);
+	as.movqToXmm(1, x64Reg::rcx);
+	as.ucomisd(1, 0);
+	isFalse.push_back(as.jcc(CC_B));
+	memcpy(&bits, &negEpsilon, sizeof(double));
+	as.movImm(x64Reg::rcx, bits);
+	as.movqToXmm(1, x64Reg::rcx);
+	as.ucomisd(0, 1);
+	isFalse.push_back(as.jcc(CC_B));
+	as.patch(isTrue, as.pos());
+	as.movImm(x64Reg::rax, TRUE_BITS);
+	uInt done = as.jmp();
+	for (uInt jump : isFalse) as.patch(jump, as.pos());
+	as.movImm(x64Reg::rax, FALSE_BITS);
+	as.patch(done, as.pos());
+	as.movImm(x64Reg::rcx, TRUE_BITS);
+	as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+	return CC_E;
+}
+
+//the jump has to go the same way it did while recording
+void traceJit::emitBranch(x64Emitter& as, traceInstr& instr, uInt top) {
+	uInt offset = instr.offset;
+	bool falsey = instr.op == OP_JUMP_IF_TRUE ? !instr.taken : instr.taken;
+	as.load(x64Reg::rax, x64Reg::r12, at(top - 1));
+	as.movImm(x64Reg::rcx, FALSE_BITS);
+	if (known[top - 1] == traceType::BOOL) {
+		as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+		exitIf(as, falsey ? CC_NE : CC_E, offset, top);
+	}
+	else if (falsey) {
+		as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+		uInt isFalse = as.jcc(CC_E);
+		as.movImm(x64Reg::rcx, NIL_BITS);
+		as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+		exitIf(as, CC_NE, offset, top);
+		as.patch(isFalse, as.pos());
+	}
+	else {
+		as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+		exitIf(as, CC_E, offset, top);
+		as.movImm(x64Reg::rcx, NIL_BITS);
+		as.alu(ALU_CMP, x64Reg::rax, x64Reg::rcx);
+		exitIf(as, CC_E, offset, top);
+	}
+	guards++;
+}
+#pragma endregion
+
+void traceJit::dumpStats() {
+	uInt totalCode = 0;
+	for (traceCode* compiled : traces) totalCode += compiled->machineCode;
+	std::cout << "==== Traces ====\n";
+	printf("%-20s %6s %8s %12s %8s %12s %12s\n", "loop", "line", "length", "machine code", "guards", "entries", "exits");
+	for (traceCode* compiled : traces) {
+		uInt64 exits = 0;
+		for (auto& exit : compiled->exits) exits += exit.second;
+		printf("%-20s %6llu %8u %12u %8u %12llu %12llu\n", compiled->name.c_str(), compiled->line, compiled->length,
+			compiled->machineCode, compiled->guards, compiled->entries, exits);
+		for (auto& exit : compiled->exits) printf("  left at offset %-6u %12llu\n", exit.first, exit.second);
+	}
+	printf("compiled %u loops into %u bytes\n", (uInt)traces.size(), totalCode);
+	std::cout << "==== Trace aborts ====\n";
+	if (aborts.empty()) std::cout << "none\n";
+	for (auto& abort : aborts) printf("%8llu  %s\n", abort.second, abort.first.c_str());
+}
+#endif // TRACING_JIT
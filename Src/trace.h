@@ -0,0 +1,128 @@
+#pragma once
+#include "common.h"
+
+#ifdef TRACING_JIT
+#include "jit.h"
+#include <map>
+
+//back edges a loop takes in the interpreter before it's next iteration is recorded
+#define TRACE_THRESHOLD 50
+//instructions a single iteration can have before the recording is aborted
+#define TRACE_MAX_LENGTH 2000
+//loops that fail to record this many times are left to the interpreter
+#define TRACE_MAX_ABORTS 3
+
+class objFiber;
+
+//types the recorder sees, numbers that aren't integers are doubles
+enum class traceType : uint8_t {
+	UNKNOWN,
+	INT,
+	DOUBLE,
+	BOOL,
+	NIL,
+	STRING,
+	ARRAY,
+	OTHER
+};
+
+//a single instruction the interpreter ran while recording
+struct traceInstr {
+	uInt offset;
+	//always the generic version of the instruction
+	uint8_t op;
+	//types of the 3 values on top of the stack before the instruction ran, peek(0) first
+	traceType types[3];
+	//for conditional jumps, whether the jump was taken
+	bool taken;
+};
+
+//machine code for a single iteration of a loop, it starts at the loop header and jumps back to itself
+struct traceCode {
+	uint8_t* start;
+	//number of values between the frame's slots and stackTop at the loop header, and the most the trace pushes
+	uInt depth;
+	uInt maxDepth;
+
+	string name;
+	uInt64 line;
+	uInt length;
+	uInt machineCode;
+	uInt guards;
+	uInt64 entries;
+	//number of times the interpreter took over at each offset
+	std::map<uInt, uInt64> exits;
+};
+
+//records the instructions and operand types of a single iteration of a hot loop and compiles them into a straight line of machine code,
+//every branch the iteration took and every type it saw becomes a guard that leaves to the interpreter if it doesn't hold
+//
+//the trace works on the same stack and slots as the interpreter and is entered through the same trampoline as the baseline JIT(see jit.h),
+//so a side exit only has to set stackTop and return the offset of the instruction to continue from, values are written to the stack
+//as they're computed and a instruction that fails a guard hasn't changed anything yet, so the interpreter simply runs it again
+//
+//recording is aborted on anything that could allocate, call user code or leave the loop's function, the reason is kept for --jit-stats
+class traceJit {
+public:
+	traceJit();
+	//print the report once the program finishes
+	bool stats;
+	//set while a iteration is being recorded, the interpreter reports every instruction it runs through record()
+	bool recording;
+
+	//creates the anchor the first time the loop's back edge is taken
+	traceAnchor* anchor(chunk& body, uInt header);
+	//counts a back edge towards recording the loop, returns true if recording started
+	bool hot(objFiber* fiber, traceAnchor* loop, uInt loopEnd);
+	//called before the instruction at offset runs
+	void record(objFiber* fiber, uInt offset);
+	//returns the offset the interpreter continues from
+	uInt run(traceCode* code, Value* slots, Value** stackTop, Value* constants, objUpval** upvals);
+	void dumpStats();
+private:
+	//what's being recorded
+	objFiber* fiber;
+	int frameCount;
+	uint8_t* code;
+	traceAnchor* loop;
+	uInt header;
+	uInt loopEnd;
+	uInt depth;
+	string name;
+	uInt64 line;
+	vector<traceInstr> instrs;
+
+	vector<traceCode*> traces;
+	//"function:line reason" of every aborted recording, and how many times it happened
+	std::map<string, uInt64> aborts;
+
+	void abort(string reason);
+	//a reason to abort, or a empty string if the instruction can be traced
+	string check(traceInstr& instr);
+	void finish(chunk& body);
+
+	//nullptr if the trace couldn't be compiled
+	traceCode* compile(chunk& body);
+	void emitArith(x64Emitter& as, traceInstr& instr, uInt top);
+	void emitIncrement(x64Emitter& as, traceInstr& instr, uInt top);
+	//leaves the result in the flags, returns the condition code that's set if it's true
+	uint8_t emitCompare(x64Emitter& as, traceInstr& instr, uInt top);
+	void emitBranch(x64Emitter& as, traceInstr& instr, uInt top);
+	void emitHelperCheck(x64Emitter& as, uInt offset, uInt top);
+	void emitGuard(x64Emitter& as, x64Reg reg, uInt slot, traceType type, uInt offset, uInt top);
+	void emitLoadDouble(x64Emitter& as, uInt slot, traceType type, int xmm, uInt offset, uInt top);
+	void exitIf(x64Emitter& as, uint8_t cc, uInt offset, uInt top);
+
+	//type of every slot the trace knows, everything is unknown at the loop header since the trace can be entered with anything in them
+	vector<traceType> known;
+	uInt guards;
+	//jumps to the interpreter, with the offset and stack depth it continues at
+	struct sideExit {
+		uInt jump;
+		uInt offset;
+		uInt top;
+	};
+	vector<sideExit> sideExits;
+	vector<uInt> exitStubs;
+};
+#endif
@@ -3,16 +3,12 @@
 #include <cmath>
 
 bool valuesEqual(Value a, Value b) {
-    if (a.type != b.type) return false;
-    switch (a.type) {
-    case VAL_BOOL:   return AS_BOOL(a) == AS_BOOL(b);
-    case VAL_NIL:    return false;
-    case VAL_NUM: {
-        return FLOAT_EQ(AS_NUMBER(a), AS_NUMBER(b));
-    }
-    case VAL_OBJ:    return AS_OBJ(a) == AS_OBJ(b);
-    default:         return false; // Unreachable.
-    }
+    if (ARE_INTS(a, b)) return AS_INT(a) == AS_INT(b);
+    if (IS_NUMBER(a) && IS_NUMBER(b)) return FLOAT_EQ(AS_NUMBER(a), AS_NUMBER(b));
+    if (IS_BOOL(a) && IS_BOOL(b)) return AS_BOOL(a) == AS_BOOL(b);
+    if (IS_OBJ(a) && IS_OBJ(b)) return AS_OBJ(a) == AS_OBJ(b);
+    //nil is never equal to anything, including nil
+    return false;
 }
 
 
@@ -22,10 +18,10 @@ void printValue(Value value) {
 }
 
 string valueTypeToStr(Value val) {
-    switch (val.type) {
-    case VAL_NIL: return "nil";
-    case VAL_NUM: return "number";
-    case VAL_OBJ: {
+    if (IS_NIL(val)) return "nil";
+    if (IS_BOOL(val)) return "bool";
+    if (IS_NUMBER(val)) return "number";
+    if (IS_OBJ(val)) {
         obj* temp = AS_OBJ(val);
         switch (temp->type) {
         case OBJ_ARRAY: return "array";
@@ -41,29 +37,23 @@ string valueTypeToStr(Value val) {
         case OBJ_UPVALUE: return "upvalue";
         }
     }
-    }
     return "error, couldn't determine type of value";
 }
 
 string valueToStr(Value val) {
-    switch (val.type) {
-    case VAL_BOOL:
-        return AS_BOOL(val) ? "true" : "false";
-        break;
-    case VAL_NIL: return "nil"; break;
-    case VAL_NUM: {
+    if (IS_BOOL(val)) return AS_BOOL(val) ? "true" : "false";
+    if (IS_NIL(val)) return "nil";
+    if (IS_NUMBER(val)) {
         double num = AS_NUMBER(val);
         int prec = num == (int)num ? 0 : 5;
         return std::to_string(num).substr(0, std::to_string(num).find(".") + prec);
-        break;
-    }
-    case VAL_OBJ: return objectToStr(val); break;
-    default:
-        std::cout << "Error printing object";
-        return "";
     }
+    if (IS_OBJ(val)) return objectToStr(val);
+    std::cout << "Error printing object";
+    return "";
 }
 
+#ifndef NAN_BOXING
 //creates a value obj on the stack and 
 Value BOOL_VAL(bool boolean) {
     Value val;
@@ -86,9 +76,17 @@ Value NUMBER_VAL(double number) {
     return val;
 }
 
+Value INT_VAL(int32_t number) {
+    Value val;
+    val.type = VAL_INT;
+    val.as.integer = number;
+    return val;
+}
+
 Value OBJ_VAL(obj* object) {
     Value val;
     val.type = VAL_OBJ;
     val.as.object = object;
     return val;
-}
\ No newline at end of file
+}
+#endif // !NAN_BOXING
\ No newline at end of file
@@ -1,11 +1,90 @@
 #pragma once
 
 #include "common.h"
+#include <cstring>
+#include <cstdint>
 
 class obj;
 
+//numbers are either doubles or 32 bit integers, integers are produced by integer literals and stay integers through
+//arithmetic as long as the result fits, otherwise they get promoted to doubles
+//IS_NUMBER/AS_NUMBER work on both kinds, IS_INT/AS_INT are used by the fast paths in the interpreter
+#ifdef NAN_BOXING
+//every value is a 64 bit word, doubles are stored as is, everything else is packed into the payload of a quiet NaN
+//objects set the sign bit and use the lower 48 bits for the pointer, nil and bools use the lowest 2 bits as a tag
+//integers set bit 48 and keep the number in the lower 32 bits
+#define SIGN_BIT	((uInt64)0x8000000000000000)
+#define QNAN		((uInt64)0x7ffc000000000000)
+
+#define TAG_NIL		1
+#define TAG_FALSE	2
+#define TAG_TRUE	3
+#define TAG_INT		((uInt64)1 << 48)
+
+#define NIL_BITS	((uInt64)(QNAN | TAG_NIL))
+#define FALSE_BITS	((uInt64)(QNAN | TAG_FALSE))
+#define TRUE_BITS	((uInt64)(QNAN | TAG_TRUE))
+#define INT_BITS	((uInt64)(QNAN | TAG_INT))
+
+struct Value {
+	uInt64 bits;
+	Value() {
+		bits = NIL_BITS;
+	}
+};
+
+#define IS_BOOL(value)    (((value).bits | 1) == TRUE_BITS)
+#define IS_NIL(value)     ((value).bits == NIL_BITS)
+#define IS_DOUBLE(value)  (((value).bits & QNAN) != QNAN)
+#define IS_INT(value)     (((value).bits & (SIGN_BIT | QNAN | TAG_INT)) == INT_BITS)
+//single branch check used by the binary operators
+#define ARE_INTS(a, b)    (((((a).bits & (SIGN_BIT | QNAN | TAG_INT)) ^ INT_BITS) | (((b).bits & (SIGN_BIT | QNAN | TAG_INT)) ^ INT_BITS)) == 0)
+#define IS_NUMBER(value)  (IS_DOUBLE(value) || IS_INT(value))
+#define IS_OBJ(value)     (((value).bits & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT))
+
+#define AS_BOOL(value)    ((value).bits == TRUE_BITS)
+#define AS_INT(value)     ((int32_t)(uint32_t)(value).bits)
+#define AS_NUMBER(value)  valueToNum(value)
+#define AS_OBJ(value)     ((obj*)(uintptr_t)((value).bits & ~(SIGN_BIT | QNAN)))
+
+//checks for a double first so that the check can be merged with the IS_NUMBER check that usually comes before it
+inline double valueToNum(Value val) {
+	if (IS_DOUBLE(val)) {
+		double num;
+		memcpy(&num, &val.bits, sizeof(double));
+		return num;
+	}
+	return AS_INT(val);
+}
+
+//these are inlined since every instruction that produces a value goes through them
+inline Value BOOL_VAL(bool boolean) {
+	Value val;
+	val.bits = boolean ? TRUE_BITS : FALSE_BITS;
+	return val;
+}
+inline Value NIL_VAL() {
+	return Value();
+}
+inline Value NUMBER_VAL(double number) {
+	Value val;
+	memcpy(&val.bits, &number, sizeof(double));
+	return val;
+}
+inline Value INT_VAL(int32_t number) {
+	Value val;
+	val.bits = INT_BITS | (uint32_t)number;
+	return val;
+}
+inline Value OBJ_VAL(obj* object) {
+	Value val;
+	val.bits = SIGN_BIT | QNAN | (uInt64)(uintptr_t)object;
+	return val;
+}
+#else
 enum valueType {
 	VAL_NUM,
+	VAL_INT,
 	VAL_BOOL,
 	VAL_NIL,
 	VAL_OBJ
@@ -13,6 +92,7 @@ enum valueType {
 
 union valUnion {
 	double num;
+	int32_t integer;
 	bool boolean;
 	obj* object;
 };
@@ -28,18 +108,35 @@ struct Value {
 
 #define IS_BOOL(value)    ((value).type == VAL_BOOL)
 #define IS_NIL(value)     ((value).type == VAL_NIL)
-#define IS_NUMBER(value)  ((value).type == VAL_NUM)
+#define IS_DOUBLE(value)  ((value).type == VAL_NUM)
+#define IS_INT(value)     ((value).type == VAL_INT)
+#define ARE_INTS(a, b)    (IS_INT(a) && IS_INT(b))
+#define IS_NUMBER(value)  (IS_DOUBLE(value) || IS_INT(value))
 #define IS_OBJ(value)     ((value).type == VAL_OBJ)
 
 #define AS_BOOL(value)    ((value).as.boolean)
-#define AS_NUMBER(value)  ((value).as.num)
+#define AS_INT(value)     ((value).as.integer)
+#define AS_NUMBER(value)  valueToNum(value)
 #define AS_OBJ(value)     ((value).as.object)
 
+inline double valueToNum(Value val) {
+	if (IS_DOUBLE(val)) return val.as.num;
+	return AS_INT(val);
+}
+
 
 Value BOOL_VAL(bool boolean);
 Value NIL_VAL();
 Value NUMBER_VAL(double number);   
+Value INT_VAL(int32_t number);
 Value OBJ_VAL(obj* object);
+#endif // NAN_BOXING
+
+//result of integer arithmetic done in 64 bits, stays a integer if it fits, otherwise it's promoted to a double
+inline Value INT_OR_NUMBER_VAL(int64_t number) {
+	if (number >= INT32_MIN && number <= INT32_MAX) return INT_VAL((int32_t)number);
+	return NUMBER_VAL((double)number);
+}
 
 
 bool valuesEqual(Value a, Value b);